@@ -0,0 +1,159 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * The _C_API capsule (see copium_capi.h).
+ *
+ * Registered types live in module_state.registered_types, as {type: None} for atomic ones and
+ * {type: capsule of its copier, or of its buffer allocator} otherwise. classify_route() consults
+ * it, so a registration only costs anything when a type is first classified. Changing it drops
+ * the routes cached for the type by resetting its version tag.
+ */
+
+#ifndef _COPIUM_CAPI_C
+#define _COPIUM_CAPI_C
+
+#include "copium_capi.h"
+#include "_deepcopy.c"
+
+// Whether deepcopy handles instances of tp before it gets to the type's route.
+static int capi_is_reserved(PyTypeObject* tp) {
+    stdlib_resolve_pending();
+    return is_atomic_immutable(tp) || tp == &PyTuple_Type || tp == &PyList_Type ||
+        tp == &PyDict_Type || tp == &PySet_Type || tp == &PyFrozenSet_Type;
+}
+
+static void capi_invalidate(PyTypeObject* tp) {
+    PyType_Modified(tp);
+    // A type without a version tag is never cached: assign it a new one right away.
+    (void)_PyType_Lookup(tp, module_state.s__deepcopy__);
+}
+
+// Steals entry.
+static int capi_register(PyTypeObject* tp, PyObject* entry) {
+    if (!entry)
+        return -1;
+    if (capi_is_reserved(tp)) {
+        PyErr_Format(
+            PyExc_TypeError, "copium copies '%.200s' objects itself", tp->tp_name
+        );
+        Py_DECREF(entry);
+        return -1;
+    }
+    int status = PyDict_SetItem(module_state.registered_types, (PyObject*)tp, entry);
+    Py_DECREF(entry);
+    if (status < 0)
+        return -1;
+    capi_invalidate(tp);
+    return 0;
+}
+
+/*
+ * Registrations come from other extensions, outside of any copium call: they go to the
+ * copium of the calling interpreter.
+ */
+static int capi_register_atomic(PyTypeObject* tp) {
+    ModuleState* state = copium_interp_module_state();
+    if (!state)
+        return -1;
+    ModuleState* outer = copium_enter(state);
+    int status = capi_register(tp, Py_NewRef(Py_None));
+    copium_leave(outer);
+    return status;
+}
+
+static int capi_register_copier(PyTypeObject* tp, copium_copyfunc copier) {
+    if (!copier) {
+        PyErr_SetString(PyExc_ValueError, "copier must not be NULL");
+        return -1;
+    }
+    ModuleState* state = copium_interp_module_state();
+    if (!state)
+        return -1;
+    ModuleState* outer = copium_enter(state);
+    int status = capi_register(tp, PyCapsule_New((void*)copier, COPIUM_COPIER_CAPSULE, NULL));
+    copium_leave(outer);
+    return status;
+}
+
+static int capi_register_buffer(PyTypeObject* tp, copium_bufferallocfunc alloc) {
+    if (!alloc) {
+        PyErr_SetString(PyExc_ValueError, "alloc must not be NULL");
+        return -1;
+    }
+    if (!tp->tp_as_buffer || !tp->tp_as_buffer->bf_getbuffer) {
+        PyErr_Format(PyExc_TypeError, "'%.200s' objects don't export a buffer", tp->tp_name);
+        return -1;
+    }
+    ModuleState* state = copium_interp_module_state();
+    if (!state)
+        return -1;
+    ModuleState* outer = copium_enter(state);
+    int status = capi_register(tp, PyCapsule_New((void*)alloc, COPIUM_BUFFER_CAPSULE, NULL));
+    copium_leave(outer);
+    return status;
+}
+
+static int capi_unregister_impl(PyTypeObject* tp) {
+    PyObject* key = (PyObject*)tp;
+    int found = PyDict_Contains(module_state.registered_types, key);
+    if (found <= 0)
+        return found;
+    if (PyDict_DelItem(module_state.registered_types, key) < 0)
+        return -1;
+    capi_invalidate(tp);
+    return 1;
+}
+
+static int capi_unregister(PyTypeObject* tp) {
+    ModuleState* state = copium_interp_module_state();
+    if (!state)
+        return -1;
+    ModuleState* outer = copium_enter(state);
+    int found = capi_unregister_impl(tp);
+    copium_leave(outer);
+    return found;
+}
+
+static PyObject* capi_deepcopy(PyObject* obj, void* memo_ctx) {
+    return deepcopy(obj, (PyMemoObject*)memo_ctx);
+}
+
+static int capi_memoize(void* memo_ctx, PyObject* original, PyObject* copy) {
+    return memoize((PyMemoObject*)memo_ctx, original, copy, memo_hash_pointer(original));
+}
+
+static PyObject* capi_recall(void* memo_ctx, PyObject* original) {
+    Py_ssize_t hash;
+    return remember((PyMemoObject*)memo_ctx, original, &hash);
+}
+
+static CopiumCAPI capi = {
+    .version = COPIUM_CAPI_VERSION,
+    .register_atomic = capi_register_atomic,
+    .register_copier = capi_register_copier,
+    .unregister = capi_unregister,
+    .deepcopy = capi_deepcopy,
+    .memoize = capi_memoize,
+    .recall = capi_recall,
+    .register_buffer = capi_register_buffer,
+};
+
+static int capi_init(PyObject* module) {
+    module_state.registered_types = PyDict_New();
+    if (!module_state.registered_types)
+        return -1;
+    PyObject* capsule = PyCapsule_New(&capi, "ccopium._C_API", NULL);
+    if (!capsule)
+        return -1;
+    if (PyModule_AddObject(module, "_C_API", capsule) < 0) {
+        Py_DECREF(capsule);
+        return -1;
+    }
+    return 0;
+}
+
+#endif  // _COPIUM_CAPI_C
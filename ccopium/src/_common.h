@@ -67,6 +67,12 @@
     #define MAYBE_INLINE inline
 #endif
 
+#ifdef _MSC_VER
+    #define COPIUM_THREAD_LOCAL __declspec(thread)
+#else
+    #define COPIUM_THREAD_LOCAL _Thread_local
+#endif
+
 #ifdef Py_GIL_DISABLED
     #define COPIUM_Py_BEGIN_CRITICAL_SECTION(op) Py_BEGIN_CRITICAL_SECTION(op)
     #define COPIUM_Py_END_CRITICAL_SECTION() Py_END_CRITICAL_SECTION()
@@ -85,6 +91,12 @@
     #define PyObject_GetOptionalAttr(obj, name, out) _PyObject_LookupAttr((obj), (name), (out))
 #endif
 
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+    #include "structmember.h"
+    #define Py_T_OBJECT_EX T_OBJECT_EX
+    #define Py_READONLY READONLY
+#endif
+
 #if PY_VERSION_HEX >= PY_VERSION_3_13_HEX
     #include "pycore_dict.h"
     #define COPIUM_PyDict_SetItem_Take2(op, key, value) _PyDict_SetItem_Take2(op, key, value)
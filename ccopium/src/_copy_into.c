@@ -0,0 +1,221 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * In-place deep copies (copium.extra.copy_into).
+ *
+ * copy_into(dst, src) turns dst into a deep copy of src, keeping the containers it already has
+ * where they line up with src's. Both are walked together: a list or dict of src found where
+ * dst holds one of the same exact type gets its items overwritten in place, and everything else
+ * goes through deepcopy(). A list is resized to fit. A dict whose keys come in the same order as
+ * src's, all of them atomic, only has its values replaced and so keeps its table; any other one
+ * is cleared and refilled, still reusing the values found under the same keys. Copying a state
+ * of the same shape into the previous copy of it then only allocates for the leaves that are
+ * copied anew.
+ *
+ * The walk shares its memo with deepcopy(): each container of src maps to the one that became
+ * its copy, so references between them keep their shape. A container of dst taken over is
+ * memoized as its own copy too, so one it holds in two places only gets reused for the first. dst must not share
+ * containers with src, and is left half updated if the copy fails.
+ */
+#ifndef _COPIUM_COPY_INTO_C
+#define _COPIUM_COPY_INTO_C
+
+#include "_common.h"
+#include "_state.c"
+#include "_type_checks.c"
+#include "_dict_iter.c"
+#include "_memo.c"
+#include "_deepcopy.c"
+
+static PyObject* copy_into(PyMemoObject* memo, PyObject* dst, PyObject* src);
+
+static int copy_into_list(PyMemoObject* memo, PyObject* dst, PyObject* src) {
+    Py_ssize_t i = 0;
+    for (; i < PyList_GET_SIZE(src); i++) {
+        PyObject* item = COPIUM_PyList_GET_ITEM_REF(src, i);
+        if (!item)
+            return -1;
+        PyObject* old = i < PyList_GET_SIZE(dst) ? COPIUM_PyList_GET_ITEM_REF(dst, i) : NULL;
+        PyObject* copy = old ? copy_into(memo, old, item) : deepcopy(item, memo);
+        Py_DECREF(item);
+        if (!copy) {
+            Py_XDECREF(old);
+            return -1;
+        }
+        int status = 0;
+        if (copy == old)
+            Py_DECREF(copy);
+        else if (i < PyList_GET_SIZE(dst))
+            status = PyList_SetItem(dst, i, copy);
+        else {
+            status = PyList_Append(dst, copy);
+            Py_DECREF(copy);
+        }
+        Py_XDECREF(old);
+        if (status < 0)
+            return -1;
+    }
+    if (PyList_GET_SIZE(dst) > i)
+        return PyList_SetSlice(dst, i, PyList_GET_SIZE(dst), NULL);
+    return 0;
+}
+
+// Whether the key of dst is the one of src, as its deep copy.
+static ALWAYS_INLINE int copy_into_same_key(PyObject* dst_key, PyObject* src_key) {
+    if (!is_atomic_element(src_key))
+        return 0;
+    if (dst_key == src_key)
+        return 1;
+    // Comparing atomics runs no Python code.
+    return Py_TYPE(dst_key) == Py_TYPE(src_key) &&
+           PyObject_RichCompareBool(dst_key, src_key, Py_EQ) == 1;
+}
+
+// Replaces the values of dst if its keys are those of src in the same order. Returns 1 if it
+// did, 0 if the keys differ (dst may have some of its values replaced already), or -1 with an
+// exception set.
+static int copy_into_dict_values(PyMemoObject* memo, PyObject* dst, PyObject* src) {
+    Py_ssize_t size = PyDict_GET_SIZE(src);
+    if (PyDict_GET_SIZE(dst) != size)
+        return 0;
+    DictIterGuard iter;
+    if (dict_iter_init(&iter, src) < 0)
+        return -1;
+    Py_ssize_t dst_pos = 0;
+    PyObject *key, *value, *dst_key, *dst_value;
+    int next;
+    while ((next = dict_iter_next(&iter, &key, &value)) > 0) {
+        int same = PyDict_GET_SIZE(dst) == size &&
+                   PyDict_Next(dst, &dst_pos, &dst_key, &dst_value) &&
+                   copy_into_same_key(dst_key, key);
+        PyObject* copy = NULL;
+        if (same) {
+            Py_INCREF(dst_key);
+            Py_INCREF(dst_value);
+            copy = copy_into(memo, dst_value, value);
+        }
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (!same || !copy) {
+            if (same) {
+                Py_DECREF(dst_key);
+                Py_DECREF(dst_value);
+            }
+#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
+            dict_iter_cleanup(&iter);
+#endif
+            return same ? -1 : 0;
+        }
+        // Replacing the value of a key it holds leaves dst's table as it is.
+        int status = copy == dst_value ? 0 : PyDict_SetItem(dst, dst_key, copy);
+        Py_DECREF(copy);
+        Py_DECREF(dst_key);
+        Py_DECREF(dst_value);
+        if (status < 0) {
+#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
+            dict_iter_cleanup(&iter);
+#endif
+            return -1;
+        }
+    }
+    return next < 0 ? -1 : 1;
+}
+
+static int copy_into_dict(PyMemoObject* memo, PyObject* dst, PyObject* src) {
+    int reused = copy_into_dict_values(memo, dst, src);
+    if (reused != 0)
+        return reused < 0 ? -1 : 0;
+
+    // Values found under an atomic key still get reused for the same key of src.
+    PyObject* old = PyDict_Copy(dst);
+    if (!old)
+        return -1;
+    PyDict_Clear(dst);
+    DictIterGuard iter;
+    if (dict_iter_init(&iter, src) < 0) {
+        Py_DECREF(old);
+        return -1;
+    }
+    PyObject *key, *value;
+    int next;
+    while ((next = dict_iter_next(&iter, &key, &value)) > 0) {
+        PyObject* previous = NULL;
+        PyObject* key_copy;
+        if (is_atomic_element(key)) {
+            previous = PyDict_GetItemWithError(old, key);
+            key_copy = Py_NewRef(key);
+        } else {
+            key_copy = deepcopy(key, memo);
+        }
+        PyObject* value_copy = NULL;
+        if (key_copy && !PyErr_Occurred()) {
+            if (previous) {
+                Py_INCREF(previous);
+                value_copy = copy_into(memo, previous, value);
+                Py_DECREF(previous);
+            } else {
+                value_copy = deepcopy(value, memo);
+            }
+        }
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (!value_copy ||
+            COPIUM_PyDict_SetItem_Take2((PyDictObject*)dst, key_copy, value_copy) < 0) {
+            if (!value_copy)
+                Py_XDECREF(key_copy);
+#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
+            dict_iter_cleanup(&iter);
+#endif
+            Py_DECREF(old);
+            return -1;
+        }
+    }
+    Py_DECREF(old);
+    return next < 0 ? -1 : 0;
+}
+
+// What dst becomes as a deep copy of src: dst itself if it could be reused, a new copy
+// otherwise. Steals nothing; returns a new reference, or NULL with an exception set.
+static PyObject* copy_into(PyMemoObject* memo, PyObject* dst, PyObject* src) {
+    PyTypeObject* type = Py_TYPE(src);
+    if (LIKELY(is_literal_immutable(type)))
+        return Py_NewRef(src);
+    if ((type != &PyList_Type && type != &PyDict_Type) || Py_TYPE(dst) != type || dst == src)
+        return deepcopy(src, memo);
+
+    Py_ssize_t hash;
+    PyObject* memoized = remember(memo, src, &hash);
+    if (memoized)
+        return memoized;
+    // A container of dst taken over already is memoized as its own copy, and so is one of src
+    // copied so far, which dst isn't supposed to hold but mustn't get overwritten either.
+    Py_ssize_t dst_hash = memo_hash_pointer(dst);
+    if (memo_table_lookup_h(memo->table, dst, dst_hash))
+        return deepcopy(src, memo);
+    if (memoize(memo, src, dst, hash) < 0 || memoize(memo, dst, dst, dst_hash) < 0)
+        return NULL;
+
+    if (Py_EnterRecursiveCall(" while copying into an object"))
+        return NULL;
+    int status = type == &PyList_Type ? copy_into_list(memo, dst, src)
+                                      : copy_into_dict(memo, dst, src);
+    Py_LeaveRecursiveCall();
+    return status < 0 ? NULL : Py_NewRef(dst);
+}
+
+// Returns dst made into a deep copy of src, or a new deep copy of src if dst can't be.
+static PyObject* copy_into_root(PyObject* dst, PyObject* src) {
+    int is_tss;
+    PyMemoObject* memo = get_memo(&is_tss);
+    if (!memo)
+        return NULL;
+    PyObject* result = copy_into(memo, dst, src);
+    cleanup_memo(memo, is_tss);
+    return result;
+}
+
+#endif  // _COPIUM_COPY_INTO_C
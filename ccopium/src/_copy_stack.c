@@ -0,0 +1,147 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Work stack of the container traversal in _deepcopy.c
+ *
+ * One frame per list, tuple, dict, set or frozenset whose items are being copied. Frames live
+ * in fixed-size segments that are linked, never reallocated: a frame's address stays put while
+ * it's on the stack, which the 3.14 dict watcher relies on (DictIterGuard is linked into a
+ * global list) and which lets a nested traversal push on top of frames still referenced from C.
+ * The stack belongs to the memo, so the thread's memo keeps its segments between calls.
+ */
+#ifndef _COPIUM_COPY_STACK_C
+#define _COPIUM_COPY_STACK_C
+
+#include "_common.h"
+#include "_dict_iter.c"
+
+#ifndef COPIUM_COPY_FRAMES_PER_SEGMENT
+    #define COPIUM_COPY_FRAMES_PER_SEGMENT 64
+#endif
+#ifndef COPIUM_COPY_STACK_RETAIN_SEGMENTS
+    #define COPIUM_COPY_STACK_RETAIN_SEGMENTS 4 /* 256 levels */
+#endif
+
+typedef enum {
+    COPY_FRAME_LIST,
+    COPY_FRAME_TUPLE,
+    COPY_FRAME_DICT,
+    COPY_FRAME_SET,
+    COPY_FRAME_FROZENSET,
+} CopyFrameKind;
+
+typedef struct {
+    PyObject* original; /* borrowed; whoever pushed the frame keeps it alive */
+    /* list, dict, set: the copy, already in the memo; tuple, frozenset: a tuple of item copies */
+    PyObject* copied;
+    /* set, and list and dict without a GIL: the items, taken before the copy is memoized */
+    PyObject* snapshot;
+    PyObject* pending;  /* list item, dict key or value (frozenset item, borrowed) being copied */
+    PyObject* key_copy; /* dict: copy of the key whose value is being copied */
+    PyObject* value;    /* dict: value of that key, copied next */
+    Py_ssize_t hash;    /* memo hash of original, or MEMO_HASH_DEFERRED */
+    Py_ssize_t index;
+    Py_ssize_t size;
+    /* frozenset: iteration position; cloned dict: see dict_clone_replace(); list without a GIL:
+       index of the snapshot's first item */
+    Py_ssize_t pos;
+    DictIterGuard iter;
+    unsigned char kind;
+    unsigned char all_same;  /* tuple, frozenset: no item copy differed from its original yet */
+    unsigned char iter_live; /* dict: iter still has to be cleaned up */
+    unsigned char clone;     /* dict: copied started as PyDict_Copy(original), see _dict_clone.c */
+    unsigned char records;   /* list: its dicts are taken as records, until one isn't one */
+} CopyFrame;
+
+typedef struct CopyFrameSegment {
+    struct CopyFrameSegment* prev;
+    struct CopyFrameSegment* next;
+    CopyFrame frames[COPIUM_COPY_FRAMES_PER_SEGMENT];
+} CopyFrameSegment;
+
+typedef struct {
+    CopyFrameSegment* first;
+    CopyFrameSegment* segment; /* the one holding top */
+    CopyFrame* top;            /* NULL when empty */
+} CopyStack;
+
+static void copy_stack_init(CopyStack* stack) {
+    stack->first = NULL;
+    stack->segment = NULL;
+    stack->top = NULL;
+}
+
+static CopyFrameSegment* copy_stack_segment_new(CopyFrameSegment* prev) {
+    CopyFrameSegment* segment = (CopyFrameSegment*)PyMem_Malloc(sizeof(CopyFrameSegment));
+    if (!segment) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    segment->prev = prev;
+    segment->next = NULL;
+    return segment;
+}
+
+static CopyFrame* copy_stack_push_segment(CopyStack* stack) {
+    CopyFrameSegment* segment;
+    if (!stack->top) {
+        if (!stack->first && !(stack->first = copy_stack_segment_new(NULL)))
+            return NULL;
+        segment = stack->first;
+    } else {
+        segment = stack->segment->next;
+        if (!segment) {
+            segment = copy_stack_segment_new(stack->segment);
+            if (!segment)
+                return NULL;
+            stack->segment->next = segment;
+        }
+    }
+    stack->segment = segment;
+    return stack->top = &segment->frames[0];
+}
+
+/* New uninitialized top frame, or NULL with MemoryError set. */
+static ALWAYS_INLINE CopyFrame* copy_stack_push(CopyStack* stack) {
+    CopyFrame* top = stack->top;
+    if (LIKELY(top && top != &stack->segment->frames[COPIUM_COPY_FRAMES_PER_SEGMENT - 1]))
+        return stack->top = top + 1;
+    return copy_stack_push_segment(stack);
+}
+
+static ALWAYS_INLINE void copy_stack_pop(CopyStack* stack) {
+    CopyFrame* top = stack->top;
+    if (LIKELY(top != &stack->segment->frames[0])) {
+        stack->top = top - 1;
+        return;
+    }
+    stack->segment = stack->segment->prev;
+    stack->top = stack->segment ? &stack->segment->frames[COPIUM_COPY_FRAMES_PER_SEGMENT - 1]
+                                : NULL;
+}
+
+/* Free all but the first `keep` segments. Only called with the stack empty. */
+static void copy_stack_shrink_to(CopyStack* stack, Py_ssize_t keep) {
+    assert(stack->top == NULL);
+    CopyFrameSegment** link = &stack->first;
+    for (Py_ssize_t i = 0; i < keep && *link; i++)
+        link = &(*link)->next;
+    CopyFrameSegment* segment = *link;
+    *link = NULL;
+    while (segment) {
+        CopyFrameSegment* next = segment->next;
+        PyMem_Free(segment);
+        segment = next;
+    }
+}
+
+static void copy_stack_free(CopyStack* stack) {
+    copy_stack_shrink_to(stack, 0);
+    stack->segment = NULL;
+}
+
+#endif  // _COPIUM_COPY_STACK_C
@@ -9,10 +9,15 @@
 
 #include "_memo.c"
 #include "_dict_iter.c"
+#include "_dict_clone.c"
 #include "_type_checks.c"
 #include "_recursion_guard.c"
 #include "_reduce_helpers.c"
+#include "_type_cache.c"
+#include "_shared_types.c"
 #include "_fallback.c"
+#include "_slow_copy.c"
+#include "copium_capi.h"
 
 #include "object.h"
 
@@ -21,21 +26,12 @@
 #endif
 
 static ALWAYS_INLINE PyObject* deepcopy(PyObject* original, PyMemoObject* memo);
-
-static MAYBE_INLINE PyObject* deepcopy_list(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
-);
-static MAYBE_INLINE PyObject* deepcopy_tuple(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
-);
-static MAYBE_INLINE PyObject* deepcopy_dict(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
+static ALWAYS_INLINE PyObject* deepcopy_unmemoized(
+    PyObject* original, PyTypeObject* type, PyMemoObject* memo, Py_ssize_t memo_key_hash
 );
-static MAYBE_INLINE PyObject* deepcopy_set(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
-);
-static MAYBE_INLINE PyObject* deepcopy_frozenset(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
+
+static PyObject* deepcopy_containers(
+    PyObject* original, PyTypeObject* type, PyMemoObject* memo, Py_ssize_t memo_key_hash
 );
 static MAYBE_INLINE PyObject* deepcopy_bytearray(
     PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
@@ -43,156 +39,1238 @@ static MAYBE_INLINE PyObject* deepcopy_bytearray(
 static MAYBE_INLINE PyObject* deepcopy_method(
     PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
 );
+static PyObject* deepcopy_collection(
+    PyObject* original, PyTypeObject* tp, PyMemoObject* memo, Py_ssize_t memo_key_hash
+);
 static MAYBE_INLINE PyObject* deepcopy_custom(
     PyObject* original, PyObject* __deepcopy__, PyMemoObject* memo, Py_ssize_t memo_key_hash
 );
+static PyObject* deepcopy_custom_unbound(
+    PyObject* original, PyObject* __deepcopy__, PyMemoObject* memo, Py_ssize_t memo_key_hash
+);
 static PyObject* deepcopy_object(
     PyObject* original, PyTypeObject* tp, PyMemoObject* memo, Py_ssize_t memo_key_hash
 );
+static PyObject* deepcopy_registered(
+    PyObject* original, PyObject* copier, PyMemoObject* memo, Py_ssize_t memo_key_hash
+);
+static PyObject* deepcopy_buffer(
+    PyObject* original, PyObject* __copy__, PyMemoObject* memo, Py_ssize_t memo_key_hash
+);
+static int exported_flat_buffer(PyObject* original, Py_buffer* view);
+static PyObject* deepcopy_exported_buffer(
+    PyObject* original, PyObject* registered, Py_buffer* view, PyMemoObject* memo,
+    Py_ssize_t memo_key_hash
+);
+static int keeps_builtin_reduce(PyTypeObject* tp, PyObject** getnewargs);
+static PyObject* deepcopy_subclass(
+    PyObject* original, PyTypeObject* tp, PyObject* getnewargs, PyMemoObject* memo,
+    Py_ssize_t memo_key_hash
+);
+
+// Names of the capsules that hold the copiers and buffer allocators in
+// module_state.registered_types.
+#define COPIUM_COPIER_CAPSULE "ccopium.copier"
+#define COPIUM_BUFFER_CAPSULE "ccopium.buffer"
+
+// Decides how instances of tp are copied once they got past the exact builtin containers.
+// Everything derived here only depends on the type, so the result is cached per tp_version_tag.
+static CopyRoute classify_route(PyTypeObject* tp, PyObject** deepcopy) {
+    *deepcopy = NULL;
+    stdlib_resolve_pending();
+    if (UNLIKELY(PyDict_GET_SIZE(module_state.registered_types))) {
+        PyObject* registered = PyDict_GetItemWithError(module_state.registered_types, (PyObject*)tp);
+        PyErr_Clear();
+        if (registered == Py_None)
+            return ROUTE_ATOMIC;
+        if (registered) {
+            *deepcopy = registered;
+            return ROUTE_REGISTERED;
+        }
+    }
+    if (is_builtin_immutable(tp) || is_class(tp) || is_stdlib_immutable(tp))
+        return ROUTE_ATOMIC;
+    if (is_configured_atomic(tp))
+        return ROUTE_ATOMIC;
+    if (tp == &PyFrozenSet_Type || tp == &PyByteArray_Type || tp == &PyMethod_Type)
+        return ROUTE_NATIVE;
+    // These check copyreg.dispatch_table on each copy: a reductor can be registered after a
+    // first copy classified the type.
+    if (is_stdlib_container(tp))
+        return ROUTE_NATIVE;
+    if (is_stdlib_value(tp))
+        return ROUTE_STDLIB;
+    if (is_enum_member_type(tp))
+        return ROUTE_ATOMIC;
+    if (is_stdlib_tzinfo_holder(tp))
+        return ROUTE_TZINFO;
+    if (is_stdlib_buffer(tp)) {
+        *deepcopy = _PyType_Lookup(tp, module_state.s__copy__);
+        if (*deepcopy)
+            return ROUTE_BUFFER;
+    }
+    // Instance attribute lookup only mirrors the type's MRO with the stock getattro.
+    if (tp->tp_getattro != PyObject_GenericGetAttr)
+        return ROUTE_LOOKUP;
+
+    PyObject* found = _PyType_Lookup(tp, module_state.s__deepcopy__);
+    if (!found)
+        return keeps_builtin_reduce(tp, deepcopy) ? ROUTE_SUBCLASS : ROUTE_REDUCE;
+    // A plain function binds to obj and nothing else, so calling it with (obj, memo) is exactly
+    // what the bound method would do.
+    if (Py_IS_TYPE(found, &PyFunction_Type)) {
+        *deepcopy = found;
+        return ROUTE_CUSTOM;
+    }
+    // So does a C method of a class tp derives from, e.g. a __deepcopy__ written in an extension.
+    if (Py_IS_TYPE(found, &PyMethodDescr_Type) &&
+        PyType_IsSubtype(tp, PyDescr_TYPE((PyMethodDescrObject*)found))) {
+        *deepcopy = found;
+        return ROUTE_CUSTOM;
+    }
+    return ROUTE_LOOKUP;
+}
+
+#ifdef Py_GIL_DISABLED
+// Whether *object, which tp's route borrowed, is still what tp looks it up as. It's replaced
+// by a new reference if so, and by NULL if not.
+static int route_object_acquire(PyTypeObject* tp, CopyRoute route, PyObject** object) {
+    PyObject* cached = *object;
+    PyObject* found = NULL;
+    *object = NULL;
+    switch (route) {
+        case ROUTE_REGISTERED:
+            if (PyDict_GetItemRef(module_state.registered_types, (PyObject*)tp, &found) < 0)
+                PyErr_Clear();
+            break;
+        case ROUTE_BUFFER:
+            found = _PyType_LookupRef(tp, module_state.s__copy__);
+            break;
+        case ROUTE_CUSTOM:
+            found = _PyType_LookupRef(tp, module_state.s__deepcopy__);
+            break;
+        case ROUTE_SUBCLASS:
+            found = _PyType_LookupRef(tp, module_state.s__getnewargs__);
+            if (found != cached) {
+                // Or the function of the __new__ namedtuple() generated, see
+                // keeps_builtin_reduce().
+                Py_XDECREF(found);
+                PyObject* descr = _PyType_LookupRef(tp, module_state.s__new__);
+                found = descr && Py_IS_TYPE(descr, &PyStaticMethod_Type)
+                    ? PyObject_GetAttrString(descr, "__func__")
+                    : NULL;
+                PyErr_Clear();
+                Py_XDECREF(descr);
+            }
+            break;
+        default:
+            *object = Py_NewRef(cached);
+            return 1;
+    }
+    if (found == cached) {
+        *object = found;
+        return 1;
+    }
+    Py_XDECREF(found);
+    return 0;
+}
+#endif
+
+/*
+ * The route for instances of tp, and in *object what it copies them with, see
+ * type_cache_route(). That's borrowed from the type: with the GIL, nothing can replace it
+ * before it's used. Without the GIL, another thread can replace the attribute it was looked up
+ * as and free it at any time, so there it's a new reference, looked up again to check the cached
+ * one is still current. route_object_release() gives it back.
+ */
+static ALWAYS_INLINE CopyRoute route_of(PyTypeObject* tp, PyObject** object) {
+    CopyRoute route = type_cache_route(tp, object);
+    if (UNLIKELY(route == ROUTE_UNKNOWN)) {
+        route = classify_route(tp, object);
+        type_cache_set_route(tp, route, *object);
+    }
+#ifdef Py_GIL_DISABLED
+    if (*object && UNLIKELY(!route_object_acquire(tp, route, object))) {
+        // Replaced since: the version tag changed with it, so classify anew. Should it get
+        // replaced once more in between, look it up on the instance.
+        route = classify_route(tp, object);
+        type_cache_set_route(tp, route, *object);
+        if (*object && !route_object_acquire(tp, route, object))
+            return ROUTE_LOOKUP;
+    }
+#endif
+    return route;
+}
+
+static ALWAYS_INLINE void route_object_release(PyObject* object) {
+#ifdef Py_GIL_DISABLED
+    Py_XDECREF(object);
+#else
+    (void)object;
+#endif
+}
+
+// Whether the tzinfo of a datetime or time, if any, leaves it its own deep copy.
+static int tzinfo_is_atomic(PyObject* obj) {
+    PyObject* tzinfo = PyObject_GetAttr(obj, module_state.s_tzinfo);
+    if (!tzinfo)
+        return -1;
+    int atomic = 1;
+    if (tzinfo != Py_None) {
+        PyTypeObject* tp = Py_TYPE(tzinfo);
+        PyObject* unused;
+        CopyRoute route = type_cache_route(tp, &unused);
+        if (route == ROUTE_UNKNOWN) {
+            route = classify_route(tp, &unused);
+            type_cache_set_route(tp, route, unused);
+        }
+        atomic = route == ROUTE_ATOMIC || (route == ROUTE_STDLIB && !has_registered_reductor(tp));
+    }
+    Py_DECREF(tzinfo);
+    return atomic;
+}
+
+#if PY_VERSION_HEX >= PY_VERSION_3_11_HEX && !defined(Py_GIL_DISABLED)
+// The managed dict of obj if it has been materialized, without materializing it. Otherwise,
+// *values tells whether its attributes are kept inline, as values for its type's shared keys.
+static ALWAYS_INLINE PyObject* managed_dict_peek(PyObject* obj, PyTypeObject* tp, int* values) {
+    #if PY_VERSION_HEX >= PY_VERSION_3_13_HEX
+    PyObject* dict = (PyObject*)_PyObject_GetManagedDict(obj);
+    *values = !dict && PyType_HasFeature(tp, Py_TPFLAGS_INLINE_VALUES) &&
+        _PyObject_InlineValues(obj)->valid;
+    return dict;
+    #elif PY_VERSION_HEX >= PY_VERSION_3_12_HEX
+    (void)tp;
+    PyDictOrValues dorv = *_PyObject_DictOrValuesPointer(obj);
+    *values = _PyDictOrValues_IsValues(dorv);
+    return *values ? NULL : _PyDictOrValues_GetDict(dorv);
+    #else
+    (void)tp;
+    *values = *_PyObject_ValuesPointer(obj) != NULL;
+    return *_PyObject_ManagedDictPointer(obj);
+    #endif
+}
+
+// Whether the shared keys of tp's instances have name among them, whether or not a given
+// instance has a value for it. Names set through setattr() are interned; object.__setattr__()
+// takes them as they are.
+static int shared_keys_contain(PyTypeObject* tp, PyObject* name) {
+    PyDictKeysObject* keys = ((PyHeapTypeObject*)tp)->ht_cached_keys;
+    if (!keys)
+        return 1;
+    PyDictUnicodeEntry* entries = DK_UNICODE_ENTRIES(keys);
+    for (Py_ssize_t i = 0; i < keys->dk_nentries; i++) {
+        PyObject* key = entries[i].me_key;
+        if (key == name ||
+            (key && !PyUnicode_CHECK_INTERNED(key) && PyUnicode_Compare(key, name) == 0))
+            return 1;
+    }
+    return 0;
+}
+#endif
+
+// Whether obj resolves __deepcopy__ the way its type's cached route says, i.e. its instance
+// __dict__ doesn't shadow the type with its own __deepcopy__. A managed dict (3.11+) is only
+// looked into once it's there: attributes kept inline can't be named __deepcopy__ unless the
+// shared keys have it. Free-threaded builds can't read those without locking, so there it's
+// materialized when the caller is about to read the dict anyway; otherwise report 0 and let the
+// caller fall back to the attribute lookup.
+static int instance_follows_type(PyObject* obj, PyTypeObject* tp, int reads_dict) {
+    if (tp->tp_dictoffset == 0)
+        return 1;
+#if PY_VERSION_HEX >= PY_VERSION_3_11_HEX
+    if (PyType_HasFeature(tp, Py_TPFLAGS_MANAGED_DICT)) {
+    #ifndef Py_GIL_DISABLED
+        (void)reads_dict;
+        int values;
+        PyObject* dict = managed_dict_peek(obj, tp, &values);
+        if (dict)
+            return !PyDict_Contains(dict, module_state.s__deepcopy__);
+        return !values || !shared_keys_contain(tp, module_state.s__deepcopy__);
+    #else
+        if (!reads_dict)
+            return 0;
+    #endif
+    }
+#else
+    (void)reads_dict;
+#endif
+    PyObject** dictptr = _PyObject_GetDictPtr(obj);
+    if (!dictptr || !*dictptr)
+        return 1;
+    return !PyDict_Contains(*dictptr, module_state.s__deepcopy__);
+}
 
 static ALWAYS_INLINE PyObject* deepcopy(PyObject* original, PyMemoObject* memo) {
     assert(memo != NULL && "deepcopy: memo must not be NULL");
 
     PyTypeObject* type = Py_TYPE(original);
 
-    if (LIKELY(is_literal_immutable(type)))
+    if (LIKELY(is_literal_immutable(type))) {
+        COPIUM_STAT(prememo_atomic);
         return Py_NewRef(original);
+    }
 
     Py_ssize_t memo_key_hash;
     PyObject* memoized = remember(memo, original, &memo_key_hash);
-    if (memoized)
+    if (memoized) {
+        COPIUM_STAT(memo_hit);
         return memoized;
+    }
 
-    if (type == &PyTuple_Type)
-        return RECURSION_GUARDED(deepcopy_tuple(original, memo, memo_key_hash));
-    if (type == &PyDict_Type)
-        return RECURSION_GUARDED(deepcopy_dict(original, memo, memo_key_hash));
-    if (type == &PyList_Type)
-        return RECURSION_GUARDED(deepcopy_list(original, memo, memo_key_hash));
-    if (type == &PySet_Type)
-        return RECURSION_GUARDED(deepcopy_set(original, memo, memo_key_hash));
-
-    if (is_builtin_immutable(type) || is_class(type))
-        return Py_NewRef(original);
+#if COPIUM_PARALLEL_DEEPCOPY
+    if (UNLIKELY(memo->shared))
+        return memo_settle(
+            memo, original, deepcopy_unmemoized(original, type, memo, memo_key_hash)
+        );
+#endif
+    return deepcopy_unmemoized(original, type, memo, memo_key_hash);
+}
 
-    if (type == &PyFrozenSet_Type)
-        return RECURSION_GUARDED(deepcopy_frozenset(original, memo, memo_key_hash));
-    if (type == &PyByteArray_Type)
-        return deepcopy_bytearray(original, memo, memo_key_hash);
-    if (type == &PyMethod_Type)
-        return deepcopy_method(original, memo, memo_key_hash);
+// Everything deepcopy() does once original turned out not to be in the memo.
+static ALWAYS_INLINE PyObject* deepcopy_unmemoized(
+    PyObject* original, PyTypeObject* type, PyMemoObject* memo, Py_ssize_t memo_key_hash
+) {
+    if (type == &PyTuple_Type || type == &PyDict_Type || type == &PyList_Type ||
+        type == &PySet_Type)
+        return RECURSION_GUARDED(deepcopy_containers(original, type, memo, memo_key_hash));
 
-    if (is_stdlib_immutable(type))
+    // deepcopy(x, share=...)
+    if (is_shared_by_call(type)) {
+        COPIUM_STAT(atomic);
         return Py_NewRef(original);
+    }
+
+    PyObject* __deepcopy__;
+    CopyRoute route = route_of(type, &__deepcopy__);
+    PyObject* copied;
+
+    switch (route) {
+        case ROUTE_ATOMIC:
+            COPIUM_STAT(atomic);
+            return Py_NewRef(original);
+        case ROUTE_NATIVE:
+            if (type == &PyFrozenSet_Type)
+                return RECURSION_GUARDED(
+                    deepcopy_containers(original, type, memo, memo_key_hash)
+                );
+            if (type == &PyByteArray_Type)
+                return deepcopy_bytearray(original, memo, memo_key_hash);
+            if (type == &PyMethod_Type)
+                return deepcopy_method(original, memo, memo_key_hash);
+            if (has_registered_reductor(type))
+                return SLOW_COPY_ROUTE(deepcopy_object(original, type, memo, memo_key_hash));
+            if (instance_follows_type(original, type, 1))
+                return RECURSION_GUARDED(
+                    deepcopy_collection(original, type, memo, memo_key_hash)
+                );
+            break;
+        case ROUTE_STDLIB:
+            if (has_registered_reductor(type))
+                return SLOW_COPY_ROUTE(deepcopy_object(original, type, memo, memo_key_hash));
+            COPIUM_STAT(atomic);
+            return Py_NewRef(original);
+        case ROUTE_TZINFO: {
+            if (has_registered_reductor(type))
+                return SLOW_COPY_ROUTE(deepcopy_object(original, type, memo, memo_key_hash));
+            int atomic = tzinfo_is_atomic(original);
+            if (atomic < 0)
+                return NULL;
+            if (atomic) {
+                COPIUM_STAT(atomic);
+                return Py_NewRef(original);
+            }
+            return SLOW_COPY_ROUTE(deepcopy_object(original, type, memo, memo_key_hash));
+        }
+        case ROUTE_REGISTERED:
+            if (PyCapsule_IsValid(__deepcopy__, COPIUM_BUFFER_CAPSULE)) {
+                Py_buffer view;
+                int flat = exported_flat_buffer(original, &view);
+                copied = NULL;
+                if (flat)
+                    copied = deepcopy_exported_buffer(
+                        original, __deepcopy__, &view, memo, memo_key_hash
+                    );
+                route_object_release(__deepcopy__);
+                if (flat)
+                    return copied;
+                // Objects or strides in it: copied as if it weren't registered.
+                break;
+            }
+            copied = RECURSION_GUARDED(
+                deepcopy_registered(original, __deepcopy__, memo, memo_key_hash)
+            );
+            route_object_release(__deepcopy__);
+            return copied;
+        case ROUTE_BUFFER:
+            if (has_registered_reductor(type)) {
+                route_object_release(__deepcopy__);
+                return SLOW_COPY_ROUTE(deepcopy_object(original, type, memo, memo_key_hash));
+            }
+            copied = deepcopy_buffer(original, __deepcopy__, memo, memo_key_hash);
+            route_object_release(__deepcopy__);
+            return copied;
+        case ROUTE_SUBCLASS:
+            if (instance_follows_type(original, type, 1)) {
+                copied = RECURSION_GUARDED(
+                    deepcopy_subclass(original, type, __deepcopy__, memo, memo_key_hash)
+                );
+                route_object_release(__deepcopy__);
+                return copied;
+            }
+            route_object_release(__deepcopy__);
+            break;
+        case ROUTE_CUSTOM:
+            if (instance_follows_type(original, type, 0)) {
+                copied = SLOW_COPY_ROUTE(
+                    deepcopy_custom_unbound(original, __deepcopy__, memo, memo_key_hash)
+                );
+                route_object_release(__deepcopy__);
+                return copied;
+            }
+            route_object_release(__deepcopy__);
+            break;
+        case ROUTE_REDUCE:
+            if (instance_follows_type(
+                    original, type, type_cache_reduce_plan(type) >= REDUCE_PLAN_NEWOBJ_DICT
+                ))
+                return SLOW_COPY_ROUTE(deepcopy_object(original, type, memo, memo_key_hash));
+            break;
+        default:
+            break;
+    }
 
-    PyObject* __deepcopy__ = NULL;
+    // A __getattr__ may run from here on, see memo_expose().
+    if (memo_expose(memo) < 0)
+        return NULL;
+    __deepcopy__ = NULL;
     int has_deepcopy = PyObject_GetOptionalAttr(
         original, module_state.s__deepcopy__, &__deepcopy__
     );
     if (has_deepcopy < 0)
         return NULL;
     if (has_deepcopy)
-        return deepcopy_custom(original, __deepcopy__, memo, memo_key_hash);
+        return SLOW_COPY_ROUTE(deepcopy_custom(original, __deepcopy__, memo, memo_key_hash));
 
-    return deepcopy_object(original, type, memo, memo_key_hash);
+    return SLOW_COPY_ROUTE(deepcopy_object(original, type, memo, memo_key_hash));
 }
 
-static MAYBE_INLINE PyObject* deepcopy_list(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
-) {
-    Py_ssize_t sz = PyList_GET_SIZE(original);
+/*
+ * Container traversal.
+ *
+ * Exact lists, tuples, dicts, sets and frozensets are copied without recursing: each one gets a
+ * frame on memo->stack (see _copy_stack.c) that tracks how far its items got, and a container
+ * found among them is pushed on top and finished before its parent goes on. How deep such a
+ * graph can go is only bounded by memory. Any other item goes through deepcopy_unmemoized() as
+ * before, so the reduce and __deepcopy__ routes still recurse, and each traversal they start
+ * counts as one level for the recursion guard.
+ */
 
-    PyObject* copied = PyList_New(sz);
-    if (!copied)
-        return NULL;
+static ALWAYS_INLINE int is_traversed_container(PyTypeObject* type) {
+    return type == &PyList_Type || type == &PyDict_Type || type == &PyTuple_Type ||
+           type == &PySet_Type || type == &PyFrozenSet_Type;
+}
 
-    // Once we put list in memo, Python will be able access its items,
-    // which will lead to segfault if we won't override NULL pointers
-    // with valid PyObjects. Still this is much faster than using PyList_Append.
-    for (Py_ssize_t i = 0; i < sz; i++) {
-#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
-        Py_INCREF(Py_Ellipsis);
+// Whether item, of which the caller knows of `held` references (the container's own plus the
+// ones it took), can't come up again while its container is copied. Its memo lookup and insert
+// are then elided (see memo_defer()). Free-threaded builds don't get a stable refcount to
+// reason about.
+static ALWAYS_INLINE int copy_item_deferrable(
+    PyObject* item, PyTypeObject* type, PyMemoObject* memo, Py_ssize_t held
+) {
+#ifndef Py_GIL_DISABLED
+    return Py_REFCNT(item) == held && memo->defer_unique &&
+           (type == &PyList_Type || type == &PyDict_Type || type == &PyTuple_Type ||
+            type == &PySet_Type);
+#else
+    (void)item;
+    (void)type;
+    (void)memo;
+    (void)held;
+    return 0;
 #endif
-        PyList_SET_ITEM(copied, i, Py_Ellipsis);
+}
+
+// How many of the n items lead with a literal immutable, i.e. are their own deep copies.
+// Types are checked four at a time, so that a long run of them costs a branch per four.
+static ALWAYS_INLINE Py_ssize_t atomic_prefix(PyObject* const* items, Py_ssize_t n) {
+    Py_ssize_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        int all = is_literal_immutable(Py_TYPE(items[i])) &
+                  is_literal_immutable(Py_TYPE(items[i + 1])) &
+                  is_literal_immutable(Py_TYPE(items[i + 2])) &
+                  is_literal_immutable(Py_TYPE(items[i + 3]));
+        if (!all)
+            break;
     }
-    if (memoize(memo, original, copied, memo_key_hash) < 0) {
-        Py_DECREF(copied);
-        return NULL;
+    while (i < n && is_literal_immutable(Py_TYPE(items[i])))
+        i++;
+    return i;
+}
+
+// Whether a set element is its own deep copy: a literal immutable, or a tuple of them.
+static ALWAYS_INLINE int is_atomic_element(PyObject* item) {
+    PyTypeObject* type = Py_TYPE(item);
+    if (is_literal_immutable(type))
+        return 1;
+    if (type != &PyTuple_Type)
+        return 0;
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(item); i++) {
+        if (!is_literal_immutable(Py_TYPE(PyTuple_GET_ITEM(item, i))))
+            return 0;
     }
+    return 1;
+}
 
-    for (Py_ssize_t i = 0; i < sz; i++) {
-        PyObject* item = COPIUM_PyList_GET_ITEM_REF(original, i);
-        if (UNLIKELY(item == NULL)) {
-            PyErr_SetString(PyExc_RuntimeError, "list changed size during iteration");
-            goto error;
+/*
+ * Without a GIL, a list or dict is read in one critical section when its frame starts: the items
+ * its frame goes on to copy are a snapshot taken there, like a set's. Its size is still checked
+ * along the way, as iterating over it would, so that growing or shrinking it under the copy
+ * raises. Its copy is filled without locking for as long as nothing but the memo leads to it
+ * and no Python code has got the memo (memo->defer_unique); from then on, another thread could
+ * be at it too.
+ */
+#ifdef Py_GIL_DISABLED
+// Items of dict as a (key, value, key, value, ...) tuple.
+static PyObject* dict_snapshot(PyObject* dict) {
+    PyObject* snapshot;
+    Py_BEGIN_CRITICAL_SECTION(dict);
+    snapshot = PyTuple_New(2 * PyDict_GET_SIZE(dict));
+    if (snapshot) {
+        Py_ssize_t pos = 0, i = 0;
+        PyObject *key, *value;
+        while (PyDict_Next(dict, &pos, &key, &value)) {
+            PyTuple_SET_ITEM(snapshot, i++, Py_NewRef(key));
+            PyTuple_SET_ITEM(snapshot, i++, Py_NewRef(value));
         }
+    }
+    Py_END_CRITICAL_SECTION();
+    return snapshot;
+}
+#endif
 
-        Py_SETREF(item, deepcopy(item, memo));
-
-        if (!item)
-            goto error;
+static ALWAYS_INLINE int set_items_all_atomic(PyObject* set) {
+    Py_ssize_t pos = 0;
+    PyObject* item;
+    Py_hash_t item_hash;
+    while (_PySet_NextEntry(set, &pos, &item, &item_hash)) {
+        if (!is_atomic_element(item))
+            return 0;
+    }
+    return 1;
+}
 
-        // Though highly unlikely, since we're exposing list in memo, it theoretically could change.
-        int size_changed = 0;
-        COPIUM_Py_BEGIN_CRITICAL_SECTION(copied);
-        if (UNLIKELY(PyList_GET_SIZE(copied) != sz)) {
-            size_changed = 1;
-        } else {
+// Sets frame up to copy original. Lists, dicts and sets are memoized before their items are
+// copied, so that the items can refer back to them; tuples and frozensets once they're built.
+// Returns 0 with the frame set up, 1 if original's copy needed no traversal (it's in
+// frame->copied, memoized as needed), or -1 with an exception set.
+//
+// Atomic items that a list or tuple leads with are taken in one go. A tuple of nothing else is
+// returned as is, and such a list needs no traversal. A set or frozenset of atomic elements
+// neither: its copy is the same elements in the same table. PySet_New() clones that table with
+// the stored hashes instead of hashing and probing each element again, and a frozenset is
+// returned as is.
+static int copy_frame_start(
+    CopyFrame* frame, PyObject* original, PyTypeObject* type, PyMemoObject* memo, Py_ssize_t hash
+) {
+    frame->original = original;
+    frame->hash = hash;
+    frame->index = 0;
+    frame->pending = NULL;
+
+    if (type == &PyList_Type) {
+        COPIUM_STAT(list);
+        Py_ssize_t sz = PyList_GET_SIZE(original);
+        PyObject* copied = PyList_New(sz);
+        if (!copied)
+            return -1;
+        PyObject** items = ((PyListObject*)copied)->ob_item;
+        Py_ssize_t atomic;
+#ifdef Py_GIL_DISABLED
+        PyObject* snapshot = NULL;
+#endif
+        COPIUM_Py_BEGIN_CRITICAL_SECTION(original);
+        PyObject** source = ((PyListObject*)original)->ob_item;
+        Py_ssize_t n = Py_MIN(sz, PyList_GET_SIZE(original));
+        atomic = atomic_prefix(source, n);
+        memcpy(items, source, (size_t)atomic * sizeof(PyObject*));
+        for (Py_ssize_t i = 0; i < atomic; i++)
+            Py_INCREF(items[i]);
+#ifdef Py_GIL_DISABLED
+        if (atomic < sz) {
+            snapshot = PyTuple_New(n - atomic);
+            for (Py_ssize_t i = atomic; snapshot && i < n; i++)
+                PyTuple_SET_ITEM(snapshot, i - atomic, Py_NewRef(source[i]));
+        }
+#endif
+        COPIUM_Py_END_CRITICAL_SECTION();
+#ifdef Py_GIL_DISABLED
+        if (UNLIKELY(atomic < sz && !snapshot)) {
+            Py_DECREF(copied);
+            return -1;
+        }
+#endif
+        // Once we put list in memo, Python will be able access its items,
+        // which will lead to segfault if we won't override NULL pointers
+        // with valid PyObjects. Still this is much faster than using PyList_Append.
+        for (Py_ssize_t i = atomic; i < sz; i++) {
 #if PY_VERSION_HEX < PY_VERSION_3_12_HEX
-            PyList_SetItem(copied, i, item);
+            Py_INCREF(Py_Ellipsis);
+#endif
+            PyList_SET_ITEM(copied, i, Py_Ellipsis);
+        }
+        if (memoize(memo, original, copied, hash) < 0) {
+#ifdef Py_GIL_DISABLED
+            Py_XDECREF(snapshot);
+#endif
+            Py_DECREF(copied);
+            return -1;
+        }
+        frame->copied = copied;
+        if (atomic == sz)
+            return 1;
+        frame->kind = COPY_FRAME_LIST;
+        frame->size = sz;
+        frame->index = atomic;
+        frame->records = 1;
+#ifdef Py_GIL_DISABLED
+        frame->snapshot = snapshot;
+        frame->pos = atomic;
+#endif
+        return 0;
+    }
+
+    if (type == &PyTuple_Type) {
+        COPIUM_STAT(tuple);
+        Py_ssize_t sz = PyTuple_GET_SIZE(original);
+        PyObject** source = ((PyTupleObject*)original)->ob_item;
+        Py_ssize_t atomic = atomic_prefix(source, sz);
+        if (atomic == sz) {
+            frame->copied = Py_NewRef(original);
+            return 1;
+        }
+        PyObject* copied = PyTuple_New(sz);
+        if (!copied)
+            return -1;
+        for (Py_ssize_t i = 0; i < atomic; i++)
+            PyTuple_SET_ITEM(copied, i, Py_NewRef(source[i]));
+        frame->kind = COPY_FRAME_TUPLE;
+        frame->copied = copied;
+        frame->size = sz;
+        frame->index = atomic;
+        frame->all_same = 1;
+        return 0;
+    }
+
+    if (type == &PyDict_Type) {
+        COPIUM_STAT(dict);
+#if COPIUM_DICT_CLONE
+        frame->clone = (unsigned char)dict_keys_all_atomic(original);
+#else
+        frame->clone = 0;
+#endif
+#ifdef Py_GIL_DISABLED
+        PyObject* snapshot = dict_snapshot(original);
+        if (!snapshot)
+            return -1;
+        Py_ssize_t sz = PyTuple_GET_SIZE(snapshot) / 2;
+        PyObject* copied = _PyDict_NewPresized(sz);
+        if (!copied) {
+            Py_DECREF(snapshot);
+            return -1;
+        }
+        if (memoize(memo, original, copied, hash) < 0) {
+            Py_DECREF(snapshot);
+            Py_DECREF(copied);
+            return -1;
+        }
+        frame->snapshot = snapshot;
+        frame->size = sz;
+        frame->iter_live = 0;
 #else
-            PyList_SET_ITEM(copied, i, item);
+        PyObject* copied = frame->clone ? PyDict_Copy(original)
+                                        : _PyDict_NewPresized(PyDict_Size(original));
+        if (!copied)
+            return -1;
+        if (memoize(memo, original, copied, hash) < 0) {
+            Py_DECREF(copied);
+            return -1;
+        }
+        if (dict_iter_init(&frame->iter, original) < 0) {
+            forget(memo, original, hash);
+            Py_DECREF(copied);
+            return -1;
+        }
+        frame->iter_live = 1;
 #endif
+        frame->kind = COPY_FRAME_DICT;
+        frame->copied = copied;
+        frame->key_copy = NULL;
+        frame->value = NULL;
+        frame->pos = 0;
+        return 0;
+    }
+
+    if (type == &PySet_Type) {
+        COPIUM_STAT(set);
+        PyObject* snapshot = NULL;
+        Py_ssize_t i = 0;
+        int atomic;
+
+        COPIUM_Py_BEGIN_CRITICAL_SECTION(original);
+        atomic = set_items_all_atomic(original);
+        Py_ssize_t sz = atomic ? -1 : PySet_Size(original);
+        if (sz >= 0)
+            snapshot = PyTuple_New(sz);
+        if (snapshot) {
+            Py_ssize_t pos = 0;
+            PyObject* item;
+            Py_hash_t item_hash;
+            while (_PySet_NextEntry(original, &pos, &item, &item_hash)) {
+                PyTuple_SET_ITEM(snapshot, i++, Py_NewRef(item));
+            }
         }
         COPIUM_Py_END_CRITICAL_SECTION();
 
-        if (UNLIKELY(size_changed)) {
-            Py_DECREF(item);
-            PyErr_SetString(PyExc_RuntimeError, "list changed size during iteration");
-            goto error;
+        if (atomic) {
+            PyObject* copied = PySet_New(original);
+            if (!copied)
+                return -1;
+#ifdef Py_GIL_DISABLED
+            // original may have changed since it was checked; the clone can't have.
+            if (UNLIKELY(!set_items_all_atomic(copied))) {
+                Py_DECREF(copied);
+                return copy_frame_start(frame, original, type, memo, hash);
+            }
+#endif
+            if (memoize(memo, original, copied, hash) < 0) {
+                Py_DECREF(copied);
+                return -1;
+            }
+            frame->copied = copied;
+            return 1;
+        }
+        if (UNLIKELY(!snapshot))
+            return -1;
+
+        PyObject* copied = PySet_New(NULL);
+        if (!copied) {
+            Py_DECREF(snapshot);
+            return -1;
+        }
+        if (memoize(memo, original, copied, hash) < 0) {
+            Py_DECREF(snapshot);
+            Py_DECREF(copied);
+            return -1;
         }
+        frame->kind = COPY_FRAME_SET;
+        frame->copied = copied;
+        frame->snapshot = snapshot;
+        frame->size = i;
+        return 0;
     }
 
-    return copied;
+    COPIUM_STAT(frozenset);
+    if (set_items_all_atomic(original)) {
+        frame->copied = Py_NewRef(original);
+        return 1;
+    }
+    Py_ssize_t sz = PySet_Size(original);
+    if (sz < 0)
+        return -1;
+    PyObject* items = PyTuple_New(sz);
+    if (!items)
+        return -1;
+    frame->kind = COPY_FRAME_FROZENSET;
+    frame->copied = items;
+    frame->size = sz;
+    frame->pos = 0;
+    frame->all_same = 1;
+    return 0;
+}
 
-error:
-    forget(memo, original, memo_key_hash);
-    Py_DECREF(copied);
+// Copies one item of a container, of which the container knows of `held` references. Returns
+// 1 with *copy set, 0 if item is a container that needs a frame of its own (to be memoized
+// under *hash), or -1 with an exception set.
+static ALWAYS_INLINE int copy_item(
+    PyObject* item, PyMemoObject* memo, Py_ssize_t held, PyObject** copy, Py_ssize_t* hash
+) {
+    PyTypeObject* type = Py_TYPE(item);
+
+    if (LIKELY(is_literal_immutable(type))) {
+        COPIUM_STAT(prememo_atomic);
+        *copy = Py_NewRef(item);
+        return 1;
+    }
+    if (copy_item_deferrable(item, type, memo, held)) {
+        *hash = MEMO_HASH_DEFERRED;
+        return 0;
+    }
+
+    *copy = remember(memo, item, hash);
+    if (*copy) {
+        COPIUM_STAT(memo_hit);
+        return 1;
+    }
+    if (is_traversed_container(type))
+        return 0;
+
+    *copy = deepcopy_unmemoized(item, type, memo, *hash);
+#if COPIUM_PARALLEL_DEEPCOPY
+    if (UNLIKELY(memo->shared))
+        *copy = memo_settle(memo, item, *copy);
+#endif
+    return *copy ? 1 : -1;
+}
+
+// The list item at frame->index, as a new reference, or NULL with an exception set.
+static ALWAYS_INLINE PyObject* copy_frame_list_item(CopyFrame* frame) {
+    PyObject* original = frame->original;
+#ifdef Py_GIL_DISABLED
+    Py_ssize_t i = frame->index - frame->pos;
+    if (LIKELY(i < PyTuple_GET_SIZE(frame->snapshot) && frame->index < PyList_GET_SIZE(original)))
+        return Py_NewRef(PyTuple_GET_ITEM(frame->snapshot, i));
+#else
+    PyObject* item = COPIUM_PyList_GET_ITEM_REF(original, frame->index);
+    if (LIKELY(item != NULL))
+        return item;
+#endif
+    PyErr_SetString(PyExc_RuntimeError, "list changed size during iteration");
     return NULL;
 }
 
-static MAYBE_INLINE PyObject* deepcopy_tuple(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
+static ALWAYS_INLINE int copy_frame_list_store(
+    CopyFrame* frame, PyMemoObject* memo, PyObject* copy
+) {
+    PyObject* copied = frame->copied;
+#ifdef Py_GIL_DISABLED
+    if (memo->defer_unique) {
+        PyList_SET_ITEM(copied, frame->index, copy);
+        return 0;
+    }
+#else
+    (void)memo;
+#endif
+    // Though highly unlikely, since we're exposing list in memo, it theoretically could change.
+    int size_changed = 0;
+    COPIUM_Py_BEGIN_CRITICAL_SECTION(copied);
+    if (UNLIKELY(PyList_GET_SIZE(copied) != frame->size)) {
+        size_changed = 1;
+    } else {
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+        PyList_SetItem(copied, frame->index, copy);
+#else
+        PyList_SET_ITEM(copied, frame->index, copy);
+#endif
+    }
+    COPIUM_Py_END_CRITICAL_SECTION();
+
+    if (UNLIKELY(size_changed)) {
+        Py_DECREF(copy);
+        PyErr_SetString(PyExc_RuntimeError, "list changed size during iteration");
+        return -1;
+    }
+    return 0;
+}
+
+// The dict's next key and value, as dict_iter_next() has them.
+static ALWAYS_INLINE int copy_frame_dict_next(CopyFrame* frame, PyObject** key, PyObject** value) {
+#ifdef Py_GIL_DISABLED
+    if (UNLIKELY(PyDict_GET_SIZE(frame->original) != frame->size)) {
+        PyErr_SetString(PyExc_RuntimeError, "dictionary changed size during iteration");
+        return -1;
+    }
+    if (frame->index == frame->size)
+        return 0;
+    Py_ssize_t i = 2 * frame->index++;
+    *key = Py_NewRef(PyTuple_GET_ITEM(frame->snapshot, i));
+    *value = Py_NewRef(PyTuple_GET_ITEM(frame->snapshot, i + 1));
+    return 1;
+#else
+    int next = dict_iter_next(&frame->iter, key, value);
+    if (next <= 0)
+        frame->iter_live = 0;
+    return next;
+#endif
+}
+
+// Stores a dict entry's copies. Steals both.
+static ALWAYS_INLINE int copy_frame_dict_store(
+    CopyFrame* frame, PyObject* key_copy, PyObject* copy
 ) {
-    Py_ssize_t sz = PyTuple_GET_SIZE(original);
+#if COPIUM_DICT_CLONE
+    if (frame->clone)
+        return dict_clone_replace(frame->copied, &frame->pos, key_copy, copy);
+#endif
+    return COPIUM_PyDict_SetItem_Take2((PyDictObject*)frame->copied, key_copy, copy);
+}
 
-    PyObject* copied = PyTuple_New(sz);
+#if COPIUM_DICT_CLONE
+// Copies item, a dict the list frame would otherwise push a frame for, if it is a record (see
+// _dict_clone.c). Returns 1 with *copy set, memoized under hash, 0 if it isn't one, in which case
+// the frame stops looking, or -1 with an exception set.
+static ALWAYS_INLINE int copy_frame_list_record(
+    CopyFrame* frame, PyObject* item, PyMemoObject* memo, Py_ssize_t hash, PyObject** copy
+) {
+    if (!dict_is_record(item)) {
+        frame->records = 0;
+        return 0;
+    }
+    COPIUM_STAT(dict);
+    PyObject* copied = PyDict_Copy(item);
     if (!copied)
-        return NULL;
+        return -1;
+    if (memoize(memo, item, copied, hash) < 0) {
+        Py_DECREF(copied);
+        return -1;
+    }
+    *copy = copied;
+    return 1;
+}
+#endif
 
-    int all_same = 1;
-    for (Py_ssize_t i = 0; i < sz; i++) {
-        PyObject* item = PyTuple_GET_ITEM(original, i);
-        PyObject* copied_item = deepcopy(item, memo);
-        if (!copied_item) {
-            Py_DECREF(copied);
-            return NULL;
+// Copies the frame's items in order until one is a container of its own. Returns 1 with that
+// item in *child (borrowed, the frame keeps it alive) and its memo hash in *child_hash, 0 once
+// all items are copied, or -1 with an exception set.
+static ALWAYS_INLINE int copy_frame_advance(
+    CopyFrame* frame, PyMemoObject* memo, PyObject** child, Py_ssize_t* child_hash
+) {
+    PyObject* original = frame->original;
+    PyObject* copied = frame->copied;
+    PyObject* copy;
+
+    switch (frame->kind) {
+        case COPY_FRAME_LIST:
+            for (; frame->index < frame->size; frame->index++) {
+                PyObject* item = copy_frame_list_item(frame);
+                if (UNLIKELY(item == NULL))
+                    return -1;
+                int copied_item = copy_item(item, memo, 2, &copy, child_hash);
+#if COPIUM_DICT_CLONE
+                if (!copied_item && frame->records && Py_IS_TYPE(item, &PyDict_Type))
+                    copied_item = copy_frame_list_record(frame, item, memo, *child_hash, &copy);
+#endif
+                if (!copied_item) {
+                    frame->pending = item;
+                    *child = item;
+                    return 1;
+                }
+                Py_DECREF(item);
+                if (copied_item < 0 || copy_frame_list_store(frame, memo, copy) < 0)
+                    return -1;
+            }
+            return 0;
+
+        case COPY_FRAME_TUPLE:
+            for (; frame->index < frame->size; frame->index++) {
+                PyObject* item = PyTuple_GET_ITEM(original, frame->index);
+                int copied_item = copy_item(item, memo, 1, &copy, child_hash);
+                if (!copied_item) {
+                    *child = item;
+                    return 1;
+                }
+                if (copied_item < 0)
+                    return -1;
+                if (copy != item)
+                    frame->all_same = 0;
+                PyTuple_SET_ITEM(copied, frame->index, copy);
+            }
+            return 0;
+
+        case COPY_FRAME_DICT:
+            for (;;) {
+                PyObject* value = frame->value;
+                if (value) {
+                    // Back from copying the key: its value is next.
+                    frame->value = NULL;
+                } else {
+                    // Relying on dict_iter_next to INCREF key and value
+                    PyObject* key;
+                    int iter_flag = copy_frame_dict_next(frame, &key, &value);
+                    if (iter_flag <= 0)
+                        return iter_flag;
+                    if (frame->clone) {
+                        // An atomic key is its own copy, already in place.
+                        frame->key_copy = key;
+                    } else {
+                        int copied_key = copy_item(key, memo, 2, &copy, child_hash);
+                        if (!copied_key) {
+                            frame->pending = key;
+                            frame->value = value;
+                            *child = key;
+                            return 1;
+                        }
+                        Py_DECREF(key);
+                        if (copied_key < 0) {
+                            Py_DECREF(value);
+                            return -1;
+                        }
+                        frame->key_copy = copy;
+                    }
+                }
+
+                int copied_value = copy_item(value, memo, 2, &copy, child_hash);
+                if (!copied_value) {
+                    frame->pending = value;
+                    *child = value;
+                    return 1;
+                }
+                Py_DECREF(value);
+                if (copied_value < 0)
+                    return -1;
+                PyObject* key_copy = frame->key_copy;
+                frame->key_copy = NULL;
+                if (copy_frame_dict_store(frame, key_copy, copy) < 0)
+                    return -1;
+            }
+
+        case COPY_FRAME_SET:
+            for (; frame->index < frame->size; frame->index++) {
+                PyObject* item = PyTuple_GET_ITEM(frame->snapshot, frame->index);
+                int copied_item = copy_item(item, memo, 2, &copy, child_hash);
+                if (!copied_item) {
+                    *child = item;
+                    return 1;
+                }
+                if (copied_item < 0)
+                    return -1;
+                int ret = PySet_Add(copied, copy);
+                Py_DECREF(copy);
+                if (ret < 0)
+                    return -1;
+            }
+            return 0;
+
+        default:
+            while (frame->index < frame->size) {
+                PyObject* item;
+                Py_hash_t hash;
+                if (!_PySet_NextEntry(original, &frame->pos, &item, &hash))
+                    break;
+                int copied_item = copy_item(item, memo, 1, &copy, child_hash);
+                if (!copied_item) {
+                    frame->pending = item;
+                    *child = item;
+                    return 1;
+                }
+                if (copied_item < 0)
+                    return -1;
+                if (copy != item)
+                    frame->all_same = 0;
+                PyTuple_SET_ITEM(copied, frame->index++, copy);
+            }
+            return 0;
+    }
+}
+
+// Puts the copy of the *child copy_frame_advance() stopped at into the frame's copy, and moves
+// past it. Steals copy.
+static int copy_frame_deliver(CopyFrame* frame, PyMemoObject* memo, PyObject* copy) {
+    switch (frame->kind) {
+        case COPY_FRAME_LIST:
+            Py_CLEAR(frame->pending);
+            if (copy_frame_list_store(frame, memo, copy) < 0)
+                return -1;
+            frame->index++;
+            return 0;
+
+        case COPY_FRAME_TUPLE:
+            if (copy != PyTuple_GET_ITEM(frame->original, frame->index))
+                frame->all_same = 0;
+            PyTuple_SET_ITEM(frame->copied, frame->index++, copy);
+            return 0;
+
+        case COPY_FRAME_DICT: {
+            Py_CLEAR(frame->pending);
+            if (frame->value) {
+                frame->key_copy = copy;
+                return 0;
+            }
+            PyObject* key_copy = frame->key_copy;
+            frame->key_copy = NULL;
+            return copy_frame_dict_store(frame, key_copy, copy);
+        }
+
+        case COPY_FRAME_SET: {
+            int ret = PySet_Add(frame->copied, copy);
+            Py_DECREF(copy);
+            frame->index++;
+            return ret;
         }
-        if (copied_item != item)
-            all_same = 0;
-        PyTuple_SET_ITEM(copied, i, copied_item);
+
+        default:
+            if (copy != frame->pending)
+                frame->all_same = 0;
+            frame->pending = NULL;
+            PyTuple_SET_ITEM(frame->copied, frame->index++, copy);
+            return 0;
     }
+}
 
-    if (all_same) {
-        Py_DECREF(copied);
-        return Py_NewRef(original);
+// The copy of the frame's original once all its items are copied. Releases what the frame
+// holds either way.
+static PyObject* copy_frame_finish(CopyFrame* frame, PyMemoObject* memo) {
+    PyObject* copied = frame->copied;
+
+    switch (frame->kind) {
+        case COPY_FRAME_SET:
+            Py_DECREF(frame->snapshot);
+            return copied;
+
+        case COPY_FRAME_LIST:
+        case COPY_FRAME_DICT:
+#ifdef Py_GIL_DISABLED
+            Py_DECREF(frame->snapshot);
+#endif
+            return copied;
+
+        case COPY_FRAME_TUPLE:
+            if (frame->all_same) {
+                Py_DECREF(copied);
+                return Py_NewRef(frame->original);
+            }
+            if (frame->hash != MEMO_HASH_DEFERRED) {
+                PyObject* existing = memo_table_lookup_h(
+                    memo->table, (void*)frame->original, frame->hash
+                );
+                if (existing) {
+                    Py_DECREF(copied);
+                    return Py_NewRef(existing);
+                }
+            }
+            break;
+
+        default: {
+            PyObject* items = copied;
+            if (frame->all_same) {
+                Py_DECREF(items);
+                return Py_NewRef(frame->original);
+            }
+            copied = PyFrozenSet_New(items);
+            Py_DECREF(items);
+            if (!copied)
+                return NULL;
+            break;
+        }
     }
 
-    PyObject* existing = memo_table_lookup_h(memo->table, (void*)original, memo_key_hash);
-    if (existing) {
+    if (memoize(memo, frame->original, copied, frame->hash) < 0) {
         Py_DECREF(copied);
-        return Py_NewRef(existing);
+        return NULL;
     }
+    return copied;
+}
+
+// Releases what the frame holds after an error, and takes its copy back out of the memo.
+static void copy_frame_abort(CopyFrame* frame, PyMemoObject* memo) {
+    switch (frame->kind) {
+        case COPY_FRAME_DICT:
+#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
+            if (frame->iter_live)
+                dict_iter_cleanup(&frame->iter);
+#endif
+            Py_XDECREF(frame->key_copy);
+            Py_XDECREF(frame->value);
+            /* fallthrough */
+        case COPY_FRAME_LIST:
+#ifdef Py_GIL_DISABLED
+            Py_DECREF(frame->snapshot);
+#endif
+            Py_XDECREF(frame->pending);
+            forget(memo, frame->original, frame->hash);
+            break;
+        case COPY_FRAME_SET:
+            Py_DECREF(frame->snapshot);
+            forget(memo, frame->original, frame->hash);
+            break;
+        default:
+            break;
+    }
+    Py_DECREF(frame->copied);
+}
+
+static PyObject* deepcopy_containers(
+    PyObject* original, PyTypeObject* type, PyMemoObject* memo, Py_ssize_t memo_key_hash
+) {
+    CopyStack* stack = &memo->stack;
+    CopyFrame* below = stack->top;
+
+    CopyFrame* frame = copy_stack_push(stack);
+    if (!frame)
+        return NULL;
+    int started = copy_frame_start(frame, original, type, memo, memo_key_hash);
+    if (started != 0) {
+        PyObject* copy = started > 0 ? frame->copied : NULL;
+        copy_stack_pop(stack);
+        return copy;
+    }
+
+    for (;;) {
+        PyObject* child;
+        Py_ssize_t child_hash;
+        int advanced = copy_frame_advance(frame, memo, &child, &child_hash);
+
+        if (advanced > 0) {
+            // The child's items are copied before the frame's next one.
+            CopyFrame* pushed = copy_stack_push(stack);
+            if (!pushed)
+                goto error;
+            int started = copy_frame_start(pushed, child, Py_TYPE(child), memo, child_hash);
+            if (started == 0) {
+                frame = pushed;
+                continue;
+            }
+            PyObject* copy = pushed->copied;
+            copy_stack_pop(stack);
+            if (started < 0)
+                goto error;
+#if COPIUM_PARALLEL_DEEPCOPY
+            if (UNLIKELY(memo->shared))
+                copy = memo_settle(memo, child, copy);
+#endif
+            if (!copy || UNLIKELY(copy_frame_deliver(frame, memo, copy) < 0))
+                goto error;
+            continue;
+        }
+        if (UNLIKELY(advanced < 0))
+            goto error;
+
+        PyObject* finished = frame->original;
+        PyObject* copy = copy_frame_finish(frame, memo);
+        copy_stack_pop(stack);
+        if (stack->top == below)
+            return copy;
+        frame = stack->top;
+#if COPIUM_PARALLEL_DEEPCOPY
+        if (UNLIKELY(memo->shared))
+            copy = memo_settle(memo, finished, copy);
+#else
+        (void)finished;
+#endif
+        if (!copy || UNLIKELY(copy_frame_deliver(frame, memo, copy) < 0))
+            goto error;
+    }
+
+error:
+    while (stack->top != below) {
+        copy_frame_abort(stack->top, memo);
+        copy_stack_pop(stack);
+    }
+    return NULL;
+}
+
+static MAYBE_INLINE PyObject* deepcopy_bytearray(
+    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
+) {
+    COPIUM_STAT(bytearray);
+    Py_ssize_t sz = PyByteArray_Size(original);
+
+    PyObject* copied = PyByteArray_FromStringAndSize(NULL, sz);
+    if (!copied)
+        return NULL;
+
+    if (sz)
+        memcpy(PyByteArray_AS_STRING(copied), PyByteArray_AS_STRING(original), (size_t)sz);
 
     if (memoize(memo, original, copied, memo_key_hash) < 0) {
         Py_DECREF(copied);
@@ -202,10 +1280,26 @@ static MAYBE_INLINE PyObject* deepcopy_tuple(
     return copied;
 }
 
-static MAYBE_INLINE PyObject* deepcopy_dict(
+static MAYBE_INLINE PyObject* deepcopy_method(
     PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
 ) {
-    PyObject* copied = _PyDict_NewPresized(PyDict_Size(original));
+    COPIUM_STAT(method);
+    PyObject* func = PyMethod_GET_FUNCTION(original);
+    PyObject* self = PyMethod_GET_SELF(original);
+
+    if (!func || !self)
+        return NULL;
+
+    Py_INCREF(self);
+    PyObject* copied_self = deepcopy(self, memo);
+    Py_DECREF(self);
+
+    if (!copied_self)
+        return NULL;
+
+    PyObject* copied = PyMethod_New(func, copied_self);
+    Py_DECREF(copied_self);
+
     if (!copied)
         return NULL;
 
@@ -214,138 +1308,182 @@ static MAYBE_INLINE PyObject* deepcopy_dict(
         return NULL;
     }
 
-    DictIterGuard iter_guard;
-    if (dict_iter_init(&iter_guard, original) < 0) {
-        return NULL;
-    }
+    return copied;
+}
 
-    PyObject *key, *value;
-    int iter_flag;
+/*
+ * collections containers, rebuilt the way deepcopy rebuilds them from their __reduce_ex__, minus
+ * the trip through Python: an empty instance goes in the memo first, then gets copies of the
+ * items. Counter and defaultdict don't override item assignment, so theirs go in through the
+ * dict API; an OrderedDict keeps its own order.
+ */
 
-    // Relying on dict_iter_next to INCREF key and value
-    while ((iter_flag = dict_iter_next(&iter_guard, &key, &value)) > 0) {
-        Py_SETREF(key, deepcopy(key, memo));
-        if (!key) {
-            Py_DECREF(value);
-            goto error;
+// Fills copied, a new dict or dict subclass, with copies of the items of the dict original.
+static int deepcopy_dict_items_into(PyObject* copied, PyObject* original, PyMemoObject* memo) {
+    DictIterGuard iter;
+    if (dict_iter_init(&iter, original) < 0)
+        return -1;
+    PyObject *key, *value;
+    int next;
+    while ((next = dict_iter_next(&iter, &key, &value)) > 0) {
+        PyObject* key_copy = deepcopy(key, memo);
+        PyObject* value_copy = key_copy ? deepcopy(value, memo) : NULL;
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (!value_copy ||
+            COPIUM_PyDict_SetItem_Take2((PyDictObject*)copied, key_copy, value_copy) < 0) {
+            if (!value_copy)
+                Py_XDECREF(key_copy);
+#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
+            dict_iter_cleanup(&iter);
+#endif
+            return -1;
         }
+    }
+    return next;
+}
 
-        Py_SETREF(value, deepcopy(value, memo));
+static int deepcopy_ordereddict_items_into(
+    PyObject* copied, PyObject* original, PyMemoObject* memo
+) {
+    PyObject* it = PyObject_GetIter(original);
+    if (!it)
+        return -1;
+    PyObject* key;
+    while ((key = PyIter_Next(it))) {
+        PyObject* value = PyDict_GetItemWithError(original, key);
         if (!value) {
+            if (!PyErr_Occurred())
+                PyErr_SetObject(PyExc_KeyError, key);
             Py_DECREF(key);
-            goto error;
+            break;
+        }
+        Py_INCREF(value);
+        PyObject* key_copy = deepcopy(key, memo);
+        PyObject* value_copy = key_copy ? deepcopy(value, memo) : NULL;
+        Py_DECREF(key);
+        Py_DECREF(value);
+        int status = value_copy ? PyODict_SetItem(copied, key_copy, value_copy) : -1;
+        Py_XDECREF(key_copy);
+        Py_XDECREF(value_copy);
+        if (status < 0)
+            break;
+    }
+    Py_DECREF(it);
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+static int deepcopy_deque_items_into(PyObject* copied, PyObject* original, PyMemoObject* memo) {
+    PyObject* items = PySequence_List(original);
+    if (!items)
+        return -1;
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(items); i++) {
+        PyObject* item = PyList_GET_ITEM(items, i);
+        PyObject* item_copy = deepcopy(item, memo);
+        if (!item_copy) {
+            Py_DECREF(items);
+            return -1;
         }
-
-        if (COPIUM_PyDict_SetItem_Take2((PyDictObject*)copied, key, value) < 0)
-            goto error;
+        PyList_SET_ITEM(items, i, item_copy);
+        Py_DECREF(item);
     }
-
-    if (iter_flag < 0)
-        goto error;
-
-    return copied;
-
-error:
-#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
-    dict_iter_cleanup(&iter_guard);
-#endif
-    forget(memo, original, memo_key_hash);
-    Py_DECREF(copied);
-    return NULL;
+    PyObject* result = PyObject_CallMethodOneArg(copied, module_state.s_extend, items);
+    Py_DECREF(items);
+    if (!result)
+        return -1;
+    Py_DECREF(result);
+    return 0;
 }
 
-static MAYBE_INLINE PyObject* deepcopy_set(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
+static PyObject* deepcopy_collection(
+    PyObject* original, PyTypeObject* tp, PyMemoObject* memo, Py_ssize_t memo_key_hash
 ) {
-    PyObject* snapshot = NULL;
-    PyObject* item;
-    Py_ssize_t i = 0;
-    Py_ssize_t sz;
-    int init_failed = 0;
-
-    COPIUM_Py_BEGIN_CRITICAL_SECTION(original);
-    sz = PySet_Size(original);
-    if (sz < 0) {
-        init_failed = 1;
+    COPIUM_STAT(collections);
+    PyObject* copied = NULL;
+    if (tp == module_state.OrderedDict_type) {
+        // Instance attributes are state that __reduce_ex__ would have to carry over.
+        PyObject** dictptr = _PyObject_GetDictPtr(original);
+        if (dictptr && *dictptr && PyDict_GET_SIZE(*dictptr))
+            return SLOW_COPY_ROUTE(deepcopy_object(original, tp, memo, memo_key_hash));
+        copied = PyObject_CallNoArgs((PyObject*)tp);
+    } else if (tp == module_state.defaultdict_type) {
+        // The factory is an argument of the reconstruction: copied before the instance exists.
+        PyObject* factory = PyObject_GetAttr(original, module_state.s_default_factory);
+        PyObject* factory_copy = factory ? deepcopy(factory, memo) : NULL;
+        Py_XDECREF(factory);
+        if (!factory_copy)
+            return NULL;
+        copied = PyObject_CallOneArg((PyObject*)tp, factory_copy);
+        Py_DECREF(factory_copy);
+    } else if (tp == module_state.deque_type) {
+        PyObject* maxlen = PyObject_GetAttr(original, module_state.s_maxlen);
+        if (!maxlen)
+            return NULL;
+        PyObject* empty = PyTuple_New(0);
+        if (empty)
+            copied = PyObject_CallFunctionObjArgs((PyObject*)tp, empty, maxlen, NULL);
+        Py_XDECREF(empty);
+        Py_DECREF(maxlen);
     } else {
-        snapshot = PyTuple_New(sz);
-        if (!snapshot) {
-            init_failed = 1;
-        } else {
-            Py_ssize_t pos = 0;
-            Py_hash_t hash;
-            while (_PySet_NextEntry(original, &pos, &item, &hash)) {
-                PyTuple_SET_ITEM(snapshot, i++, Py_NewRef(item));
-            }
-        }
+        // Counter: its __init__ only gets to add items, and its __reduce__ drops the instance
+        // __dict__, so an instance fresh from tp_new is what reduction would start from.
+        PyObject* args = PyTuple_New(0);
+        if (!args)
+            return NULL;
+        copied = tp->tp_new(tp, args, NULL);
+        Py_DECREF(args);
     }
-    COPIUM_Py_END_CRITICAL_SECTION();
-
-    if (UNLIKELY(init_failed))
-        return NULL;
-
-    PyObject* copied = PySet_New(NULL);
-    if (!copied) {
-        Py_DECREF(snapshot);
+    if (!copied)
         return NULL;
-    }
-
     if (memoize(memo, original, copied, memo_key_hash) < 0) {
-        Py_DECREF(snapshot);
         Py_DECREF(copied);
         return NULL;
     }
 
-    for (Py_ssize_t j = 0; j < i; j++) {
-        item = PyTuple_GET_ITEM(snapshot, j);
-        PyObject* copied_item = deepcopy(item, memo);
-        if (!copied_item)
-            goto error;
-
-        int ret = PySet_Add(copied, copied_item);
-        Py_DECREF(copied_item);
-
-        if (ret < 0)
-            goto error;
+    int status;
+    if (tp == module_state.OrderedDict_type)
+        status = deepcopy_ordereddict_items_into(copied, original, memo);
+    else if (tp == module_state.deque_type)
+        status = deepcopy_deque_items_into(copied, original, memo);
+    else
+        status = deepcopy_dict_items_into(copied, original, memo);
+    if (status < 0) {
+        forget(memo, original, memo_key_hash);
+        Py_DECREF(copied);
+        return NULL;
     }
-
-    Py_DECREF(snapshot);
     return copied;
-
-error:
-    Py_DECREF(snapshot);
-    forget(memo, original, memo_key_hash);
-    Py_DECREF(copied);
-    return NULL;
 }
 
-static MAYBE_INLINE PyObject* deepcopy_frozenset(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
+// Copies original with the copier its type got registered with through _C_API.
+static PyObject* deepcopy_registered(
+    PyObject* original, PyObject* copier, PyMemoObject* memo, Py_ssize_t memo_key_hash
 ) {
-    Py_ssize_t sz = PySet_Size(original);
-    if (sz < 0)
+    COPIUM_STAT(c_api);
+    if (memo_expose(memo) < 0)
         return NULL;
-
-    PyObject* items = PyTuple_New(sz);
-    if (!items)
+    copium_copyfunc copy = (copium_copyfunc)PyCapsule_GetPointer(copier, COPIUM_COPIER_CAPSULE);
+    if (!copy)
         return NULL;
 
-    Py_ssize_t pos = 0, i = 0;
-    PyObject* item;
-    Py_hash_t hash;
+    PyObject* copied = copy(original, memo);
+    if (!copied)
+        return NULL;
 
-    while (_PySet_NextEntry(original, &pos, &item, &hash) && i < sz) {
-        PyObject* copied_item = deepcopy(item, memo);
-        if (!copied_item) {
-            Py_DECREF(items);
-            return NULL;
-        }
-        PyTuple_SET_ITEM(items, i++, copied_item);
+    if (copied != original && memoize(memo, original, copied, memo_key_hash) < 0) {
+        Py_DECREF(copied);
+        return NULL;
     }
+    return copied;
+}
 
-    PyObject* copied = PyFrozenSet_New(items);
-    Py_DECREF(items);
-
+// Holds nothing but C values, so a shallow copy of the buffer is the deep copy: one memcpy,
+// without escaping the memo for a __deepcopy__ that only ever calls the same thing.
+static PyObject* deepcopy_buffer(
+    PyObject* original, PyObject* __copy__, PyMemoObject* memo, Py_ssize_t memo_key_hash
+) {
+    COPIUM_STAT(buffer);
+    PyObject* copied = PyObject_Vectorcall(__copy__, &original, 1, NULL);
     if (!copied)
         return NULL;
 
@@ -353,53 +1491,100 @@ static MAYBE_INLINE PyObject* deepcopy_frozenset(
         Py_DECREF(copied);
         return NULL;
     }
-
     return copied;
 }
 
-static MAYBE_INLINE PyObject* deepcopy_bytearray(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
-) {
-    Py_ssize_t sz = PyByteArray_Size(original);
+// Whether format, a struct module one, has objects in it. Field names (":name:") don't count.
+static int format_holds_objects(const char* format) {
+    int in_name = 0;
+    for (; format && *format; format++) {
+        if (*format == ':')
+            in_name = !in_name;
+        else if (!in_name && *format == 'O')
+            return 1;
+    }
+    return 0;
+}
 
-    PyObject* copied = PyByteArray_FromStringAndSize(NULL, sz);
+// The buffer of an instance of a type registered with register_buffer(), if it's one a memcpy
+// copies: C-contiguous, and holding nothing but C values. 1 with view filled in, 0 if not.
+static int exported_flat_buffer(PyObject* original, Py_buffer* view) {
+    if (PyObject_GetBuffer(original, view, PyBUF_RECORDS_RO) < 0) {
+        // Copied as if it weren't registered, which raises again if it's due.
+        PyErr_Clear();
+        return 0;
+    }
+    if (PyBuffer_IsContiguous(view, 'C') && !format_holds_objects(view->format))
+        return 1;
+    PyBuffer_Release(view);
+    return 0;
+}
+
+static int copy_buffer_into(PyObject* copied, Py_buffer* view, PyTypeObject* tp) {
+    Py_buffer target;
+    if (PyObject_GetBuffer(copied, &target, PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS) < 0)
+        return -1;
+    int status = 0;
+    if (target.len == view->len) {
+        memcpy(target.buf, view->buf, (size_t)view->len);
+    } else {
+        PyErr_Format(
+            PyExc_ValueError,
+            "the buffer allocator of '%.200s' made %zd bytes for %zd",
+            tp->tp_name,
+            target.len,
+            view->len
+        );
+        status = -1;
+    }
+    PyBuffer_Release(&target);
+    return status;
+}
+
+// Releases view, which exported_flat_buffer() filled in.
+static PyObject* deepcopy_exported_buffer(
+    PyObject* original, PyObject* registered, Py_buffer* view, PyMemoObject* memo,
+    Py_ssize_t memo_key_hash
+) {
+    COPIUM_STAT(buffer);
+    PyObject* copied = NULL;
+    copium_bufferallocfunc alloc =
+        (copium_bufferallocfunc)PyCapsule_GetPointer(registered, COPIUM_BUFFER_CAPSULE);
+    if (alloc && memo_expose(memo) == 0)
+        copied = alloc(original, view);
+    if (copied && copy_buffer_into(copied, view, Py_TYPE(original)) < 0)
+        Py_CLEAR(copied);
+    PyBuffer_Release(view);
     if (!copied)
         return NULL;
 
-    if (sz)
-        memcpy(PyByteArray_AS_STRING(copied), PyByteArray_AS_STRING(original), (size_t)sz);
-
     if (memoize(memo, original, copied, memo_key_hash) < 0) {
         Py_DECREF(copied);
         return NULL;
     }
-
     return copied;
 }
 
-static MAYBE_INLINE PyObject* deepcopy_method(
-    PyObject* original, PyMemoObject* memo, Py_ssize_t memo_key_hash
+static PyObject* deepcopy_custom(
+    PyObject* original, PyObject* __deepcopy__, PyMemoObject* memo, Py_ssize_t memo_key_hash
 ) {
-    PyObject* func = PyMethod_GET_FUNCTION(original);
-    PyObject* self = PyMethod_GET_SELF(original);
-
-    if (!func || !self)
+    if (memo->defer_unique && memo_escape(memo) < 0) {
+        Py_DECREF(__deepcopy__);
         return NULL;
+    }
+    COPIUM_STAT(deepcopy);
+    MemoCheckpoint checkpoint = memo_checkpoint(memo);
 
-    Py_INCREF(self);
-    PyObject* copied_self = deepcopy(self, memo);
-    Py_DECREF(self);
-
-    if (!copied_self)
-        return NULL;
+    PyObject* copied = PyObject_CallOneArg(__deepcopy__, (PyObject*)memo);
+    if (!copied)
+        copied = _maybe_retry_with_dict_memo(original, __deepcopy__, memo, checkpoint);
 
-    PyObject* copied = PyMethod_New(func, copied_self);
-    Py_DECREF(copied_self);
+    Py_DECREF(__deepcopy__);
 
     if (!copied)
         return NULL;
 
-    if (memoize(memo, original, copied, memo_key_hash) < 0) {
+    if (copied != original && memoize(memo, original, copied, memo_key_hash) < 0) {
         Py_DECREF(copied);
         return NULL;
     }
@@ -407,14 +1592,27 @@ static MAYBE_INLINE PyObject* deepcopy_method(
     return copied;
 }
 
-static PyObject* deepcopy_custom(
+// Same as deepcopy_custom, but with __deepcopy__ taken unbound from the type (borrowed), so no
+// bound method is created unless the dict memo retry needs one.
+static PyObject* deepcopy_custom_unbound(
     PyObject* original, PyObject* __deepcopy__, PyMemoObject* memo, Py_ssize_t memo_key_hash
 ) {
+    if (memo->defer_unique && memo_escape(memo) < 0)
+        return NULL;
+    COPIUM_STAT(deepcopy);
+    // The call may drop the type's last reference to the function.
+    Py_INCREF(__deepcopy__);
     MemoCheckpoint checkpoint = memo_checkpoint(memo);
 
-    PyObject* copied = PyObject_CallOneArg(__deepcopy__, (PyObject*)memo);
-    if (!copied)
-        copied = _maybe_retry_with_dict_memo(original, __deepcopy__, memo, checkpoint);
+    PyObject* args[2] = {original, (PyObject*)memo};
+    PyObject* copied = PyObject_Vectorcall(__deepcopy__, args, 2, NULL);
+    if (!copied) {
+        PyObject* bound = PyMethod_New(__deepcopy__, original);
+        if (bound) {
+            copied = _maybe_retry_with_dict_memo(original, bound, memo, checkpoint);
+            Py_DECREF(bound);
+        }
+    }
 
     Py_DECREF(__deepcopy__);
 
@@ -848,13 +2046,434 @@ static int apply_dictitems(PyObject* instance, PyObject* dictitems, PyMemoObject
     return ret;
 }
 
+/* --------------------------- Reduce plan cache ------------------------------ */
+
+// True when tp inherits object's reduce protocol untouched, so that __reduce_ex__(4) can only
+// ever yield __newobj__(cls) plus the state object.__getstate__ makes of __dict__ and
+// __slotnames__.
+static int inherits_object_reduce(PyTypeObject* tp) {
+    if (!PyType_HasFeature(tp, Py_TPFLAGS_HEAPTYPE) ||
+        PyType_HasFeature(tp, Py_TPFLAGS_LIST_SUBCLASS | Py_TPFLAGS_DICT_SUBCLASS) ||
+        tp->tp_itemsize != 0 || tp->tp_getattro != PyObject_GenericGetAttr)
+        return 0;
+
+    PyTypeObject* object_tp = &PyBaseObject_Type;
+    if (_PyType_Lookup(tp, module_state.s__reduce_ex__) !=
+            _PyType_Lookup(object_tp, module_state.s__reduce_ex__) ||
+        _PyType_Lookup(tp, module_state.s__reduce__) !=
+            _PyType_Lookup(object_tp, module_state.s__reduce__) ||
+        _PyType_Lookup(tp, module_state.s__getstate__) !=
+            _PyType_Lookup(object_tp, module_state.s__getstate__) ||
+        _PyType_Lookup(tp, module_state.s__getnewargs_ex__) ||
+        _PyType_Lookup(tp, module_state.s__getnewargs__) ||
+        _PyType_Lookup(tp, module_state.s__setstate__))
+        return 0;
+    return 1;
+}
+
+// The __slotnames__ copyreg cached on tp, borrowed; a reduce call must have been made to
+// populate it.
+static PyObject* cached_slotnames(PyTypeObject* tp) {
+    PyObject* slotnames = PyDict_GetItemWithError(tp->tp_dict, module_state.s__slotnames__);
+    if (!slotnames) {
+        PyErr_Clear();
+        return NULL;
+    }
+    return PyList_CheckExact(slotnames) ? slotnames : NULL;
+}
+
+// Whether the state of tp's instances is their __dict__ alone.
+static int has_default_reduce(PyTypeObject* tp) {
+    if (tp->tp_dictoffset == 0 || !inherits_object_reduce(tp))
+        return 0;
+    PyObject* slotnames = cached_slotnames(tp);
+    return slotnames && PyList_GET_SIZE(slotnames) == 0;
+}
+
+/*
+ * Whether every one of tp's __slotnames__ is a writable T_OBJECT_EX member, which
+ * object.__getstate__ reads and setattr() writes at a fixed offset of the instance; if so,
+ * *slots receives the offsets. Free-threaded builds go through the descriptors, which read the
+ * slots with the atomics a concurrent write calls for.
+ */
+static int slotted_reduce(PyTypeObject* tp, SlotPlan* slots) {
+#ifdef Py_GIL_DISABLED
+    (void)tp;
+    (void)slots;
+    return 0;
+#else
+    if (tp->tp_setattro != PyObject_GenericSetAttr || !inherits_object_reduce(tp))
+        return 0;
+    PyObject* slotnames = cached_slotnames(tp);
+    if (!slotnames || PyList_GET_SIZE(slotnames) == 0 ||
+        PyList_GET_SIZE(slotnames) > COPIUM_SLOT_PLAN_MAX)
+        return 0;
+    for (Py_ssize_t i = 0; i < PyList_GET_SIZE(slotnames); i++) {
+        PyObject* name = PyList_GET_ITEM(slotnames, i);
+        PyObject* descr = PyUnicode_Check(name) ? _PyType_Lookup(tp, name) : NULL;
+        if (!descr || !Py_IS_TYPE(descr, &PyMemberDescr_Type))
+            return 0;
+        PyMemberDef* member = ((PyMemberDescrObject*)descr)->d_member;
+        if (member->type != Py_T_OBJECT_EX || (member->flags & Py_READONLY) ||
+            member->offset <= 0 || member->offset > UINT16_MAX)
+            return 0;
+        slots->offsets[i] = (uint16_t)member->offset;
+    }
+    slots->count = (uint16_t)PyList_GET_SIZE(slotnames);
+    return 1;
+#endif
+}
+
+// State object.__getstate__ gives a slotted instance: None, __dict__, or (__dict__ or None,
+// {slot: value}).
+static int is_slot_state(PyObject* state) {
+    if (!state || PyDict_CheckExact(state))
+        return 1;
+    return PyTuple_CheckExact(state) && PyTuple_GET_SIZE(state) == 2 &&
+        (PyTuple_GET_ITEM(state, 0) == Py_None || PyDict_CheckExact(PyTuple_GET_ITEM(state, 0))) &&
+        PyDict_CheckExact(PyTuple_GET_ITEM(state, 1));
+}
+
+static ReducePlan classify_reduce(
+    PyTypeObject* tp,
+    PyObject* callable,
+    PyObject* argtup,
+    PyObject* state,
+    PyObject* listitems,
+    PyObject* dictitems,
+    SlotPlan* slots
+) {
+    int newobj_of_cls = callable == module_state.copyreg___newobj__ &&
+        PyTuple_GET_SIZE(argtup) == 1 && PyTuple_GET_ITEM(argtup, 0) == (PyObject*)tp;
+    if (!newobj_of_cls || listitems || dictitems)
+        return REDUCE_PLAN_GENERIC;
+
+    if ((!state || PyDict_CheckExact(state)) && has_default_reduce(tp))
+        return REDUCE_PLAN_NEWOBJ_DICT;
+    if (is_slot_state(state) && slotted_reduce(tp, slots))
+        return REDUCE_PLAN_NEWOBJ_SLOTS;
+    return REDUCE_PLAN_GENERIC;
+}
+
+// Instance attributes that object.__reduce_ex__ and __setstate__ resolution would pick up ahead
+// of the type's.
+static int shadows_reduce_protocol(PyObject* dict) {
+    return PyDict_Contains(dict, module_state.s__reduce_ex__) ||
+        PyDict_Contains(dict, module_state.s__reduce__) ||
+        PyDict_Contains(dict, module_state.s__getstate__) ||
+        PyDict_Contains(dict, module_state.s__getnewargs_ex__) ||
+        PyDict_Contains(dict, module_state.s__getnewargs__) ||
+        PyDict_Contains(dict, module_state.s__setstate__);
+}
+
+// The slots of original set, deep copied into the same slots of instance, in the order of
+// __slotnames__: what applying the slot state object.__getstate__ makes amounts to.
+static int copy_slots(
+    PyObject* original, PyObject* instance, const SlotPlan* slots, PyMemoObject* memo
+) {
+    for (uint16_t i = 0; i < slots->count; i++) {
+        PyObject* value = *(PyObject**)((char*)original + slots->offsets[i]);
+        if (!value)
+            continue;  // unset: left out of the state
+        Py_INCREF(value);
+        PyObject* copied = deepcopy(value, memo);
+        Py_DECREF(value);
+        if (!copied)
+            return -1;
+        Py_XSETREF(*(PyObject**)((char*)instance + slots->offsets[i]), copied);
+    }
+    return 0;
+}
+
+// Cached-plan equivalent of reducing to __newobj__(cls) + __dict__, and the slots if given:
+// builds the instance directly and copies them without calling __reduce_ex__ or building the
+// state.
+//
+// Returns:
+// - 1 with *out set to a new reference (or NULL on error)
+// - 0 if this instance doesn't fit the plan (caller should take the generic path)
+//
+static int reconstruct_newobj_state(
+    PyObject* original,
+    PyTypeObject* tp,
+    const SlotPlan* slots,
+    PyMemoObject* memo,
+    Py_ssize_t memo_key_hash,
+    PyObject** out
+) {
+    *out = NULL;
+
+    PyObject* dict = NULL;
+    if (!slots || tp->tp_dictoffset) {
+        dict = PyObject_GetAttr(original, module_state.s__dict__);
+        if (!dict) {
+            PyErr_Clear();
+            return 0;
+        }
+        if (!PyDict_Check(dict) ||
+            (PyDict_GET_SIZE(dict) > 0 && shadows_reduce_protocol(dict))) {
+            Py_DECREF(dict);
+            return 0;
+        }
+    }
+
+    PyObject* empty_args = PyTuple_New(0);
+    if (!empty_args)
+        goto error;
+    PyObject* instance = tp->tp_new(tp, empty_args, NULL);
+    Py_DECREF(empty_args);
+    if (!instance)
+        goto error;
+
+    if (memoize(memo, original, instance, memo_key_hash) < 0) {
+        Py_DECREF(instance);
+        goto error;
+    }
+
+    if ((dict && PyDict_GET_SIZE(dict) > 0 && apply_dict_state(instance, dict, memo) < 0) ||
+        (slots && copy_slots(original, instance, slots, memo) < 0)) {
+        forget(memo, original, memo_key_hash);
+        Py_DECREF(instance);
+        goto error;
+    }
+
+    Py_XDECREF(dict);
+    *out = instance;
+    return 1;
+
+error:
+    Py_XDECREF(dict);
+    return 1;
+}
+
+/*
+ * Subclasses of tuple, list and dict that leave the reduce protocol to object. What
+ * __reduce_ex__(4) makes of those is known from the type alone, so they are rebuilt the way
+ * deepcopy would rebuild them from it, without the reduce call and the Python iterators: a tuple
+ * subclass is created from copies of its items, a list or dict subclass is created empty,
+ * memoized, and then gets a copy of the instance __dict__ and copies of its items.
+ */
+
+// Whether a class in tp's MRO declares __slots__ beyond __dict__ and __weakref__, which reduce
+// would carry over as slot state.
+static int declares_slots(PyTypeObject* tp) {
+    PyObject* mro = tp->tp_mro;
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(mro); i++) {
+        PyTypeObject* base = (PyTypeObject*)PyTuple_GET_ITEM(mro, i);
+        if (!PyType_HasFeature(base, Py_TPFLAGS_HEAPTYPE))
+            continue;
+        PyObject* slots = PyDict_GetItemWithError(base->tp_dict, module_state.s__slots__);
+        if (!slots) {
+            if (PyErr_Occurred()) {
+                PyErr_Clear();
+                return 1;
+            }
+            continue;
+        }
+        if (PyUnicode_Check(slots))
+            slots = PyTuple_Pack(1, slots);
+        else if (PyTuple_Check(slots) || PyList_Check(slots))
+            slots = PySequence_Tuple(slots);
+        else
+            return 1;  // whatever iterable it was, it's been consumed by now
+        if (!slots) {
+            PyErr_Clear();
+            return 1;
+        }
+        for (Py_ssize_t j = 0; j < PyTuple_GET_SIZE(slots); j++) {
+            PyObject* name = PyTuple_GET_ITEM(slots, j);
+            if (!PyUnicode_Check(name) ||
+                (PyUnicode_CompareWithASCIIString(name, "__dict__") != 0 &&
+                 PyUnicode_CompareWithASCIIString(name, "__weakref__") != 0)) {
+                Py_DECREF(slots);
+                return 1;
+            }
+        }
+        Py_DECREF(slots);
+    }
+    return 0;
+}
+
+// The __new__ namedtuple() generated for tp, if tp still has it: a function that passes its
+// arguments on to tuple.__new__ as one tuple. Borrowed from its staticmethod in the MRO.
+static PyObject* namedtuple_generated_new(PyTypeObject* tp) {
+    PyObject* descr = _PyType_Lookup(tp, module_state.s__new__);
+    if (!descr || !Py_IS_TYPE(descr, &PyStaticMethod_Type))
+        return NULL;
+    PyObject* func = PyObject_GetAttrString(descr, "__func__");
+    PyObject* tuple_new = PyObject_GetAttr((PyObject*)&PyTuple_Type, module_state.s__new__);
+    int generated = func && tuple_new && PyFunction_Check(func) &&
+        PyDict_GetItemString(PyFunction_GET_GLOBALS(func), "_tuple_new") == tuple_new;
+    PyErr_Clear();
+    Py_XDECREF(tuple_new);
+    Py_XDECREF(func);
+    return generated ? func : NULL;
+}
+
+// Whether tp is a tuple, list or dict subclass deepcopy_subclass() can rebuild. For tuple
+// subclasses, *getnewargs receives what the items are handed over to:
+// - tuple's __getnewargs__: tp_new, as one tuple
+// - a namedtuple's __getnewargs__: tp_new, one by one (into a __new__ of tp's own)
+// - the __new__ namedtuple() generated: tuple's tp_new, as one tuple, skipping that __new__
+static int keeps_builtin_reduce(PyTypeObject* tp, PyObject** getnewargs) {
+    *getnewargs = NULL;
+    if (!PyType_HasFeature(tp, Py_TPFLAGS_HEAPTYPE) ||
+        tp->tp_getattro != PyObject_GenericGetAttr)
+        return 0;
+    PyTypeObject* builtin = tp;
+    while (PyType_HasFeature(builtin, Py_TPFLAGS_HEAPTYPE))
+        builtin = builtin->tp_base;
+    if (builtin != &PyTuple_Type && builtin != &PyList_Type && builtin != &PyDict_Type)
+        return 0;
+
+    PyTypeObject* object_tp = &PyBaseObject_Type;
+    if (_PyType_Lookup(tp, module_state.s__reduce_ex__) !=
+            _PyType_Lookup(object_tp, module_state.s__reduce_ex__) ||
+        _PyType_Lookup(tp, module_state.s__reduce__) !=
+            _PyType_Lookup(object_tp, module_state.s__reduce__) ||
+        _PyType_Lookup(tp, module_state.s__getstate__) !=
+            _PyType_Lookup(object_tp, module_state.s__getstate__) ||
+        _PyType_Lookup(tp, module_state.s__getnewargs_ex__) ||
+        _PyType_Lookup(tp, module_state.s__setstate__))
+        return 0;
+
+    PyObject* found = _PyType_Lookup(tp, module_state.s__getnewargs__);
+    if (builtin == &PyTuple_Type) {
+        int tuples = found == _PyType_Lookup(&PyTuple_Type, module_state.s__getnewargs__);
+        int namedtuples = found && PyFunction_Check(found) &&
+            PyFunction_GET_CODE(found) == module_state.namedtuple___getnewargs___code;
+        if (!tuples && !namedtuples)
+            return 0;
+        PyObject* generated = namedtuples ? namedtuple_generated_new(tp) : NULL;
+        if (generated)
+            found = generated;
+    } else if (found) {
+        return 0;
+    }
+    // Reduction hands over iter(obj) or obj.items(), which deepcopy feeds to append() or
+    // item assignment.
+    if (builtin == &PyList_Type &&
+        (tp->tp_iter != PyList_Type.tp_iter ||
+         _PyType_Lookup(tp, module_state.s_append) !=
+             _PyType_Lookup(&PyList_Type, module_state.s_append)))
+        return 0;
+    if (builtin == &PyDict_Type &&
+        (tp->tp_as_mapping->mp_ass_subscript != PyDict_Type.tp_as_mapping->mp_ass_subscript ||
+         _PyType_Lookup(tp, module_state.s_items) !=
+             _PyType_Lookup(&PyDict_Type, module_state.s_items)))
+        return 0;
+
+    if (declares_slots(tp))
+        return 0;
+    *getnewargs = found;
+    return 1;
+}
+
+static PyObject* deepcopy_subclass(
+    PyObject* original, PyTypeObject* tp, PyObject* getnewargs, PyMemoObject* memo,
+    Py_ssize_t memo_key_hash
+) {
+    PyObject** dictptr = tp->tp_dictoffset ? _PyObject_GetDictPtr(original) : NULL;
+    PyObject* dict = dictptr && *dictptr && PyDict_GET_SIZE(*dictptr) ? *dictptr : NULL;
+    if (has_registered_reductor(tp) ||
+        (dict &&
+         (shadows_reduce_protocol(dict) || PyDict_Contains(dict, module_state.s_append) ||
+          PyDict_Contains(dict, module_state.s_items))))
+        return SLOW_COPY_ROUTE(deepcopy_object(original, tp, memo, memo_key_hash));
+
+    COPIUM_STAT(subclass);
+    PyObject* copied;
+    if (PyTuple_Check(original)) {
+        // The items are arguments of the reconstruction: copied before the instance exists.
+        Py_ssize_t size = PyTuple_GET_SIZE(original);
+        PyObject* items = PyTuple_New(size);
+        if (!items)
+            return NULL;
+        for (Py_ssize_t i = 0; i < size; i++) {
+            PyObject* item_copy = deepcopy(PyTuple_GET_ITEM(original, i), memo);
+            if (!item_copy) {
+                Py_DECREF(items);
+                return NULL;
+            }
+            PyTuple_SET_ITEM(items, i, item_copy);
+        }
+        newfunc tp_new = tp->tp_new;
+        PyObject* args;
+        if (!PyFunction_Check(getnewargs)) {
+            args = PyTuple_Pack(1, items);
+        } else if (PyFunction_GET_CODE(getnewargs) == module_state.namedtuple___getnewargs___code) {
+            args = Py_NewRef(items);
+        } else if (((PyCodeObject*)PyFunction_GET_CODE(getnewargs))->co_argcount == size + 1) {
+            tp_new = PyTuple_Type.tp_new;
+            args = PyTuple_Pack(1, items);
+        } else {
+            args = Py_NewRef(items);  // for the generated __new__ to reject
+        }
+        Py_DECREF(items);
+        if (!args)
+            return NULL;
+        copied = tp_new(tp, args, NULL);
+        Py_DECREF(args);
+    } else {
+        PyObject* args = PyTuple_New(0);
+        if (!args)
+            return NULL;
+        copied = tp->tp_new(tp, args, NULL);
+        Py_DECREF(args);
+    }
+    if (!copied)
+        return NULL;
+    if (memoize(memo, original, copied, memo_key_hash) < 0) {
+        Py_DECREF(copied);
+        return NULL;
+    }
+
+    // Same order as applying the reduced state: the __dict__ first, then the items.
+    int status = dict ? apply_dict_state(copied, dict, memo) : 0;
+    if (status == 0 && PyList_Check(original)) {
+        for (Py_ssize_t i = 0; status == 0 && i < PyList_GET_SIZE(original); i++) {
+            PyObject* item = Py_NewRef(PyList_GET_ITEM(original, i));
+            PyObject* item_copy = deepcopy(item, memo);
+            Py_DECREF(item);
+            status = item_copy ? PyList_Append(copied, item_copy) : -1;
+            Py_XDECREF(item_copy);
+        }
+    } else if (status == 0 && PyDict_Check(original)) {
+        status = deepcopy_dict_items_into(copied, original, memo);
+    }
+    if (status < 0) {
+        forget(memo, original, memo_key_hash);
+        Py_DECREF(copied);
+        return NULL;
+    }
+    return copied;
+}
+
 static PyObject* deepcopy_object(
     PyObject* original, PyTypeObject* tp, PyMemoObject* memo, Py_ssize_t memo_key_hash
 ) {
+    COPIUM_STAT(reduce);
+    COPIUM_STAT_REDUCE_TYPE(tp);
+    // A reductor, __reduce_ex__ or __getstate__ may hand back originals in what it returns.
+    if (memo_expose(memo) < 0)
+        return NULL;
+    ReducePlan plan = REDUCE_PLAN_GENERIC;
     PyObject* reduce_result = try_reduce_via_registry(original, tp);
-    if (!reduce_result) {
+    if (reduce_result) {
+        COPIUM_STAT(registry);
+    } else {
         if (PyErr_Occurred())
             return NULL;
+        plan = type_cache_reduce_plan(tp);
+        if (plan == REDUCE_PLAN_NEWOBJ_DICT || plan == REDUCE_PLAN_NEWOBJ_SLOTS) {
+            SlotPlan slots;
+            int slotted = type_cache_slot_plan(tp, &slots);
+            PyObject* instance;
+            if (reconstruct_newobj_state(
+                    original, tp, slotted ? &slots : NULL, memo, memo_key_hash, &instance
+                ))
+                return instance;
+        }
         reduce_result = call_reduce_method_preferring_ex(original);
         if (!reduce_result)
             return NULL;
@@ -875,6 +2494,13 @@ static PyObject* deepcopy_object(
         return Py_NewRef(original);
     }
 
+    if (plan == REDUCE_PLAN_UNKNOWN) {
+        SlotPlan slots;
+        type_cache_set_reduce_plan(
+            tp, classify_reduce(tp, callable, argtup, state, listitems, dictitems, &slots), &slots
+        );
+    }
+
     PyObject* instance;
     if (callable == module_state.copyreg___newobj__)
         instance = reconstruct_newobj(argtup, memo);
@@ -14,6 +14,7 @@
 #include "_type_checks.c"
 #include "_recursion_guard.c"
 #include "_memo_legacy.c"
+#include "_slow_copy.c"
 
 /* _PySet_NextEntry() */
 #if PY_VERSION_HEX >= PY_VERSION_3_13_HEX
@@ -90,7 +91,7 @@ static ALWAYS_INLINE PyObject* deepcopy_legacy(
     if (type == &PyMethod_Type)
         return deepcopy_method_legacy(original, memo, keepalive_pointer);
 
-    if (is_stdlib_immutable(type))
+    if (is_stdlib_immutable(type) || is_configured_atomic(type) || is_shared_by_call(type))
         return Py_NewRef(original);
 
     PyObject* __deepcopy__ = NULL;
@@ -98,7 +99,7 @@ static ALWAYS_INLINE PyObject* deepcopy_legacy(
     if (has_deepcopy < 0)
         return NULL;
     if (has_deepcopy) {
-        PyObject* copied = PyObject_CallOneArg(__deepcopy__, memo);
+        PyObject* copied = SLOW_COPY_ROUTE(PyObject_CallOneArg(__deepcopy__, memo));
         Py_DECREF(__deepcopy__);
 
         if (!copied)
@@ -117,7 +118,7 @@ static ALWAYS_INLINE PyObject* deepcopy_legacy(
         return copied;
     }
 
-    return deepcopy_object_legacy(original, type, memo, keepalive_pointer);
+    return SLOW_COPY_ROUTE(deepcopy_object_legacy(original, type, memo, keepalive_pointer));
 }
 
 static MAYBE_INLINE PyObject* deepcopy_list_legacy(
@@ -0,0 +1,136 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Dict copies that start as a clone of the original's table
+ *
+ * When every key of a dict is a literal immutable, its deep copy has the very same keys in the
+ * very same order. PyDict_Copy() then makes that copy for us at the table level: it clones the
+ * keys object with the cached hashes (or shares a split table's keys) instead of inserting
+ * entries one by one. All that's left is to swap each value for its copy, which is written
+ * straight into the entry that holds it.
+ *
+ * A list of records, dicts whose keys and values are all literal immutables (rows of an API
+ * response or a query), goes further: the clone of such a dict is its deep copy, done. The list
+ * takes it for such an item right away instead of pushing a frame that would only go over its
+ * values to put every one of them back (see copy_frame_list_record()). A table of str keys only
+ * has atomic keys by its kind, so telling a record apart is a scan over its values alone. The
+ * rows of a list tend to be shaped alike, so it stops looking after a dict that isn't one.
+ *
+ * Only done where the table layout is known: 3.11+ with the GIL.
+ */
+#ifndef _COPIUM_DICT_CLONE_C
+#define _COPIUM_DICT_CLONE_C
+
+#include "_common.h"
+#include "_type_checks.c"
+
+#if PY_VERSION_HEX >= PY_VERSION_3_11_HEX && !defined(Py_GIL_DISABLED)
+    #define COPIUM_DICT_CLONE 1
+    #if PY_VERSION_HEX < PY_VERSION_3_13_HEX
+        #include "pycore_dict.h"
+    #endif
+#else
+    #define COPIUM_DICT_CLONE 0
+#endif
+
+#if COPIUM_DICT_CLONE
+
+// Whether a deep copy of dict would come out with its keys as they are.
+static ALWAYS_INLINE int dict_keys_all_atomic(PyObject* dict) {
+    Py_ssize_t pos = 0;
+    PyObject *key, *value;
+    while (PyDict_Next(dict, &pos, &key, &value)) {
+        if (!is_literal_immutable(Py_TYPE(key)))
+            return 0;
+    }
+    return 1;
+}
+
+// Whether the clone of dict is its deep copy: its keys and values are all literal immutables.
+static ALWAYS_INLINE int dict_is_record(PyObject* dict) {
+    PyDictObject* d = (PyDictObject*)dict;
+    PyDictKeysObject* keys = d->ma_keys;
+    Py_ssize_t n = keys->dk_nentries;
+    if (d->ma_values) {
+        PyObject** values = d->ma_values->values;
+        for (Py_ssize_t i = 0; i < n; i++) {
+            if (values[i] && !is_literal_immutable(Py_TYPE(values[i])))
+                return 0;
+        }
+        return 1;
+    }
+    if (DK_IS_UNICODE(keys)) {
+        PyDictUnicodeEntry* entries = DK_UNICODE_ENTRIES(keys);
+        for (Py_ssize_t i = 0; i < n; i++) {
+            PyObject* value = entries[i].me_value;
+            if (value && !is_literal_immutable(Py_TYPE(value)))
+                return 0;
+        }
+        return 1;
+    }
+    PyDictKeyEntry* entries = DK_ENTRIES(keys);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject* value = entries[i].me_value;
+        if (value && (!is_literal_immutable(Py_TYPE(value)) ||
+                      !is_literal_immutable(Py_TYPE(entries[i].me_key))))
+            return 0;
+    }
+    return 1;
+}
+
+// Key and value slot of the i-th entry of dict's table. The value is NULL for an unused entry.
+static ALWAYS_INLINE PyObject** dict_clone_entry(PyDictObject* dict, Py_ssize_t i, PyObject** key) {
+    PyDictKeysObject* keys = dict->ma_keys;
+    if (dict->ma_values) {
+        *key = DK_UNICODE_ENTRIES(keys)[i].me_key;
+        return &dict->ma_values->values[i];
+    }
+    if (DK_IS_UNICODE(keys)) {
+        PyDictUnicodeEntry* entry = &DK_UNICODE_ENTRIES(keys)[i];
+        *key = entry->me_key;
+        return &entry->me_value;
+    }
+    PyDictKeyEntry* entry = &DK_ENTRIES(keys)[i];
+    *key = entry->me_key;
+    return &entry->me_value;
+}
+
+/*
+ * Replaces the value of key in clone with value. Steals both. *cursor is the entry past the last
+ * one replaced: keys come in the clone's order, so the entry is normally the next used one. If
+ * it isn't (a split table keeping another order, or Python code that got hold of the clone
+ * through the memo changed it) the value goes in by lookup instead.
+ */
+static ALWAYS_INLINE int dict_clone_replace(
+    PyObject* clone, Py_ssize_t* cursor, PyObject* key, PyObject* value
+) {
+    PyDictObject* dict = (PyDictObject*)clone;
+    Py_ssize_t n = dict->ma_keys->dk_nentries;
+    for (Py_ssize_t i = *cursor; i < n; i++) {
+        PyObject* entry_key;
+        PyObject** slot = dict_clone_entry(dict, i, &entry_key);
+        if (!*slot)
+            continue;
+        if (UNLIKELY(entry_key != key))
+            break;
+        PyObject* old = *slot;
+        *slot = value;
+        *cursor = i + 1;
+        // The clone is only tracked if the original was: a copy may need it when its original
+        // didn't (an object whose type isn't GC, say, copied into one that is).
+        if (UNLIKELY(!PyObject_GC_IsTracked(clone)) && PyObject_IS_GC(value))
+            PyObject_GC_Track(clone);
+        Py_DECREF(key);
+        Py_DECREF(old);
+        return 0;
+    }
+    return COPIUM_PyDict_SetItem_Take2(dict, key, value);
+}
+
+#endif  // COPIUM_DICT_CLONE
+
+#endif  // _COPIUM_DICT_CLONE_C
@@ -13,9 +13,9 @@
 #if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
     #include <stdatomic.h>
 
+// Guards of all interpreters are in one list; the watcher (module_state.dict_watcher_id) is
+// added to each interpreter on its own.
 static PyMutex g_dictiter_mutex = {0};
-static int g_dict_watcher_id = -1;
-static int g_dict_watcher_registered = 0;
 
     #ifdef Py_GIL_DISABLED
 
@@ -125,8 +125,8 @@ static ALWAYS_INLINE int dict_iter_init(DictIterGuard* iter_guard, PyObject* dic
         g_guard_list_head->prev = iter_guard;
     }
     g_guard_list_head = iter_guard;
-    if (need_watch && g_dict_watcher_registered) {
-        PyDict_Watch(g_dict_watcher_id, dict);
+    if (need_watch && module_state.dict_watcher_id >= 0) {
+        PyDict_Watch(module_state.dict_watcher_id, dict);
     }
     PyMutex_Unlock(&g_dictiter_mutex);
 
@@ -146,8 +146,8 @@ static ALWAYS_INLINE void dict_iter_cleanup(DictIterGuard* iter_guard) {
         iter_guard->next->prev = iter_guard->prev;
     }
     int need_unwatch = (dict_watch_count_locked(dict) == 0);
-    if (need_unwatch && g_dict_watcher_registered) {
-        PyDict_Unwatch(g_dict_watcher_id, dict);
+    if (need_unwatch && module_state.dict_watcher_id >= 0) {
+        PyDict_Unwatch(module_state.dict_watcher_id, dict);
     }
     PyMutex_Unlock(&g_dictiter_mutex);
 }
@@ -240,27 +240,16 @@ static ALWAYS_INLINE int dict_iter_next(
 }
 #endif
 
-static int dict_iter_module_init(void) {
+// Left to the interpreter to clear when it goes away.
+static int dict_iter_interp_init(InterpState* interp) {
 #if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
     #ifndef Py_GIL_DISABLED
-    g_dict_watcher_id = PyDict_AddWatcher(_copium_dict_watcher_cb);
-    if (g_dict_watcher_id < 0)
+    interp->dict_watcher_id = PyDict_AddWatcher(_copium_dict_watcher_cb);
+    if (interp->dict_watcher_id < 0)
         return -1;
-    g_dict_watcher_registered = 1;
     #endif
 #endif
+    (void)interp;
     return 0;
 }
-
-static void dict_iter_module_cleanup(void) {
-#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
-    #ifndef Py_GIL_DISABLED
-    if (g_dict_watcher_registered) {
-        PyDict_ClearWatcher(g_dict_watcher_id);
-        g_dict_watcher_registered = 0;
-        g_dict_watcher_id = -1;
-    }
-    #endif
-#endif
-}
 #endif  // _COPIUM_DICT_ITER_C
@@ -179,6 +179,19 @@ done:
     return result;
 }
 
+// Before 3.12 the patched copy.deepcopy is a Python function of copium's own, made from the
+// template in _patching.c: whoever called it is the frame below.
+static int _is_patched_deepcopy_frame(PyCodeObject* code) {
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+    PyCodeObject* template = (PyCodeObject*)module_state.patch_template_code;
+    return template && code->co_filename == template->co_filename &&
+        code->co_name == template->co_name;
+#else
+    (void)code;
+    return 0;
+#endif
+}
+
 static PyObject* _get_caller_frame_info(void) {
     PyObject* result = NULL;
     PyObject* linecache = NULL;
@@ -197,6 +210,8 @@ static PyObject* _get_caller_frame_info(void) {
 
     while (frame) {
         code = PyFrame_GetCode(frame);
+        if (code && _is_patched_deepcopy_frame(code))
+            Py_CLEAR(code);
         if (!code) {
             PyFrameObject* back = PyFrame_GetBack(frame);
             Py_DECREF(frame);
@@ -531,6 +546,7 @@ static PyObject* _maybe_retry_with_dict_memo(
         return NULL;
     }
 
+    COPIUM_STAT(dict_memo_retry);
     PyErr_Fetch(&exc_type, &exc_value, &exc_tb);
     PyErr_NormalizeException(&exc_type, &exc_value, &exc_tb);
 
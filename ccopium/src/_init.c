@@ -18,80 +18,188 @@
 #include "_state.c"
 #include "_dict_iter.c"
 #include "_memo.c"
+#include "_stats.c"
+#include "_type_cache.c"
+#include "_capi.c"
 
-/* Tracks initialization state for proper cleanup in reverse order */
-static struct {
-    int strings_ready;
-    int types_ready;
-    int copyreg_ready;
-    int sentinel_ready;
-    int memo_tss_ready;
-    int dict_iter_ready;
-    int memo_types_ready;
-    int error_attr_ready;
-} _init_state = {0};
-
-static void _copium_cleanup(void) {
-    /* Clean up in reverse order of initialization */
-
-    Py_CLEAR(module_state.ignored_errors);
-    Py_CLEAR(module_state.ignored_errors_joined);
-    module_state.memo_mode = COPIUM_MEMO_NATIVE;
-    module_state.on_incompatible = COPIUM_ON_INCOMPATIBLE_WARN;
+/*
+ * Everything here fills in module_state, the state of the module being executed: copium_exec()
+ * enters it for the duration. The state starts out zeroed and copium_state_clear() copes with
+ * any part of it missing, so it undoes a failed init as well as a finished one.
+ */
 
-    if (_init_state.dict_iter_ready) {
-        dict_iter_module_cleanup();
-        _init_state.dict_iter_ready = 0;
-    }
+#define COPIUM_STATE_OBJECTS(X)                                                             \
+    X(s__reduce_ex__)                                                                       \
+    X(s__reduce__)                                                                          \
+    X(s__deepcopy__)                                                                        \
+    X(s__copy__)                                                                            \
+    X(s__setstate__)                                                                        \
+    X(s__dict__)                                                                            \
+    X(s_append)                                                                             \
+    X(s_update)                                                                             \
+    X(s__new__)                                                                             \
+    X(s__get__)                                                                             \
+    X(s__getstate__)                                                                        \
+    X(s__getnewargs_ex__)                                                                   \
+    X(s__getnewargs__)                                                                      \
+    X(s__slotnames__)                                                                       \
+    X(s__slots__)                                                                           \
+    X(s_items)                                                                              \
+    X(s_extend)                                                                             \
+    X(s_maxlen)                                                                             \
+    X(s_default_factory)                                                                    \
+    X(s_tzinfo)                                                                             \
+    X(sentinel)                                                                             \
+    X(BuiltinFunctionType)                                                                  \
+    X(MethodType)                                                                           \
+    X(CodeType)                                                                             \
+    X(range_type)                                                                           \
+    X(property_type)                                                                        \
+    X(weakref_ref_type)                                                                     \
+    X(re_Pattern_type)                                                                      \
+    X(Decimal_type)                                                                         \
+    X(Fraction_type)                                                                        \
+    X(OrderedDict_type)                                                                     \
+    X(defaultdict_type)                                                                     \
+    X(deque_type)                                                                           \
+    X(Counter_type)                                                                         \
+    X(date_type)                                                                            \
+    X(timedelta_type)                                                                       \
+    X(timezone_type)                                                                        \
+    X(datetime_type)                                                                        \
+    X(time_type)                                                                            \
+    X(UUID_type)                                                                            \
+    X(PurePosixPath_type)                                                                   \
+    X(PureWindowsPath_type)                                                                 \
+    X(PosixPath_type)                                                                       \
+    X(WindowsPath_type)                                                                     \
+    X(IPv4Address_type)                                                                     \
+    X(IPv6Address_type)                                                                     \
+    X(IPv4Network_type)                                                                     \
+    X(IPv6Network_type)                                                                     \
+    X(IPv4Interface_type)                                                                   \
+    X(IPv6Interface_type)                                                                   \
+    X(array_type)                                                                           \
+    X(EnumType)                                                                             \
+    X(Enum___deepcopy__)                                                                    \
+    X(namedtuple___getnewargs___code)                                                       \
+    X(copyreg_dispatch)                                                                     \
+    X(copy_Error)                                                                           \
+    X(copyreg___newobj__)                                                                   \
+    X(copyreg___newobj___ex)                                                                \
+    X(registered_types)                                                                     \
+    X(atomic_types)                                                                         \
+    X(ignored_errors)                                                                       \
+    X(ignored_errors_joined)                                                                \
+    X(slow_copy_callback)                                                                   \
+    X(dict_items_descr)                                                                     \
+    X(Memo_Type)                                                                            \
+    X(KeepaliveList_Type)                                                                   \
+    X(MemoKeysView_Type)                                                                    \
+    X(MemoValuesView_Type)                                                                  \
+    X(MemoItemsView_Type)                                                                   \
+    X(MemoViewIter_Type)                                                                    \
+    X(Plan_Type)                                                                            \
+    X(Replicator_Type)                                                                      \
+    X(SnapshotNode_Type)                                                                    \
+    X(Snapshotter_Type)
+
+static int copium_state_traverse(ModuleState* state, visitproc visit, void* arg) {
+#define VISIT_STATE_OBJECT(field) Py_VISIT(state->field);
+    COPIUM_STATE_OBJECTS(VISIT_STATE_OBJECT)
+#undef VISIT_STATE_OBJECT
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+    Py_VISIT(state->patch_template_code);
+#endif
+    return 0;
+}
 
-    if (_init_state.memo_tss_ready) {
-        if (PyThread_tss_is_created(&module_state.memo_tss)) {
-            PyThread_tss_delete(&module_state.memo_tss);
-        }
-        _init_state.memo_tss_ready = 0;
-    }
+static void copium_state_clear(ModuleState* state) {
+    // Routes cached for registered types point into the registry.
+    PyObject* registered = state->registered_types;
+    PyObject *tp, *entry;
+    Py_ssize_t pos = 0;
+    while (registered && PyDict_Next(registered, &pos, &tp, &entry))
+        PyType_Modified((PyTypeObject*)tp);
+    // And the ones of the configured atomic types outlive them otherwise.
+    PyObject* atomic = state->atomic_types;
+    for (Py_ssize_t i = 0; atomic && i < PyTuple_GET_SIZE(atomic); i++)
+        PyType_Modified((PyTypeObject*)PyTuple_GET_ITEM(atomic, i));
+
+#define CLEAR_STATE_OBJECT(field) Py_CLEAR(state->field);
+    COPIUM_STATE_OBJECTS(CLEAR_STATE_OBJECT)
+#undef CLEAR_STATE_OBJECT
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+    Py_CLEAR(state->patch_template_code);
+#endif
+    state->dict_items_vc = NULL;
+    state->memo_mode = COPIUM_MEMO_NATIVE;
+    state->on_incompatible = COPIUM_ON_INCOMPATIBLE_WARN;
+    state->memo_retention = COPIUM_MEMO_RETENTION_ADAPTIVE;
+}
 
-    if (_init_state.sentinel_ready) {
-        Py_CLEAR(module_state.sentinel);
-        _init_state.sentinel_ready = 0;
-    }
+static void copium_state_free(ModuleState* state) {
+    copium_state_clear(state);
+    // No thread has a memo left: it would have kept Memo_Type, and with it the module, alive.
+    if (PyThread_tss_is_created(&state->memo_tss))
+        PyThread_tss_delete(&state->memo_tss);
+    InterpState* interp = copium_interp();
+    if (interp && interp->state == state)
+        interp->state = NULL;
+}
 
-    if (_init_state.copyreg_ready) {
-        Py_CLEAR(module_state.copyreg_dispatch);
-        Py_CLEAR(module_state.copy_Error);
-        Py_CLEAR(module_state.copyreg___newobj__);
-        Py_CLEAR(module_state.copyreg___newobj___ex);
-        _init_state.copyreg_ready = 0;
-    }
+/* ------------------------- Per-interpreter state ---------------------------- */
+
+static void copium_interp_free(PyObject* capsule) {
+    InterpState* interp = (InterpState*)PyCapsule_GetPointer(capsule, COPIUM_INTERP_CAPSULE);
+    if (!interp)
+        return;
+    if (copium_interp_cache.interp == interp)
+        copium_interp_cache = (InterpStateCache){0, NULL};
+#if COPIUM_STATS
+    stats_free_blocks(interp);
+#endif
+    PyMem_RawFree(interp);
+}
 
-    if (_init_state.types_ready) {
-        Py_CLEAR(module_state.BuiltinFunctionType);
-        Py_CLEAR(module_state.MethodType);
-        Py_CLEAR(module_state.CodeType);
-        Py_CLEAR(module_state.range_type);
-        Py_CLEAR(module_state.property_type);
-        Py_CLEAR(module_state.weakref_ref_type);
-        Py_CLEAR(module_state.re_Pattern_type);
-        Py_CLEAR(module_state.Decimal_type);
-        Py_CLEAR(module_state.Fraction_type);
-        _init_state.types_ready = 0;
-    }
+static InterpState* copium_interp_ensure(void) {
+    InterpState* interp = copium_interp();
+    if (interp)
+        return interp;
 
-    if (_init_state.strings_ready) {
-        Py_CLEAR(module_state.s__reduce_ex__);
-        Py_CLEAR(module_state.s__reduce__);
-        Py_CLEAR(module_state.s__deepcopy__);
-        Py_CLEAR(module_state.s__setstate__);
-        Py_CLEAR(module_state.s__dict__);
-        Py_CLEAR(module_state.s_append);
-        Py_CLEAR(module_state.s_update);
-        Py_CLEAR(module_state.s__new__);
-        Py_CLEAR(module_state.s__get__);
-        _init_state.strings_ready = 0;
+    PyObject* dict = PyInterpreterState_GetDict(PyInterpreterState_Get());
+    if (!dict) {
+        PyErr_SetString(PyExc_ImportError, "copium: interpreter has no state dict");
+        return NULL;
+    }
+    interp = (InterpState*)PyMem_RawCalloc(1, sizeof(InterpState));
+    if (!interp) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    interp->dict_watcher_id = -1;
+    interp->snapshot_watcher_id = -1;
+    PyObject* capsule = PyCapsule_New(interp, COPIUM_INTERP_CAPSULE, copium_interp_free);
+    if (!capsule) {
+        PyMem_RawFree(interp);
+        return NULL;
     }
+    int status = PyDict_SetItemString(dict, COPIUM_INTERP_CAPSULE, capsule);
+    Py_DECREF(capsule);
+    if (status < 0)
+        return NULL;
+    if (dict_iter_interp_init(interp) < 0)
+        return NULL;
+    return copium_interp();
+}
 
-    Py_CLEAR(module_state.dict_items_descr);
-    module_state.dict_items_vc = NULL;
+// Cached routes and counters of another interpreter are of no use here, and may outlive it.
+static void copium_adopt_interp(ModuleState* state) {
+    memset(_copium_type_cache, 0, sizeof(_copium_type_cache));
+#if COPIUM_STATS
+    stats_local = NULL;
+#endif
+    copium_thread_interp = state->interp_id;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -116,16 +224,31 @@ static int _init_strings(void) {
     module_state.s__reduce_ex__ = PyUnicode_InternFromString("__reduce_ex__");
     module_state.s__reduce__ = PyUnicode_InternFromString("__reduce__");
     module_state.s__deepcopy__ = PyUnicode_InternFromString("__deepcopy__");
+    module_state.s__copy__ = PyUnicode_InternFromString("__copy__");
     module_state.s__setstate__ = PyUnicode_InternFromString("__setstate__");
     module_state.s__dict__ = PyUnicode_InternFromString("__dict__");
     module_state.s_append = PyUnicode_InternFromString("append");
     module_state.s_update = PyUnicode_InternFromString("update");
     module_state.s__new__ = PyUnicode_InternFromString("__new__");
     module_state.s__get__ = PyUnicode_InternFromString("get");
+    module_state.s__getstate__ = PyUnicode_InternFromString("__getstate__");
+    module_state.s__getnewargs_ex__ = PyUnicode_InternFromString("__getnewargs_ex__");
+    module_state.s__getnewargs__ = PyUnicode_InternFromString("__getnewargs__");
+    module_state.s__slotnames__ = PyUnicode_InternFromString("__slotnames__");
+    module_state.s__slots__ = PyUnicode_InternFromString("__slots__");
+    module_state.s_items = PyUnicode_InternFromString("items");
+    module_state.s_extend = PyUnicode_InternFromString("extend");
+    module_state.s_maxlen = PyUnicode_InternFromString("maxlen");
+    module_state.s_default_factory = PyUnicode_InternFromString("default_factory");
+    module_state.s_tzinfo = PyUnicode_InternFromString("tzinfo");
 
     if (!module_state.s__reduce_ex__ || !module_state.s__reduce__ || !module_state.s__deepcopy__ ||
-        !module_state.s__setstate__ || !module_state.s__dict__ || !module_state.s_append ||
-        !module_state.s_update || !module_state.s__new__ || !module_state.s__get__) {
+        !module_state.s__copy__ || !module_state.s__setstate__ || !module_state.s__dict__ ||
+        !module_state.s_append || !module_state.s_update || !module_state.s__new__ ||
+        !module_state.s__get__ || !module_state.s__getstate__ || !module_state.s__getnewargs_ex__ ||
+        !module_state.s__getnewargs__ || !module_state.s__slotnames__ || !module_state.s__slots__ ||
+        !module_state.s_items || !module_state.s_extend || !module_state.s_maxlen ||
+        !module_state.s_default_factory || !module_state.s_tzinfo) {
         PyErr_SetString(PyExc_ImportError, "copium: failed to intern required names");
         return -1;
     }
@@ -136,9 +259,6 @@ static int _init_types(void) {
     PyObject* mod_types = NULL;
     PyObject* mod_builtins = NULL;
     PyObject* mod_weakref = NULL;
-    PyObject* mod_re = NULL;
-    PyObject* mod_decimal = NULL;
-    PyObject* mod_fractions = NULL;
     int result = -1;
 
     mod_types = PyImport_ImportModule("types");
@@ -153,27 +273,16 @@ static int _init_types(void) {
     if (!mod_weakref)
         goto done;
 
-    mod_re = PyImport_ImportModule("re");
-    if (!mod_re)
-        goto done;
-
-    mod_decimal = PyImport_ImportModule("decimal");
-    if (!mod_decimal)
-        goto done;
-
-    mod_fractions = PyImport_ImportModule("fractions");
-    if (!mod_fractions)
-        goto done;
-
     LOAD_TYPE(mod_types, "BuiltinFunctionType", BuiltinFunctionType);
     LOAD_TYPE(mod_types, "CodeType", CodeType);
     LOAD_TYPE(mod_types, "MethodType", MethodType);
     LOAD_TYPE(mod_builtins, "property", property_type);
     LOAD_TYPE(mod_builtins, "range", range_type);
     LOAD_TYPE(mod_weakref, "ref", weakref_ref_type);
-    LOAD_TYPE(mod_re, "Pattern", re_Pattern_type);
-    LOAD_TYPE(mod_decimal, "Decimal", Decimal_type);
-    LOAD_TYPE(mod_fractions, "Fraction", Fraction_type);
+
+    // The rest are found once their modules get imported (see stdlib_resolve_imported()).
+    module_state.stdlib_pending = STDLIB_ALL;
+    stdlib_resolve_imported();
 
     result = 0;
 
@@ -181,9 +290,6 @@ done:
     Py_XDECREF(mod_types);
     Py_XDECREF(mod_builtins);
     Py_XDECREF(mod_weakref);
-    Py_XDECREF(mod_re);
-    Py_XDECREF(mod_decimal);
-    Py_XDECREF(mod_fractions);
 
     if (result < 0 && !PyErr_Occurred()) {
         PyErr_SetString(PyExc_ImportError, "copium: failed to import required stdlib modules");
@@ -319,6 +425,11 @@ static int _load_config_from_env(void) {
     module_state.memo_mode = (use_dict && use_dict[0]) ? COPIUM_MEMO_DICT : COPIUM_MEMO_NATIVE;
     module_state.on_incompatible = (no_fallback && no_fallback[0]) ? COPIUM_ON_INCOMPATIBLE_RAISE
                                                                    : COPIUM_ON_INCOMPATIBLE_WARN;
+    module_state.memo_retention = COPIUM_MEMO_RETENTION_ADAPTIVE;
+    Py_CLEAR(module_state.slow_copy_callback);
+    module_state.slow_copy_threshold_ns = -1;
+    module_state.slow_copy_sample = 0;
+    set_atomic_types(NULL);
 
     PyObject* parsed = _parse_ignored_errors();
     if (!parsed)
@@ -327,67 +438,59 @@ static int _load_config_from_env(void) {
     return _copium_update_suppress_warnings(parsed);
 }
 
-int _copium_init(PyObject* module) {
-    if (_load_config_from_env() < 0)
-        goto error;
+// Fills in the state of module, which must have been entered.
+static int _copium_init(PyObject* module) {
+    InterpState* interp = copium_interp_ensure();
+    if (!interp)
+        return -1;
+    module_state.interp_id = PyInterpreterState_GetID(PyInterpreterState_Get());
+    module_state.dict_watcher_id = interp->dict_watcher_id;
 
+    if (_load_config_from_env() < 0)
+        return -1;
     if (_init_strings() < 0)
-        goto error;
-    _init_state.strings_ready = 1;
-
+        return -1;
     if (_init_types() < 0)
-        goto error;
-    _init_state.types_ready = 1;
-
+        return -1;
     if (_init_copy_and_copyreg() < 0)
-        goto error;
-    _init_state.copyreg_ready = 1;
+        return -1;
 
     module_state.sentinel = PyList_New(0);
     if (!module_state.sentinel) {
         PyErr_SetString(PyExc_ImportError, "copium: failed to create sentinel list");
-        goto error;
+        return -1;
     }
-    _init_state.sentinel_ready = 1;
 
     module_state.dict_items_descr = PyObject_GetAttrString((PyObject*)&PyDict_Type, "items");
     if (!module_state.dict_items_descr)
-        goto error;
+        return -1;
 
     module_state.dict_items_vc = PyVectorcall_Function(module_state.dict_items_descr);
     if (!module_state.dict_items_vc) {
         PyErr_SetString(PyExc_TypeError, "copium: failed to intern dict.items vectorcall");
-        goto error;
+        return -1;
     }
 
     if (PyThread_tss_create(&module_state.memo_tss) != 0) {
         PyErr_SetString(PyExc_ImportError, "copium: failed to create memo TSS");
-        goto error;
+        return -1;
     }
-    _init_state.memo_tss_ready = 1;
-
-    if (dict_iter_module_init() < 0)
-        goto error;
-    _init_state.dict_iter_ready = 1;
 
-    if (memo_ready_types() < 0)
-        goto error;
-    _init_state.memo_types_ready = 1;
+    if (memo_make_types(module) < 0)
+        return -1;
 
     /* Register Memo with collections.abc.MutableMapping */
     if (memo_register_abcs() < 0)
-        goto error;
+        return -1;
 
     if (PyObject_SetAttrString(module, "Error", module_state.copy_Error) < 0)
-        goto error;
-    _init_state.error_attr_ready = 1;
+        return -1;
 
-    return 0;
+    if (capi_init(module) < 0)
+        return -1;
 
-error:
-    _copium_cleanup();
-    return -1;
+    interp->state = &module_state;
+    return 0;
 }
 
-
 #endif /* _COPIUM_INIT_C */
\ No newline at end of file
@@ -16,6 +16,8 @@
 #include "_common.h"
 #include "_state.c"
 #include "_abc_registration.c"
+#include "_stats.c"
+#include "_copy_stack.c"
 
 #include <stdint.h>
 #include <stdlib.h>
@@ -23,14 +25,23 @@
 
 /* ------------------------------ Memo table -------------------------------- */
 
-typedef struct {
-    void* key;
-    PyObject* value; /* stored with a strong reference inside the table */
-} MemoEntry;
+/*
+ * Swiss-table layout: one control byte per slot and keys and values in arrays of their own.
+ * A full slot's control byte holds the low 7 bits of its hash, so probing compares a whole
+ * group of MEMO_GROUP_WIDTH control bytes at once and only touches the keys that matched.
+ * The first MEMO_GROUP_WIDTH - 1 control bytes are mirrored past the end, which lets a group
+ * be loaded starting at any slot.
+ */
+#define MEMO_GROUP_WIDTH 16
+#define MEMO_CTRL_EMPTY ((uint8_t)0x80)
+#define MEMO_CTRL_DELETED ((uint8_t)0xFE)
+#define MEMO_CTRL_IS_FULL(c) ((c) < 0x80)
 
 typedef struct {
-    MemoEntry* slots;
-    Py_ssize_t size;   /* power-of-two capacity */
+    uint8_t* ctrl;     /* size + MEMO_GROUP_WIDTH - 1 control bytes */
+    void** keys;       /* owns the single allocation that values and ctrl live in */
+    PyObject** values; /* stored with strong references for full slots */
+    Py_ssize_t size;   /* power-of-two capacity, at least MEMO_GROUP_WIDTH */
     Py_ssize_t used;   /* number of live entries */
     Py_ssize_t filled; /* live + tombstones */
 } MemoTable;
@@ -48,11 +59,49 @@ typedef struct {
     Py_ssize_t capacity;
 } MemoUndoLog;
 
+/*
+ * extra.parallel_deepcopy() support. Needs PyMutex (3.13+) and only pays off without a GIL, but
+ * can be forced on a GIL build to exercise it.
+ */
+#ifndef COPIUM_PARALLEL_DEEPCOPY
+    #ifdef Py_GIL_DISABLED
+        #define COPIUM_PARALLEL_DEEPCOPY 1
+    #else
+        #define COPIUM_PARALLEL_DEEPCOPY 0
+    #endif
+#endif
+#if COPIUM_PARALLEL_DEEPCOPY && PY_VERSION_HEX < PY_VERSION_3_13_HEX
+    #error "COPIUM_PARALLEL_DEEPCOPY requires Python 3.13+"
+#endif
+
+#if COPIUM_PARALLEL_DEEPCOPY
+typedef struct _ShardedMemo ShardedMemo;
+#endif
+
+#ifdef Py_GIL_DISABLED
+    #define COPIUM_LAZY_KEEPALIVE 0
+#else
+    #define COPIUM_LAZY_KEEPALIVE 1
+#endif
+
 /* Exact runtime layout of the memo object (must begin with PyObject_HEAD). */
 typedef struct _PyMemoObject {
     PyObject_HEAD MemoTable* table;
     KeepaliveVector keepalive;
     MemoUndoLog undo_log;
+    /* (original, copy) pairs whose table insert was elided, see memo_defer() */
+    KeepaliveVector deferred;
+    int defer_unique; /* nonzero while the memo hasn't been handed to Python code */
+    /* nonzero while keepalive holds none of the table's keys, see memo_keep_originals() */
+    int lazy_keepalive;
+    /* Decaying high-water marks of recent calls on this thread, see memo_retain() */
+    Py_ssize_t recent_entries;
+    Py_ssize_t recent_items;
+#if COPIUM_PARALLEL_DEEPCOPY
+    /* When set, lookups and inserts go to this memo instead of table, see sharded_memo_*() */
+    ShardedMemo* shared;
+#endif
+    CopyStack stack; /* frames of the container traversal, see deepcopy_containers() */
 } PyMemoObject;
 
 /* Forward decl to refer to Memo_Type in helpers */
@@ -60,6 +109,9 @@ typedef struct _PyMemoObject PyMemoObject;
 
 #define MEMO_TOMBSTONE ((void*)(uintptr_t)(-1))
 
+/* Passed in place of a real hash for originals that are memoized through memo_defer(). */
+#define MEMO_HASH_DEFERRED ((Py_ssize_t)-1)
+
 /* SplitMix64-style pointer hasher, stable across the process. */
 static ALWAYS_INLINE Py_ssize_t hash_pointer(void* ptr) {
     uintptr_t h = (uintptr_t)ptr;
@@ -68,6 +120,8 @@ static ALWAYS_INLINE Py_ssize_t hash_pointer(void* ptr) {
     h ^= h >> 33;
     h *= (uintptr_t)0xc4ceb9fe1a85ec53ULL;
     h ^= h >> 33;
+    if (UNLIKELY((Py_ssize_t)h == MEMO_HASH_DEFERRED))
+        h = (uintptr_t)-2;
     return (Py_ssize_t)h;
 }
 
@@ -78,7 +132,7 @@ static ALWAYS_INLINE Py_ssize_t memo_hash_pointer(void* ptr) {
 
 /* Retention policy caps for TLS memo/keepalive reuse */
 #ifndef COPIUM_MEMO_RETAIN_MAX_SLOTS
-    #define COPIUM_MEMO_RETAIN_MAX_SLOTS (1 << 17) /* 131072 slots (~2 MiB for 16B entries) */
+    #define COPIUM_MEMO_RETAIN_MAX_SLOTS (1 << 17) /* 131072 slots (~2 MiB at 17 bytes per slot) */
 #endif
 #ifndef COPIUM_MEMO_RETAIN_SHRINK_TO
     #define COPIUM_MEMO_RETAIN_SHRINK_TO (1 << 13) /* 8192 slots */
@@ -89,6 +143,9 @@ static ALWAYS_INLINE Py_ssize_t memo_hash_pointer(void* ptr) {
 #ifndef COPIUM_KEEP_RETAIN_TARGET
     #define COPIUM_KEEP_RETAIN_TARGET (1 << 10) /* 1024 elements */
 #endif
+#ifndef COPIUM_MEMO_RETAIN_DECAY_SHIFT
+    #define COPIUM_MEMO_RETAIN_DECAY_SHIFT 3 /* adaptive high-water mark loses 1/8 per call */
+#endif
 
 /* ------------------------------ Keep vector impl --------------------------- */
 
@@ -141,15 +198,20 @@ static void keepalive_free(KeepaliveVector* kv) {
     kv->capacity = 0;
 }
 
-/* Shrink capacity if it ballooned past the cap; keep it modest thereafter. */
-void keepalive_shrink_if_large(KeepaliveVector* kv) {
+/* Shrink capacity to target if it ballooned past limit. */
+static void keepalive_shrink_to(KeepaliveVector* kv, Py_ssize_t limit, Py_ssize_t target) {
     if (!kv || !kv->items)
         return;
-    if (kv->capacity > COPIUM_KEEP_RETAIN_MAX) {
-        Py_ssize_t target = COPIUM_KEEP_RETAIN_TARGET;
+    if (kv->capacity > limit) {
         if (target < kv->size) {
             /* In practice size==0 after clear, but be safe. */
-            target = kv->size ? kv->size : 1;
+            target = kv->size;
+        }
+        if (target == 0) {
+            PyMem_Free(kv->items);
+            kv->items = NULL;
+            kv->capacity = 0;
+            return;
         }
         PyObject** ni = (PyObject**)PyMem_Realloc(kv->items, (size_t)target * sizeof(PyObject*));
         if (ni) {
@@ -193,15 +255,17 @@ static void undo_log_free(MemoUndoLog* log) {
     log->capacity = 0;
 }
 
-/* Shrink undo log capacity if it ballooned past a threshold */
-static void undo_log_shrink_if_large(MemoUndoLog* log) {
+/* Shrink undo log capacity to target if it ballooned past limit */
+static void undo_log_shrink_to(MemoUndoLog* log, Py_ssize_t limit, Py_ssize_t target) {
     if (!log || !log->keys)
         return;
-    /* Use same thresholds as keepalive */
-    if (log->capacity > COPIUM_KEEP_RETAIN_MAX) {
-        Py_ssize_t target = COPIUM_KEEP_RETAIN_TARGET;
+    if (log->capacity > limit) {
         if (target < log->size)
-            target = log->size ? log->size : 1;
+            target = log->size;
+        if (target == 0) {
+            undo_log_free(log);
+            return;
+        }
         void** ni = (void**)PyMem_Realloc(log->keys, (size_t)target * sizeof(void*));
         if (ni) {
             log->keys = ni;
@@ -210,17 +274,174 @@ static void undo_log_shrink_if_large(MemoUndoLog* log) {
     }
 }
 
+/* ------------------------------ Group probing ------------------------------ */
+
+/*
+ * Each match returns a bitmask with one bit per matching control byte, spaced
+ * 1 << MEMO_MASK_SHIFT bits apart.
+ */
+typedef uint64_t MemoBitMask;
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define MEMO_MASK_SHIFT 0
+
+typedef __m128i MemoGroup;
+
+static ALWAYS_INLINE MemoGroup memo_group_load(const uint8_t* ctrl) {
+    return _mm_loadu_si128((const __m128i*)ctrl);
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match(MemoGroup group, uint8_t h2) {
+    return (MemoBitMask)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match_empty(MemoGroup group) {
+    return (MemoBitMask)_mm_movemask_epi8(
+        _mm_cmpeq_epi8(group, _mm_set1_epi8((char)MEMO_CTRL_EMPTY))
+    );
+}
+
+// Empty or deleted: the only control bytes with the high bit set.
+static ALWAYS_INLINE MemoBitMask memo_group_match_free(MemoGroup group) {
+    return (MemoBitMask)_mm_movemask_epi8(group);
+}
+
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+    #include <arm_neon.h>
+    #define MEMO_MASK_SHIFT 2
+
+typedef uint8x16_t MemoGroup;
+
+static ALWAYS_INLINE MemoGroup memo_group_load(const uint8_t* ctrl) {
+    return vld1q_u8(ctrl);
+}
+
+// Narrows a 0x00/0xFF byte vector to a nibble per byte and keeps one bit of each nibble.
+static ALWAYS_INLINE MemoBitMask memo_group_bits(uint8x16_t cmp) {
+    uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(cmp), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & 0x8888888888888888ULL;
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match(MemoGroup group, uint8_t h2) {
+    return memo_group_bits(vceqq_u8(group, vdupq_n_u8(h2)));
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match_empty(MemoGroup group) {
+    return memo_group_bits(vceqq_u8(group, vdupq_n_u8(MEMO_CTRL_EMPTY)));
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match_free(MemoGroup group) {
+    return memo_group_bits(vcgeq_u8(group, vdupq_n_u8(0x80)));
+}
+
+#else
+    #define MEMO_MASK_SHIFT 0
+
+typedef struct {
+    uint8_t bytes[MEMO_GROUP_WIDTH];
+} MemoGroup;
+
+static ALWAYS_INLINE MemoGroup memo_group_load(const uint8_t* ctrl) {
+    MemoGroup group;
+    memcpy(group.bytes, ctrl, MEMO_GROUP_WIDTH);
+    return group;
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match(MemoGroup group, uint8_t h2) {
+    MemoBitMask mask = 0;
+    for (int i = 0; i < MEMO_GROUP_WIDTH; i++)
+        mask |= (MemoBitMask)(group.bytes[i] == h2) << i;
+    return mask;
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match_empty(MemoGroup group) {
+    return memo_group_match(group, MEMO_CTRL_EMPTY);
+}
+
+static ALWAYS_INLINE MemoBitMask memo_group_match_free(MemoGroup group) {
+    MemoBitMask mask = 0;
+    for (int i = 0; i < MEMO_GROUP_WIDTH; i++)
+        mask |= (MemoBitMask)(group.bytes[i] >> 7) << i;
+    return mask;
+}
+#endif
+
+#if defined(_MSC_VER)
+    #include <intrin.h>
+#endif
+
+// Offset within the group of the lowest match; mask must be nonzero.
+static ALWAYS_INLINE Py_ssize_t memo_mask_lowest(MemoBitMask mask) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return (Py_ssize_t)(index >> MEMO_MASK_SHIFT);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (!_BitScanForward(&index, (unsigned long)mask)) {
+        _BitScanForward(&index, (unsigned long)(mask >> 32));
+        index += 32;
+    }
+    return (Py_ssize_t)(index >> MEMO_MASK_SHIFT);
+#else
+    return (Py_ssize_t)(__builtin_ctzll(mask) >> MEMO_MASK_SHIFT);
+#endif
+}
+
+#define MEMO_H1(hash) ((size_t)(hash) >> 7)
+#define MEMO_H2(hash) ((uint8_t)((size_t)(hash) & 0x7F))
+
 /* ------------------------------ Memo table impl ---------------------------- */
 
+static ALWAYS_INLINE void memo_table_set_ctrl(MemoTable* table, Py_ssize_t idx, uint8_t ctrl) {
+    Py_ssize_t mask = table->size - 1;
+    table->ctrl[idx] = ctrl;
+    table->ctrl[((idx - (MEMO_GROUP_WIDTH - 1)) & mask) + (MEMO_GROUP_WIDTH - 1)] = ctrl;
+}
+
+// Slot holding key, or -1.
+static ALWAYS_INLINE Py_ssize_t memo_table_find(MemoTable* table, void* key, Py_ssize_t hash) {
+    Py_ssize_t mask = table->size - 1;
+    Py_ssize_t pos = (Py_ssize_t)MEMO_H1(hash) & mask;
+    uint8_t h2 = MEMO_H2(hash);
+    for (Py_ssize_t stride = MEMO_GROUP_WIDTH;; stride += MEMO_GROUP_WIDTH) {
+        MemoGroup group = memo_group_load(table->ctrl + pos);
+        for (MemoBitMask match = memo_group_match(group, h2); match; match &= match - 1) {
+            Py_ssize_t idx = (pos + memo_mask_lowest(match)) & mask;
+            if (LIKELY(table->keys[idx] == key))
+                return idx;
+        }
+        if (LIKELY(memo_group_match_empty(group)))
+            return -1;
+        pos = (pos + stride) & mask;
+    }
+}
+
+// First empty or deleted slot on hash's probe sequence.
+static ALWAYS_INLINE Py_ssize_t memo_table_find_free(MemoTable* table, Py_ssize_t hash) {
+    Py_ssize_t mask = table->size - 1;
+    Py_ssize_t pos = (Py_ssize_t)MEMO_H1(hash) & mask;
+    for (Py_ssize_t stride = MEMO_GROUP_WIDTH;; stride += MEMO_GROUP_WIDTH) {
+        MemoBitMask free_slots = memo_group_match_free(memo_group_load(table->ctrl + pos));
+        if (LIKELY(free_slots))
+            return (pos + memo_mask_lowest(free_slots)) & mask;
+        pos = (pos + stride) & mask;
+    }
+}
+
+static void memo_table_decref_values(MemoTable* table) {
+    for (Py_ssize_t i = 0; i < table->size; i++) {
+        if (MEMO_CTRL_IS_FULL(table->ctrl[i]))
+            Py_XDECREF(table->values[i]);
+    }
+}
+
 void memo_table_free(MemoTable* table) {
     if (!table)
         return;
-    for (Py_ssize_t i = 0; i < table->size; i++) {
-        if (table->slots[i].key && table->slots[i].key != MEMO_TOMBSTONE) {
-            Py_XDECREF(table->slots[i].value);
-        }
-    }
-    free(table->slots);
+    memo_table_decref_values(table);
+    free(table->keys);
     free(table);
 }
 
@@ -228,20 +449,20 @@ void memo_table_free(MemoTable* table) {
 void memo_table_clear(MemoTable* table);
 static int memo_table_resize(MemoTable** table_ptr, Py_ssize_t min_capacity_needed);
 
-/* Reset-with-policy: clear, and shrink if past cap back to a small target. */
-int memo_table_reset(MemoTable** table_ptr) {
+/* Reset-with-policy: clear, and shrink back to shrink_to slots if the table grew past limit. */
+int memo_table_reset(MemoTable** table_ptr, Py_ssize_t limit, Py_ssize_t shrink_to) {
     if (!table_ptr)
         return 0;
     MemoTable* t = *table_ptr;
     if (!t)
         return 0;
 
-    /* Always drop references and zero slots first. */
+    /* Always drop references and mark every slot empty first. */
     memo_table_clear(t);
 
-    if (t->size > COPIUM_MEMO_RETAIN_MAX_SLOTS) {
+    if (t->size > limit) {
         /* Rebuild a smaller table; migrating 0 entries is cheap. */
-        Py_ssize_t min_needed = COPIUM_MEMO_RETAIN_SHRINK_TO / 2;
+        Py_ssize_t min_needed = shrink_to / 2;
         if (min_needed < 1)
             min_needed = 1;
         if (memo_table_resize(table_ptr, min_needed) < 0) {
@@ -251,64 +472,63 @@ int memo_table_reset(MemoTable** table_ptr) {
     return 0;
 }
 
-/* New: reset table contents in-place but keep capacity for reuse (TLS buffer) */
+/* Reset table contents in-place but keep capacity for reuse (TLS buffer); keys and values of
+ * empty slots are never read, so only the control bytes need clearing. */
 void memo_table_clear(MemoTable* table) {
     if (!table)
         return;
-    for (Py_ssize_t i = 0; i < table->size; i++) {
-        void* key = table->slots[i].key;
-        if (key && key != MEMO_TOMBSTONE) {
-            Py_XDECREF(table->slots[i].value);
-        }
-        table->slots[i].key = NULL;
-        table->slots[i].value = NULL;
-    }
+    if (table->used)
+        memo_table_decref_values(table);
+    if (table->filled)
+        memset(table->ctrl, MEMO_CTRL_EMPTY, (size_t)(table->size + MEMO_GROUP_WIDTH - 1));
     table->used = 0;
     table->filled = 0;
 }
 
 static int memo_table_resize(MemoTable** table_ptr, Py_ssize_t min_capacity_needed) {
     MemoTable* old = *table_ptr;
-    Py_ssize_t new_size = 8;
+    Py_ssize_t new_size = MEMO_GROUP_WIDTH;
     while (new_size < (min_capacity_needed * 2)) {
         Py_ssize_t next = new_size << 1;
         if (next <= 0 || next < new_size) { /* overflow clamp */
-            new_size = (Py_ssize_t)1 << (sizeof(void*) * 8 - 2);
+            new_size = (Py_ssize_t)1 << (sizeof(void*) * 8 - 5);
             break;
         }
         new_size = next;
     }
 
-    MemoEntry* new_slots = (MemoEntry*)calloc((size_t)new_size, sizeof(MemoEntry));
-    if (!new_slots)
+    size_t ctrl_size = (size_t)(new_size + MEMO_GROUP_WIDTH - 1);
+    void** block = (void**)malloc((size_t)new_size * 2 * sizeof(void*) + ctrl_size);
+    if (!block)
         return -1;
 
     MemoTable* nt = (MemoTable*)malloc(sizeof(MemoTable));
     if (!nt) {
-        free(new_slots);
+        free(block);
         return -1;
     }
-    nt->slots = new_slots;
+    nt->keys = block;
+    nt->values = (PyObject**)(block + new_size);
+    nt->ctrl = (uint8_t*)(block + new_size * 2);
     nt->size = new_size;
     nt->used = 0;
     nt->filled = 0;
+    memset(nt->ctrl, MEMO_CTRL_EMPTY, ctrl_size);
 
     if (old) {
         for (Py_ssize_t i = 0; i < old->size; i++) {
-            void* key = old->slots[i].key;
-            if (key && key != MEMO_TOMBSTONE) {
-                PyObject* value = old->slots[i].value; /* transfer */
-                Py_ssize_t mask = nt->size - 1;
-                Py_ssize_t idx = hash_pointer(key) & mask;
-                while (nt->slots[idx].key)
-                    idx = (idx + 1) & mask;
-                nt->slots[idx].key = key;
-                nt->slots[idx].value = value;
-                nt->used++;
-                nt->filled++;
-            }
+            if (!MEMO_CTRL_IS_FULL(old->ctrl[i]))
+                continue;
+            void* key = old->keys[i];
+            Py_ssize_t hash = hash_pointer(key);
+            Py_ssize_t idx = memo_table_find_free(nt, hash);
+            memo_table_set_ctrl(nt, idx, MEMO_H2(hash));
+            nt->keys[idx] = key;
+            nt->values[idx] = old->values[i]; /* transfer */
+            nt->used++;
+            nt->filled++;
         }
-        free(old->slots);
+        free(old->keys);
         free(old);
     }
     *table_ptr = nt;
@@ -321,78 +541,12 @@ static ALWAYS_INLINE int memo_table_ensure(MemoTable** table_ptr) {
     return memo_table_resize(table_ptr, 1);
 }
 
-/* Existing non-hash-parameterized APIs (kept for compatibility) */
-static ALWAYS_INLINE PyObject* memo_table_lookup(MemoTable* table, void* key) {
-    if (!table)
-        return NULL;
-    Py_ssize_t mask = table->size - 1;
-    Py_ssize_t idx = hash_pointer(key) & mask;
-    for (;;) {
-        void* slot_key = table->slots[idx].key;
-        if (!slot_key)
-            return NULL;
-        if (slot_key != MEMO_TOMBSTONE && slot_key == key) {
-            return table->slots[idx].value; /* borrowed */
-        }
-        idx = (idx + 1) & mask;
-    }
-}
-
-static ALWAYS_INLINE int memo_table_insert(MemoTable** table_ptr, void* key, PyObject* value) {
-    if (memo_table_ensure(table_ptr) < 0)
-        return -1;
-    MemoTable* table = *table_ptr;
-
-    if ((table->filled * 10) >= (table->size * 7)) {
-        if (memo_table_resize(table_ptr, table->used + 1) < 0)
-            return -1;
-        table = *table_ptr;
-    }
-
-    Py_ssize_t mask = table->size - 1;
-    Py_ssize_t idx = hash_pointer(key) & mask;
-    Py_ssize_t first_tomb = -1;
-
-    for (;;) {
-        void* slot_key = table->slots[idx].key;
-        if (!slot_key) {
-            Py_ssize_t insert_at = (first_tomb >= 0) ? first_tomb : idx;
-            table->slots[insert_at].key = key;
-            Py_INCREF(value);
-            table->slots[insert_at].value = value;
-            table->used++;
-            table->filled++;
-            return 0;
-        }
-        if (slot_key == MEMO_TOMBSTONE) {
-            if (first_tomb < 0)
-                first_tomb = idx;
-        } else if (slot_key == key) {
-            PyObject* old_value = table->slots[idx].value;
-            Py_INCREF(value);
-            table->slots[idx].value = value;
-            Py_XDECREF(old_value);
-            return 0;
-        }
-        idx = (idx + 1) & mask;
-    }
-}
-
-/* New hash-parameterized hot-path APIs (avoid recomputing hash) */
+/* Hash-parameterized hot-path APIs (avoid recomputing hash) */
 static ALWAYS_INLINE PyObject* memo_table_lookup_h(MemoTable* table, void* key, Py_ssize_t hash) {
     if (!table)
         return NULL;
-    Py_ssize_t mask = table->size - 1;
-    Py_ssize_t idx = hash & mask;
-    for (;;) {
-        void* slot_key = table->slots[idx].key;
-        if (!slot_key)
-            return NULL;
-        if (slot_key != MEMO_TOMBSTONE && slot_key == key) {
-            return table->slots[idx].value; /* borrowed */
-        }
-        idx = (idx + 1) & mask;
-    }
+    Py_ssize_t idx = memo_table_find(table, key, hash);
+    return idx < 0 ? NULL : table->values[idx]; /* borrowed */
 }
 
 static ALWAYS_INLINE int memo_table_insert_h(
@@ -402,59 +556,53 @@ static ALWAYS_INLINE int memo_table_insert_h(
         return -1;
     MemoTable* table = *table_ptr;
 
+    Py_ssize_t idx = memo_table_find(table, key, hash);
+    if (UNLIKELY(idx >= 0)) {
+        PyObject* old_value = table->values[idx];
+        Py_INCREF(value);
+        table->values[idx] = value;
+        Py_XDECREF(old_value);
+        return 0;
+    }
+
     if ((table->filled * 10) >= (table->size * 7)) {
+        COPIUM_STAT(memo_resize);
         if (memo_table_resize(table_ptr, table->used + 1) < 0)
             return -1;
         table = *table_ptr;
     }
 
-    Py_ssize_t mask = table->size - 1;
-    Py_ssize_t idx = hash & mask;
-    Py_ssize_t first_tomb = -1;
-
-    for (;;) {
-        void* slot_key = table->slots[idx].key;
-        if (!slot_key) {
-            Py_ssize_t insert_at = (first_tomb >= 0) ? first_tomb : idx;
-            table->slots[insert_at].key = key;
-            Py_INCREF(value);
-            table->slots[insert_at].value = value;
-            table->used++;
-            table->filled++;
-            return 0;
-        }
-        if (slot_key == MEMO_TOMBSTONE) {
-            if (first_tomb < 0)
-                first_tomb = idx;
-        } else if (slot_key == key) {
-            PyObject* old_value = table->slots[idx].value;
-            Py_INCREF(value);
-            table->slots[idx].value = value;
-            Py_XDECREF(old_value);
-            return 0;
-        }
-        idx = (idx + 1) & mask;
-    }
+    idx = memo_table_find_free(table, hash);
+    if (table->ctrl[idx] == MEMO_CTRL_EMPTY)
+        table->filled++;
+    memo_table_set_ctrl(table, idx, MEMO_H2(hash));
+    table->keys[idx] = key;
+    Py_INCREF(value);
+    table->values[idx] = value;
+    table->used++;
+    return 0;
 }
 
 static ALWAYS_INLINE int memo_table_remove_h(MemoTable* table, void* key, Py_ssize_t hash) {
     if (!table)
         return -1;
-    Py_ssize_t mask = table->size - 1;
-    Py_ssize_t idx = hash & mask;
-    for (;;) {
-        void* slot_key = table->slots[idx].key;
-        if (!slot_key)
-            return -1; /* not found */
-        if (slot_key != MEMO_TOMBSTONE && slot_key == key) {
-            table->slots[idx].key = MEMO_TOMBSTONE;
-            Py_XDECREF(table->slots[idx].value);
-            table->slots[idx].value = NULL;
-            table->used--;
-            return 0;
-        }
-        idx = (idx + 1) & mask;
-    }
+    Py_ssize_t idx = memo_table_find(table, key, hash);
+    if (idx < 0)
+        return -1; /* not found */
+    memo_table_set_ctrl(table, idx, MEMO_CTRL_DELETED);
+    Py_XDECREF(table->values[idx]);
+    table->values[idx] = NULL;
+    table->used--;
+    return 0;
+}
+
+/* Non-hash-parameterized APIs (kept for compatibility) */
+static ALWAYS_INLINE PyObject* memo_table_lookup(MemoTable* table, void* key) {
+    return memo_table_lookup_h(table, key, hash_pointer(key));
+}
+
+static ALWAYS_INLINE int memo_table_insert(MemoTable** table_ptr, void* key, PyObject* value) {
+    return memo_table_insert_h(table_ptr, key, value, hash_pointer(key));
 }
 
 int memo_table_remove(MemoTable* table, void* key) {
@@ -465,22 +613,15 @@ int memo_table_remove(MemoTable* table, void* key) {
 static PyObject* memo_table_pop(MemoTable* table, void* key) {
     if (!table)
         return NULL;
-    Py_ssize_t mask = table->size - 1;
-    Py_ssize_t idx = hash_pointer(key) & mask;
-    for (;;) {
-        void* slot_key = table->slots[idx].key;
-        if (!slot_key)
-            return NULL; /* not found */
-        if (slot_key != MEMO_TOMBSTONE && slot_key == key) {
-            table->slots[idx].key = MEMO_TOMBSTONE;
-            PyObject* value = table->slots[idx].value;
-            table->slots[idx].value = NULL;
-            table->used--;
-            /* Return owned reference - caller owns it now */
-            return value;
-        }
-        idx = (idx + 1) & mask;
-    }
+    Py_ssize_t idx = memo_table_find(table, key, hash_pointer(key));
+    if (idx < 0)
+        return NULL; /* not found */
+    memo_table_set_ctrl(table, idx, MEMO_CTRL_DELETED);
+    PyObject* value = table->values[idx];
+    table->values[idx] = NULL;
+    table->used--;
+    /* Return owned reference - caller owns it now */
+    return value;
 }
 
 /* Pop an arbitrary item. Returns key via out parameter, value as return. */
@@ -488,12 +629,11 @@ static PyObject* memo_table_popitem(MemoTable* table, void** key_out) {
     if (!table || table->used == 0)
         return NULL;
     for (Py_ssize_t i = 0; i < table->size; i++) {
-        void* slot_key = table->slots[i].key;
-        if (slot_key && slot_key != MEMO_TOMBSTONE) {
-            *key_out = slot_key;
-            table->slots[i].key = MEMO_TOMBSTONE;
-            PyObject* value = table->slots[i].value;
-            table->slots[i].value = NULL;
+        if (MEMO_CTRL_IS_FULL(table->ctrl[i])) {
+            *key_out = table->keys[i];
+            memo_table_set_ctrl(table, i, MEMO_CTRL_DELETED);
+            PyObject* value = table->values[i];
+            table->values[i] = NULL;
             table->used--;
             return value; /* owned reference */
         }
@@ -501,15 +641,95 @@ static PyObject* memo_table_popitem(MemoTable* table, void** key_out) {
     return NULL;
 }
 
-/* ------------------------- Memo type & keepalive proxy -------------------------- */
+/* ------------------------------ Sharded memo ------------------------------ */
+
+#if COPIUM_PARALLEL_DEEPCOPY
+/*
+ * Memo shared by the workers of one parallel_deepcopy() call, striped over independently
+ * locked tables by the top bits of the hash (the table itself probes with the low ones).
+ *
+ * Nothing is removed before the whole call is over, so a looked-up copy stays valid after the
+ * shard is unlocked. Two workers can still both miss on the same original and both copy it:
+ * inserts keep whichever copy got there first, and deepcopy() settles on that one once its
+ * own copy is done, so every original still ends up with a single copy.
+ */
+    #ifndef COPIUM_MEMO_SHARDS_LOG2
+        #define COPIUM_MEMO_SHARDS_LOG2 6 /* 64 shards */
+    #endif
+    #define COPIUM_MEMO_SHARDS (1 << COPIUM_MEMO_SHARDS_LOG2)
+
+typedef struct {
+    PyMutex lock;
+    MemoTable* table;
+    KeepaliveVector keepalive; /* originals memoized through sharded_memo_insert(..., keep=1) */
+    char pad[64 - sizeof(void*) * 5];
+} MemoShard;
+
+struct _ShardedMemo {
+    MemoShard shards[COPIUM_MEMO_SHARDS];
+};
+
+static ALWAYS_INLINE MemoShard* sharded_memo_shard(ShardedMemo* sm, Py_ssize_t hash) {
+    return &sm->shards[(size_t)hash >> (sizeof(size_t) * 8 - COPIUM_MEMO_SHARDS_LOG2)];
+}
+
+static ShardedMemo* sharded_memo_new(void) {
+    ShardedMemo* sm = (ShardedMemo*)PyMem_Calloc(1, sizeof(ShardedMemo));
+    if (!sm)
+        PyErr_NoMemory();
+    return sm;
+}
+
+static void sharded_memo_free(ShardedMemo* sm) {
+    if (!sm)
+        return;
+    for (int i = 0; i < COPIUM_MEMO_SHARDS; i++) {
+        memo_table_free(sm->shards[i].table);
+        keepalive_free(&sm->shards[i].keepalive);
+    }
+    PyMem_Free(sm);
+}
+
+/* Borrowed copy of key, or NULL. */
+static PyObject* sharded_memo_lookup(ShardedMemo* sm, void* key, Py_ssize_t hash) {
+    MemoShard* shard = sharded_memo_shard(sm, hash);
+    PyMutex_Lock(&shard->lock);
+    PyObject* found = memo_table_lookup_h(shard->table, key, hash);
+    PyMutex_Unlock(&shard->lock);
+    return found;
+}
+
+/* Insert unless key already has a copy. Returns the borrowed copy that is in the memo, or NULL
+ * with an exception set. keep also keeps key alive for as long as the memo. */
+static PyObject* sharded_memo_insert(
+    ShardedMemo* sm, void* key, PyObject* value, Py_ssize_t hash, int keep
+) {
+    MemoShard* shard = sharded_memo_shard(sm, hash);
+    PyMutex_Lock(&shard->lock);
+    PyObject* found = memo_table_lookup_h(shard->table, key, hash);
+    if (!found) {
+        if (memo_table_insert_h(&shard->table, key, value, hash) < 0 ||
+            (keep && keepalive_append(&shard->keepalive, (PyObject*)key) < 0)) {
+            PyMutex_Unlock(&shard->lock);
+            PyErr_NoMemory();
+            return NULL;
+        }
+        found = value;
+    }
+    PyMutex_Unlock(&shard->lock);
+    return found;
+}
+#endif
 
-PyTypeObject Memo_Type;
+/* ------------------------- Memo type & keepalive proxy -------------------------- */
 
-/* Forward declarations for view types */
-static PyTypeObject MemoKeysView_Type;
-static PyTypeObject MemoValuesView_Type;
-static PyTypeObject MemoItemsView_Type;
-static PyTypeObject MemoViewIter_Type;
+/*
+ * The types below are made for each module, see memo_make_types(). Their methods may be called
+ * with no state entered, so they find their types in the module of the memo they're about.
+ */
+static ALWAYS_INLINE ModuleState* memo_types_of(PyMemoObject* memo) {
+    return (ModuleState*)PyType_GetModuleState(Py_TYPE(memo));
+}
 
 /* _KeepaliveList proxy ============================================================
  * A thin Python object that forwards to PyMemoObject.keep.
@@ -520,14 +740,15 @@ typedef struct {
     PyObject_HEAD PyMemoObject* owner; /* strong ref to the memo owning the vector */
 } KeepaliveListObject;
 
-static PyTypeObject KeepaliveList_Type;
-
 /* Forward decls */
 static PyObject* KeepaliveList_New(PyMemoObject* owner);
+static int memo_keep_originals(PyMemoObject* memo);
 
 static void KeepaliveList_dealloc(KeepaliveListObject* self) {
+    PyTypeObject* tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    tp->tp_free((PyObject*)self);
+    Py_DECREF(tp);
 }
 
 static Py_ssize_t KeepaliveList_len(KeepaliveListObject* self) {
@@ -591,19 +812,6 @@ static PyObject* KeepaliveList_clear(KeepaliveListObject* self, PyObject* noargs
     Py_RETURN_NONE;
 }
 
-static PySequenceMethods KeepaliveList_as_sequence = {
-    (lenfunc)KeepaliveList_len,          /* sq_length */
-    0,                                   /* sq_concat */
-    0,                                   /* sq_repeat */
-    (ssizeargfunc)KeepaliveList_getitem, /* sq_item */
-    0,                                   /* sq_slice (deprecated) */
-    0,                                   /* sq_ass_item */
-    0,                                   /* sq_ass_slice (deprecated) */
-    0,                                   /* sq_contains */
-    0,                                   /* sq_inplace_concat */
-    0                                    /* sq_inplace_repeat */
-};
-
 static PyObject* KeepaliveList_repr(KeepaliveListObject* self) {
     PyObject* list;
     PyObject* inner_repr;
@@ -635,7 +843,10 @@ static PyMethodDef KeepaliveList_methods[] = {
 };
 
 static PyObject* KeepaliveList_New(PyMemoObject* owner) {
-    KeepaliveListObject* self = PyObject_New(KeepaliveListObject, &KeepaliveList_Type);
+    if (owner->lazy_keepalive && memo_keep_originals(owner) < 0)
+        return NULL;
+    KeepaliveListObject* self =
+        PyObject_New(KeepaliveListObject, memo_types_of(owner)->KeepaliveList_Type);
     if (!self)
         return NULL;
     Py_INCREF(owner);
@@ -648,7 +859,7 @@ static PyObject* KeepaliveList_richcompare(KeepaliveListObject* self, PyObject*
         Py_RETURN_NOTIMPLEMENTED;
     }
 
-    if (!PyObject_TypeCheck(other, &KeepaliveList_Type)) {
+    if (Py_TYPE(other) != Py_TYPE(self)) {
         Py_RETURN_NOTIMPLEMENTED;
     }
 
@@ -668,17 +879,23 @@ static PyObject* KeepaliveList_richcompare(KeepaliveListObject* self, PyObject*
     }
 }
 
-static PyTypeObject KeepaliveList_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "copium.keepalive",
-    .tp_basicsize = sizeof(KeepaliveListObject),
-    .tp_dealloc = (destructor)KeepaliveList_dealloc,
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_as_sequence = &KeepaliveList_as_sequence,
-    .tp_iter = (getiterfunc)KeepaliveList_iter,
-    .tp_methods = KeepaliveList_methods,
-    .tp_repr = (reprfunc)KeepaliveList_repr,
-    .tp_richcompare = (richcmpfunc)KeepaliveList_richcompare,
-    .tp_hash = PyObject_HashNotImplemented,
+static PyType_Slot KeepaliveList_slots[] = {
+    {Py_tp_dealloc, KeepaliveList_dealloc},
+    {Py_sq_length, KeepaliveList_len},
+    {Py_sq_item, KeepaliveList_getitem},
+    {Py_tp_iter, KeepaliveList_iter},
+    {Py_tp_methods, KeepaliveList_methods},
+    {Py_tp_repr, KeepaliveList_repr},
+    {Py_tp_richcompare, KeepaliveList_richcompare},
+    {Py_tp_hash, PyObject_HashNotImplemented},
+    {0, NULL},
+};
+
+static PyType_Spec KeepaliveList_spec = {
+    .name = "copium.keepalive",
+    .basicsize = sizeof(KeepaliveListObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = KeepaliveList_slots,
 };
 
 /* --------------------------- Memo View Types ------------------------------- */
@@ -702,11 +919,14 @@ typedef struct {
 } MemoViewIter;
 
 static void MemoView_dealloc(MemoView* self) {
+    PyTypeObject* tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    tp->tp_free((PyObject*)self);
+    Py_DECREF(tp);
 }
 
 static int MemoView_traverse(MemoView* self, visitproc visit, void* arg) {
+    Py_VISIT(Py_TYPE(self));
     Py_VISIT(self->owner);
     return 0;
 }
@@ -749,50 +969,40 @@ static PyObject* MemoItemsView_repr(MemoView* self) {
     return PyUnicode_FromFormat("dict_items(...)");
 }
 
-static PySequenceMethods MemoView_as_sequence = {
-    .sq_length = (lenfunc)MemoView_len,
-};
-
-static PyTypeObject MemoKeysView_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "dict_keys",
-    .tp_basicsize = sizeof(MemoView),
-    .tp_dealloc = (destructor)MemoView_dealloc,
-    .tp_repr = (reprfunc)MemoKeysView_repr,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)MemoView_traverse,
-    .tp_iter = (getiterfunc)MemoKeysView_iter,
-    .tp_as_sequence = &MemoView_as_sequence,
-};
-
-static PyTypeObject MemoValuesView_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "dict_values",
-    .tp_basicsize = sizeof(MemoView),
-    .tp_dealloc = (destructor)MemoView_dealloc,
-    .tp_repr = (reprfunc)MemoValuesView_repr,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)MemoView_traverse,
-    .tp_iter = (getiterfunc)MemoValuesView_iter,
-    .tp_as_sequence = &MemoView_as_sequence,
-};
-
-static PyTypeObject MemoItemsView_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "dict_items",
-    .tp_basicsize = sizeof(MemoView),
-    .tp_dealloc = (destructor)MemoView_dealloc,
-    .tp_repr = (reprfunc)MemoItemsView_repr,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)MemoView_traverse,
-    .tp_iter = (getiterfunc)MemoItemsView_iter,
-    .tp_as_sequence = &MemoView_as_sequence,
-};
+#define MEMO_VIEW_FLAGS                                                           \
+    (Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE |        \
+     Py_TPFLAGS_DISALLOW_INSTANTIATION)
+
+#define MEMO_VIEW_SPEC(kind, type_name)                                           \
+    static PyType_Slot Memo##kind##View_slots[] = {                               \
+        {Py_tp_dealloc, MemoView_dealloc},                                        \
+        {Py_tp_repr, Memo##kind##View_repr},                                      \
+        {Py_tp_traverse, MemoView_traverse},                                      \
+        {Py_tp_iter, Memo##kind##View_iter},                                      \
+        {Py_sq_length, MemoView_len},                                             \
+        {0, NULL},                                                                \
+    };                                                                            \
+    static PyType_Spec Memo##kind##View_spec = {                                  \
+        .name = type_name,                                                        \
+        .basicsize = sizeof(MemoView),                                            \
+        .flags = MEMO_VIEW_FLAGS,                                                 \
+        .slots = Memo##kind##View_slots,                                          \
+    };
+
+MEMO_VIEW_SPEC(Keys, "dict_keys")
+MEMO_VIEW_SPEC(Values, "dict_values")
+MEMO_VIEW_SPEC(Items, "dict_items")
 
 /* View iterator */
 static void MemoViewIter_dealloc(MemoViewIter* self) {
+    PyTypeObject* tp = Py_TYPE(self);
     Py_XDECREF(self->owner);
-    Py_TYPE(self)->tp_free((PyObject*)self);
+    tp->tp_free((PyObject*)self);
+    Py_DECREF(tp);
 }
 
 static int MemoViewIter_traverse(MemoViewIter* self, visitproc visit, void* arg) {
+    Py_VISIT(Py_TYPE(self));
     Py_VISIT(self->owner);
     return 0;
 }
@@ -813,21 +1023,20 @@ static PyObject* MemoViewIter_iternext(MemoViewIter* self) {
 
         while (self->index < table->size) {
             Py_ssize_t idx = self->index++;
-            void* slot_key = table->slots[idx].key;
-
-            if (!slot_key || slot_key == MEMO_TOMBSTONE)
+            if (!MEMO_CTRL_IS_FULL(table->ctrl[idx]))
                 continue;
+            void* slot_key = table->keys[idx];
 
             if (self->kind == MEMO_IT_KEYS) {
                 return PyLong_FromVoidPtr(slot_key);
             } else if (self->kind == MEMO_IT_VALUES) {
-                PyObject* value = table->slots[idx].value;
+                PyObject* value = table->values[idx];
                 return Py_NewRef(value);
             } else { /* MEMO_IT_ITEMS */
                 PyObject* key_obj = PyLong_FromVoidPtr(slot_key);
                 if (!key_obj)
                     return NULL;
-                PyObject* value = table->slots[idx].value;
+                PyObject* value = table->values[idx];
                 PyObject* pair = PyTuple_New(2);
                 if (!pair) {
                     Py_DECREF(key_obj);
@@ -874,18 +1083,24 @@ static PyObject* MemoViewIter_iternext(MemoViewIter* self) {
     return NULL; /* StopIteration */
 }
 
-static PyTypeObject MemoViewIter_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "copium._memo_iterator",
-    .tp_basicsize = sizeof(MemoViewIter),
-    .tp_dealloc = (destructor)MemoViewIter_dealloc,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_traverse = (traverseproc)MemoViewIter_traverse,
-    .tp_iter = PyObject_SelfIter,
-    .tp_iternext = (iternextfunc)MemoViewIter_iternext,
+static PyType_Slot MemoViewIter_slots[] = {
+    {Py_tp_dealloc, MemoViewIter_dealloc},
+    {Py_tp_traverse, MemoViewIter_traverse},
+    {Py_tp_iter, PyObject_SelfIter},
+    {Py_tp_iternext, MemoViewIter_iternext},
+    {0, NULL},
+};
+
+static PyType_Spec MemoViewIter_spec = {
+    .name = "copium._memo_iterator",
+    .basicsize = sizeof(MemoViewIter),
+    .flags = MEMO_VIEW_FLAGS,
+    .slots = MemoViewIter_slots,
 };
 
 static PyObject* MemoView_iter_for_kind(MemoView* view, MemoIterKind kind) {
-    MemoViewIter* it = PyObject_GC_New(MemoViewIter, &MemoViewIter_Type);
+    MemoViewIter* it =
+        PyObject_GC_New(MemoViewIter, memo_types_of(view->owner)->MemoViewIter_Type);
     if (!it)
         return NULL;
     Py_INCREF(view->owner);
@@ -900,7 +1115,7 @@ static PyObject* MemoView_iter_for_kind(MemoView* view, MemoIterKind kind) {
 
 /* View constructors */
 static PyObject* MemoKeysView_New(PyMemoObject* owner) {
-    MemoView* v = PyObject_GC_New(MemoView, &MemoKeysView_Type);
+    MemoView* v = PyObject_GC_New(MemoView, memo_types_of(owner)->MemoKeysView_Type);
     if (!v)
         return NULL;
     Py_INCREF(owner);
@@ -910,7 +1125,7 @@ static PyObject* MemoKeysView_New(PyMemoObject* owner) {
 }
 
 static PyObject* MemoValuesView_New(PyMemoObject* owner) {
-    MemoView* v = PyObject_GC_New(MemoView, &MemoValuesView_Type);
+    MemoView* v = PyObject_GC_New(MemoView, memo_types_of(owner)->MemoValuesView_Type);
     if (!v)
         return NULL;
     Py_INCREF(owner);
@@ -920,7 +1135,7 @@ static PyObject* MemoValuesView_New(PyMemoObject* owner) {
 }
 
 static PyObject* MemoItemsView_New(PyMemoObject* owner) {
-    MemoView* v = PyObject_GC_New(MemoView, &MemoItemsView_Type);
+    MemoView* v = PyObject_GC_New(MemoView, memo_types_of(owner)->MemoItemsView_Type);
     if (!v)
         return NULL;
     Py_INCREF(owner);
@@ -936,24 +1151,30 @@ static void Memo_dealloc(PyMemoObject* self) {
     if (PyObject_CallFinalizerFromDealloc((PyObject*)self)) {
         return;
     }
+    PyTypeObject* tp = Py_TYPE(self);
     memo_table_free(self->table);
     keepalive_free(&self->keepalive);
     undo_log_free(&self->undo_log);
+    keepalive_free(&self->deferred);
+    copy_stack_free(&self->stack);
     PyObject_GC_Del(self);  // Use GC-aware free
+    Py_DECREF(tp);
 }
 
 static int Memo_traverse(PyMemoObject* self, visitproc visit, void* arg) {
+    Py_VISIT(Py_TYPE(self));
     if (self->table) {
         for (Py_ssize_t i = 0; i < self->table->size; i++) {
-            void* key = self->table->slots[i].key;
-            if (key && key != MEMO_TOMBSTONE) {
-                Py_VISIT(self->table->slots[i].value);
-            }
+            if (MEMO_CTRL_IS_FULL(self->table->ctrl[i]))
+                Py_VISIT(self->table->values[i]);
         }
     }
     for (Py_ssize_t i = 0; i < self->keepalive.size; i++) {
         Py_VISIT(self->keepalive.items[i]);
     }
+    for (Py_ssize_t i = 0; i < self->deferred.size; i++) {
+        Py_VISIT(self->deferred.items[i]);
+    }
     return 0;
 }
 
@@ -963,6 +1184,7 @@ static int Memo_clear_gc(PyMemoObject* self) {
         memo_table_clear(self->table);
     }
     keepalive_clear(&self->keepalive);
+    keepalive_clear(&self->deferred);
     return 0;
 }
 
@@ -970,8 +1192,8 @@ static ALWAYS_INLINE int memo_insert_logged(
     PyMemoObject* memo, void* key, PyObject* value, Py_ssize_t hash
 );
 
-PyMemoObject* Memo_New(void) {
-    PyMemoObject* self = PyObject_GC_New(PyMemoObject, &Memo_Type);
+static PyMemoObject* memo_new_of(PyTypeObject* tp) {
+    PyMemoObject* self = PyObject_GC_New(PyMemoObject, tp);
     if (!self)
         return NULL;
     self->table = NULL;
@@ -979,9 +1201,31 @@ PyMemoObject* Memo_New(void) {
     // Instead, call it once we know that somebody stole the ref.
     keepalive_init(&self->keepalive);
     undo_log_init(&self->undo_log);
+    keepalive_init(&self->deferred);
+    self->defer_unique = 0;
+    self->lazy_keepalive = 0;
+    self->recent_entries = 0;
+    self->recent_items = 0;
+#if COPIUM_PARALLEL_DEEPCOPY
+    self->shared = NULL;
+#endif
+    copy_stack_init(&self->stack);
     return self;
 }
 
+PyMemoObject* Memo_New(void) {
+    return memo_new_of(module_state.Memo_Type);
+}
+
+/* Borrowed value of key as seen through the mapping interface. */
+static ALWAYS_INLINE PyObject* memo_lookup_key(PyMemoObject* self, void* key) {
+#if COPIUM_PARALLEL_DEEPCOPY
+    if (UNLIKELY(self->shared))
+        return sharded_memo_lookup(self->shared, key, hash_pointer(key));
+#endif
+    return memo_table_lookup(self->table, key);
+}
+
 static Py_ssize_t Memo_len(PyMemoObject* self) {
     Py_ssize_t count = self->table ? self->table->used : 0;
     if (self->keepalive.size > 0)
@@ -1005,7 +1249,7 @@ static PyObject* Memo_subscript(PyMemoObject* self, PyObject* pykey) {
         return KeepaliveList_New(self);
     }
 
-    PyObject* value = memo_table_lookup(self->table, key);
+    PyObject* value = memo_lookup_key(self, key);
     if (!value) {
         PyErr_SetObject(PyExc_KeyError, pykey);
         return NULL;
@@ -1030,6 +1274,10 @@ static int Memo_ass_subscript(PyMemoObject* self, PyObject* pykey, PyObject* val
         }
         return res;
     } else {
+#if COPIUM_PARALLEL_DEEPCOPY
+        if (UNLIKELY(self->shared))
+            return sharded_memo_insert(self->shared, key, value, hash_pointer(key), 0) ? 0 : -1;
+#endif
         /* Use logged insert to support rollback for __deepcopy__ fallback */
         return memo_insert_logged(self, key, value, hash_pointer(key));
     }
@@ -1049,7 +1297,7 @@ static int Memo_contains(PyMemoObject* self, PyObject* pykey) {
         return self->keepalive.size > 0;
     }
 
-    PyObject* value = memo_table_lookup(self->table, key);
+    PyObject* value = memo_lookup_key(self, key);
     return value != NULL;
 }
 
@@ -1059,8 +1307,8 @@ static PyObject* Memo_iter(PyMemoObject* self) {
         return NULL;
     if (self->table) {
         for (Py_ssize_t i = 0; i < self->table->size; i++) {
-            void* key = self->table->slots[i].key;
-            if (key && key != MEMO_TOMBSTONE) {
+            if (MEMO_CTRL_IS_FULL(self->table->ctrl[i])) {
+                void* key = self->table->keys[i];
                 PyObject* py_key = PyLong_FromVoidPtr(key);
                 if (!py_key || PyList_Append(keys_list, py_key) < 0) {
                     Py_XDECREF(py_key);
@@ -1142,15 +1390,15 @@ static PyObject* Memo_items(PyMemoObject* self, PyObject* noargs) {
 /* copy() - shallow copy of the memo */
 static PyObject* Memo_copy(PyMemoObject* self, PyObject* noargs) {
     (void)noargs;
-    PyMemoObject* new_memo = Memo_New();
+    PyMemoObject* new_memo = memo_new_of(Py_TYPE(self));
     if (!new_memo)
         return NULL;
 
     if (self->table) {
         for (Py_ssize_t i = 0; i < self->table->size; i++) {
-            void* key = self->table->slots[i].key;
-            if (key && key != MEMO_TOMBSTONE) {
-                PyObject* value = self->table->slots[i].value;
+            if (MEMO_CTRL_IS_FULL(self->table->ctrl[i])) {
+                void* key = self->table->keys[i];
+                PyObject* value = self->table->values[i];
                 if (memo_table_insert(&new_memo->table, key, value) < 0) {
                     Py_DECREF(new_memo);
                     return NULL;
@@ -1248,13 +1496,13 @@ static PyObject* Memo_update(
     PyObject* other = args[0];
 
     /* Check if it's a Memo */
-    if (Py_TYPE(other) == &Memo_Type) {
+    if (Py_TYPE(other) == Py_TYPE(self)) {
         PyMemoObject* other_memo = (PyMemoObject*)other;
         if (other_memo->table) {
             for (Py_ssize_t i = 0; i < other_memo->table->size; i++) {
-                void* key = other_memo->table->slots[i].key;
-                if (key && key != MEMO_TOMBSTONE) {
-                    PyObject* value = other_memo->table->slots[i].value;
+                if (MEMO_CTRL_IS_FULL(other_memo->table->ctrl[i])) {
+                    void* key = other_memo->table->keys[i];
+                    PyObject* value = other_memo->table->values[i];
                     if (memo_table_insert(&self->table, key, value) < 0)
                         return NULL;
                 }
@@ -1362,14 +1610,6 @@ static PyObject* Memo_update(
     Py_RETURN_NONE;
 }
 
-static PyMappingMethods Memo_as_mapping = {
-    (lenfunc)Memo_len, (binaryfunc)Memo_subscript, (objobjargproc)Memo_ass_subscript
-};
-
-static PySequenceMethods Memo_as_sequence = {
-    .sq_contains = (objobjproc)Memo_contains,
-};
-
 /* get(key[, default]) - returns None when key not found (dict-compatible) */
 static PyObject* Memo_get(PyMemoObject* self, PyObject* const* args, Py_ssize_t nargs) {
     if (nargs < 1 || nargs > 2) {
@@ -1385,7 +1625,7 @@ static PyObject* Memo_get(PyMemoObject* self, PyObject* const* args, Py_ssize_t
     if (key == NULL && PyErr_Occurred())
         return NULL;
 
-    PyObject* value = memo_table_lookup(self->table, key);
+    PyObject* value = memo_lookup_key(self, key);
     if (value) {
         return Py_NewRef(value);
     }
@@ -1417,13 +1657,19 @@ static PyObject* Memo_setdefault(PyMemoObject* self, PyObject* const* args, Py_s
     }
 
     /* Existing value? */
-    PyObject* value = memo_table_lookup(self->table, key);
+    PyObject* value = memo_lookup_key(self, key);
     if (value) {
         return Py_NewRef(value);
     }
 
     /* No existing value: store default (or None if omitted) and return it. */
     PyObject* def = (nargs == 2) ? args[1] : Py_None;
+#if COPIUM_PARALLEL_DEEPCOPY
+    if (UNLIKELY(self->shared)) {
+        value = sharded_memo_insert(self->shared, key, def, hash_pointer(key), 0);
+        return Py_XNewRef(value);
+    }
+#endif
     if (memo_table_insert(&self->table, key, def) < 0) {
         return NULL;
     }
@@ -1437,7 +1683,7 @@ static PyObject* Memo_richcompare(PyMemoObject* self, PyObject* other, int op) {
     }
 
     /* Only compare with other Memo objects for now */
-    if (Py_TYPE(other) != &Memo_Type) {
+    if (Py_TYPE(other) != Py_TYPE(self)) {
         /* Could also compare with dicts, but let's keep it simple */
         if (op == Py_EQ)
             Py_RETURN_FALSE;
@@ -1460,9 +1706,9 @@ static PyObject* Memo_richcompare(PyMemoObject* self, PyObject* other, int op) {
     /* Check all keys and values match */
     if (self->table) {
         for (Py_ssize_t i = 0; i < self->table->size; i++) {
-            void* key = self->table->slots[i].key;
-            if (key && key != MEMO_TOMBSTONE) {
-                PyObject* self_val = self->table->slots[i].value;
+            if (MEMO_CTRL_IS_FULL(self->table->ctrl[i])) {
+                void* key = self->table->keys[i];
+                PyObject* self_val = self->table->values[i];
                 PyObject* other_val = memo_table_lookup(other_memo->table, key);
                 if (!other_val) {
                     if (op == Py_EQ)
@@ -1571,48 +1817,66 @@ static PyMethodDef Memo_methods[] = {
     {NULL, NULL, 0, NULL}
 };
 
-PyTypeObject Memo_Type = {
-    PyVarObject_HEAD_INIT(NULL, 0).tp_name = "copium.memo",
-    .tp_basicsize = sizeof(PyMemoObject),
-    .tp_dealloc = (destructor)Memo_dealloc,
-    .tp_repr = (reprfunc)Memo_repr,
-    .tp_getset = Memo_getset,
-    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
-    .tp_as_mapping = &Memo_as_mapping,
-    .tp_as_sequence = &Memo_as_sequence,
-    .tp_iter = (getiterfunc)Memo_iter,
-    .tp_methods = Memo_methods,
-    .tp_traverse = (traverseproc)Memo_traverse,
-    .tp_clear = (inquiry)Memo_clear_gc,
-    .tp_richcompare = (richcmpfunc)Memo_richcompare,
+static PyType_Slot Memo_slots[] = {
+    {Py_tp_dealloc, Memo_dealloc},
+    {Py_tp_repr, Memo_repr},
+    {Py_tp_getset, Memo_getset},
+    {Py_mp_length, Memo_len},
+    {Py_mp_subscript, Memo_subscript},
+    {Py_mp_ass_subscript, Memo_ass_subscript},
+    {Py_sq_contains, Memo_contains},
+    {Py_tp_iter, Memo_iter},
+    {Py_tp_methods, Memo_methods},
+    {Py_tp_traverse, Memo_traverse},
+    {Py_tp_clear, Memo_clear_gc},
+    {Py_tp_richcompare, Memo_richcompare},
+    {0, NULL},
 };
 
-/* --------------------------- Type readiness helper ------------------------- */
+static PyType_Spec Memo_spec = {
+    .name = "copium.memo",
+    .basicsize = sizeof(PyMemoObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE |
+        Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = Memo_slots,
+};
+
+/* --------------------------- Type creation --------------------------------- */
+
+static PyTypeObject* memo_make_type(PyObject* module, PyType_Spec* spec) {
+    return (PyTypeObject*)PyType_FromModuleAndSpec(module, spec, NULL);
+}
 
-/* Called from module init in _copying.c */
-int memo_ready_types(void) {
-    if (PyType_Ready(&KeepaliveList_Type) < 0)
+/* Called from module init in _init.c, with the module's state entered */
+static int memo_make_types(PyObject* module) {
+    module_state.KeepaliveList_Type = memo_make_type(module, &KeepaliveList_spec);
+    if (!module_state.KeepaliveList_Type)
         return -1;
-    if (PyType_Ready(&MemoViewIter_Type) < 0)
+    module_state.MemoViewIter_Type = memo_make_type(module, &MemoViewIter_spec);
+    if (!module_state.MemoViewIter_Type)
         return -1;
-    if (PyType_Ready(&MemoKeysView_Type) < 0)
+    module_state.MemoKeysView_Type = memo_make_type(module, &MemoKeysView_spec);
+    if (!module_state.MemoKeysView_Type)
         return -1;
-    if (PyType_Ready(&MemoValuesView_Type) < 0)
+    module_state.MemoValuesView_Type = memo_make_type(module, &MemoValuesView_spec);
+    if (!module_state.MemoValuesView_Type)
         return -1;
-    if (PyType_Ready(&MemoItemsView_Type) < 0)
+    module_state.MemoItemsView_Type = memo_make_type(module, &MemoItemsView_spec);
+    if (!module_state.MemoItemsView_Type)
         return -1;
-    if (PyType_Ready(&Memo_Type) < 0)
+    module_state.Memo_Type = memo_make_type(module, &Memo_spec);
+    if (!module_state.Memo_Type)
         return -1;
     return 0;
 }
 
 /* Register Memo and view types with collections.abc ABCs */
 int memo_register_abcs(void) {
-    if (register_with_collections_abc("MutableMapping", &Memo_Type) < 0)
+    if (register_with_collections_abc("MutableMapping", module_state.Memo_Type) < 0)
         return -1;
-    register_with_collections_abc("KeysView", &MemoKeysView_Type);
-    register_with_collections_abc("ValuesView", &MemoValuesView_Type);
-    register_with_collections_abc("ItemsView", &MemoItemsView_Type);
+    register_with_collections_abc("KeysView", module_state.MemoKeysView_Type);
+    register_with_collections_abc("ValuesView", module_state.MemoValuesView_Type);
+    register_with_collections_abc("ItemsView", module_state.MemoItemsView_Type);
     return 0;
 }
 
@@ -1626,27 +1890,104 @@ static ALWAYS_INLINE PyMemoObject* get_memo(int* out_is_tss) {
             return NULL;
         PyThread_tss_set(&module_state.memo_tss, tss_memo);
         *out_is_tss = 1;
+        tss_memo->defer_unique = 1;
+        tss_memo->lazy_keepalive = COPIUM_LAZY_KEEPALIVE;
         return tss_memo;
     }
 
     if (LIKELY(Py_REFCNT(tss_memo) == 1)) {
         // no unfinished deepcopy operations in this thread
         *out_is_tss = 1;
+        tss_memo->defer_unique = 1;
+        tss_memo->lazy_keepalive = COPIUM_LAZY_KEEPALIVE;
         return tss_memo;
     }
     // looks like we need new memo for a nested deepcopy
     *out_is_tss = 0;
-    return Memo_New();
+    PyMemoObject* memo = Memo_New();
+    if (memo) {
+        memo->defer_unique = 1;
+        memo->lazy_keepalive = COPIUM_LAZY_KEEPALIVE;
+    }
+    return memo;
+}
+
+/*
+ * What the thread's memo keeps allocated between deepcopy() calls.
+ *
+ * "fixed" shrinks whatever grew past the compile-time COPIUM_*_RETAIN_* caps. "minimal" gives
+ * everything back after each call. "adaptive" keeps decaying high-water marks of how many table
+ * entries and keepalive items recent calls needed, holds on to capacity for that and releases
+ * anything more than twice over it. A thread that keeps alternating small and huge copies keeps
+ * the huge table; once the huge copies stop, the mark halves about every 5 calls.
+ */
+static Py_ssize_t memo_retain_decay(Py_ssize_t recent, Py_ssize_t now) {
+    recent -= recent >> COPIUM_MEMO_RETAIN_DECAY_SHIFT;
+    return now > recent ? now : recent;
+}
+
+/* Table size memo_table_resize() picks for this many entries. */
+static Py_ssize_t memo_retain_slots(Py_ssize_t entries) {
+    Py_ssize_t slots = MEMO_GROUP_WIDTH;
+    while (slots < entries * 2)
+        slots <<= 1;
+    return slots;
+}
+
+static void memo_retain(PyMemoObject* memo) {
+    Py_ssize_t table_limit, table_target, items_limit, items_target;
+
+    switch (module_state.memo_retention) {
+        case COPIUM_MEMO_RETENTION_FIXED:
+            table_limit = COPIUM_MEMO_RETAIN_MAX_SLOTS;
+            table_target = COPIUM_MEMO_RETAIN_SHRINK_TO;
+            items_limit = COPIUM_KEEP_RETAIN_MAX;
+            items_target = COPIUM_KEEP_RETAIN_TARGET;
+            break;
+        case COPIUM_MEMO_RETENTION_MINIMAL:
+            table_limit = table_target = MEMO_GROUP_WIDTH;
+            items_limit = items_target = 0;
+            memo->recent_entries = memo->recent_items = 0;
+            break;
+        default: {
+            Py_ssize_t items = memo->keepalive.size;
+            if (memo->deferred.size > items)
+                items = memo->deferred.size;
+            if (memo->undo_log.size > items)
+                items = memo->undo_log.size;
+            memo->recent_entries = memo_retain_decay(
+                memo->recent_entries, memo->table ? memo->table->used : 0
+            );
+            memo->recent_items = memo_retain_decay(memo->recent_items, items);
+
+            table_target = memo_retain_slots(memo->recent_entries);
+            table_limit = table_target * 2;
+            items_target = memo->recent_items;
+            items_limit = items_target * 2 > COPIUM_KEEP_RETAIN_TARGET ? items_target * 2
+                                                                       : COPIUM_KEEP_RETAIN_TARGET;
+            break;
+        }
+    }
+
+    keepalive_clear(&memo->keepalive);
+    keepalive_shrink_to(&memo->keepalive, items_limit, items_target);
+    undo_log_clear(&memo->undo_log);
+    undo_log_shrink_to(&memo->undo_log, items_limit, items_target);
+    keepalive_clear(&memo->deferred);
+    keepalive_shrink_to(&memo->deferred, items_limit, items_target);
+    copy_stack_shrink_to(
+        &memo->stack,
+        module_state.memo_retention == COPIUM_MEMO_RETENTION_MINIMAL
+            ? 0
+            : COPIUM_COPY_STACK_RETAIN_SEGMENTS
+    );
+    memo_table_reset(&memo->table, table_limit, table_target);
 }
 
 static ALWAYS_INLINE int cleanup_memo(PyMemoObject* memo, int is_tss) {
     if (LIKELY(is_tss && Py_REFCNT(memo) == 1)) {
         // we're still the only owner, cleanup references and keep it in TSS
-        keepalive_clear(&memo->keepalive);
-        keepalive_shrink_if_large(&memo->keepalive);
-        undo_log_clear(&memo->undo_log);
-        undo_log_shrink_if_large(&memo->undo_log);
-        memo_table_reset(&memo->table);
+        memo_retain(memo);
         return 1;
     }
     if (is_tss) {
@@ -1662,11 +2003,105 @@ static ALWAYS_INLINE int cleanup_memo(PyMemoObject* memo, int is_tss) {
     return 0;
 }
 
+/*
+ * Refcount-1 memo elision.
+ *
+ * A container that only its parent refers to can't be reached a second time while the parent
+ * is being copied, so nothing will ever look it up in the memo. Such children are copied with
+ * MEMO_HASH_DEFERRED: the lookup is skipped and memoize() only records the pair here. The
+ * records are moved into the table by memo_escape() right before Python code gets hold of the
+ * memo, so a __deepcopy__ sees exactly what it would have seen without the elision.
+ */
+static int memo_defer(PyMemoObject* memo, PyObject* original, PyObject* copy) {
+    if (keepalive_append(&memo->deferred, original) < 0)
+        return -1;
+    if (keepalive_append(&memo->deferred, copy) < 0)
+        return -1;
+    return 0;
+}
+
+#if COPIUM_PARALLEL_DEEPCOPY
+/* The copy of original that made it into the shared memo, in place of this worker's own copy
+ * if another worker's got there first. */
+static PyObject* memo_settle(PyMemoObject* memo, PyObject* original, PyObject* copy) {
+    if (!copy)
+        return NULL;
+    PyObject* winner = sharded_memo_lookup(memo->shared, original, hash_pointer(original));
+    if (winner && winner != copy)
+        Py_SETREF(copy, Py_NewRef(winner));
+    return copy;
+}
+#endif
+
+/*
+ * Lazy keepalive.
+ *
+ * The keepalive is there for code other than copium's own: a __deepcopy__ or a reduction may drop
+ * the last reference to an original that's already memoized, or hand out temporaries (a
+ * __reduce_ex__ state) that only live for the call, and a new object allocated at the same address
+ * would then hit the memo. While a copy only takes native routes, every memoized original stays
+ * reachable from the object being copied, so memoize() leaves the keepalive alone and this fills it
+ * in from the table's keys right before anything else runs. memo[id(memo)] then lists them in table
+ * order rather than in the order they were memoized. Free-threaded builds keep every original right
+ * away: another thread may drop one mid-copy.
+ */
+static int memo_keep_originals(PyMemoObject* memo) {
+    memo->lazy_keepalive = 0;
+    MemoTable* table = memo->table;
+    if (!table || !table->used)
+        return 0;
+    KeepaliveVector* keepalive = &memo->keepalive;
+    if (keepalive->size + table->used > keepalive->capacity &&
+        keepalive_grow(keepalive, keepalive->size + table->used) < 0)
+        return -1;
+    for (Py_ssize_t i = 0; i < table->size; i++) {
+        if (MEMO_CTRL_IS_FULL(table->ctrl[i]))
+            keepalive->items[keepalive->size++] = Py_NewRef((PyObject*)table->keys[i]);
+    }
+    return 0;
+}
+
+static int memo_escape(PyMemoObject* memo) {
+    memo->defer_unique = 0;
+    if (memo->lazy_keepalive && memo_keep_originals(memo) < 0)
+        return -1;
+    KeepaliveVector* deferred = &memo->deferred;
+    for (Py_ssize_t i = 0; i < deferred->size; i += 2) {
+        PyObject* original = deferred->items[i];
+        PyObject* copy = deferred->items[i + 1];
+        if (memo_table_insert_h(&memo->table, original, copy, hash_pointer(original)) < 0)
+            return -1;
+        if (keepalive_append(&memo->keepalive, original) < 0)
+            return -1;
+    }
+    keepalive_clear(deferred);
+    return 0;
+}
+
+/*
+ * Ahead of code other than copium's own (reductions, copiers, attribute lookups): it may hand back
+ * originals whose copies the memo deferred, or drop the last reference to memoized ones. The memo
+ * has to know of both by then.
+ */
+static ALWAYS_INLINE int memo_expose(PyMemoObject* memo) {
+    if (memo->defer_unique)
+        return memo_escape(memo);
+    return memo->lazy_keepalive ? memo_keep_originals(memo) : 0;
+}
+
 static ALWAYS_INLINE int memoize(
     PyMemoObject* memo, void* original, PyObject* copy, Py_ssize_t hash
 ) {
+    if (hash == MEMO_HASH_DEFERRED)
+        return memo_defer(memo, (PyObject*)original, copy);
+#if COPIUM_PARALLEL_DEEPCOPY
+    if (UNLIKELY(memo->shared))
+        return sharded_memo_insert(memo->shared, original, copy, hash, 1) ? 0 : -1;
+#endif
     if (memo_table_insert_h(&memo->table, original, copy, hash) < 0)
         return -1;
+    if (memo->lazy_keepalive)
+        return 0;
     if (keepalive_append(&memo->keepalive, (PyObject*)original) < 0)
         return -1;
     return 0;
@@ -1677,6 +2112,12 @@ static ALWAYS_INLINE PyObject* remember(
 ) {
     void* memo_key = (void*)original;
     *memo_key_hash = memo_hash_pointer(memo_key);
+#if COPIUM_PARALLEL_DEEPCOPY
+    if (UNLIKELY(memo->shared)) {
+        PyObject* shared = sharded_memo_lookup(memo->shared, memo_key, *memo_key_hash);
+        return shared ? Py_NewRef(shared) : NULL;
+    }
+#endif
     PyObject* memoized = memo_table_lookup_h(memo->table, memo_key, (Py_hash_t)*memo_key_hash);
     if (memoized)
         return Py_NewRef(memoized);
@@ -1684,6 +2125,14 @@ static ALWAYS_INLINE PyObject* remember(
 }
 
 static int forget(PyMemoObject* memo, void* original, Py_ssize_t memo_key_hash) {
+    // A deferred record of a failed copy is harmless: the whole copy is unwinding.
+    if (memo_key_hash == MEMO_HASH_DEFERRED)
+        return 0;
+#if COPIUM_PARALLEL_DEEPCOPY
+    // Another worker may already hold on to the entry; the whole parallel copy fails anyway.
+    if (memo->shared)
+        return 0;
+#endif
     return memo_table_remove_h(memo->table, original, memo_key_hash);
 }
 
@@ -1728,14 +2177,14 @@ static PyObject* memo_to_dict(PyMemoObject* memo) {
 
     // Leave keepalive list out of it
     for (Py_ssize_t i = 0; i < memo->table->size; i++) {
-        void* key = memo->table->slots[i].key;
-        if (key && key != MEMO_TOMBSTONE) {
+        if (MEMO_CTRL_IS_FULL(memo->table->ctrl[i])) {
+            void* key = memo->table->keys[i];
             PyObject* py_key = PyLong_FromVoidPtr(key);
             if (!py_key) {
                 Py_DECREF(dict);
                 return NULL;
             }
-            PyObject* value = memo->table->slots[i].value;
+            PyObject* value = memo->table->values[i];
             if (PyDict_SetItem(dict, py_key, value) < 0) {
                 Py_DECREF(py_key);
                 Py_DECREF(dict);
@@ -0,0 +1,343 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * extra.parallel_deepcopy()
+ *
+ * The items of a top-level list, tuple or dict are split into contiguous chunks, one per worker
+ * thread, and each worker deep-copies its chunk with a memo of its own that forwards to one
+ * ShardedMemo (see _memo.c). The calling thread copies the first chunk itself, then assembles
+ * the result in the original order once all workers are done.
+ */
+#ifndef _COPIUM_PARALLEL_C
+#define _COPIUM_PARALLEL_C
+
+#include "_common.h"
+#include "_memo.c"
+#include "_deepcopy.c"
+
+#if COPIUM_PARALLEL_DEEPCOPY
+
+    #include "pythread.h"
+
+    // Rough object count (the items plus the items of the builtin containers among them) below
+    // which starting threads costs more than they save.
+    #ifndef COPIUM_PARALLEL_MIN_ITEMS
+        #define COPIUM_PARALLEL_MIN_ITEMS 4096
+    #endif
+
+typedef struct {
+    ModuleState* state;
+    PyInterpreterState* interp;
+    ShardedMemo* shared;
+    PyObject** originals;
+    PyObject** copies;
+    Py_ssize_t start;
+    Py_ssize_t stop;
+    PyThread_type_lock done; /* held while a worker thread runs the chunk */
+    PyObject* error;         /* what the chunk raised, if anything */
+    int ran;
+} ParallelChunk;
+
+static void parallel_chunk_run(ParallelChunk* chunk) {
+    chunk->ran = 1;
+    PyMemoObject* memo = Memo_New();
+    if (!memo) {
+        chunk->error = PyErr_GetRaisedException();
+        return;
+    }
+    memo->shared = chunk->shared;
+
+    for (Py_ssize_t i = chunk->start; i < chunk->stop; i++) {
+        PyObject* copy = deepcopy(chunk->originals[i], memo);
+        if (!copy) {
+            chunk->error = PyErr_GetRaisedException();
+            break;
+        }
+        chunk->copies[i] = copy;
+    }
+
+    memo->shared = NULL;
+    cleanup_memo(memo, 0);
+}
+
+/*
+ * Workers attach to the interpreter of the calling thread, which PyGILState_Ensure() wouldn't
+ * do in a subinterpreter. A chunk whose thread state couldn't be created is left for the
+ * calling thread.
+ */
+static void parallel_chunk_thread(void* arg) {
+    ParallelChunk* chunk = (ParallelChunk*)arg;
+    PyThreadState* tstate = PyThreadState_New(chunk->interp);
+    if (tstate) {
+        PyEval_RestoreThread(tstate);
+        ModuleState* outer = copium_enter(chunk->state);
+        parallel_chunk_run(chunk);
+        copium_leave(outer);
+        PyThreadState_Clear(tstate);
+        PyThreadState_DeleteCurrent();
+    }
+    PyThread_release_lock(chunk->done);
+}
+
+static ALWAYS_INLINE Py_ssize_t parallel_estimate_size(PyObject* item) {
+    PyTypeObject* type = Py_TYPE(item);
+    if (type == &PyList_Type)
+        return PyList_GET_SIZE(item);
+    if (type == &PyTuple_Type)
+        return PyTuple_GET_SIZE(item);
+    if (type == &PyDict_Type)
+        return PyDict_GET_SIZE(item);
+    if (type == &PySet_Type || type == &PyFrozenSet_Type)
+        return PySet_GET_SIZE(item);
+    return 0;
+}
+
+/*
+ * Copy originals[0:count] into copies[0:count] over `workers` threads. For dicts, originals
+ * holds keys and values interleaved and `stride` is 2 so that a pair never straddles chunks.
+ * Returns -1 with the first chunk's exception set if any chunk failed.
+ */
+static int parallel_copy_items(
+    ShardedMemo* shared,
+    PyObject** originals,
+    PyObject** copies,
+    Py_ssize_t count,
+    Py_ssize_t stride,
+    Py_ssize_t workers
+) {
+    Py_ssize_t units = count / stride;
+    if (workers > units)
+        workers = units;
+
+    ParallelChunk* chunks = (ParallelChunk*)PyMem_Calloc((size_t)workers, sizeof(ParallelChunk));
+    if (!chunks) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    PyInterpreterState* interp = PyInterpreterState_Get();
+    for (Py_ssize_t w = 0; w < workers; w++) {
+        chunks[w].state = copium_current_state;
+        chunks[w].interp = interp;
+        chunks[w].shared = shared;
+        chunks[w].originals = originals;
+        chunks[w].copies = copies;
+        chunks[w].start = units * w / workers * stride;
+        chunks[w].stop = units * (w + 1) / workers * stride;
+    }
+
+    // A chunk whose thread couldn't be started is copied on this thread instead.
+    for (Py_ssize_t w = 1; w < workers; w++) {
+        PyThread_type_lock done = PyThread_allocate_lock();
+        if (!done)
+            continue;
+        PyThread_acquire_lock(done, WAIT_LOCK);
+        chunks[w].done = done;
+        if (PyThread_start_new_thread(parallel_chunk_thread, &chunks[w]) ==
+            PYTHREAD_INVALID_THREAD_ID) {
+            PyThread_release_lock(done);
+            PyThread_free_lock(done);
+            chunks[w].done = NULL;
+        }
+    }
+
+    parallel_chunk_run(&chunks[0]);
+    for (Py_ssize_t w = 1; w < workers; w++) {
+        if (!chunks[w].done)
+            parallel_chunk_run(&chunks[w]);
+    }
+
+    Py_BEGIN_ALLOW_THREADS;
+    for (Py_ssize_t w = 1; w < workers; w++) {
+        if (chunks[w].done) {
+            PyThread_acquire_lock(chunks[w].done, WAIT_LOCK);
+            PyThread_release_lock(chunks[w].done);
+            PyThread_free_lock(chunks[w].done);
+        }
+    }
+    Py_END_ALLOW_THREADS;
+    for (Py_ssize_t w = 1; w < workers; w++) {
+        if (!chunks[w].ran)
+            parallel_chunk_run(&chunks[w]);
+    }
+
+    PyObject* error = NULL;
+    for (Py_ssize_t w = 0; w < workers; w++) {
+        if (!chunks[w].error)
+            continue;
+        if (!error)
+            error = chunks[w].error;
+        else
+            Py_DECREF(chunks[w].error);
+    }
+    PyMem_Free(chunks);
+
+    if (error) {
+        PyErr_SetRaisedException(error);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Shallow snapshot of a list's, tuple's or dict's items (dict keys and values interleaved) as
+ * new references. Returns the number of pointers written to *out, or -1 with an exception set.
+ */
+static Py_ssize_t parallel_snapshot(PyObject* obj, PyObject*** out) {
+    PyTypeObject* type = Py_TYPE(obj);
+    Py_ssize_t count = -1;
+    PyObject** items = NULL;
+
+    COPIUM_Py_BEGIN_CRITICAL_SECTION(obj);
+    if (type == &PyDict_Type) {
+        count = PyDict_GET_SIZE(obj) * 2;
+        items = (PyObject**)PyMem_Malloc((size_t)(count ? count : 1) * sizeof(PyObject*));
+        if (items) {
+            PyObject *key, *value;
+            Py_ssize_t pos = 0, i = 0;
+            while (PyDict_Next(obj, &pos, &key, &value)) {
+                items[i++] = Py_NewRef(key);
+                items[i++] = Py_NewRef(value);
+            }
+        }
+    } else {
+        count = Py_SIZE(obj);
+        items = (PyObject**)PyMem_Malloc((size_t)(count ? count : 1) * sizeof(PyObject*));
+        if (items) {
+            PyObject** source = type == &PyList_Type ? ((PyListObject*)obj)->ob_item
+                                                     : ((PyTupleObject*)obj)->ob_item;
+            for (Py_ssize_t i = 0; i < count; i++)
+                items[i] = Py_NewRef(source[i]);
+        }
+    }
+    COPIUM_Py_END_CRITICAL_SECTION();
+
+    if (!items) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    *out = items;
+    return count;
+}
+
+static void parallel_release(PyObject** items, Py_ssize_t count) {
+    if (!items)
+        return;
+    for (Py_ssize_t i = 0; i < count; i++)
+        Py_XDECREF(items[i]);
+    PyMem_Free(items);
+}
+
+/*
+ * parallel_deepcopy() for exact lists, tuples and dicts that are large enough. Returns NULL
+ * without an exception set when obj should go through plain deepcopy() instead.
+ */
+static PyObject* parallel_deepcopy(PyObject* obj, Py_ssize_t workers) {
+    PyTypeObject* type = Py_TYPE(obj);
+    if (workers < 2 || (type != &PyList_Type && type != &PyTuple_Type && type != &PyDict_Type))
+        return NULL;
+
+    PyObject** originals = NULL;
+    Py_ssize_t count = parallel_snapshot(obj, &originals);
+    if (count < 0)
+        return NULL;
+
+    Py_ssize_t estimate = count;
+    for (Py_ssize_t i = 0; i < count && estimate < COPIUM_PARALLEL_MIN_ITEMS; i++)
+        estimate += parallel_estimate_size(originals[i]);
+    if (estimate < COPIUM_PARALLEL_MIN_ITEMS) {
+        parallel_release(originals, count);
+        return NULL;
+    }
+
+    Py_ssize_t stride = type == &PyDict_Type ? 2 : 1;
+    PyObject** copies = (PyObject**)PyMem_Calloc((size_t)count, sizeof(PyObject*));
+    ShardedMemo* shared = sharded_memo_new();
+    PyObject* copied = NULL;
+    PyObject* result = NULL;
+    if (!copies || !shared) {
+        if (!copies)
+            PyErr_NoMemory();
+        goto done;
+    }
+
+    // Lists and dicts go into the memo before their items are copied, like in
+    // copy_frame_start(), so that cycles back to obj resolve to the result.
+    if (type == &PyList_Type) {
+        copied = PyList_New(count);
+        if (!copied)
+            goto done;
+        for (Py_ssize_t i = 0; i < count; i++)
+            PyList_SET_ITEM(copied, i, Py_NewRef(Py_Ellipsis));
+    } else if (type == &PyDict_Type) {
+        copied = PyDict_New();
+        if (!copied)
+            goto done;
+    }
+    if (copied && !sharded_memo_insert(shared, obj, copied, hash_pointer(obj), 1))
+        goto done;
+
+    if (parallel_copy_items(shared, originals, copies, count, stride, workers) < 0)
+        goto done;
+
+    if (type == &PyList_Type) {
+        int size_changed = 0;
+        COPIUM_Py_BEGIN_CRITICAL_SECTION(copied);
+        if (UNLIKELY(PyList_GET_SIZE(copied) != count)) {
+            size_changed = 1;
+        } else {
+            for (Py_ssize_t i = 0; i < count; i++) {
+                Py_SETREF(((PyListObject*)copied)->ob_item[i], copies[i]);
+                copies[i] = NULL;
+            }
+        }
+        COPIUM_Py_END_CRITICAL_SECTION();
+        if (UNLIKELY(size_changed)) {
+            PyErr_SetString(PyExc_RuntimeError, "list changed size during iteration");
+            goto done;
+        }
+        result = Py_NewRef(copied);
+    } else if (type == &PyDict_Type) {
+        for (Py_ssize_t i = 0; i < count; i += 2) {
+            if (PyDict_SetItem(copied, copies[i], copies[i + 1]) < 0)
+                goto done;
+        }
+        result = Py_NewRef(copied);
+    } else {
+        // Tuples are memoized after their items, and give back the original when nothing
+        // inside needed a copy, like in copy_frame_finish().
+        int all_same = 1;
+        for (Py_ssize_t i = 0; i < count && all_same; i++)
+            all_same = copies[i] == originals[i];
+        if (all_same) {
+            result = Py_NewRef(obj);
+            goto done;
+        }
+        PyObject* existing = sharded_memo_lookup(shared, obj, hash_pointer(obj));
+        if (existing) {
+            result = Py_NewRef(existing);
+            goto done;
+        }
+        result = PyTuple_New(count);
+        if (!result)
+            goto done;
+        for (Py_ssize_t i = 0; i < count; i++) {
+            PyTuple_SET_ITEM(result, i, copies[i]);
+            copies[i] = NULL;
+        }
+    }
+
+done:
+    Py_XDECREF(copied);
+    sharded_memo_free(shared);
+    parallel_release(copies, count);
+    parallel_release(originals, count);
+    return result;
+}
+
+#endif  // COPIUM_PARALLEL_DEEPCOPY
+
+#endif  // _COPIUM_PARALLEL_C
@@ -10,6 +10,8 @@
 #define PY_SSIZE_T_CLEAN
 #include <Python.h>
 
+#include "_state.c"
+
 PyObject* py_deepcopy(PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames);
 
 #if PY_VERSION_HEX >= 0x030C0000
@@ -86,10 +88,8 @@ static int _patch_is_applied(PyFunctionObject* fn) {
 
 #else
 
-static PyObject* g_template_code = NULL;
-
 static int _init_template(void) {
-    if (g_template_code)
+    if (module_state.patch_template_code)
         return 0;
 
     static const char* src =
@@ -140,13 +140,13 @@ static int _init_template(void) {
         return -1;
     }
 
-    g_template_code = PyObject_GetAttrString(fn, "__code__");
+    module_state.patch_template_code = PyObject_GetAttrString(fn, "__code__");
     Py_DECREF(globals);
-    return g_template_code ? 0 : -1;
+    return module_state.patch_template_code ? 0 : -1;
 }
 
 static PyObject* _build_patched_code(PyObject* target) {
-    PyObject* template_consts = PyObject_GetAttrString(g_template_code, "co_consts");
+    PyObject* template_consts = PyObject_GetAttrString(module_state.patch_template_code, "co_consts");
     if (!template_consts)
         return NULL;
 
@@ -186,7 +186,7 @@ static PyObject* _build_patched_code(PyObject* target) {
     if (!consts_tuple)
         return NULL;
 
-    PyObject* replace = PyObject_GetAttrString(g_template_code, "replace");
+    PyObject* replace = PyObject_GetAttrString(module_state.patch_template_code, "replace");
     if (!replace) {
         Py_DECREF(consts_tuple);
         return NULL;
@@ -0,0 +1,812 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Compiled copy plans (copium.extra.compile).
+ *
+ * A plan is the template's graph flattened into pre-order instructions:
+ * containers with their sizes, atomic leaves that copies share, and
+ * back-edges to containers emitted earlier. Running it rebuilds the graph
+ * with no type dispatch and, as long as the template is made of builtin
+ * containers and atomics only, without a memo.
+ *
+ * Anything else becomes a PLAN_DEEPCOPY instruction. Such plans run with a
+ * memo: every container is memoized as it is built, so objects copied through
+ * regular deepcopy see the same identities they would in a plain deepcopy of
+ * the template, and containers a deepcopy instruction already reached are
+ * taken from the memo instead of being built twice.
+ */
+#ifndef _COPIUM_PLAN_C
+#define _COPIUM_PLAN_C
+
+#include "_common.h"
+#include "_state.c"
+#include "_type_checks.c"
+#include "_memo.c"
+#include "_deepcopy.c"
+
+typedef enum {
+    PLAN_LEAF,       // share obj
+    PLAN_REF,        // copy already built for slot; obj is the original it stands for
+    PLAN_DEEPCOPY,   // deepcopy(obj, memo)
+    PLAN_LIST,       // followed by size items
+    PLAN_DICT,       // followed by size key/value pairs
+    PLAN_SET,        // followed by size items
+    PLAN_TUPLE,      // followed by size items
+    PLAN_FROZENSET,  // followed by size items
+    PLAN_BYTEARRAY,  // copy of obj's current contents
+} PlanOpKind;
+
+typedef struct {
+    PlanOpKind kind;
+    Py_ssize_t size;  // containers: number of items (pairs for dicts)
+    Py_ssize_t end;   // containers: index of the first op past the subtree
+    Py_ssize_t slot;  // slot receiving the copy (-1 if nothing refers back), or slot read by PLAN_REF
+    PyObject* obj;    // strong: the leaf to share, or the original the op copies
+} PlanOp;
+
+typedef struct {
+    PyObject_HEAD PlanOp* ops;
+    Py_ssize_t n_ops;
+    Py_ssize_t n_slots;
+    Py_ssize_t depth;  // container nesting
+    int uses_memo;
+} PlanObject;
+
+
+/* ------------------------------- Compiler --------------------------------- */
+
+// Open-addressing map from container address to the index of its op.
+typedef struct {
+    void* key;
+    Py_ssize_t index;
+} PlanSeenEntry;
+
+typedef struct {
+    PlanSeenEntry* entries;
+    Py_ssize_t mask;
+    Py_ssize_t used;  // live entries plus tombstones
+} PlanSeen;
+
+static Py_ssize_t plan_seen_get(PlanSeen* seen, void* key) {
+    if (!seen->entries)
+        return -1;
+    for (Py_ssize_t i = hash_pointer(key) & seen->mask;; i = (i + 1) & seen->mask) {
+        PlanSeenEntry* entry = &seen->entries[i];
+        if (entry->key == key)
+            return entry->index;
+        if (entry->key == NULL)
+            return -1;
+    }
+}
+
+static int plan_seen_set(PlanSeen* seen, void* key, Py_ssize_t index) {
+    if (!seen->entries || (seen->used + 1) * 2 > seen->mask + 1) {
+        PlanSeen grown = {.mask = seen->entries ? seen->mask * 2 + 1 : 63};
+        grown.entries = PyMem_Calloc((size_t)grown.mask + 1, sizeof(PlanSeenEntry));
+        if (!grown.entries) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        for (Py_ssize_t i = 0; seen->entries && i <= seen->mask; i++) {
+            PlanSeenEntry* entry = &seen->entries[i];
+            if (entry->key && entry->key != MEMO_TOMBSTONE)
+                plan_seen_set(&grown, entry->key, entry->index);
+        }
+        PyMem_Free(seen->entries);
+        *seen = grown;
+    }
+    Py_ssize_t i = hash_pointer(key) & seen->mask;
+    while (seen->entries[i].key != NULL)
+        i = (i + 1) & seen->mask;
+    seen->entries[i] = (PlanSeenEntry){.key = key, .index = index};
+    seen->used++;
+    return 0;
+}
+
+static void plan_seen_del(PlanSeen* seen, void* key) {
+    for (Py_ssize_t i = hash_pointer(key) & seen->mask;; i = (i + 1) & seen->mask) {
+        PlanSeenEntry* entry = &seen->entries[i];
+        if (entry->key == key) {
+            entry->key = MEMO_TOMBSTONE;
+            return;
+        }
+        if (entry->key == NULL)
+            return;
+    }
+}
+
+typedef struct {
+    PlanOp* ops;
+    Py_ssize_t n_ops;
+    Py_ssize_t capacity;
+    Py_ssize_t n_slots;
+    Py_ssize_t depth;
+    Py_ssize_t max_depth;
+    PlanSeen seen;
+    int uses_memo;
+    int memo_free_only;  // give up, without an exception, at the first op that needs a memo
+    int declined;
+} PlanBuilder;
+
+static Py_ssize_t plan_emit(PlanBuilder* b, PlanOpKind kind, PyObject* obj) {
+    if (b->n_ops == b->capacity) {
+        Py_ssize_t capacity = b->capacity ? b->capacity * 2 : 16;
+        PlanOp* ops = PyMem_Realloc(b->ops, (size_t)capacity * sizeof(PlanOp));
+        if (!ops) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        b->ops = ops;
+        b->capacity = capacity;
+    }
+    b->ops[b->n_ops] = (PlanOp){.kind = kind, .end = -1, .slot = -1, .obj = Py_NewRef(obj)};
+    return b->n_ops++;
+}
+
+static void plan_truncate(PlanBuilder* b, Py_ssize_t n_ops) {
+    while (b->n_ops > n_ops)
+        Py_DECREF(b->ops[--b->n_ops].obj);
+}
+
+static int plan_compile_node(PlanBuilder* b, PyObject* obj);
+
+static int plan_compile_items(PlanBuilder* b, PyObject* iterable) {
+    PyObject* it = PyObject_GetIter(iterable);
+    if (!it)
+        return -1;
+    PyObject* item;
+    while ((item = PyIter_Next(it))) {
+        int rc = plan_compile_node(b, item);
+        Py_DECREF(item);
+        if (rc < 0) {
+            Py_DECREF(it);
+            return -1;
+        }
+    }
+    Py_DECREF(it);
+    return PyErr_Occurred() ? -1 : 0;
+}
+
+static int plan_compile_container(PlanBuilder* b, PyObject* obj, PlanOpKind kind) {
+    Py_ssize_t index = plan_emit(b, kind, obj);
+    if (index < 0)
+        return -1;
+
+    if (plan_seen_set(&b->seen, obj, index) < 0)
+        return -1;
+
+    Py_ssize_t size = 0;
+    switch (kind) {
+        case PLAN_LIST:
+            size = PyList_GET_SIZE(obj);
+            for (Py_ssize_t i = 0; i < PyList_GET_SIZE(obj); i++) {
+                if (plan_compile_node(b, PyList_GET_ITEM(obj, i)) < 0)
+                    return -1;
+            }
+            break;
+        case PLAN_TUPLE:
+            size = PyTuple_GET_SIZE(obj);
+            for (Py_ssize_t i = 0; i < size; i++) {
+                if (plan_compile_node(b, PyTuple_GET_ITEM(obj, i)) < 0)
+                    return -1;
+            }
+            break;
+        case PLAN_DICT: {
+            Py_ssize_t pos = 0;
+            PyObject *key, *value;
+            size = PyDict_GET_SIZE(obj);
+            while (PyDict_Next(obj, &pos, &key, &value)) {
+                if (plan_compile_node(b, key) < 0 || plan_compile_node(b, value) < 0)
+                    return -1;
+            }
+            break;
+        }
+        case PLAN_SET:
+        case PLAN_FROZENSET:
+            size = PySet_GET_SIZE(obj);
+            if (plan_compile_items(b, obj) < 0)
+                return -1;
+            break;
+        default:
+            break;
+    }
+    b->ops[index].size = size;
+    b->ops[index].end = b->n_ops;
+
+    // A tuple or frozenset of shared leaves is what deepcopy would hand back
+    // as-is: fold it into a leaf. It's dropped from seen so that later
+    // occurrences fold again instead of pointing at ops that no longer exist.
+    if ((kind == PLAN_TUPLE || kind == PLAN_FROZENSET) && b->n_ops - index - 1 == size) {
+        int all_leaves = 1;
+        for (Py_ssize_t i = index + 1; i < b->n_ops; i++) {
+            if (b->ops[i].kind != PLAN_LEAF) {
+                all_leaves = 0;
+                break;
+            }
+        }
+        if (all_leaves) {
+            plan_truncate(b, index + 1);
+            b->ops[index] = (PlanOp){.kind = PLAN_LEAF, .end = -1, .slot = -1, .obj = obj};
+            plan_seen_del(&b->seen, obj);
+        }
+    }
+    return 0;
+}
+
+static int plan_compile_node(PlanBuilder* b, PyObject* obj) {
+    PyTypeObject* tp = Py_TYPE(obj);
+    if (is_atomic_immutable(tp))
+        return plan_emit(b, PLAN_LEAF, obj) < 0 ? -1 : 0;
+
+    Py_ssize_t seen = plan_seen_get(&b->seen, obj);
+    if (seen >= 0) {
+        PlanOp* target = &b->ops[seen];
+        if (target->end < 0 && (target->kind == PLAN_TUPLE || target->kind == PLAN_FROZENSET)) {
+            // A cycle through an immutable container that isn't built yet:
+            // only deepcopy's memo dance can resolve that.
+            b->uses_memo = 1;
+            if (b->memo_free_only) {
+                b->declined = 1;
+                return -1;
+            }
+            return plan_emit(b, PLAN_DEEPCOPY, obj) < 0 ? -1 : 0;
+        }
+        // Only ops something refers back to get a slot.
+        if (target->slot < 0)
+            target->slot = b->n_slots++;
+        Py_ssize_t slot = target->slot;
+        Py_ssize_t index = plan_emit(b, PLAN_REF, obj);
+        if (index < 0)
+            return -1;
+        b->ops[index].slot = slot;
+        return 0;
+    }
+
+    PlanOpKind kind;
+    if (tp == &PyList_Type)
+        kind = PLAN_LIST;
+    else if (tp == &PyDict_Type)
+        kind = PLAN_DICT;
+    else if (tp == &PyTuple_Type)
+        kind = PLAN_TUPLE;
+    else if (tp == &PySet_Type)
+        kind = PLAN_SET;
+    else if (tp == &PyFrozenSet_Type)
+        kind = PLAN_FROZENSET;
+    else if (tp == &PyByteArray_Type)
+        kind = PLAN_BYTEARRAY;
+    else
+        kind = PLAN_DEEPCOPY;
+
+    if (kind == PLAN_BYTEARRAY || kind == PLAN_DEEPCOPY) {
+        if (kind == PLAN_DEEPCOPY) {
+            b->uses_memo = 1;
+            if (b->memo_free_only) {
+                b->declined = 1;
+                return -1;
+            }
+        }
+        Py_ssize_t index = plan_emit(b, kind, obj);
+        if (index < 0)
+            return -1;
+        // Registered like containers, so repeated references share one copy.
+        return plan_seen_set(&b->seen, obj, index);
+    }
+
+    if (Py_EnterRecursiveCall(" while compiling a copy plan"))
+        return -1;
+    if (++b->depth > b->max_depth)
+        b->max_depth = b->depth;
+    int rc = plan_compile_container(b, obj, kind);
+    b->depth--;
+    Py_LeaveRecursiveCall();
+    return rc;
+}
+
+/*
+ * With memo_free_only, templates that would need a memo are declined:
+ * NULL is returned with no exception set.
+ */
+static PyObject* plan_compile_ex(PyObject* template, int memo_free_only) {
+    PlanBuilder b = {.memo_free_only = memo_free_only};
+    int rc = plan_compile_node(&b, template);
+    PyMem_Free(b.seen.entries);
+    if (rc < 0) {
+        plan_truncate(&b, 0);
+        PyMem_Free(b.ops);
+        return NULL;
+    }
+
+    PlanObject* plan = PyObject_GC_New(PlanObject, module_state.Plan_Type);
+    if (!plan) {
+        plan_truncate(&b, 0);
+        PyMem_Free(b.ops);
+        return NULL;
+    }
+    plan->ops = b.ops;
+    plan->n_ops = b.n_ops;
+    plan->n_slots = b.n_slots;
+    plan->depth = b.max_depth;
+    plan->uses_memo = b.uses_memo;
+    PyObject_GC_Track(plan);
+    return (PyObject*)plan;
+}
+
+static PyObject* plan_compile(PyObject* template) {
+    return plan_compile_ex(template, 0);
+}
+
+/* -------------------------------- Runner ---------------------------------- */
+
+/*
+ * Builds the node starting at ops[*pc] and advances *pc past it.
+ * slots holds borrowed pointers to the copies built so far, with slots[-1]
+ * being a sink for copies nothing refers back to; memo is NULL unless the
+ * plan uses_memo.
+ */
+static PyObject* plan_run(PlanObject* plan, Py_ssize_t* pc, PyObject** slots, PyMemoObject* memo) {
+    PlanOp* op = &plan->ops[(*pc)++];
+    PyObject* original = op->obj;
+    PyObject* copy;
+    Py_ssize_t memo_key_hash = 0;
+
+    switch (op->kind) {
+        case PLAN_LEAF:
+            return Py_NewRef(original);
+        case PLAN_REF:
+            copy = slots[op->slot];
+            if (LIKELY(copy != NULL))
+                return Py_NewRef(copy);
+            // The target's subtree was skipped: a deepcopy instruction got there first.
+            return deepcopy(original, memo);
+        case PLAN_DEEPCOPY:
+            copy = deepcopy(original, memo);
+            if (copy)
+                slots[op->slot] = copy;
+            return copy;
+        default:
+            break;
+    }
+
+    if (memo) {
+        PyObject* memoized = remember(memo, original, &memo_key_hash);
+        if (memoized) {
+            *pc = op->end;
+            slots[op->slot] = memoized;
+            return memoized;
+        }
+    }
+
+    Py_ssize_t size = op->size;
+    switch (op->kind) {
+        case PLAN_LIST:
+            copy = PyList_New(size);
+            if (!copy)
+                return NULL;
+            if (memo) {
+                // Exposed through the memo to code run by deepcopy instructions.
+                for (Py_ssize_t i = 0; i < size; i++) {
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+                    Py_INCREF(Py_Ellipsis);
+#endif
+                    PyList_SET_ITEM(copy, i, Py_Ellipsis);
+                }
+                if (memoize(memo, original, copy, memo_key_hash) < 0)
+                    goto error;
+            }
+            slots[op->slot] = copy;
+            for (Py_ssize_t i = 0; i < size; i++) {
+                PyObject* item = plan_run(plan, pc, slots, memo);
+                if (!item)
+                    goto error;
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+                if (memo) {
+                    PyList_SetItem(copy, i, item);
+                    continue;
+                }
+#endif
+                PyList_SET_ITEM(copy, i, item);
+            }
+            return copy;
+
+        case PLAN_DICT:
+            copy = _PyDict_NewPresized(size);
+            if (!copy)
+                return NULL;
+            if (memo && memoize(memo, original, copy, memo_key_hash) < 0)
+                goto error;
+            slots[op->slot] = copy;
+            for (Py_ssize_t i = 0; i < size; i++) {
+                PyObject* key = plan_run(plan, pc, slots, memo);
+                if (!key)
+                    goto error;
+                PyObject* value = plan_run(plan, pc, slots, memo);
+                if (!value) {
+                    Py_DECREF(key);
+                    goto error;
+                }
+                if (COPIUM_PyDict_SetItem_Take2((PyDictObject*)copy, key, value) < 0)
+                    goto error;
+            }
+            return copy;
+
+        case PLAN_SET:
+            copy = PySet_New(NULL);
+            if (!copy)
+                return NULL;
+            if (memo && memoize(memo, original, copy, memo_key_hash) < 0)
+                goto error;
+            slots[op->slot] = copy;
+            for (Py_ssize_t i = 0; i < size; i++) {
+                PyObject* item = plan_run(plan, pc, slots, memo);
+                if (!item)
+                    goto error;
+                int rc = PySet_Add(copy, item);
+                Py_DECREF(item);
+                if (rc < 0)
+                    goto error;
+            }
+            return copy;
+
+        case PLAN_TUPLE:
+        case PLAN_FROZENSET: {
+            PyObject* items = PyTuple_New(size);
+            if (!items)
+                return NULL;
+            for (Py_ssize_t i = 0; i < size; i++) {
+                PyObject* item = plan_run(plan, pc, slots, memo);
+                if (!item) {
+                    Py_DECREF(items);
+                    return NULL;
+                }
+                PyTuple_SET_ITEM(items, i, item);
+            }
+            if (op->kind == PLAN_FROZENSET) {
+                copy = PyFrozenSet_New(items);
+                Py_DECREF(items);
+                if (!copy)
+                    return NULL;
+            } else {
+                copy = items;
+                if (memo) {
+                    // Same checks copy_frame_finish() makes for a tuple once its items are copied.
+                    int all_same = 1;
+                    for (Py_ssize_t i = 0; i < size; i++) {
+                        if (PyTuple_GET_ITEM(copy, i) != PyTuple_GET_ITEM(original, i)) {
+                            all_same = 0;
+                            break;
+                        }
+                    }
+                    if (all_same) {
+                        Py_DECREF(copy);
+                        return Py_NewRef(original);
+                    }
+                    PyObject* existing = memo_table_lookup_h(memo->table, original, memo_key_hash);
+                    if (existing) {
+                        Py_DECREF(copy);
+                        slots[op->slot] = existing;
+                        return Py_NewRef(existing);
+                    }
+                }
+            }
+            if (memo && memoize(memo, original, copy, memo_key_hash) < 0) {
+                Py_DECREF(copy);
+                return NULL;
+            }
+            slots[op->slot] = copy;
+            return copy;
+        }
+
+        case PLAN_BYTEARRAY:
+            copy = PyByteArray_FromStringAndSize(
+                PyByteArray_AS_STRING(original), PyByteArray_GET_SIZE(original)
+            );
+            if (!copy)
+                return NULL;
+            if (memo && memoize(memo, original, copy, memo_key_hash) < 0) {
+                Py_DECREF(copy);
+                return NULL;
+            }
+            slots[op->slot] = copy;
+            return copy;
+
+        default:
+            Py_UNREACHABLE();
+    }
+
+error:
+    if (memo)
+        forget(memo, original, memo_key_hash);
+    Py_DECREF(copy);
+    return NULL;
+}
+
+/* ----------------------------- Batch runner ------------------------------- */
+
+/*
+ * Memo-less plans build all n copies in one pass over the instructions: every
+ * op produces a block of n results. A node at depth d gets its children's
+ * blocks from the scratch region of depth d + 1, which holds 2n entries so a
+ * dict's key and value blocks fit side by side. Slot blocks keep the n copies
+ * of every op something refers back to.
+ */
+typedef struct {
+    Py_ssize_t n;
+    PyObject** scratch;  // (depth + 1) * 2n entries
+    PyObject** slots;    // n_slots * n entries, plus a sink block right before slots
+} PlanBatch;
+
+static ALWAYS_INLINE void incref_n(PyObject* obj, Py_ssize_t n) {
+#ifdef Py_GIL_DISABLED
+    for (Py_ssize_t i = 0; i < n; i++)
+        Py_INCREF(obj);
+#else
+    // No-op for immortal objects on 3.12+.
+    Py_SET_REFCNT(obj, Py_REFCNT(obj) + n);
+#endif
+}
+
+static void clear_block(PyObject** block, Py_ssize_t n) {
+    for (Py_ssize_t j = 0; j < n; j++)
+        Py_CLEAR(block[j]);
+}
+
+/* Builds n copies of the node starting at ops[*pc] into out; on failure, out is left empty. */
+static int plan_run_batch(
+    PlanObject* plan, Py_ssize_t* pc, PlanBatch* batch, Py_ssize_t depth, PyObject** out
+) {
+    PlanOp* op = &plan->ops[(*pc)++];
+    PyObject* original = op->obj;
+    Py_ssize_t n = batch->n;
+    Py_ssize_t size = op->size;
+    PyObject** bound = batch->slots + op->slot * n;
+    PyObject** items = batch->scratch + (depth + 1) * 2 * n;
+
+    switch (op->kind) {
+        case PLAN_LEAF:
+            incref_n(original, n);
+            for (Py_ssize_t j = 0; j < n; j++)
+                out[j] = original;
+            return 0;
+
+        case PLAN_REF:
+            for (Py_ssize_t j = 0; j < n; j++)
+                out[j] = Py_NewRef(bound[j]);
+            return 0;
+
+        case PLAN_LIST:
+            for (Py_ssize_t j = 0; j < n; j++) {
+                if (!(out[j] = PyList_New(size)))
+                    goto error;
+            }
+            memcpy(bound, out, (size_t)n * sizeof(PyObject*));
+            for (Py_ssize_t i = 0; i < size; i++) {
+                if (plan_run_batch(plan, pc, batch, depth + 1, items) < 0)
+                    goto error;
+                for (Py_ssize_t j = 0; j < n; j++)
+                    PyList_SET_ITEM(out[j], i, items[j]);
+            }
+            return 0;
+
+        case PLAN_DICT:
+            for (Py_ssize_t j = 0; j < n; j++) {
+                if (!(out[j] = _PyDict_NewPresized(size)))
+                    goto error;
+            }
+            memcpy(bound, out, (size_t)n * sizeof(PyObject*));
+            for (Py_ssize_t i = 0; i < size; i++) {
+                if (plan_run_batch(plan, pc, batch, depth + 1, items) < 0)
+                    goto error;
+                if (plan_run_batch(plan, pc, batch, depth + 1, items + n) < 0) {
+                    clear_block(items, n);
+                    goto error;
+                }
+                for (Py_ssize_t j = 0; j < n; j++) {
+                    PyObject* key = items[j];
+                    PyObject* value = items[n + j];
+                    items[j] = items[n + j] = NULL;
+                    if (COPIUM_PyDict_SetItem_Take2((PyDictObject*)out[j], key, value) < 0) {
+                        clear_block(items, 2 * n);
+                        goto error;
+                    }
+                }
+            }
+            return 0;
+
+        case PLAN_SET:
+            for (Py_ssize_t j = 0; j < n; j++) {
+                if (!(out[j] = PySet_New(NULL)))
+                    goto error;
+            }
+            memcpy(bound, out, (size_t)n * sizeof(PyObject*));
+            for (Py_ssize_t i = 0; i < size; i++) {
+                if (plan_run_batch(plan, pc, batch, depth + 1, items) < 0)
+                    goto error;
+                int rc = 0;
+                for (Py_ssize_t j = 0; j < n; j++) {
+                    if (rc == 0)
+                        rc = PySet_Add(out[j], items[j]);
+                    Py_CLEAR(items[j]);
+                }
+                if (rc < 0)
+                    goto error;
+            }
+            return 0;
+
+        case PLAN_TUPLE:
+        case PLAN_FROZENSET:
+            for (Py_ssize_t j = 0; j < n; j++) {
+                if (!(out[j] = PyTuple_New(size)))
+                    goto error;
+            }
+            for (Py_ssize_t i = 0; i < size; i++) {
+                if (plan_run_batch(plan, pc, batch, depth + 1, items) < 0)
+                    goto error;
+                for (Py_ssize_t j = 0; j < n; j++)
+                    PyTuple_SET_ITEM(out[j], i, items[j]);
+            }
+            if (op->kind == PLAN_FROZENSET) {
+                for (Py_ssize_t j = 0; j < n; j++) {
+                    PyObject* frozen = PyFrozenSet_New(out[j]);
+                    Py_SETREF(out[j], frozen);
+                    if (!frozen)
+                        goto error;
+                }
+            }
+            // Memo-less plans have no back-edges into unfinished tuples.
+            memcpy(bound, out, (size_t)n * sizeof(PyObject*));
+            return 0;
+
+        case PLAN_BYTEARRAY:
+            for (Py_ssize_t j = 0; j < n; j++) {
+                out[j] = PyByteArray_FromStringAndSize(
+                    PyByteArray_AS_STRING(original), PyByteArray_GET_SIZE(original)
+                );
+                if (!out[j])
+                    goto error;
+            }
+            memcpy(bound, out, (size_t)n * sizeof(PyObject*));
+            return 0;
+
+        default:
+            Py_UNREACHABLE();
+    }
+
+error:
+    clear_block(out, n);
+    return -1;
+}
+
+/* Builds n copies of a memo-less plan straight into the items of list out. */
+static int plan_replicate_batch(PlanObject* plan, PyObject* out, Py_ssize_t n) {
+    size_t scratch_size = (size_t)(plan->depth + 1) * 2 * (size_t)n;
+    size_t slots_size = (size_t)(plan->n_slots + 1) * (size_t)n;
+    PyObject** buffer = PyMem_Calloc(scratch_size + slots_size, sizeof(PyObject*));
+    if (!buffer) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    PlanBatch batch = {.n = n, .scratch = buffer, .slots = buffer + scratch_size + n};
+
+    Py_ssize_t pc = 0;
+    int rc = plan_run_batch(plan, &pc, &batch, 0, ((PyListObject*)out)->ob_item);
+    PyMem_Free(buffer);
+    return rc;
+}
+
+/* Runs the plan n times into a new list. */
+static PyObject* plan_replicate(PlanObject* plan, Py_ssize_t n) {
+    PyObject* out = PyList_New(n);
+    if (!out)
+        return NULL;
+    if (n == 0)
+        return out;
+
+    if (!plan->uses_memo && n > 1) {
+        if (plan_replicate_batch(plan, out, n) < 0) {
+            Py_DECREF(out);
+            return NULL;
+        }
+        return out;
+    }
+
+    PyObject** sink = PyMem_Calloc((size_t)plan->n_slots + 1, sizeof(PyObject*));
+    if (!sink) {
+        Py_DECREF(out);
+        return PyErr_NoMemory();
+    }
+    PyObject** slots = sink + 1;
+
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (i)
+            memset(slots, 0, (size_t)plan->n_slots * sizeof(PyObject*));
+
+        Py_ssize_t pc = 0;
+        PyObject* copy_i;
+        if (plan->uses_memo) {
+            int is_tss;
+            PyMemoObject* memo = get_memo(&is_tss);
+            if (!memo)
+                goto error;
+            copy_i = plan_run(plan, &pc, slots, memo);
+            cleanup_memo(memo, is_tss);
+        } else {
+            copy_i = plan_run(plan, &pc, slots, NULL);
+        }
+        if (!copy_i)
+            goto error;
+        PyList_SET_ITEM(out, i, copy_i);
+    }
+    PyMem_Free(sink);
+    return out;
+
+error:
+    PyMem_Free(sink);
+    Py_DECREF(out);
+    return NULL;
+}
+
+/* ------------------------------ Plan type --------------------------------- */
+
+static int Plan_traverse(PlanObject* self, visitproc visit, void* arg) {
+    Py_VISIT(Py_TYPE(self));
+    for (Py_ssize_t i = 0; i < self->n_ops; i++)
+        Py_VISIT(self->ops[i].obj);
+    return 0;
+}
+
+static int Plan_clear(PlanObject* self) {
+    PlanOp* ops = self->ops;
+    Py_ssize_t n_ops = self->n_ops;
+    self->ops = NULL;
+    self->n_ops = 0;
+    for (Py_ssize_t i = 0; i < n_ops; i++)
+        Py_DECREF(ops[i].obj);
+    PyMem_Free(ops);
+    return 0;
+}
+
+static void Plan_dealloc(PlanObject* self) {
+    PyTypeObject* tp = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    Plan_clear(self);
+    tp->tp_free((PyObject*)self);
+    Py_DECREF(tp);
+}
+
+static PyObject* Plan_repr(PlanObject* self) {
+    return PyUnicode_FromFormat(
+        "<copium.extra.Plan of %zd instructions%s>",
+        self->n_ops,
+        self->uses_memo ? ", with memo" : ""
+    );
+}
+
+static PyType_Slot Plan_slots[] = {
+    {Py_tp_doc, (void*)PyDoc_STR("Copy plan produced by copium.extra.compile().")},
+    {Py_tp_dealloc, Plan_dealloc},
+    {Py_tp_repr, Plan_repr},
+    {Py_tp_traverse, Plan_traverse},
+    {Py_tp_clear, Plan_clear},
+    {0, NULL},
+};
+
+static PyType_Spec Plan_spec = {
+    .name = "copium.extra.Plan",
+    .basicsize = sizeof(PlanObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE |
+        Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = Plan_slots,
+};
+
+// Called with the state of module entered.
+static int plan_make_type(PyObject* module) {
+    module_state.Plan_Type = (PyTypeObject*)PyType_FromModuleAndSpec(module, &Plan_spec, NULL);
+    return module_state.Plan_Type ? 0 : -1;
+}
+
+#endif  // _COPIUM_PLAN_C
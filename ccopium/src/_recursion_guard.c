@@ -25,13 +25,6 @@
     #define COPIUM_STACK_SAFETY_MARGIN (256u * 1024u)  // 256 KiB
 #endif
 
-/* ------------------------- Thread-local storage ----------------------------- */
-#ifdef _MSC_VER
-    #define COPIUM_THREAD_LOCAL __declspec(thread)
-#else
-    #define COPIUM_THREAD_LOCAL _Thread_local
-#endif
-
 /* ------------------------- Stack overflow protection ------------------------ */
 static COPIUM_THREAD_LOCAL unsigned int _copium_tls_depth = 0;
 static COPIUM_THREAD_LOCAL char* _copium_stack_low = NULL;
@@ -0,0 +1,232 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Copies on demand (copium.extra.ireplicate).
+ *
+ * ireplicate(obj, n) is replicate(obj, n) as an iterator: each step makes one deep copy, so only
+ * the copies the consumer still holds are alive at a time. Given a plan from compile(), each step
+ * runs the plan instead. A template isn't compiled on its own the way replicate() does it: the
+ * consumer runs between steps and may change obj, which a plan wouldn't see.
+ *
+ * The iterator keeps a memo and the plan's slots of its own across steps. The memo is reset the
+ * way cleanup_memo() resets the thread's one after a call, so a step doesn't go through the
+ * thread's memo at all; if Python code kept it, the next step starts a new one. A step nested in
+ * another one (a __deepcopy__ that advances the iterator) or running beside it on another thread
+ * finds them taken and copies with get_memo() and slots of its own instead.
+ */
+#ifndef _COPIUM_REPLICATOR_C
+#define _COPIUM_REPLICATOR_C
+
+#include "_common.h"
+#include "_state.c"
+#include "_type_checks.c"
+#include "_memo.c"
+#include "_deepcopy.c"
+#include "_plan.c"
+
+typedef struct {
+    PyObject_HEAD PyObject* obj;  // the template, or the plan to run
+    Py_ssize_t remaining;         // copies left to make, -1 for no end
+    PyMemoObject* memo;           // kept between steps, NULL until one needs it
+    PyObject** slots;             // the plan's slots, past the sink at slots[-1]
+    int busy;                     // a step is using memo and slots
+} ReplicatorObject;
+
+static ALWAYS_INLINE PlanObject* replicator_plan(ReplicatorObject* self) {
+    return Py_IS_TYPE(self->obj, module_state.Plan_Type) ? (PlanObject*)self->obj : NULL;
+}
+
+// Takes one copy off the count, and memo and slots if no step has them. Returns 0 once there are
+// no copies left, 1 with memo and slots taken, 2 without.
+static ALWAYS_INLINE int replicator_take(ReplicatorObject* self) {
+    int taken = 0;
+    COPIUM_Py_BEGIN_CRITICAL_SECTION(self);
+    if (self->remaining != 0) {
+        if (self->remaining > 0)
+            self->remaining--;
+        taken = self->busy ? 2 : 1;
+        self->busy = 1;
+    }
+    COPIUM_Py_END_CRITICAL_SECTION();
+    return taken;
+}
+
+static ALWAYS_INLINE void replicator_put_back(ReplicatorObject* self) {
+    COPIUM_Py_BEGIN_CRITICAL_SECTION(self);
+    self->busy = 0;
+    COPIUM_Py_END_CRITICAL_SECTION();
+}
+
+// One copy of obj, or one run of the plan with slots. memo is NULL for a plan that needs none.
+static ALWAYS_INLINE PyObject* replicator_copy(
+    PyObject* obj, PlanObject* plan, PyObject** slots, PyMemoObject* memo
+) {
+    if (!plan)
+        return deepcopy(obj, memo);
+    Py_ssize_t pc = 0;
+    return plan_run(plan, &pc, slots, memo);
+}
+
+// A step with the iterator's memo and slots.
+static PyObject* replicator_step(ReplicatorObject* self) {
+    PlanObject* plan = replicator_plan(self);
+    if (plan) {
+        if (!self->slots) {
+            PyObject** sink = PyMem_Calloc((size_t)plan->n_slots + 1, sizeof(PyObject*));
+            if (!sink)
+                return PyErr_NoMemory();
+            self->slots = sink + 1;
+        } else {
+            memset(self->slots, 0, (size_t)plan->n_slots * sizeof(PyObject*));
+        }
+        if (!plan->uses_memo)
+            return replicator_copy(self->obj, plan, self->slots, NULL);
+    }
+
+    PyMemoObject* memo = self->memo;
+    if (!memo) {
+        memo = self->memo = Memo_New();
+        if (!memo)
+            return NULL;
+    }
+    memo->defer_unique = 1;
+    memo->lazy_keepalive = COPIUM_LAZY_KEEPALIVE;
+    PyObject* copy = replicator_copy(self->obj, plan, self->slots, memo);
+    if (LIKELY(Py_REFCNT(memo) == 1)) {
+        memo_retain(memo);
+    } else {
+        self->memo = NULL;
+        PyObject_GC_Track(memo);  // this is required to break possible cycles
+        Py_DECREF(memo);
+    }
+    return copy;
+}
+
+// A step while another one has the iterator's memo and slots.
+static PyObject* replicator_step_aside(ReplicatorObject* self) {
+    PlanObject* plan = replicator_plan(self);
+    PyObject** sink = NULL;
+    if (plan) {
+        sink = PyMem_Calloc((size_t)plan->n_slots + 1, sizeof(PyObject*));
+        if (!sink)
+            return PyErr_NoMemory();
+    }
+    PyObject* copy;
+    if (plan && !plan->uses_memo) {
+        copy = replicator_copy(self->obj, plan, sink + 1, NULL);
+    } else {
+        int is_tss;
+        PyMemoObject* memo = get_memo(&is_tss);
+        copy = memo ? replicator_copy(self->obj, plan, sink ? sink + 1 : NULL, memo) : NULL;
+        if (memo)
+            cleanup_memo(memo, is_tss);
+    }
+    PyMem_Free(sink);
+    return copy;
+}
+
+static PyObject* Replicator_next_impl(ReplicatorObject* self) {
+    int taken = replicator_take(self);
+    if (!taken)
+        return NULL;
+    if (taken == 2)
+        return replicator_step_aside(self);
+    PyObject* copy = is_atomic_immutable(Py_TYPE(self->obj)) ? Py_NewRef(self->obj)
+                                                              : replicator_step(self);
+    replicator_put_back(self);
+    return copy;
+}
+
+static PyObject* Replicator_next(ReplicatorObject* self) {
+    ModuleState* outer = copium_enter((ModuleState*)PyType_GetModuleState(Py_TYPE(self)));
+    PyObject* copy = Replicator_next_impl(self);
+    copium_leave(outer);
+    return copy;
+}
+
+static PyObject* Replicator_length_hint(ReplicatorObject* self, PyObject* noargs) {
+    (void)noargs;
+    Py_ssize_t remaining;
+    COPIUM_Py_BEGIN_CRITICAL_SECTION(self);
+    remaining = self->remaining;
+    COPIUM_Py_END_CRITICAL_SECTION();
+    if (remaining < 0)
+        Py_RETURN_NOTIMPLEMENTED;
+    return PyLong_FromSsize_t(remaining);
+}
+
+static int Replicator_traverse(ReplicatorObject* self, visitproc visit, void* arg) {
+    Py_VISIT(Py_TYPE(self));
+    Py_VISIT(self->obj);
+    return 0;
+}
+
+static int Replicator_clear(ReplicatorObject* self) {
+    Py_CLEAR(self->obj);
+    return 0;
+}
+
+static void Replicator_dealloc(ReplicatorObject* self) {
+    PyTypeObject* tp = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    Replicator_clear(self);
+    Py_XDECREF(self->memo);
+    if (self->slots)
+        PyMem_Free(self->slots - 1);
+    tp->tp_free((PyObject*)self);
+    Py_DECREF(tp);
+}
+
+static PyMethodDef Replicator_methods[] = {
+    {"__length_hint__",
+     (PyCFunction)Replicator_length_hint,
+     METH_NOARGS,
+     PyDoc_STR("Private method returning an estimate of len(list(it)).")},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyType_Slot Replicator_slots[] = {
+    {Py_tp_doc, (void*)PyDoc_STR("Iterator over deep copies made by copium.extra.ireplicate().")},
+    {Py_tp_dealloc, Replicator_dealloc},
+    {Py_tp_traverse, Replicator_traverse},
+    {Py_tp_clear, Replicator_clear},
+    {Py_tp_iter, PyObject_SelfIter},
+    {Py_tp_iternext, Replicator_next},
+    {Py_tp_methods, Replicator_methods},
+    {0, NULL},
+};
+
+static PyType_Spec Replicator_spec = {
+    .name = "copium.extra.Replicator",
+    .basicsize = sizeof(ReplicatorObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE |
+        Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = Replicator_slots,
+};
+
+// Returns an iterator over n copies of obj, or over copies without end if n is -1.
+static PyObject* replicator_new(PyObject* obj, Py_ssize_t n) {
+    ReplicatorObject* self = PyObject_GC_New(ReplicatorObject, module_state.Replicator_Type);
+    if (!self)
+        return NULL;
+    self->obj = Py_NewRef(obj);
+    self->remaining = n;
+    self->memo = NULL;
+    self->slots = NULL;
+    self->busy = 0;
+    PyObject_GC_Track(self);
+    return (PyObject*)self;
+}
+
+// Called with the state of module entered.
+static int replicator_make_type(PyObject* module) {
+    module_state.Replicator_Type =
+        (PyTypeObject*)PyType_FromModuleAndSpec(module, &Replicator_spec, NULL);
+    return module_state.Replicator_Type ? 0 : -1;
+}
+
+#endif  // _COPIUM_REPLICATOR_C
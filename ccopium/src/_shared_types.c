@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Types shared rather than copied: configure(atomic_types=...) for every call, and
+ * deepcopy(x, share=...) for one. Only exact types count, like registrations (see _capi.c).
+ *
+ * The configured ones are consulted by classify_route(), so once a type is classified they
+ * cost what any other atomic type does; changing them drops the routes cached for the types
+ * that came or went. The ones of a call are checked ahead of the route of every object copied
+ * while it runs on that thread, nested calls included. That is a thread-local load when there
+ * are none, and a scan of a few pointers when there are.
+ */
+#ifndef _COPIUM_SHARED_TYPES_C
+#define _COPIUM_SHARED_TYPES_C
+
+#include "_common.h"
+#include "_state.c"
+
+// Borrowed from the deepcopy() call that passed share=, NULL outside of one.
+static COPIUM_THREAD_LOCAL PyObject* _call_shared_types = NULL;
+
+static ALWAYS_INLINE int shared_types_contain(PyObject* types, PyTypeObject* tp) {
+    PyObject** items = ((PyTupleObject*)types)->ob_item;
+    for (Py_ssize_t i = 0, n = PyTuple_GET_SIZE(types); i < n; i++) {
+        if (items[i] == (PyObject*)tp)
+            return 1;
+    }
+    return 0;
+}
+
+// Cold: only asked by classify_route().
+static int is_configured_atomic(PyTypeObject* tp) {
+    PyObject* types = module_state.atomic_types;
+    return types && shared_types_contain(types, tp);
+}
+
+static ALWAYS_INLINE int is_shared_by_call(PyTypeObject* tp) {
+    PyObject* types = _call_shared_types;
+    return UNLIKELY(types != NULL) && shared_types_contain(types, tp);
+}
+
+/*
+ * The types of a type or an iterable of them, as a new tuple, or NULL with an exception set.
+ * The containers deepcopy traverses itself never get to a route to be shared on.
+ */
+static PyObject* shared_types_from(PyObject* value, const char* param) {
+    PyObject* types = PyType_Check(value) ? PyTuple_Pack(1, value) : PySequence_Tuple(value);
+    if (!types) {
+        if (PyErr_ExceptionMatches(PyExc_TypeError)) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "%s must be a type or an iterable of types, got '%.200s'",
+                param,
+                Py_TYPE(value)->tp_name
+            );
+        }
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(types); i++) {
+        PyObject* item = PyTuple_GET_ITEM(types, i);
+        if (!PyType_Check(item)) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "%s[%zd] must be a type, got '%.200s'",
+                param,
+                i,
+                Py_TYPE(item)->tp_name
+            );
+            Py_DECREF(types);
+            return NULL;
+        }
+        PyTypeObject* tp = (PyTypeObject*)item;
+        if (tp == &PyTuple_Type || tp == &PyList_Type || tp == &PyDict_Type ||
+            tp == &PySet_Type || tp == &PyFrozenSet_Type) {
+            PyErr_Format(
+                PyExc_TypeError, "copium copies '%.200s' objects itself", tp->tp_name
+            );
+            Py_DECREF(types);
+            return NULL;
+        }
+    }
+    return types;
+}
+
+static void shared_types_invalidate(PyObject* types) {
+    for (Py_ssize_t i = 0; types && i < PyTuple_GET_SIZE(types); i++) {
+        PyTypeObject* tp = (PyTypeObject*)PyTuple_GET_ITEM(types, i);
+        PyType_Modified(tp);
+        // A type without a version tag is never cached: assign it a new one right away.
+        (void)_PyType_Lookup(tp, module_state.s__deepcopy__);
+    }
+}
+
+// Steals types, a tuple from shared_types_from() or NULL for none.
+static void set_atomic_types(PyObject* types) {
+    if (types && PyTuple_GET_SIZE(types) == 0)
+        Py_CLEAR(types);
+    PyObject* old = module_state.atomic_types;
+    module_state.atomic_types = types;
+    shared_types_invalidate(old);
+    shared_types_invalidate(types);
+    Py_XDECREF(old);
+}
+
+#endif  // _COPIUM_SHARED_TYPES_C
@@ -0,0 +1,207 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Slow-copy sampler, set up with configure(slow_copy_callback=...)
+ *
+ * Times the top-level deepcopy() calls, whatever memo they copy with; one made while another
+ * call on the thread is timed is part of that call. One that took at least slow_copy_threshold_us,
+ * or every slow_copy_sample-th one on a thread, is reported by calling the callback with a dict
+ * of:
+ *
+ *   callsite    (filename, lineno, function, line) of the calling frame, or None
+ *   elapsed_us  how long the call took
+ *   python_us   ... of which in the reduce and __deepcopy__ routes, along with whatever those
+ *               copied underneath
+ *   native_us   ... and the rest
+ *   nodes       objects copied rather than returned as is
+ *   memo_size   entries the memo got to hold
+ *
+ * nodes and memo_size are 0 for a memo that's neither copium's own nor a dict: counting its
+ * entries would call into Python.
+ *   sampled     whether the call was one of the sampled ones
+ *
+ * A call reads the clock on either end, and so does every reduce or __deepcopy__ route it
+ * takes, which calls into Python anyway. Nothing is counted per native node: every copy ends
+ * up in the memo, which already knows how many it holds.
+ */
+#ifndef _COPIUM_SLOW_COPY_C
+#define _COPIUM_SLOW_COPY_C
+
+#include "_common.h"
+#include "_state.c"
+#include "_memo.c"
+#include "_fallback.c"
+
+typedef struct SlowCopySample {
+    int64_t start;
+    int64_t elapsed;
+    int64_t python_start;  // of the outermost route in progress
+    int64_t python;
+    int python_depth;
+    int active;
+    int sampled;
+    Py_ssize_t nodes;
+    Py_ssize_t memo_size;
+} SlowCopySample;
+
+// The call being timed on this thread, which the routes it takes report to.
+static COPIUM_THREAD_LOCAL SlowCopySample* _slow_copy_current = NULL;
+// Set while the callback runs, so that copies it makes aren't timed themselves.
+static COPIUM_THREAD_LOCAL int _slow_copy_reporting = 0;
+static COPIUM_THREAD_LOCAL Py_ssize_t _slow_copy_calls = 0;
+
+static ALWAYS_INLINE int64_t slow_copy_now(void) {
+#if PY_VERSION_HEX >= PY_VERSION_3_13_HEX
+    PyTime_t now;
+    (void)PyTime_MonotonicRaw(&now);
+    return (int64_t)now;
+#else
+    return (int64_t)_PyTime_GetMonotonicClock();
+#endif
+}
+
+// Copies memo holds, and the entries it holds them with, as far as that's known without
+// calling into Python. A dict memo's keep-alive list isn't a copy.
+static void slow_copy_count(PyObject* memo, Py_ssize_t* nodes, Py_ssize_t* memo_size) {
+    *nodes = *memo_size = 0;
+    if (Py_TYPE(memo) == module_state.Memo_Type) {
+        PyMemoObject* native = (PyMemoObject*)memo;
+        *memo_size = native->table ? native->table->used : 0;
+        *nodes = *memo_size + native->deferred.size / 2;
+    } else if (PyDict_CheckExact(memo)) {
+        *memo_size = PyDict_GET_SIZE(memo);
+        PyObject* key = PyLong_FromVoidPtr(memo);
+        int keeps = key ? PyDict_Contains(memo, key) : -1;
+        Py_XDECREF(key);
+        if (keeps < 0)
+            PyErr_Clear();
+        *nodes = *memo_size - (keeps > 0);
+    }
+}
+
+static void slow_copy_start(SlowCopySample* sample, PyObject* memo) {
+    sample->active = !_slow_copy_reporting && !_slow_copy_current;
+    if (!sample->active)
+        return;
+    sample->sampled = 0;
+    Py_ssize_t every = module_state.slow_copy_sample;
+    if (every > 0 && ++_slow_copy_calls >= every) {
+        _slow_copy_calls = 0;
+        sample->sampled = 1;
+    }
+    sample->python = 0;
+    sample->python_depth = 0;
+    // What the memo held before the call isn't the call's.
+    slow_copy_count(memo, &sample->nodes, &sample->memo_size);
+    _slow_copy_current = sample;
+    sample->start = slow_copy_now();
+}
+
+// Right after the copy, while the memo still holds what it made.
+static void slow_copy_stop(SlowCopySample* sample, PyObject* memo) {
+    if (!sample->active)
+        return;
+    sample->elapsed = slow_copy_now() - sample->start;
+    _slow_copy_current = NULL;
+    Py_ssize_t nodes_before = sample->nodes;
+    slow_copy_count(memo, &sample->nodes, &sample->memo_size);
+    sample->nodes -= nodes_before;
+}
+
+static ALWAYS_INLINE void slow_copy_route_enter(SlowCopySample* sample) {
+    if (sample->python_depth++ == 0)
+        sample->python_start = slow_copy_now();
+}
+
+static ALWAYS_INLINE void slow_copy_route_leave(SlowCopySample* sample) {
+    if (--sample->python_depth == 0)
+        sample->python += slow_copy_now() - sample->python_start;
+}
+
+// Times expr, a reduce or __deepcopy__ route taken by the call being timed, if any.
+#define SLOW_COPY_ROUTE(expr)                              \
+    (__extension__({                                       \
+        PyObject* _ret;                                    \
+        SlowCopySample* _sample = _slow_copy_current;      \
+        if (LIKELY(!_sample)) {                            \
+            _ret = (expr);                                 \
+        } else {                                           \
+            slow_copy_route_enter(_sample);                \
+            _ret = (expr);                                 \
+            slow_copy_route_leave(_sample);                \
+        }                                                  \
+        _ret;                                              \
+    }))
+
+static int slow_copy_set_us(PyObject* report, const char* key, int64_t ns) {
+    PyObject* value = PyFloat_FromDouble((double)ns / 1000.0);
+    if (!value)
+        return -1;
+    int status = PyDict_SetItemString(report, key, value);
+    Py_DECREF(value);
+    return status;
+}
+
+static int slow_copy_set_size(PyObject* report, const char* key, Py_ssize_t n) {
+    PyObject* value = PyLong_FromSsize_t(n);
+    if (!value)
+        return -1;
+    int status = PyDict_SetItemString(report, key, value);
+    Py_DECREF(value);
+    return status;
+}
+
+static PyObject* slow_copy_make_report(const SlowCopySample* sample) {
+    PyObject* report = PyDict_New();
+    if (!report)
+        return NULL;
+    PyObject* callsite = _get_caller_frame_info();
+    if (!callsite) {
+        PyErr_Clear();
+        callsite = Py_NewRef(Py_None);
+    }
+    int status = PyDict_SetItemString(report, "callsite", callsite);
+    Py_DECREF(callsite);
+    if (status < 0 || slow_copy_set_us(report, "elapsed_us", sample->elapsed) < 0 ||
+        slow_copy_set_us(report, "python_us", sample->python) < 0 ||
+        slow_copy_set_us(report, "native_us", sample->elapsed - sample->python) < 0 ||
+        slow_copy_set_size(report, "nodes", sample->nodes) < 0 ||
+        slow_copy_set_size(report, "memo_size", sample->memo_size) < 0 ||
+        PyDict_SetItemString(report, "sampled", sample->sampled ? Py_True : Py_False) < 0) {
+        Py_DECREF(report);
+        return NULL;
+    }
+    return report;
+}
+
+// Calls the callback if the call is due to be reported. Its failures are unraisable: the copy
+// itself went fine.
+static void slow_copy_finish(const SlowCopySample* sample) {
+    if (!sample->active)
+        return;
+    int64_t threshold = module_state.slow_copy_threshold_ns;
+    int slow = threshold >= 0 && sample->elapsed >= threshold;
+    if (!slow && !sample->sampled)
+        return;
+    PyObject* callback = module_state.slow_copy_callback;
+    if (!callback)
+        return;
+    Py_INCREF(callback);
+
+    _slow_copy_reporting = 1;
+    PyObject* report = slow_copy_make_report(sample);
+    PyObject* result = report ? PyObject_CallOneArg(callback, report) : NULL;
+    _slow_copy_reporting = 0;
+
+    if (!result)
+        PyErr_WriteUnraisable(callback);
+    Py_XDECREF(result);
+    Py_XDECREF(report);
+    Py_DECREF(callback);
+}
+
+#endif  // _COPIUM_SLOW_COPY_C
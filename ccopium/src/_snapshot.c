@@ -0,0 +1,538 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * Incremental snapshots (copium.extra.Snapshotter).
+ *
+ * A snapshotter keeps, for every dict of its root it has copied, a node with that copy. The
+ * dicts are watched (PyDict_Watch, 3.12+): any change marks the dict's node dirty, along with
+ * the nodes of every dict it was found in, up to the root. The next snapshot hands out the
+ * previous copy of a dict whose node is clean, as long as that copy holds nothing else than
+ * atomics and such dicts ("pure"), and copies everything else again. Its cost goes with the
+ * size of what changed and of what can't be watched, not with the size of the whole tree.
+ *
+ * Lists and tuples are walked again on every snapshot, so that the dicts inside them still get
+ * reused, and are never pure themselves: a dict holding one is copied anew every time. Any
+ * other object goes through deepcopy() with a memo shared by the whole snapshot, which also
+ * gets every copy the walk made, so references from such objects to dicts and lists copied
+ * by the walk keep pointing at the same copies. The dicts nested in a reused copy aren't in
+ * that memo, only the one at its top.
+ *
+ * Snapshots share what didn't change with each other, so they must not be mutated. Without
+ * dict watchers (before 3.12, and on free-threaded builds) every snapshot is a full deepcopy.
+ */
+#ifndef _COPIUM_SNAPSHOT_C
+#define _COPIUM_SNAPSHOT_C
+
+#include "_common.h"
+#include "_state.c"
+#include "_type_checks.c"
+#include "_dict_iter.c"
+#include "_memo.c"
+#include "_deepcopy.c"
+
+#if PY_VERSION_HEX >= PY_VERSION_3_12_HEX && !defined(Py_GIL_DISABLED)
+    #define COPIUM_SNAPSHOT_WATCH 1
+#else
+    #define COPIUM_SNAPSHOT_WATCH 0
+#endif
+
+typedef struct {
+    PyObject_HEAD PyObject* copy; /* the dict's copy in the latest snapshot that reached it */
+    /* dicts it was found in, only ever used as keys into the snapshotter's nodes */
+    void** parents;
+    Py_ssize_t n_parents;
+    Py_ssize_t parents_capacity;
+    uint64_t epoch;        /* latest snapshot that reached it */
+    unsigned char dirty;   /* the dict, or one in it, changed since copy was made */
+    unsigned char pure;    /* copy holds nothing but atomics and pure dicts */
+    unsigned char copying; /* copy is still being filled in */
+} SnapshotNode;
+
+typedef struct SnapshotterObject {
+    PyObject_HEAD PyObject* root;
+    MemoTable* nodes; /* original dict -> SnapshotNode */
+    uint64_t epoch;
+    int stale; /* a change couldn't be propagated: start over */
+    /* work list of snapshot_mark_dirty() */
+    void** marking;
+    Py_ssize_t marking_capacity;
+    struct SnapshotterObject* prev;
+    struct SnapshotterObject* next;
+} SnapshotterObject;
+
+/* ------------------------------ Nodes ------------------------------------ */
+
+static void SnapshotNode_dealloc(SnapshotNode* self) {
+    PyTypeObject* tp = Py_TYPE(self);
+    Py_XDECREF(self->copy);
+    PyMem_Free(self->parents);
+    tp->tp_free((PyObject*)self);
+    Py_DECREF(tp);
+}
+
+static PyType_Slot SnapshotNode_slots[] = {
+    {Py_tp_dealloc, SnapshotNode_dealloc},
+    {0, NULL},
+};
+
+static PyType_Spec SnapshotNode_spec = {
+    .name = "copium.extra._SnapshotNode",
+    .basicsize = sizeof(SnapshotNode),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_IMMUTABLETYPE | Py_TPFLAGS_DISALLOW_INSTANTIATION,
+    .slots = SnapshotNode_slots,
+};
+
+static int snapshot_node_add_parent(SnapshotNode* node, void* parent) {
+    for (Py_ssize_t i = 0; i < node->n_parents; i++) {
+        if (node->parents[i] == parent)
+            return 0;
+    }
+    if (node->n_parents == node->parents_capacity) {
+        Py_ssize_t capacity = node->parents_capacity ? node->parents_capacity * 2 : 2;
+        void** parents = PyMem_Realloc(node->parents, (size_t)capacity * sizeof(void*));
+        if (!parents) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        node->parents = parents;
+        node->parents_capacity = capacity;
+    }
+    node->parents[node->n_parents++] = parent;
+    return 0;
+}
+
+/* ------------------------------ Watching --------------------------------- */
+
+#if COPIUM_SNAPSHOT_WATCH
+// Watchers and the snapshotters they mark are per interpreter, see InterpState.
+
+// Marks dict's node and those of the dicts it is in dirty, stopping at nodes that already are.
+static void snapshot_mark_dirty(SnapshotterObject* self, PyObject* dict) {
+    Py_ssize_t n = 0;
+    void* current = dict;
+    for (;;) {
+        SnapshotNode* node = (SnapshotNode*)memo_table_lookup(self->nodes, current);
+        if (node && !node->dirty) {
+            node->dirty = 1;
+            if (n + node->n_parents > self->marking_capacity) {
+                Py_ssize_t capacity = (n + node->n_parents) * 2;
+                void** marking = PyMem_Realloc(self->marking, (size_t)capacity * sizeof(void*));
+                if (!marking) {
+                    self->stale = 1;
+                    return;
+                }
+                self->marking = marking;
+                self->marking_capacity = capacity;
+            }
+            memcpy(self->marking + n, node->parents, (size_t)node->n_parents * sizeof(void*));
+            n += node->n_parents;
+        }
+        if (n == 0)
+            return;
+        current = self->marking[--n];
+    }
+}
+
+static void snapshot_drop_node(SnapshotterObject* self, PyObject* dict) {
+    if (self->nodes)
+        memo_table_remove(self->nodes, dict);
+}
+
+static int snapshot_watcher_cb(
+    PyDict_WatchEvent event, PyObject* dict, PyObject* key, PyObject* new_value
+) {
+    (void)key;
+    (void)new_value;
+    InterpState* interp = copium_interp();
+    for (SnapshotterObject* s = interp ? interp->snapshotters : NULL; s; s = s->next) {
+        if (event == PyDict_EVENT_DEALLOCATED)
+            snapshot_drop_node(s, dict);
+        else
+            snapshot_mark_dirty(s, dict);
+    }
+    return 0;
+}
+
+static int snapshot_watch(PyObject* dict) {
+    InterpState* interp = copium_interp();
+    if (!interp) {
+        PyErr_SetString(PyExc_RuntimeError, "copium is not loaded in this interpreter");
+        return -1;
+    }
+    if (interp->snapshot_watcher_id < 0) {
+        interp->snapshot_watcher_id = PyDict_AddWatcher(snapshot_watcher_cb);
+        if (interp->snapshot_watcher_id < 0)
+            return -1;
+    }
+    return PyDict_Watch(interp->snapshot_watcher_id, dict);
+}
+
+// Stops watching the dicts no other snapshotter has a node for.
+static void snapshot_unwatch_all(SnapshotterObject* self) {
+    InterpState* interp = copium_interp();
+    if (!interp)
+        return;
+    MemoTable* nodes = self->nodes;
+    for (Py_ssize_t i = 0; nodes && i < nodes->size; i++) {
+        if (!MEMO_CTRL_IS_FULL(nodes->ctrl[i]))
+            continue;
+        void* dict = nodes->keys[i];
+        int shared = 0;
+        for (SnapshotterObject* s = interp->snapshotters; s && !shared; s = s->next)
+            shared = s != self && memo_table_lookup(s->nodes, dict) != NULL;
+        if (!shared)
+            PyDict_Unwatch(interp->snapshot_watcher_id, (PyObject*)dict);
+    }
+}
+#endif
+
+/* ------------------------------ Copying ---------------------------------- */
+
+static PyObject* snapshot_copy(
+    SnapshotterObject* self, PyObject* obj, void* parent, PyMemoObject* memo, int* pure
+);
+
+static PyObject* snapshot_copy_dict(
+    SnapshotterObject* self, PyObject* dict, void* parent, PyMemoObject* memo, int* pure
+) {
+    Py_ssize_t hash = hash_pointer(dict);
+    SnapshotNode* node = (SnapshotNode*)memo_table_lookup_h(self->nodes, dict, hash);
+    if (node && parent && snapshot_node_add_parent(node, parent) < 0)
+        return NULL;
+
+    if (node && node->epoch == self->epoch) {
+        // Reached before in this snapshot. One still being filled in can't vouch for what it
+        // will hold yet.
+        *pure = node->pure && !node->copying;
+        return Py_NewRef(node->copy);
+    }
+    // Copied already by deepcopy(), from within an object.
+    PyObject* memoized = remember(memo, dict, &hash);
+    if (memoized) {
+        *pure = 0;
+        return memoized;
+    }
+    if (node && node->pure && !node->dirty) {
+        if (memoize(memo, dict, node->copy, hash) < 0)
+            return NULL;
+        node->epoch = self->epoch;
+        *pure = 1;
+        return Py_NewRef(node->copy);
+    }
+
+    if (!node) {
+        node = PyObject_New(SnapshotNode, module_state.SnapshotNode_Type);
+        if (!node)
+            return NULL;
+        node->copy = NULL;
+        node->parents = NULL;
+        node->n_parents = 0;
+        node->parents_capacity = 0;
+        node->epoch = 0;
+        node->dirty = 1;
+        node->pure = 0;
+        node->copying = 0;
+        if ((parent && snapshot_node_add_parent(node, parent) < 0) ||
+            memo_table_insert_h(&self->nodes, dict, (PyObject*)node, hash) < 0) {
+            Py_DECREF(node);
+            return NULL;
+        }
+#if COPIUM_SNAPSHOT_WATCH
+        if (snapshot_watch(dict) < 0) {
+            memo_table_remove_h(self->nodes, dict, hash);
+            Py_DECREF(node);
+            return NULL;
+        }
+#endif
+    } else {
+        Py_INCREF(node);
+    }
+
+    // The node holds on to the copy from here, and Python code run below may drop the node.
+    PyObject* copy = PyDict_New();
+    if (!copy || memoize(memo, dict, copy, hash) < 0) {
+        Py_XDECREF(copy);
+        Py_DECREF(node);
+        return NULL;
+    }
+    Py_XSETREF(node->copy, Py_NewRef(copy));
+    node->epoch = self->epoch;
+    node->dirty = 0;
+    node->pure = 1;
+    node->copying = 1;
+
+    DictIterGuard iter;
+    if (dict_iter_init(&iter, dict) < 0)
+        goto error;
+    PyObject *key, *value;
+    int next;
+    while ((next = dict_iter_next(&iter, &key, &value)) > 0) {
+        PyObject* key_copy;
+        if (is_atomic_element(key)) {
+            key_copy = Py_NewRef(key);
+        } else {
+            node->pure = 0;
+            key_copy = deepcopy(key, memo);
+        }
+        int value_pure = 0;
+        PyObject* value_copy = key_copy ? snapshot_copy(self, value, dict, memo, &value_pure)
+                                        : NULL;
+        Py_DECREF(key);
+        Py_DECREF(value);
+        if (!value_pure)
+            node->pure = 0;
+        if (!value_copy || COPIUM_PyDict_SetItem_Take2((PyDictObject*)copy, key_copy, value_copy) < 0) {
+            Py_XDECREF(key_copy);
+#if PY_VERSION_HEX >= PY_VERSION_3_14_HEX
+            dict_iter_cleanup(&iter);
+#endif
+            goto error;
+        }
+    }
+    if (next < 0)
+        goto error;
+
+    node->copying = 0;
+    *pure = node->pure;
+    Py_DECREF(node);
+    return copy;
+
+error:
+    // Whatever made it into the copy can't be trusted next time around.
+    node->copying = 0;
+    node->dirty = 1;
+    Py_DECREF(node);
+    Py_DECREF(copy);
+    return NULL;
+}
+
+static PyObject* snapshot_copy(
+    SnapshotterObject* self, PyObject* obj, void* parent, PyMemoObject* memo, int* pure
+) {
+    PyTypeObject* type = Py_TYPE(obj);
+    if (is_atomic_immutable(type) || is_atomic_element(obj)) {
+        *pure = 1;
+        return Py_NewRef(obj);
+    }
+    if (type == &PyDict_Type) {
+        if (Py_EnterRecursiveCall(" while taking a snapshot"))
+            return NULL;
+        PyObject* copy = snapshot_copy_dict(self, obj, parent, memo, pure);
+        Py_LeaveRecursiveCall();
+        return copy;
+    }
+
+    *pure = 0;
+    Py_ssize_t hash;
+    PyObject* copy = remember(memo, obj, &hash);
+    if (copy || (type != &PyList_Type && type != &PyTuple_Type))
+        return copy ? copy : deepcopy(obj, memo);
+
+    if (Py_EnterRecursiveCall(" while taking a snapshot"))
+        return NULL;
+    int item_pure;
+    if (type == &PyList_Type) {
+        copy = PyList_New(0);
+        if (copy && memoize(memo, obj, copy, hash) < 0)
+            Py_CLEAR(copy);
+        for (Py_ssize_t i = 0; copy && i < PyList_GET_SIZE(obj); i++) {
+            PyObject* item = COPIUM_PyList_GET_ITEM_REF(obj, i);
+            PyObject* item_copy = item ? snapshot_copy(self, item, NULL, memo, &item_pure) : NULL;
+            Py_XDECREF(item);
+            if (!item_copy || PyList_Append(copy, item_copy) < 0)
+                Py_CLEAR(copy);
+            Py_XDECREF(item_copy);
+        }
+    } else {
+        Py_ssize_t size = PyTuple_GET_SIZE(obj);
+        copy = PyTuple_New(size);
+        for (Py_ssize_t i = 0; copy && i < size; i++) {
+            PyObject* item_copy = snapshot_copy(
+                self, PyTuple_GET_ITEM(obj, i), NULL, memo, &item_pure
+            );
+            if (!item_copy)
+                Py_CLEAR(copy);
+            else
+                PyTuple_SET_ITEM(copy, i, item_copy);
+        }
+        if (copy) {
+            // An item may have led back here and copied the tuple already.
+            PyObject* existing = memo_table_lookup_h(memo->table, obj, hash);
+            if (existing)
+                Py_SETREF(copy, Py_NewRef(existing));
+            else if (memoize(memo, obj, copy, hash) < 0)
+                Py_CLEAR(copy);
+        }
+    }
+    Py_LeaveRecursiveCall();
+    return copy;
+}
+
+/* ------------------------------ Snapshotter type ------------------------- */
+
+static PyObject* Snapshotter_new(PyTypeObject* type, PyObject* args, PyObject* kwargs) {
+    PyObject* root;
+    static char* kwlist[] = {"root", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O:Snapshotter", kwlist, &root))
+        return NULL;
+
+    SnapshotterObject* self = (SnapshotterObject*)type->tp_alloc(type, 0);
+    if (!self)
+        return NULL;
+    self->root = Py_NewRef(root);
+    self->nodes = NULL;
+    self->epoch = 0;
+    self->stale = 0;
+    self->marking = NULL;
+    self->marking_capacity = 0;
+    self->prev = NULL;
+    self->next = NULL;
+#if COPIUM_SNAPSHOT_WATCH
+    InterpState* interp = copium_interp();
+    if (interp) {
+        self->next = interp->snapshotters;
+        if (interp->snapshotters)
+            interp->snapshotters->prev = self;
+        interp->snapshotters = self;
+    }
+#endif
+    return (PyObject*)self;
+}
+
+static PyObject* Snapshotter_snapshot_impl(SnapshotterObject* self) {
+    int is_tss;
+    PyMemoObject* memo = get_memo(&is_tss);
+    if (!memo)
+        return NULL;
+#if COPIUM_SNAPSHOT_WATCH
+    if (self->stale) {
+        snapshot_unwatch_all(self);
+        memo_table_clear(self->nodes);
+        self->stale = 0;
+    }
+    self->epoch++;
+    int pure;
+    PyObject* copy = snapshot_copy(self, self->root, NULL, memo, &pure);
+#else
+    PyObject* copy = deepcopy(self->root, memo);
+#endif
+    cleanup_memo(memo, is_tss);
+    return copy;
+}
+
+static PyObject* Snapshotter_snapshot(SnapshotterObject* self, PyObject* noargs) {
+    (void)noargs;
+    ModuleState* outer = copium_enter((ModuleState*)PyType_GetModuleState(Py_TYPE(self)));
+    PyObject* copy = Snapshotter_snapshot_impl(self);
+    copium_leave(outer);
+    return copy;
+}
+
+static int Snapshotter_traverse(SnapshotterObject* self, visitproc visit, void* arg) {
+    Py_VISIT(Py_TYPE(self));
+    Py_VISIT(self->root);
+    // The nodes aren't tracked: what they hold is visited on their behalf.
+    MemoTable* nodes = self->nodes;
+    for (Py_ssize_t i = 0; nodes && i < nodes->size; i++) {
+        if (MEMO_CTRL_IS_FULL(nodes->ctrl[i]))
+            Py_VISIT(((SnapshotNode*)nodes->values[i])->copy);
+    }
+    return 0;
+}
+
+static int Snapshotter_clear(SnapshotterObject* self) {
+#if COPIUM_SNAPSHOT_WATCH
+    snapshot_unwatch_all(self);
+#endif
+    MemoTable* nodes = self->nodes;
+    self->nodes = NULL;
+    memo_table_free(nodes);
+    Py_CLEAR(self->root);
+    return 0;
+}
+
+static void Snapshotter_dealloc(SnapshotterObject* self) {
+    PyTypeObject* tp = Py_TYPE(self);
+    PyObject_GC_UnTrack(self);
+    Snapshotter_clear(self);
+#if COPIUM_SNAPSHOT_WATCH
+    InterpState* interp = copium_interp();
+    if (self->prev)
+        self->prev->next = self->next;
+    else if (interp && interp->snapshotters == self)
+        interp->snapshotters = self->next;
+    if (self->next)
+        self->next->prev = self->prev;
+#endif
+    PyMem_Free(self->marking);
+    tp->tp_free((PyObject*)self);
+    Py_DECREF(tp);
+}
+
+static PyObject* Snapshotter_get_root(SnapshotterObject* self, void* closure) {
+    (void)closure;
+    if (!self->root)
+        Py_RETURN_NONE;
+    return Py_NewRef(self->root);
+}
+
+static PyMethodDef Snapshotter_methods[] = {
+    {"snapshot",
+     (PyCFunction)Snapshotter_snapshot,
+     METH_NOARGS,
+     PyDoc_STR(
+         "snapshot(self, /)\n--\n\n"
+         "Deep copy root, reusing the copies of its dicts that didn't change since the previous\n"
+         "snapshot."
+     )},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef Snapshotter_getset[] = {
+    {"root", (getter)Snapshotter_get_root, NULL, PyDoc_STR("The object snapshots are taken of."), NULL},
+    {NULL, NULL, NULL, NULL, NULL}
+};
+
+static PyType_Slot Snapshotter_slots[] = {
+    {Py_tp_doc,
+     (void*)PyDoc_STR(
+         "Snapshotter(root)\n--\n\n"
+         "Takes deep copies of root that share whatever didn't change between them.\n\n"
+         "Dicts in root are watched for changes. snapshot() copies again only the dicts that\n"
+         "changed, or that hold a changed dict, and reuses the previous copies of the others.\n"
+         "Lists, tuples and other objects can't be watched and are copied again every time,\n"
+         "along with the dicts holding them. Snapshots share structure, so they must not be\n"
+         "mutated. Before Python 3.12 and on free-threaded builds, every snapshot is a full\n"
+         "deepcopy(root).")},
+    {Py_tp_new, Snapshotter_new},
+    {Py_tp_dealloc, Snapshotter_dealloc},
+    {Py_tp_traverse, Snapshotter_traverse},
+    {Py_tp_clear, Snapshotter_clear},
+    {Py_tp_methods, Snapshotter_methods},
+    {Py_tp_getset, Snapshotter_getset},
+    {0, NULL},
+};
+
+static PyType_Spec Snapshotter_spec = {
+    .name = "copium.extra.Snapshotter",
+    .basicsize = sizeof(SnapshotterObject),
+    .flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC | Py_TPFLAGS_IMMUTABLETYPE,
+    .slots = Snapshotter_slots,
+};
+
+// Called with the state of module entered.
+static int snapshot_make_types(PyObject* module) {
+    module_state.SnapshotNode_Type =
+        (PyTypeObject*)PyType_FromModuleAndSpec(module, &SnapshotNode_spec, NULL);
+    if (!module_state.SnapshotNode_Type)
+        return -1;
+    module_state.Snapshotter_Type =
+        (PyTypeObject*)PyType_FromModuleAndSpec(module, &Snapshotter_spec, NULL);
+    return module_state.Snapshotter_Type ? 0 : -1;
+}
+
+#endif  // _COPIUM_SNAPSHOT_C
@@ -19,17 +19,34 @@ typedef enum {
     COPIUM_ON_INCOMPATIBLE_SILENT = 2,
 } CopiumOnIncompatible;
 
+typedef enum {
+    COPIUM_MEMO_RETENTION_ADAPTIVE = 0,
+    COPIUM_MEMO_RETENTION_FIXED = 1,
+    COPIUM_MEMO_RETENTION_MINIMAL = 2,
+} CopiumMemoRetention;
+
 typedef struct {
     // Interned strings for attribute lookups
     PyObject* s__reduce_ex__;
     PyObject* s__reduce__;
     PyObject* s__deepcopy__;
+    PyObject* s__copy__;
     PyObject* s__setstate__;
     PyObject* s__dict__;
     PyObject* s_append;
     PyObject* s_update;
     PyObject* s__new__;
     PyObject* s__get__;
+    PyObject* s__getstate__;
+    PyObject* s__getnewargs_ex__;
+    PyObject* s__getnewargs__;
+    PyObject* s__slotnames__;
+    PyObject* s__slots__;
+    PyObject* s_items;
+    PyObject* s_extend;
+    PyObject* s_maxlen;
+    PyObject* s_default_factory;
+    PyObject* s_tzinfo;
 
     // Used for identity comparison
     PyObject* sentinel;
@@ -44,6 +61,34 @@ typedef struct {
     PyTypeObject* re_Pattern_type;
     PyTypeObject* Decimal_type;
     PyTypeObject* Fraction_type;
+    PyTypeObject* OrderedDict_type;
+    PyTypeObject* defaultdict_type;
+    PyTypeObject* deque_type;
+    PyTypeObject* Counter_type;
+    PyTypeObject* date_type;
+    PyTypeObject* timedelta_type;
+    PyTypeObject* timezone_type;
+    PyTypeObject* datetime_type;
+    PyTypeObject* time_type;
+    PyTypeObject* UUID_type;
+    PyTypeObject* PurePosixPath_type;
+    PyTypeObject* PureWindowsPath_type;
+    PyTypeObject* PosixPath_type;
+    PyTypeObject* WindowsPath_type;
+    PyTypeObject* IPv4Address_type;
+    PyTypeObject* IPv6Address_type;
+    PyTypeObject* IPv4Network_type;
+    PyTypeObject* IPv6Network_type;
+    PyTypeObject* IPv4Interface_type;
+    PyTypeObject* IPv6Interface_type;
+    PyTypeObject* array_type;
+    PyTypeObject* EnumType;
+    PyObject* Enum___deepcopy__;  // returns the member itself; NULL if enum.Enum has none
+    PyObject* namedtuple___getnewargs___code;  // shared by every namedtuple's; NULL if not found
+    int stdlib_pending;  // STDLIB_* modules the fields above are yet to be found in
+#ifdef Py_GIL_DISABLED
+    PyMutex stdlib_mutex;
+#endif
 
     // Stdlib refs
     PyObject* copyreg_dispatch;                  // dict
@@ -51,6 +96,11 @@ typedef struct {
     PyObject* copyreg___newobj__;                // copyreg.__newobj__ (or sentinel)
     PyObject* copyreg___newobj___ex;             // copyreg.__newobj_ex__ (or sentinel)
 
+    // _C_API registrations: {type: None if atomic, else capsule of its copium_copyfunc}
+    PyObject* registered_types;
+    // copium.configure(atomic_types=...): tuple of types, NULL for none (see _shared_types.c)
+    PyObject* atomic_types;
+
     // TLS memo allows reuse across deepcopy calls without allocation.
     // Key insight: memo is thread-local, not coroutine-local, which is correct
     // because deepcopy is synchronous and doesn't yield.
@@ -59,11 +109,123 @@ typedef struct {
     // Configuration (initialized from env vars, overridable via copium.configure())
     CopiumMemoMode memo_mode;
     CopiumOnIncompatible on_incompatible;
+    CopiumMemoRetention memo_retention;  // what the TSS memo keeps between calls
     PyObject* ignored_errors;         // Tuple of error suffixes to suppress warnings for
     PyObject* ignored_errors_joined;  // Pre-joined string for warning message (or NULL if empty)
+    PyObject* slow_copy_callback;     // see _slow_copy.c, NULL when nothing is timed
+    int64_t slow_copy_threshold_ns;   // -1 when only sampled calls are reported
+    Py_ssize_t slow_copy_sample;      // report every nth call on a thread, 0 for none
     PyObject* dict_items_descr;
     vectorcallfunc dict_items_vc;
+
+    // Types, made for each module (see copium_exec())
+    PyTypeObject* Memo_Type;
+    PyTypeObject* KeepaliveList_Type;
+    PyTypeObject* MemoKeysView_Type;
+    PyTypeObject* MemoValuesView_Type;
+    PyTypeObject* MemoItemsView_Type;
+    PyTypeObject* MemoViewIter_Type;
+    PyTypeObject* Plan_Type;
+    PyTypeObject* Replicator_Type;
+    PyTypeObject* SnapshotNode_Type;
+    PyTypeObject* Snapshotter_Type;
+
+#if PY_VERSION_HEX < PY_VERSION_3_12_HEX
+    PyObject* patch_template_code;  // see _patching.c
+#endif
+    int dict_watcher_id;  // the interpreter's, see InterpState
+    int64_t interp_id;    // interpreter the module was made in
 } ModuleState;
 
-static ModuleState module_state = {0};
+/*
+ * Per-interpreter state.
+ *
+ * Anything reached from a callback that only knows which interpreter it runs in: dict watchers,
+ * the patched copy.deepcopy, _C_API registrations. Made along with the first copium module of
+ * the interpreter and kept in the interpreter's dict, so it outlives the module: it goes away
+ * with the interpreter.
+ */
+struct SnapshotterObject;
+struct CopiumStatsBlock;
+
+typedef struct {
+    ModuleState* state;  // of the copium module imported last; NULL once that one is freed
+    int dict_watcher_id;  // see _dict_iter.c, -1 if there is none
+    int snapshot_watcher_id;  // see _snapshot.c, -1 until a dict is watched
+    struct SnapshotterObject* snapshotters;
+    struct CopiumStatsBlock* stats_blocks;  // see _stats.c
+#ifdef Py_GIL_DISABLED
+    PyMutex stats_blocks_mutex;
+#endif
+} InterpState;
+
+#define COPIUM_INTERP_CAPSULE "ccopium._interp_state"
+
+/*
+ * The state of the module a call came through, set by copium_enter() for its duration: every
+ * module-level function, and every method that needs it, enters the state of its own module.
+ * Threads running no copium code have none.
+ */
+static COPIUM_THREAD_LOCAL ModuleState* copium_current_state = NULL;
+#define module_state (*copium_current_state)
+
+// Interpreter whose objects the thread's type cache and stats block are about.
+static COPIUM_THREAD_LOCAL int64_t copium_thread_interp = -1;
+
+static void copium_adopt_interp(ModuleState* state);
+
+static ALWAYS_INLINE ModuleState* copium_module_state(PyObject* module) {
+    return (ModuleState*)PyModule_GetState(module);
+}
+
+// Makes state current. Returns the state to hand back to copium_leave(), NULL if none was.
+static ALWAYS_INLINE ModuleState* copium_enter(ModuleState* state) {
+    ModuleState* outer = copium_current_state;
+    copium_current_state = state;
+    if (UNLIKELY(state->interp_id != copium_thread_interp))
+        copium_adopt_interp(state);
+    return outer;
+}
+
+static ALWAYS_INLINE void copium_leave(ModuleState* outer) {
+    copium_current_state = outer;
+    if (UNLIKELY(outer && outer->interp_id != copium_thread_interp))
+        copium_adopt_interp(outer);
+}
+
+typedef struct {
+    int64_t id;
+    InterpState* interp;
+} InterpStateCache;
+
+static COPIUM_THREAD_LOCAL InterpStateCache copium_interp_cache = {0, NULL};
+
+// State of the current interpreter; NULL, with no exception set, if copium was never imported in it.
+static InterpState* copium_interp(void) {
+    PyInterpreterState* interp = PyInterpreterState_Get();
+    int64_t id = PyInterpreterState_GetID(interp);
+    if (LIKELY(copium_interp_cache.interp && copium_interp_cache.id == id))
+        return copium_interp_cache.interp;
+    PyObject* dict = PyInterpreterState_GetDict(interp);
+    PyObject* capsule = dict ? PyDict_GetItemString(dict, COPIUM_INTERP_CAPSULE) : NULL;
+    if (!capsule)
+        return NULL;
+    InterpState* found = (InterpState*)PyCapsule_GetPointer(capsule, COPIUM_INTERP_CAPSULE);
+    if (!found) {
+        PyErr_Clear();
+        return NULL;
+    }
+    copium_interp_cache = (InterpStateCache){id, found};
+    return found;
+}
+
+// Module state for callers that only know the interpreter; NULL with an exception set if none.
+static ModuleState* copium_interp_module_state(void) {
+    InterpState* interp = copium_interp();
+    if (UNLIKELY(!interp || !interp->state)) {
+        PyErr_SetString(PyExc_RuntimeError, "copium is not loaded in this interpreter");
+        return NULL;
+    }
+    return interp->state;
+}
 #endif  // _COPIUM_STATE_C
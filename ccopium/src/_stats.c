@@ -0,0 +1,257 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * copium.stats() counters
+ *
+ * Built with -DCOPIUM_STATS=1 only; otherwise COPIUM_STAT() and friends expand to nothing.
+ * Every thread bumps a block of counters of its own, and stats() adds up the blocks of all
+ * threads that ever counted anything in the interpreter. Blocks live as long as the
+ * interpreter, so counts of threads that have exited still show up.
+ */
+#ifndef _COPIUM_STATS_C
+#define _COPIUM_STATS_C
+
+#include "_common.h"
+#include "_state.c"
+
+#ifndef COPIUM_STATS
+    #define COPIUM_STATS 0
+#endif
+
+#if COPIUM_STATS
+
+    #ifdef Py_GIL_DISABLED
+        #include <stdatomic.h>
+    #endif
+
+typedef enum {
+    COPIUM_STAT_prememo_atomic,  /* literal immutables returned before the memo lookup */
+    COPIUM_STAT_memo_hit,        /* objects found in the memo */
+    COPIUM_STAT_tuple,           /* native container routes */
+    COPIUM_STAT_dict,
+    COPIUM_STAT_list,
+    COPIUM_STAT_set,
+    COPIUM_STAT_frozenset,
+    COPIUM_STAT_bytearray,
+    COPIUM_STAT_method,
+    COPIUM_STAT_collections,     /* exact OrderedDict, defaultdict, deque and Counter */
+    COPIUM_STAT_c_api,           /* copiers registered through the _C_API capsule */
+    COPIUM_STAT_buffer,          /* exact array.array, registered buffer exporters */
+    COPIUM_STAT_subclass,        /* tuple, list and dict subclasses rebuilt natively */
+    COPIUM_STAT_atomic,          /* atomics recognized after the memo lookup */
+    COPIUM_STAT_deepcopy,        /* __deepcopy__ calls */
+    COPIUM_STAT_reduce,          /* objects reconstructed through the reduce protocol */
+    COPIUM_STAT_registry,        /* ... of which reduced through copyreg.dispatch_table */
+    COPIUM_STAT_dict_memo_retry, /* __deepcopy__ calls retried with a dict memo */
+    COPIUM_STAT_memo_resize,     /* memo table growths */
+    COPIUM_STAT_COUNT
+} CopiumStat;
+
+static const char* const copium_stat_names[COPIUM_STAT_COUNT] = {
+    "prememo_atomic",
+    "memo_hit",
+    "tuple",
+    "dict",
+    "list",
+    "set",
+    "frozenset",
+    "bytearray",
+    "method",
+    "collections",
+    "c_api",
+    "buffer",
+    "subclass",
+    "atomic",
+    "deepcopy",
+    "reduce",
+    "registry",
+    "dict_memo_retry",
+    "memo_resize",
+};
+
+    #ifdef Py_GIL_DISABLED
+typedef _Atomic uint64_t CopiumCounter;
+        // Only the owning thread writes, so a plain load and store is enough.
+        #define COPIUM_COUNTER_BUMP(c)                                                \
+            atomic_store_explicit(                                                    \
+                &(c), atomic_load_explicit(&(c), memory_order_relaxed) + 1,           \
+                memory_order_relaxed                                                  \
+            )
+        #define COPIUM_COUNTER_LOAD(c) atomic_load_explicit(&(c), memory_order_relaxed)
+        #define COPIUM_COUNTER_ZERO(c) atomic_store_explicit(&(c), 0, memory_order_relaxed)
+    #else
+typedef uint64_t CopiumCounter;
+        #define COPIUM_COUNTER_BUMP(c) ((c)++)
+        #define COPIUM_COUNTER_LOAD(c) (c)
+        #define COPIUM_COUNTER_ZERO(c) ((c) = 0)
+    #endif
+
+typedef struct CopiumStatsBlock {
+    CopiumCounter counters[COPIUM_STAT_COUNT];
+    PyObject* reduce_types; /* {type: count} of objects that took the reduce route */
+    struct CopiumStatsBlock* next;
+} CopiumStatsBlock;
+
+// Of the interpreter set in copium_thread_interp.
+static COPIUM_THREAD_LOCAL CopiumStatsBlock* stats_local = NULL;
+
+static CopiumStatsBlock* stats_block_slow(void) {
+    InterpState* interp = copium_interp();
+    if (!interp)
+        return NULL;
+    CopiumStatsBlock* block = (CopiumStatsBlock*)PyMem_RawCalloc(1, sizeof(CopiumStatsBlock));
+    if (!block)
+        return NULL;
+    // Made here so that stats() never sees it half-built; types go uncounted if this fails.
+    block->reduce_types = PyDict_New();
+    if (!block->reduce_types)
+        PyErr_Clear();
+    #ifdef Py_GIL_DISABLED
+    PyMutex_Lock(&interp->stats_blocks_mutex);
+    #endif
+    block->next = interp->stats_blocks;
+    interp->stats_blocks = block;
+    #ifdef Py_GIL_DISABLED
+    PyMutex_Unlock(&interp->stats_blocks_mutex);
+    #endif
+    stats_local = block;
+    return block;
+}
+
+static void stats_free_blocks(InterpState* interp) {
+    CopiumStatsBlock* block = interp->stats_blocks;
+    interp->stats_blocks = NULL;
+    while (block) {
+        CopiumStatsBlock* next = block->next;
+        if (stats_local == block)
+            stats_local = NULL;
+        Py_XDECREF(block->reduce_types);
+        PyMem_RawFree(block);
+        block = next;
+    }
+}
+
+static ALWAYS_INLINE CopiumStatsBlock* stats_block(void) {
+    CopiumStatsBlock* block = stats_local;
+    if (LIKELY(block))
+        return block;
+    return stats_block_slow();
+}
+
+static ALWAYS_INLINE void stats_bump(CopiumStat stat) {
+    CopiumStatsBlock* block = stats_block();
+    if (LIKELY(block))
+        COPIUM_COUNTER_BUMP(block->counters[stat]);
+}
+
+/* Called with no exception set; whatever goes wrong here is dropped. */
+static void stats_bump_reduce_type(PyTypeObject* tp) {
+    CopiumStatsBlock* block = stats_block();
+    if (!block || !block->reduce_types)
+        return;
+    // stats(reset=True) may clear the dict from another thread, so don't borrow from it.
+    #if PY_VERSION_HEX >= PY_VERSION_3_13_HEX
+    PyObject* count = NULL;
+    PyDict_GetItemRef(block->reduce_types, (PyObject*)tp, &count);
+    #else
+    PyObject* count = Py_XNewRef(PyDict_GetItemWithError(block->reduce_types, (PyObject*)tp));
+    #endif
+    long long now = count ? PyLong_AsLongLong(count) + 1 : 1;
+    Py_XDECREF(count);
+    PyObject* updated = PyErr_Occurred() ? NULL : PyLong_FromLongLong(now);
+    if (!updated || PyDict_SetItem(block->reduce_types, (PyObject*)tp, updated) < 0)
+        PyErr_Clear();
+    Py_XDECREF(updated);
+}
+
+static int stats_add_counts(PyObject* into, PyObject* from) {
+    int status = 0;
+    COPIUM_Py_BEGIN_CRITICAL_SECTION(from);
+    PyObject *key, *value;
+    Py_ssize_t pos = 0;
+    while (status == 0 && PyDict_Next(from, &pos, &key, &value)) {
+        PyObject* seen = PyDict_GetItemWithError(into, key);
+        PyObject* sum = seen ? PyNumber_Add(seen, value) : Py_NewRef(value);
+        if (!sum || PyDict_SetItem(into, key, sum) < 0)
+            status = -1;
+        Py_XDECREF(sum);
+    }
+    COPIUM_Py_END_CRITICAL_SECTION();
+    return status;
+}
+
+/*
+ * {counter name: total, ..., "reduce_types": {type: count}} over all threads. With reset, the
+ * counters are zeroed as they are read; a thread counting at the same time may lose a bump.
+ */
+static PyObject* stats_collect(int reset) {
+    uint64_t totals[COPIUM_STAT_COUNT] = {0};
+    PyObject* result = NULL;
+    PyObject* reduce_types = PyDict_New();
+    if (!reduce_types)
+        return NULL;
+
+    InterpState* interp = copium_interp();
+    CopiumStatsBlock* head = NULL;
+    if (interp) {
+    #ifdef Py_GIL_DISABLED
+        PyMutex_Lock(&interp->stats_blocks_mutex);
+    #endif
+        head = interp->stats_blocks;
+    #ifdef Py_GIL_DISABLED
+        PyMutex_Unlock(&interp->stats_blocks_mutex);
+    #endif
+    }
+
+    // Blocks are only ever prepended, so the list past head stays as it is.
+    for (CopiumStatsBlock* block = head; block; block = block->next) {
+        for (int i = 0; i < COPIUM_STAT_COUNT; i++) {
+            totals[i] += COPIUM_COUNTER_LOAD(block->counters[i]);
+            if (reset)
+                COPIUM_COUNTER_ZERO(block->counters[i]);
+        }
+        if (block->reduce_types) {
+            if (stats_add_counts(reduce_types, block->reduce_types) < 0)
+                goto error;
+            if (reset)
+                PyDict_Clear(block->reduce_types);
+        }
+    }
+
+    result = PyDict_New();
+    if (!result)
+        goto error;
+    for (int i = 0; i < COPIUM_STAT_COUNT; i++) {
+        PyObject* total = PyLong_FromUnsignedLongLong(totals[i]);
+        if (!total || PyDict_SetItemString(result, copium_stat_names[i], total) < 0) {
+            Py_XDECREF(total);
+            goto error;
+        }
+        Py_DECREF(total);
+    }
+    if (PyDict_SetItemString(result, "reduce_types", reduce_types) < 0)
+        goto error;
+    Py_DECREF(reduce_types);
+    return result;
+
+error:
+    Py_XDECREF(result);
+    Py_DECREF(reduce_types);
+    return NULL;
+}
+
+    #define COPIUM_STAT(name) stats_bump(COPIUM_STAT_##name)
+    #define COPIUM_STAT_REDUCE_TYPE(tp) stats_bump_reduce_type(tp)
+
+#else
+
+    #define COPIUM_STAT(name) ((void)0)
+    #define COPIUM_STAT_REDUCE_TYPE(tp) ((void)0)
+
+#endif  // COPIUM_STATS
+
+#endif  // _COPIUM_STATS_C
@@ -0,0 +1,145 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef _COPIUM_TYPE_CACHE_C
+#define _COPIUM_TYPE_CACHE_C
+
+#include "_common.h"
+
+#include <stdint.h>
+
+/*
+ * Per-type classification cache.
+ *
+ * Entries are keyed by tp_version_tag. CPython clears the tag whenever a type
+ * (or any of its bases) is mutated and never hands the same tag to another
+ * type, so a stale entry simply stops matching. The table is thread-local,
+ * which keeps it free of synchronization on free-threaded builds.
+ */
+
+#ifndef COPIUM_TYPE_CACHE_SIZE
+    #define COPIUM_TYPE_CACHE_SIZE 256u
+#endif
+
+// Most __slotnames__ a type can have for its slots to be copied by offset.
+#ifndef COPIUM_SLOT_PLAN_MAX
+    #define COPIUM_SLOT_PLAN_MAX 16u
+#endif
+
+typedef enum {
+    REDUCE_PLAN_UNKNOWN = 0,  // not classified yet, or no valid version tag
+    REDUCE_PLAN_GENERIC = 1,  // go through __reduce_ex__ on every copy
+    // The plans from here on skip __reduce_ex__ and read the instance __dict__ themselves.
+    // __reduce_ex__(4) is known to produce (copyreg.__newobj__, (cls,), __dict__ or None, None, None)
+    REDUCE_PLAN_NEWOBJ_DICT = 2,
+    // The same with (__dict__ or None, {slot: value}) state, every slot a plain object member:
+    // read and written at the offsets in SlotPlan
+    REDUCE_PLAN_NEWOBJ_SLOTS = 3,
+} ReducePlan;
+
+// Where instances of a REDUCE_PLAN_NEWOBJ_SLOTS type keep their __slotnames__, in order.
+typedef struct {
+    uint16_t count;
+    uint16_t offsets[COPIUM_SLOT_PLAN_MAX];
+} SlotPlan;
+
+// How deepcopy handles instances of a type that isn't one of the exact builtin containers.
+typedef enum {
+    ROUTE_UNKNOWN = 0,  // not classified yet, or no valid version tag
+    ROUTE_ATOMIC = 1,   // immutable: returned as-is
+    ROUTE_NATIVE = 2,   // exact frozenset / bytearray / bound method / stdlib containers: copied natively
+    ROUTE_CUSTOM = 3,   // __deepcopy__ is a function or C method on the type, called as (obj, memo)
+    ROUTE_REDUCE = 4,   // no __deepcopy__ anywhere in the MRO: straight to reduce
+    ROUTE_LOOKUP = 5,   // attribute resolution can't be vouched for: look __deepcopy__ up per instance
+    ROUTE_TZINFO = 6,   // exact datetime / time: atomic, unless its tzinfo isn't
+    ROUTE_REGISTERED = 7,  // copier or buffer allocator registered through the _C_API capsule
+    ROUTE_BUFFER = 8,   // exact array.array: a flat buffer, copied by its own __copy__
+    ROUTE_SUBCLASS = 9,  // tuple / list / dict subclass keeping object's reduce: rebuilt natively
+    ROUTE_STDLIB = 10,  // exact date / UUID / Path / ...: atomic, unless copyreg has a reductor
+} CopyRoute;
+
+typedef struct {
+    PyTypeObject* tp;
+    unsigned int version;
+    CopyRoute route;
+    // borrowed: kept alive by the type's MRO (or the _C_API registry) for as long as version
+    // matches, which only holds up under the GIL; route_of() in _deepcopy.c checks it without
+    PyObject* deepcopy;
+    ReducePlan reduce;
+    SlotPlan slots;
+} TypeCacheEntry;
+
+static COPIUM_THREAD_LOCAL TypeCacheEntry _copium_type_cache[COPIUM_TYPE_CACHE_SIZE];
+
+static ALWAYS_INLINE TypeCacheEntry* type_cache_matching_entry(PyTypeObject* tp) {
+    unsigned int version = tp->tp_version_tag;
+    if (version == 0)
+        return NULL;
+    TypeCacheEntry* entry = &_copium_type_cache[version & (COPIUM_TYPE_CACHE_SIZE - 1)];
+    if (LIKELY(entry->version == version && entry->tp == tp))
+        return entry;
+    return NULL;
+}
+
+// Entry for the current version of tp, evicting whatever occupied its slot.
+// NULL for types without a valid version tag, which are never cached.
+static TypeCacheEntry* type_cache_claim_entry(PyTypeObject* tp) {
+    TypeCacheEntry* entry = type_cache_matching_entry(tp);
+    if (entry)
+        return entry;
+    unsigned int version = tp->tp_version_tag;
+    if (version == 0)
+        return NULL;
+    entry = &_copium_type_cache[version & (COPIUM_TYPE_CACHE_SIZE - 1)];
+    *entry = (TypeCacheEntry){.tp = tp, .version = version};
+    return entry;
+}
+
+// Cached route for tp; *deepcopy receives the borrowed unbound __deepcopy__ for ROUTE_CUSTOM
+// (__copy__ for ROUTE_BUFFER, __getnewargs__ for ROUTE_SUBCLASS of tuple).
+static ALWAYS_INLINE CopyRoute type_cache_route(PyTypeObject* tp, PyObject** deepcopy) {
+    TypeCacheEntry* entry = type_cache_matching_entry(tp);
+    if (!entry) {
+        *deepcopy = NULL;
+        return ROUTE_UNKNOWN;
+    }
+    *deepcopy = entry->deepcopy;
+    return entry->route;
+}
+
+static void type_cache_set_route(PyTypeObject* tp, CopyRoute route, PyObject* deepcopy) {
+    TypeCacheEntry* entry = type_cache_claim_entry(tp);
+    if (entry) {
+        entry->route = route;
+        entry->deepcopy = deepcopy;
+    }
+}
+
+static ALWAYS_INLINE ReducePlan type_cache_reduce_plan(PyTypeObject* tp) {
+    TypeCacheEntry* entry = type_cache_matching_entry(tp);
+    return entry ? entry->reduce : REDUCE_PLAN_UNKNOWN;
+}
+
+// Copied out, since copying the slots can run code that evicts the entry.
+static ALWAYS_INLINE int type_cache_slot_plan(PyTypeObject* tp, SlotPlan* slots) {
+    TypeCacheEntry* entry = type_cache_matching_entry(tp);
+    if (!entry || entry->reduce != REDUCE_PLAN_NEWOBJ_SLOTS)
+        return 0;
+    *slots = entry->slots;
+    return 1;
+}
+
+// slots is only read for REDUCE_PLAN_NEWOBJ_SLOTS.
+static void type_cache_set_reduce_plan(PyTypeObject* tp, ReducePlan plan, const SlotPlan* slots) {
+    TypeCacheEntry* entry = type_cache_claim_entry(tp);
+    if (entry) {
+        entry->reduce = plan;
+        if (plan == REDUCE_PLAN_NEWOBJ_SLOTS)
+            entry->slots = *slots;
+    }
+}
+
+#endif  // _COPIUM_TYPE_CACHE_C
@@ -32,6 +32,216 @@ static ALWAYS_INLINE int is_stdlib_immutable(PyTypeObject* tp) {
     return (int)r;
 }
 
+static ALWAYS_INLINE int is_stdlib_container(PyTypeObject* tp) {
+    unsigned long r = (tp == module_state.OrderedDict_type) |
+        (tp == module_state.defaultdict_type) | (tp == module_state.deque_type) |
+        (tp == module_state.Counter_type);
+    return (int)r;
+}
+
+/*
+ * Stdlib value types copium doesn't import itself, resolved like the fields above by
+ * stdlib_resolve_pending() once their module has been imported. Only exact types count. Unlike
+ * is_stdlib_immutable(), none of them is copied by copy._deepcopy_dispatch: a reductor
+ * registered in copyreg.dispatch_table takes over, so the routes check for one on each copy.
+ */
+static ALWAYS_INLINE int is_stdlib_value(PyTypeObject* tp) {
+    unsigned long r = (tp == module_state.date_type) | (tp == module_state.timedelta_type) |
+        (tp == module_state.timezone_type) | (tp == module_state.UUID_type) |
+        (tp == module_state.PurePosixPath_type) | (tp == module_state.PureWindowsPath_type) |
+        (tp == module_state.PosixPath_type) | (tp == module_state.WindowsPath_type) |
+        (tp == module_state.IPv4Address_type) | (tp == module_state.IPv6Address_type) |
+        (tp == module_state.IPv4Network_type) | (tp == module_state.IPv6Network_type) |
+        (tp == module_state.IPv4Interface_type) | (tp == module_state.IPv6Interface_type);
+    return (int)r;
+}
+
+// Immutable too, but they hold on to a tzinfo, which can be anything.
+static ALWAYS_INLINE int is_stdlib_tzinfo_holder(PyTypeObject* tp) {
+    return (int)((tp == module_state.datetime_type) | (tp == module_state.time_type));
+}
+
+// Flat buffers of C values, copied wholesale by their own __copy__.
+static ALWAYS_INLINE int is_stdlib_buffer(PyTypeObject* tp) {
+    return tp == module_state.array_type;
+}
+
+// Whether a reductor registered in copyreg.dispatch_table is meant to take over for tp.
+static int has_registered_reductor(PyTypeObject* tp) {
+    PyObject* reductor = PyDict_GetItemWithError(module_state.copyreg_dispatch, (PyObject*)tp);
+    PyErr_Clear();
+    return reductor != NULL;
+}
+
+// Members of an enum that copies them through enum.Enum.__deepcopy__, i.e. as themselves. The
+// __deepcopy__ comes before any reductor, so these are atomic for good.
+static int is_enum_member_type(PyTypeObject* tp) {
+    if (!module_state.Enum___deepcopy__ ||
+        !PyType_IsSubtype(Py_TYPE(tp), module_state.EnumType))
+        return 0;
+    return _PyType_Lookup(tp, module_state.s__deepcopy__) == module_state.Enum___deepcopy__;
+}
+
+/*
+ * Stdlib modules of the types copium handles natively. They are only looked up once something
+ * else has imported them: importing copium, e.g. from copium_patch.pth at startup, shouldn't
+ * import re, decimal, fractions and enum with it. Until then the fields above stay NULL, which
+ * is right as long as there are no instances. A module that isn't fully initialized yet stays
+ * pending.
+ */
+enum {
+    STDLIB_RE = 1 << 0,
+    STDLIB_DECIMAL = 1 << 1,
+    STDLIB_FRACTIONS = 1 << 2,
+    STDLIB_COLLECTIONS = 1 << 3,
+    STDLIB_ENUM = 1 << 4,
+    STDLIB_DATETIME = 1 << 5,
+    STDLIB_UUID = 1 << 6,
+    STDLIB_PATHLIB = 1 << 7,
+    STDLIB_IPADDRESS = 1 << 8,
+    STDLIB_ARRAY = 1 << 9,
+    STDLIB_ALL = (1 << 10) - 1,
+};
+
+// New reference to the module if it has been imported, NULL otherwise.
+static PyObject* stdlib_imported(const char* name) {
+    PyObject* module_name = PyUnicode_FromString(name);
+    PyObject* module = module_name ? PyImport_GetModule(module_name) : NULL;
+    Py_XDECREF(module_name);
+    return module;
+}
+
+static int stdlib_load(PyObject* module, const char* name, PyObject** target) {
+    PyObject* found = PyObject_GetAttrString(module, name);
+    if (!found)
+        return 0;
+    Py_XSETREF(*target, found);
+    return 1;
+}
+
+#define STDLIB_LOAD_TYPE(module, name, field) \
+    (stdlib_load((module), (name), (PyObject**)&module_state.field) && PyType_Check(module_state.field))
+
+// Every namedtuple class gets its own __getnewargs__ function, all made from the code object
+// nested in namedtuple() itself.
+static PyObject* find_namedtuple_getnewargs_code(PyObject* mod_collections) {
+    PyObject* found = NULL;
+    PyObject* namedtuple = PyObject_GetAttrString(mod_collections, "namedtuple");
+    PyObject* code = namedtuple ? PyObject_GetAttrString(namedtuple, "__code__") : NULL;
+    PyObject* consts = code ? PyObject_GetAttrString(code, "co_consts") : NULL;
+    if (consts && PyTuple_Check(consts)) {
+        for (Py_ssize_t i = 0; i < PyTuple_GET_SIZE(consts) && !found; i++) {
+            PyObject* item = PyTuple_GET_ITEM(consts, i);
+            if (!PyCode_Check(item))
+                continue;
+            PyObject* name = ((PyCodeObject*)item)->co_name;
+            if (PyUnicode_CompareWithASCIIString(name, "__getnewargs__") == 0)
+                found = Py_NewRef(item);
+        }
+    }
+    Py_XDECREF(consts);
+    Py_XDECREF(code);
+    Py_XDECREF(namedtuple);
+    PyErr_Clear();
+    return found;
+}
+
+static int stdlib_resolve(int which, PyObject* module) {
+    switch (which) {
+        case STDLIB_RE:
+            return STDLIB_LOAD_TYPE(module, "Pattern", re_Pattern_type);
+        case STDLIB_DECIMAL:
+            return STDLIB_LOAD_TYPE(module, "Decimal", Decimal_type);
+        case STDLIB_FRACTIONS:
+            return STDLIB_LOAD_TYPE(module, "Fraction", Fraction_type);
+        case STDLIB_COLLECTIONS:
+            if (!STDLIB_LOAD_TYPE(module, "OrderedDict", OrderedDict_type) ||
+                !STDLIB_LOAD_TYPE(module, "defaultdict", defaultdict_type) ||
+                !STDLIB_LOAD_TYPE(module, "deque", deque_type) ||
+                !STDLIB_LOAD_TYPE(module, "Counter", Counter_type))
+                return 0;
+            Py_XSETREF(
+                module_state.namedtuple___getnewargs___code,
+                find_namedtuple_getnewargs_code(module)
+            );
+            return 1;
+        case STDLIB_ENUM: {
+            PyObject* Enum = PyObject_GetAttrString(module, "Enum");
+            if (!Enum || !STDLIB_LOAD_TYPE(module, "EnumMeta", EnumType)) {
+                Py_XDECREF(Enum);
+                return 0;
+            }
+            Py_XSETREF(
+                module_state.Enum___deepcopy__,
+                PyObject_GetAttr(Enum, module_state.s__deepcopy__)
+            );
+            Py_DECREF(Enum);
+            return 1;
+        }
+        case STDLIB_DATETIME:
+            return STDLIB_LOAD_TYPE(module, "date", date_type) &&
+                STDLIB_LOAD_TYPE(module, "timedelta", timedelta_type) &&
+                STDLIB_LOAD_TYPE(module, "timezone", timezone_type) &&
+                STDLIB_LOAD_TYPE(module, "datetime", datetime_type) &&
+                STDLIB_LOAD_TYPE(module, "time", time_type);
+        case STDLIB_UUID:
+            return STDLIB_LOAD_TYPE(module, "UUID", UUID_type);
+        case STDLIB_PATHLIB:
+            return STDLIB_LOAD_TYPE(module, "PurePosixPath", PurePosixPath_type) &&
+                STDLIB_LOAD_TYPE(module, "PureWindowsPath", PureWindowsPath_type) &&
+                STDLIB_LOAD_TYPE(module, "PosixPath", PosixPath_type) &&
+                STDLIB_LOAD_TYPE(module, "WindowsPath", WindowsPath_type);
+        case STDLIB_IPADDRESS:
+            return STDLIB_LOAD_TYPE(module, "IPv4Address", IPv4Address_type) &&
+                STDLIB_LOAD_TYPE(module, "IPv6Address", IPv6Address_type) &&
+                STDLIB_LOAD_TYPE(module, "IPv4Network", IPv4Network_type) &&
+                STDLIB_LOAD_TYPE(module, "IPv6Network", IPv6Network_type) &&
+                STDLIB_LOAD_TYPE(module, "IPv4Interface", IPv4Interface_type) &&
+                STDLIB_LOAD_TYPE(module, "IPv6Interface", IPv6Interface_type);
+        case STDLIB_ARRAY:
+            return STDLIB_LOAD_TYPE(module, "array", array_type);
+    }
+    return 0;
+}
+
+static void stdlib_resolve_imported(void) {
+    static const struct {
+        int which;
+        const char* module;
+    } modules[] = {
+        {STDLIB_RE, "re"},
+        {STDLIB_DECIMAL, "decimal"},
+        {STDLIB_FRACTIONS, "fractions"},
+        {STDLIB_COLLECTIONS, "collections"},
+        {STDLIB_ENUM, "enum"},
+        {STDLIB_DATETIME, "datetime"},
+        {STDLIB_UUID, "uuid"},
+        {STDLIB_PATHLIB, "pathlib"},
+        {STDLIB_IPADDRESS, "ipaddress"},
+        {STDLIB_ARRAY, "array"},
+    };
+#ifdef Py_GIL_DISABLED
+    PyMutex_Lock(&module_state.stdlib_mutex);
+#endif
+    for (size_t i = 0; i < sizeof(modules) / sizeof(*modules); i++) {
+        if (!(module_state.stdlib_pending & modules[i].which))
+            continue;
+        PyObject* module = stdlib_imported(modules[i].module);
+        if (module && stdlib_resolve(modules[i].which, module))
+            module_state.stdlib_pending &= ~modules[i].which;
+        Py_XDECREF(module);
+        PyErr_Clear();
+    }
+#ifdef Py_GIL_DISABLED
+    PyMutex_Unlock(&module_state.stdlib_mutex);
+#endif
+}
+
+static ALWAYS_INLINE void stdlib_resolve_pending(void) {
+    if (UNLIKELY(module_state.stdlib_pending))
+        stdlib_resolve_imported();
+}
+
 static ALWAYS_INLINE int is_class(PyTypeObject* tp) {
     return PyType_HasFeature(tp, Py_TPFLAGS_TYPE_SUBCLASS);
 }
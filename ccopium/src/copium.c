@@ -12,10 +12,11 @@
  *   - deepcopy(obj, memo=None)   - deep copy
  *   - replace(obj, **changes)    - replace fields (Python >= 3.13)
  *   - Error                      - copy.Error exception
+ *   - _C_API                     - capsule for extension types, see copium_capi.h
  *
  * Submodules:
  *   - copium.patch        - stdlib patching (enable, disable, enabled)
- *   - copium.extra        - batch utilities (replicate, repeatcall)
+ *   - copium.extra        - batch utilities (replicate, repeatcall, compile)
  *   - copium.__about__    - version information
  */
 
@@ -41,6 +42,7 @@
 #include "_deepcopy_legacy.c"
 #include "_copy.c"
 #include "_patching.c"
+#include "_capi.c"
 #include "_init.c"
 
 /* ========================================================================== */
@@ -55,9 +57,7 @@
 /*                              Main API                                      */
 /* ========================================================================== */
 
-PyObject* py_copy(PyObject* self, PyObject* obj) {
-    (void)self;
-
+static PyObject* py_copy_impl(PyObject* obj) {
     {
         PyTypeObject* tp = Py_TYPE(obj);
         if (is_atomic_immutable(tp)) {
@@ -154,10 +154,78 @@ PyObject* py_copy(PyObject* self, PyObject* obj) {
     return out;
 }
 
-PyObject* py_deepcopy(PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
+PyObject* py_copy(PyObject* self, PyObject* obj) {
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* out = py_copy_impl(obj);
+    copium_leave(outer);
+    return out;
+}
+
+// Top-level deepcopy with the thread's own memo, timed for the slow-copy sampler.
+static PyObject* deepcopy_sampled(PyObject* obj, PyMemoObject* memo, int is_tss) {
+    SlowCopySample sample;
+    slow_copy_start(&sample, (PyObject*)memo);
+    PyObject* result = deepcopy(obj, memo);
+    slow_copy_stop(&sample, (PyObject*)memo);
+    cleanup_memo(memo, is_tss);
+    if (result)
+        slow_copy_finish(&sample);
+    return result;
+}
+
+// Top-level deepcopy with a memo that isn't the thread's own: a Memo, or a dict or any other
+// mapping.
+static PyObject* deepcopy_with_memo(PyObject* obj, PyObject* memo_arg) {
+    if (LIKELY(Py_TYPE(memo_arg) == module_state.Memo_Type)) {
+        Py_INCREF(memo_arg);
+        PyObject* result = deepcopy(obj, (PyMemoObject*)memo_arg);
+        Py_DECREF(memo_arg);
+        return result;
+    }
+
+    PyObject* keep_list = NULL;
+    PyObject* result = deepcopy_legacy(obj, memo_arg, &keep_list);
+    Py_XDECREF(keep_list);
+    return result;
+}
+
+// deepcopy_with_memo(), timed for the slow-copy sampler.
+static PyObject* deepcopy_with_memo_sampled(PyObject* obj, PyObject* memo_arg) {
+    SlowCopySample sample;
+    slow_copy_start(&sample, memo_arg);
+    PyObject* result = deepcopy_with_memo(obj, memo_arg);
+    slow_copy_stop(&sample, memo_arg);
+    if (result)
+        slow_copy_finish(&sample);
+    return result;
+}
+
+static PyObject* deepcopy_top(PyObject* obj, PyObject* memo_arg);
+
+// deepcopy(x, memo, share=...): the types are shared by whatever this thread copies until the
+// call returns, on top of the ones an outer call shares.
+static PyObject* deepcopy_sharing(PyObject* obj, PyObject* memo_arg, PyObject* share_arg) {
+    PyObject* types = shared_types_from(share_arg, "share");
+    if (!types)
+        return NULL;
+    PyObject* outer = _call_shared_types;
+    if (outer && PyTuple_GET_SIZE(outer)) {
+        PyObject* both = PySequence_Concat(outer, types);
+        Py_DECREF(types);
+        if (!both)
+            return NULL;
+        types = both;
+    }
+    _call_shared_types = PyTuple_GET_SIZE(types) ? types : NULL;
+    PyObject* result = deepcopy_top(obj, memo_arg);
+    _call_shared_types = outer;
+    Py_DECREF(types);
+    return result;
+}
+
+static PyObject* py_deepcopy_impl(PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
     PyObject* obj = NULL;
     PyObject* memo_arg = Py_None;
-    int memo_owned = 0;
 
     if (!kwnames || PyTuple_GET_SIZE(kwnames) == 0) {
         if (UNLIKELY(nargs < 1)) {
@@ -174,7 +242,7 @@ PyObject* py_deepcopy(PyObject* self, PyObject* const* args, Py_ssize_t nargs, P
         }
         obj = args[0];
         memo_arg = (nargs == 2) ? args[1] : Py_None;
-        goto have_args;
+        return deepcopy_top(obj, memo_arg);
     }
 
     const Py_ssize_t kwcount = PyTuple_GET_SIZE(kwnames);
@@ -206,10 +274,11 @@ PyObject* py_deepcopy(PyObject* self, PyObject* const* args, Py_ssize_t nargs, P
             }
             obj = args[0];
             memo_arg = args[nargs + 0];
-            goto have_args;
+            return deepcopy_top(obj, memo_arg);
         }
     }
 
+    PyObject* share_arg = NULL;
     {
         Py_ssize_t i;
         int seen_memo_kw = 0;
@@ -261,6 +330,11 @@ PyObject* py_deepcopy(PyObject* self, PyObject* const* args, Py_ssize_t nargs, P
                 continue;
             }
 
+            if (PyUnicode_CompareWithASCIIString(name, "share") == 0) {
+                share_arg = val;
+                continue;
+            }
+
             PyErr_Format(
                 PyExc_TypeError, "deepcopy() got an unexpected keyword argument '%U'", name
             );
@@ -273,7 +347,14 @@ PyObject* py_deepcopy(PyObject* self, PyObject* const* args, Py_ssize_t nargs, P
         }
     }
 
-have_args:
+    // deepcopy(x, share=...)
+    if (share_arg && share_arg != Py_None)
+        return deepcopy_sharing(obj, memo_arg, share_arg);
+    return deepcopy_top(obj, memo_arg);
+}
+
+static PyObject* deepcopy_top(PyObject* obj, PyObject* memo_arg) {
+    int memo_owned = 0;
 
     if (memo_arg == Py_None) {
         PyTypeObject* tp = Py_TYPE(obj);
@@ -288,6 +369,10 @@ have_args:
             if (UNLIKELY(!memo))
                 return NULL;
 
+            // copium.configure(slow_copy_callback=...)
+            if (UNLIKELY(module_state.slow_copy_callback))
+                return deepcopy_sampled(obj, memo, is_tss);
+
             PyObject* result = deepcopy(obj, memo);
             cleanup_memo(memo, is_tss);
             return result;
@@ -300,28 +385,24 @@ have_args:
             return NULL;
     }
 
-    PyObject* result = NULL;
-
-    if (LIKELY(Py_TYPE(memo_arg) == &Memo_Type)) {
-        PyMemoObject* memo = (PyMemoObject*)memo_arg;
-        Py_INCREF(memo_arg);
-        result = deepcopy(obj, memo);
+    // copium.configure(slow_copy_callback=...)
+    PyObject* result = UNLIKELY(module_state.slow_copy_callback)
+        ? deepcopy_with_memo_sampled(obj, memo_arg)
+        : deepcopy_with_memo(obj, memo_arg);
+    if (memo_owned)
         Py_DECREF(memo_arg);
-        return result;
-    }
-
-    else {
-        PyObject* memo = memo_arg;
-        PyObject* keep_list = NULL;
-
-        result = deepcopy_legacy(obj, memo, &keep_list);
+    return result;
+}
 
-        if (memo_owned) {
-            Py_DECREF(memo_arg);
-        }
-        Py_XDECREF(keep_list);
-        return result;
-    }
+// self is NULL when called as the patched copy.deepcopy (see _patching.c).
+PyObject* py_deepcopy(PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
+    ModuleState* state = self ? copium_module_state(self) : copium_interp_module_state();
+    if (UNLIKELY(!state))
+        return NULL;
+    ModuleState* outer = copium_enter(state);
+    PyObject* result = py_deepcopy_impl(args, nargs, kwnames);
+    copium_leave(outer);
+    return result;
 }
 
 #if PY_VERSION_HEX >= PY_VERSION_3_13_HEX
@@ -395,11 +476,7 @@ PyObject* py_replace(PyObject* self, PyObject* const* args, Py_ssize_t nargs, Py
 /*                         Configuration API                                  */
 /* ========================================================================== */
 
-static PyObject* py_configure(
-    PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
-) {
-    (void)self;
-
+static PyObject* py_configure_impl(PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
     if (UNLIKELY(nargs > 0)) {
         PyErr_SetString(PyExc_TypeError, "configure() takes no positional arguments");
         return NULL;
@@ -414,6 +491,11 @@ static PyObject* py_configure(
     PyObject* memo_val = NULL;
     PyObject* on_incompat_val = NULL;
     PyObject* suppress_val = NULL;
+    PyObject* retention_val = NULL;
+    PyObject* threshold_val = NULL;
+    PyObject* sample_val = NULL;
+    PyObject* callback_val = NULL;
+    PyObject* atomic_types_val = NULL;
 
     Py_ssize_t kwcount = PyTuple_GET_SIZE(kwnames);
     for (Py_ssize_t i = 0; i < kwcount; i++) {
@@ -426,6 +508,16 @@ static PyObject* py_configure(
             on_incompat_val = val;
         } else if (PyUnicode_CompareWithASCIIString(name, "suppress_warnings") == 0) {
             suppress_val = val;
+        } else if (PyUnicode_CompareWithASCIIString(name, "memo_retention") == 0) {
+            retention_val = val;
+        } else if (PyUnicode_CompareWithASCIIString(name, "slow_copy_threshold_us") == 0) {
+            threshold_val = val;
+        } else if (PyUnicode_CompareWithASCIIString(name, "slow_copy_sample") == 0) {
+            sample_val = val;
+        } else if (PyUnicode_CompareWithASCIIString(name, "slow_copy_callback") == 0) {
+            callback_val = val;
+        } else if (PyUnicode_CompareWithASCIIString(name, "atomic_types") == 0) {
+            atomic_types_val = val;
         } else {
             PyErr_Format(
                 PyExc_TypeError, "configure() got an unexpected keyword argument '%U'", name
@@ -485,6 +577,107 @@ static PyObject* py_configure(
         }
     }
 
+    if (retention_val) {
+        if (!PyUnicode_Check(retention_val)) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "memo_retention must be a 'str', got '%.200s'",
+                Py_TYPE(retention_val)->tp_name
+            );
+            return NULL;
+        }
+        if (PyUnicode_CompareWithASCIIString(retention_val, "adaptive") == 0) {
+            module_state.memo_retention = COPIUM_MEMO_RETENTION_ADAPTIVE;
+        } else if (PyUnicode_CompareWithASCIIString(retention_val, "fixed") == 0) {
+            module_state.memo_retention = COPIUM_MEMO_RETENTION_FIXED;
+        } else if (PyUnicode_CompareWithASCIIString(retention_val, "minimal") == 0) {
+            module_state.memo_retention = COPIUM_MEMO_RETENTION_MINIMAL;
+        } else {
+            PyErr_Format(
+                PyExc_ValueError,
+                "memo_retention must be 'adaptive', 'fixed', or 'minimal', got '%U'",
+                retention_val
+            );
+            return NULL;
+        }
+    }
+
+    if (threshold_val) {
+        if (threshold_val == Py_None) {
+            module_state.slow_copy_threshold_ns = -1;
+        } else {
+            if (!PyLong_Check(threshold_val) && !PyFloat_Check(threshold_val)) {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    "slow_copy_threshold_us must be a number or None, got '%.200s'",
+                    Py_TYPE(threshold_val)->tp_name
+                );
+                return NULL;
+            }
+            double us = PyFloat_AsDouble(threshold_val);
+            if (us == -1.0 && PyErr_Occurred())
+                return NULL;
+            if (!(us >= 0.0 && us < 9e12)) {
+                PyErr_Format(
+                    PyExc_ValueError,
+                    "slow_copy_threshold_us must be a non-negative number, got %R",
+                    threshold_val
+                );
+                return NULL;
+            }
+            module_state.slow_copy_threshold_ns = (int64_t)(us * 1000.0);
+        }
+    }
+
+    if (sample_val) {
+        Py_ssize_t every = 0;
+        if (sample_val != Py_None) {
+            if (!PyLong_Check(sample_val)) {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    "slow_copy_sample must be an 'int' or None, got '%.200s'",
+                    Py_TYPE(sample_val)->tp_name
+                );
+                return NULL;
+            }
+            every = PyLong_AsSsize_t(sample_val);
+            if (every == -1 && PyErr_Occurred())
+                return NULL;
+            if (every < 0) {
+                PyErr_Format(
+                    PyExc_ValueError, "slow_copy_sample must not be negative, got %zd", every
+                );
+                return NULL;
+            }
+        }
+        module_state.slow_copy_sample = every;
+    }
+
+    if (callback_val) {
+        if (callback_val != Py_None && !PyCallable_Check(callback_val)) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "slow_copy_callback must be callable or None, got '%.200s'",
+                Py_TYPE(callback_val)->tp_name
+            );
+            return NULL;
+        }
+        Py_XSETREF(
+            module_state.slow_copy_callback,
+            callback_val == Py_None ? NULL : Py_NewRef(callback_val)
+        );
+    }
+
+    if (atomic_types_val) {
+        PyObject* types = NULL;
+        if (atomic_types_val != Py_None) {
+            types = shared_types_from(atomic_types_val, "atomic_types");
+            if (!types)
+                return NULL;
+        }
+        set_atomic_types(types);
+    }
+
     if (suppress_val) {
         PyObject* new_tuple;
         if (suppress_val == Py_None) {
@@ -517,10 +710,16 @@ static PyObject* py_configure(
     Py_RETURN_NONE;
 }
 
-static PyObject* py_get_config(PyObject* self, PyObject* noargs) {
-    (void)self;
-    (void)noargs;
+static PyObject* py_configure(
+    PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
+) {
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* result = py_configure_impl(args, nargs, kwnames);
+    copium_leave(outer);
+    return result;
+}
 
+static PyObject* py_get_config_impl(void) {
     PyObject* dict = PyDict_New();
     if (!dict)
         return NULL;
@@ -567,6 +766,62 @@ static PyObject* py_get_config(PyObject* self, PyObject* noargs) {
     }
     Py_DECREF(suppress_warnings);
 
+    const char* memo_retention_str;
+    switch (module_state.memo_retention) {
+        case COPIUM_MEMO_RETENTION_FIXED:
+            memo_retention_str = "fixed";
+            break;
+        case COPIUM_MEMO_RETENTION_MINIMAL:
+            memo_retention_str = "minimal";
+            break;
+        default:
+            memo_retention_str = "adaptive";
+            break;
+    }
+    PyObject* memo_retention_obj = PyUnicode_FromString(memo_retention_str);
+    if (!memo_retention_obj)
+        goto error;
+    if (PyDict_SetItemString(dict, "memo_retention", memo_retention_obj) < 0) {
+        Py_DECREF(memo_retention_obj);
+        goto error;
+    }
+    Py_DECREF(memo_retention_obj);
+
+    PyObject* threshold_obj = module_state.slow_copy_threshold_ns < 0
+        ? Py_NewRef(Py_None)
+        : PyFloat_FromDouble((double)module_state.slow_copy_threshold_ns / 1000.0);
+    if (!threshold_obj)
+        goto error;
+    if (PyDict_SetItemString(dict, "slow_copy_threshold_us", threshold_obj) < 0) {
+        Py_DECREF(threshold_obj);
+        goto error;
+    }
+    Py_DECREF(threshold_obj);
+
+    PyObject* sample_obj = PyLong_FromSsize_t(module_state.slow_copy_sample);
+    if (!sample_obj)
+        goto error;
+    if (PyDict_SetItemString(dict, "slow_copy_sample", sample_obj) < 0) {
+        Py_DECREF(sample_obj);
+        goto error;
+    }
+    Py_DECREF(sample_obj);
+
+    PyObject* callback = module_state.slow_copy_callback ? module_state.slow_copy_callback
+                                                         : Py_None;
+    if (PyDict_SetItemString(dict, "slow_copy_callback", callback) < 0)
+        goto error;
+
+    PyObject* atomic_types = module_state.atomic_types ? Py_NewRef(module_state.atomic_types)
+                                                       : PyTuple_New(0);
+    if (!atomic_types)
+        goto error;
+    if (PyDict_SetItemString(dict, "atomic_types", atomic_types) < 0) {
+        Py_DECREF(atomic_types);
+        goto error;
+    }
+    Py_DECREF(atomic_types);
+
     return dict;
 
 error:
@@ -574,6 +829,49 @@ error:
     return NULL;
 }
 
+static PyObject* py_get_config(PyObject* self, PyObject* noargs) {
+    (void)noargs;
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* dict = py_get_config_impl();
+    copium_leave(outer);
+    return dict;
+}
+
+/* ========================================================================== */
+/*                         Statistics                                         */
+/* ========================================================================== */
+
+static PyObject* py_stats(
+    PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
+) {
+    (void)self;
+
+    if (UNLIKELY(nargs > 0)) {
+        PyErr_SetString(PyExc_TypeError, "stats() takes no positional arguments");
+        return NULL;
+    }
+
+    int reset = 0;
+    Py_ssize_t kwcount = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    for (Py_ssize_t i = 0; i < kwcount; i++) {
+        PyObject* name = PyTuple_GET_ITEM(kwnames, i);
+        if (PyUnicode_CompareWithASCIIString(name, "reset") != 0) {
+            PyErr_Format(PyExc_TypeError, "stats() got an unexpected keyword argument '%U'", name);
+            return NULL;
+        }
+        reset = PyObject_IsTrue(args[i]);
+        if (reset < 0)
+            return NULL;
+    }
+
+#if COPIUM_STATS
+    return stats_collect(reset);
+#else
+    PyErr_SetString(PyExc_RuntimeError, "stats() needs copium built with COPIUM_STATS=1");
+    return NULL;
+#endif
+}
+
 /* ========================================================================== */
 /*                         Module Definition                                  */
 /* ========================================================================== */
@@ -592,22 +890,33 @@ static PyMethodDef main_methods[] = {
      (PyCFunction)(void*)py_deepcopy,
      METH_FASTCALL | METH_KEYWORDS,
      PyDoc_STR(
-         "deepcopy(x, memo=None, /)\n--\n\n"
+         "deepcopy(x, memo=None, /, *, share=None)\n--\n\n"
          "Return a deep copy of obj.\n\n"
          ":param x: object to deepcopy\n"
          ":param memo: treat as opaque.\n"
+         ":param share: a type or types whose instances are shared rather than copied during\n"
+         "    this call. Exact types only; list, tuple, dict, set and frozenset can't be shared.\n"
          ":return: deep copy of the `x`."
      )},
     {"configure",
      (PyCFunction)(void*)py_configure,
      METH_FASTCALL | METH_KEYWORDS,
      PyDoc_STR(
-         "configure(*, memo=None, on_incompatible=None, suppress_warnings=None)\n--\n\n"
+         "configure(*, memo=None, on_incompatible=None, suppress_warnings=None, "
+         "memo_retention=None, slow_copy_threshold_us=None, slow_copy_sample=None, "
+         "slow_copy_callback=None, atomic_types=None)\n--\n\n"
          "Configure copium behavior.\n\n"
          "Called with no arguments, resets to environment variable defaults.\n\n"
          ":param memo: 'native' (fast, default) or 'dict' (compatible).\n"
          ":param on_incompatible: 'warn' (default), 'raise', or 'silent'.\n"
-         ":param suppress_warnings: sequence of error strings to suppress, or None to clear."
+         ":param suppress_warnings: sequence of error strings to suppress, or None to clear.\n"
+         ":param memo_retention: 'adaptive' (default), 'fixed', or 'minimal'.\n"
+         ":param slow_copy_threshold_us: report deepcopy() calls taking at least this long.\n"
+         ":param slow_copy_sample: also report every nth call on a thread; 0 for none.\n"
+         ":param slow_copy_callback: called with a dict describing each reported call, or None\n"
+         "    to stop timing calls.\n"
+         ":param atomic_types: a type or types whose instances deepcopy() shares rather than\n"
+         "    copies, or None to clear. Exact types only."
      )},
     {"get_config",
      (PyCFunction)py_get_config,
@@ -616,6 +925,16 @@ static PyMethodDef main_methods[] = {
          "get_config()\n--\n\n"
          "Return the current configuration as a dict."
      )},
+    {"stats",
+     (PyCFunction)(void*)py_stats,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR(
+         "stats(*, reset=False)\n--\n\n"
+         "Return how many objects took each deepcopy route, summed over all threads.\n\n"
+         "'reduce_types' maps the types that went through the reduce protocol to their counts.\n"
+         "Only available when built with COPIUM_STATS=1; raises RuntimeError otherwise.\n\n"
+         ":param reset: zero the counters after reading them."
+     )},
 #if PY_VERSION_HEX >= 0x030D0000
     {"replace",
      (PyCFunction)(void*)py_replace,
@@ -633,21 +952,37 @@ static int copium_exec(PyObject* module);
 static struct PyModuleDef_Slot main_slots[] = {
 #ifdef Py_GIL_DISABLED
     {Py_mod_gil, Py_MOD_GIL_NOT_USED},
+#endif
+#if PY_VERSION_HEX >= PY_VERSION_3_12_HEX
+    {Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED},
 #endif
     {Py_mod_exec, copium_exec},
     {0, NULL}
 };
 
+static int copium_module_traverse(PyObject* module, visitproc visit, void* arg) {
+    return copium_state_traverse(copium_module_state(module), visit, arg);
+}
+
+static int copium_module_clear(PyObject* module) {
+    copium_state_clear(copium_module_state(module));
+    return 0;
+}
+
+static void copium_module_free(void* module) {
+    copium_state_free(copium_module_state((PyObject*)module));
+}
+
 static struct PyModuleDef main_module_def = {
     PyModuleDef_HEAD_INIT,
     "ccopium",
     "Fast, full-native deepcopy with reduce protocol and keepalive memo.",
-    0,
+    sizeof(ModuleState),
     main_methods,
     main_slots,
-    NULL,
-    NULL,
-    NULL
+    copium_module_traverse,
+    copium_module_clear,
+    copium_module_free
 };
 
 /* ========================================================================== */
@@ -705,6 +1040,26 @@ static int _add_submodule(PyObject* parent, const char* name, PyObject* submodul
     return 0;
 }
 
+/**
+ * Add functions to a submodule, bound to the main module: they run with its state, like the
+ * main module's own.
+ */
+static int _add_functions(PyObject* submodule, PyMethodDef* defs, PyObject* module) {
+    PyObject* name = PyModule_GetNameObject(submodule);
+    if (!name)
+        return -1;
+    for (PyMethodDef* def = defs; def->ml_name; def++) {
+        PyObject* func = PyCFunction_NewEx(def, module, name);
+        if (!func || PyModule_AddObject(submodule, def->ml_name, func) < 0) {
+            Py_XDECREF(func);
+            Py_DECREF(name);
+            return -1;
+        }
+    }
+    Py_DECREF(name);
+    return 0;
+}
+
 /* ========================================================================== */
 /*                         Module Initialization                              */
 /* ========================================================================== */
@@ -713,18 +1068,23 @@ PyMODINIT_FUNC PyInit_ccopium(void) {
     return PyModuleDef_Init(&main_module_def);
 }
 
-static int copium_exec(PyObject* module) {
+static int copium_exec_impl(PyObject* module) {
     /* Initialize internal state */
     if (_copium_init(module) < 0)
         return -1;
 
     /* Create and attach extra submodule */
     PyObject* extra_module = PyModule_Create(&extra_module_def);
+    if (extra_module && (_add_functions(extra_module, extra_methods, module) < 0 ||
+                         extra_module_exec(extra_module, module) < 0))
+        Py_CLEAR(extra_module);
     if (_add_submodule(module, "extra", extra_module) < 0)
         return -1;
 
     /* Create and attach patch submodule */
     PyObject* patch_module = PyModule_Create(&patch_module_def);
+    if (patch_module && _add_functions(patch_module, patch_methods, module) < 0)
+        Py_CLEAR(patch_module);
     if (_add_submodule(module, "patch", patch_module) < 0)
         return -1;
 
@@ -734,3 +1094,14 @@ static int copium_exec(PyObject* module) {
 
     return 0;
 }
+
+static int copium_exec(PyObject* module) {
+    ModuleState* state = copium_module_state(module);
+    state->interp_id = PyInterpreterState_GetID(PyInterpreterState_Get());
+    ModuleState* outer = copium_enter(state);
+    int status = copium_exec_impl(module);
+    if (status < 0)
+        copium_state_clear(state);
+    copium_leave(outer);
+    return status;
+}
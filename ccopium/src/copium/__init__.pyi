@@ -1,10 +1,10 @@
 import sys
 from copy import Error
-from typing import Any, Literal, Sequence, TypeVar, overload, TypedDict
+from typing import Any, Callable, Iterable, Literal, Sequence, TypeVar, overload, TypedDict
 
 from copium import patch
 
-__all__ = ["copy", "deepcopy", "Error", "configure", "get_config", "patch"]
+__all__ = ["copy", "deepcopy", "Error", "configure", "get_config", "stats", "patch"]
 
 T = TypeVar("T")
 
@@ -16,15 +16,30 @@ def copy(x: T) -> T:
     :return: shallow copy of the `x`.
     """
 
-def deepcopy(x: T, memo: dict[int, Any] | None = None) -> T:
+def deepcopy(
+    x: T, memo: dict[int, Any] | None = None, *, share: type | Iterable[type] | None = None
+) -> T:
     """
     Natively compiled deepcopy.
 
     :param x: object to deepcopy
     :param memo: treat as opaque.
+    :param share: types whose instances are shared rather than copied during this call,
+        on top of the configured atomic_types. Exact types only.
     :return: deep copy of the `x`.
     """
 
+def stats(*, reset: bool = False) -> dict[str, Any]:
+    """
+    Return how many objects took each deepcopy route, summed over all threads.
+
+    Only available when copium is built with per-route counters; raises RuntimeError otherwise.
+
+    :param reset: zero the counters after reading them.
+    :return: counter name to count; 'reduce_types' maps types that went through
+        the reduce protocol to their counts.
+    """
+
 if sys.version_info >= (3, 13):
     def replace(obj: T, /, **changes: Any) -> T:
         """
@@ -61,6 +76,11 @@ def configure(
     memo: Literal["native"] = ...,
     on_incompatible: Literal["warn", "raise", "silent"] = ...,
     suppress_warnings: Sequence[str] | None = ...,
+    memo_retention: Literal["adaptive", "fixed", "minimal"] = ...,
+    slow_copy_threshold_us: float | None = ...,
+    slow_copy_sample: int = ...,
+    slow_copy_callback: Callable[[_SlowCopyReport], object] | None = ...,
+    atomic_types: type | Iterable[type] | None = ...,
 ) -> None:
     """
     Configure copium behavior. Only specified arguments are changed.
@@ -73,12 +93,38 @@ def configure(
         Only relevant when memo='native'.
     :param suppress_warnings: Error strings to suppress warnings for.
         None clears the list.
+    :param memo_retention: What each thread's reusable memo keeps allocated between calls.
+        'adaptive' keeps capacity that recent calls actually used (default).
+        'fixed' shrinks anything past fixed caps (128Ki table slots, 8Ki keepalive items).
+        'minimal' releases everything after every call.
+    :param slow_copy_threshold_us: Report deepcopy() calls that take at least this long,
+        whatever memo they copy with. A call made while another one on the thread is timed,
+        from a __deepcopy__ say, is part of that one. None stops reporting calls for being slow.
+    :param slow_copy_sample: Also report every nth call on each thread; 0 for none.
+    :param slow_copy_callback: Called with a dict describing each reported call.
+        None stops timing calls altogether. Exceptions it raises are unraisable.
+    :param atomic_types: Types whose instances deepcopy() returns as is, like ints and strs.
+        Exact types only; None clears them.
     """
 
+class _SlowCopyReport(TypedDict, total=True):
+    callsite: tuple[str, int, str, str] | None
+    elapsed_us: float
+    python_us: float  # in the reduce and __deepcopy__ routes
+    native_us: float
+    nodes: int  # objects copied rather than returned as is
+    memo_size: int  # both are 0 with a memo that's neither a dict nor copium's own
+    sampled: bool
+
 class _CopiumConfig(TypedDict, total=True):
     memo: Literal["native", "dict"]
     on_incompatible: Literal["warn", "raise", "silent"]
     suppress_warnings: tuple[str, ...]
+    memo_retention: Literal["adaptive", "fixed", "minimal"]
+    slow_copy_threshold_us: float | None
+    slow_copy_sample: int
+    slow_copy_callback: Callable[[_SlowCopyReport], object] | None
+    atomic_types: tuple[type, ...]
 
 def get_config() -> _CopiumConfig:
     """
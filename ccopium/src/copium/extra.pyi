@@ -1,10 +1,55 @@
 from typing import Callable
+from typing import Generic
+from typing import Iterator
 from typing import TypeVar
+from typing import final
+from typing import overload
 
-__all__ = ["repeatcall", "replicate"]
+__all__ = [
+    "Plan",
+    "Replicator",
+    "Snapshotter",
+    "compile",
+    "copy_into",
+    "ireplicate",
+    "parallel_deepcopy",
+    "repeatcall",
+    "replicate",
+]
 
 T = TypeVar("T")
 
+@final
+class Plan(Generic[T]):
+    """Copy plan produced by compile()."""
+
+@final
+class Replicator(Iterator[T]):
+    """Iterator over deep copies made by ireplicate()."""
+
+    def __next__(self) -> T: ...
+    def __length_hint__(self) -> int: ...
+
+@final
+class Snapshotter(Generic[T]):
+    """
+    Takes deep copies of root that share whatever didn't change between them.
+
+    Dicts in root are watched for changes. snapshot() copies again only the dicts
+    that changed, or that hold a changed dict, and reuses the previous copies of
+    the others. Lists, tuples and other objects can't be watched and are copied
+    again every time, along with the dicts holding them. Snapshots share
+    structure, so they must not be mutated. Before Python 3.12 and on
+    free-threaded builds, every snapshot is a full deepcopy(root).
+    """
+
+    def __init__(self, root: T) -> None: ...
+    @property
+    def root(self) -> T:
+        """The object snapshots are taken of."""
+    def snapshot(self) -> T:
+        """Deep copy root, reusing the copies of its dicts that didn't change since the previous snapshot."""
+
 def repeatcall(function: Callable[[], T], size: int, /) -> list[T]:
     """
     Call function repeatedly size times and return the list of results.
@@ -12,9 +57,55 @@ def repeatcall(function: Callable[[], T], size: int, /) -> list[T]:
     Equivalent of [function() for _ in range(size)], but faster.
     """
 
+@overload
+def replicate(obj: Plan[T], /, n: int) -> list[T]: ...
+@overload
 def replicate(obj: T, /, n: int) -> list[T]:
     """
     Returns n copies of the object in a list.
 
     Equivalent of [deepcopy(obj) for _ in range(n)], but faster.
+    If obj is a plan returned by compile(), the plan is run n times instead.
+    """
+
+@overload
+def ireplicate(obj: Plan[T], /, n: int | None = None) -> Replicator[T]: ...
+@overload
+def ireplicate(obj: T, /, n: int | None = None) -> Replicator[T]:
+    """
+    Returns an iterator over n deep copies of the object, or over copies without end if n is None.
+
+    Each copy is made when it's asked for, so only the ones still referenced
+    take memory. Equivalent of (deepcopy(obj) for _ in range(n)), but faster.
+    If obj is a plan returned by compile(), each step runs the plan instead.
+    """
+
+def compile(obj: T, /) -> Plan[T]:  # noqa: A001
+    """
+    Walk obj once and return a plan that replicate() turns into deep copies of it.
+
+    Builtin containers and atomic leaves are laid out ahead of time, so running
+    the plan skips type dispatch and, unless obj holds other objects, the memo.
+    obj must not be mutated while the plan is in use.
+    """
+
+def parallel_deepcopy(obj: T, /, workers: int | None = None) -> T:
+    """
+    Deep copy obj, splitting the items of a large top-level list, tuple or dict between worker threads.
+
+    The workers share one memo, so objects referenced from several chunks and
+    cycles between them still get a single copy. Only free-threaded builds copy
+    in parallel; elsewhere, and for objects too small to be worth it, this is
+    deepcopy(obj). workers defaults to os.process_cpu_count().
+    """
+
+def copy_into(dst: T, src: T, /) -> T:
+    """
+    Make dst a deep copy of src, reusing the lists and dicts it already has, and return it.
+
+    Wherever dst holds a list or dict of the same exact type as src at the same
+    place, its contents are overwritten in place; everything else is deep copied
+    anew. If dst itself can't be reused, a new deep copy of src is returned. dst
+    must not share containers with src, and is left half updated if the copy
+    fails.
     """
@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+/*
+ * copium C API, exported as the `_C_API` capsule of the copium module.
+ *
+ * Lets extension types tell copium how their instances are deep-copied, without going through
+ * a Python-level __deepcopy__: either as atomic (returned as is), or by a C copier that gets
+ * the original and an opaque memo context to copy its parts with.
+ *
+ *     static CopiumCAPI* copium;
+ *
+ *     static PyObject* point_deepcopy(PyObject* obj, void* memo_ctx) {
+ *         PyObject* label = copium->deepcopy(((Point*)obj)->label, memo_ctx);
+ *         if (!label)
+ *             return NULL;
+ *         return Point_New(((Point*)obj)->x, ((Point*)obj)->y, label);  // steals label
+ *     }
+ *
+ *     copium = CopiumCAPI_Import();
+ *     if (!copium || copium->register_copier(&Point_Type, point_deepcopy) < 0)
+ *         return -1;
+ *
+ * Registrations are per exact type, and take precedence over __deepcopy__ and the reduce
+ * protocol. Exact builtin containers and the types copium always treats as atomic can't be
+ * registered: copium gets to those first. Registrations apply to deepcopy() with copium's own
+ * memo; one given a dict memo (or configured with memo="dict") copies as before.
+ *
+ * A copier returns a new reference, or NULL with an exception set. What it returns is memoized
+ * for obj once it's done; a copier whose parts may refer back to obj has to memoize the copy
+ * itself before copying them. memo_ctx is only valid for the duration of the call.
+ *
+ * A type exporting a buffer of plain values, e.g. ndarray, can be registered with an allocator
+ * instead. It gets obj and its buffer, and returns a new instance of the same shape; copium
+ * fills that one in with a memcpy of the buffer. That's only for buffers that are C-contiguous
+ * and hold no objects (no 'O' in their format): other instances are copied as if the type
+ * weren't registered.
+ */
+
+#ifndef COPIUM_CAPI_H
+#define COPIUM_CAPI_H
+
+#include <Python.h>
+
+#define COPIUM_CAPI_VERSION 2
+
+typedef PyObject* (*copium_copyfunc)(PyObject* obj, void* memo_ctx);
+// A new reference whose buffer is as large as view, NULL on error. view is obj's.
+typedef PyObject* (*copium_bufferallocfunc)(PyObject* obj, Py_buffer* view);
+
+typedef struct {
+    // COPIUM_CAPI_VERSION of the copium that filled this in. Fields are only ever appended.
+    int version;
+
+    // 0 on success, -1 with an exception set. Registering a type again replaces its entry.
+    int (*register_atomic)(PyTypeObject* tp);
+    int (*register_copier)(PyTypeObject* tp, copium_copyfunc copier);
+    // 1 if tp was registered, 0 if it wasn't, -1 with an exception set.
+    int (*unregister)(PyTypeObject* tp);
+
+    // For copiers, with the memo_ctx they were given.
+    PyObject* (*deepcopy)(PyObject* obj, void* memo_ctx);  // new reference, NULL on error
+    int (*memoize)(void* memo_ctx, PyObject* original, PyObject* copy);  // 0, or -1 on error
+    PyObject* (*recall)(void* memo_ctx, PyObject* original);  // new reference, NULL if not copied
+
+    // Since version 2. 0 on success, -1 with an exception set.
+    int (*register_buffer)(PyTypeObject* tp, copium_bufferallocfunc alloc);
+} CopiumCAPI;
+
+// copium is built as either the copium or the ccopium module.
+static inline CopiumCAPI* CopiumCAPI_Import(void) {
+    CopiumCAPI* api = (CopiumCAPI*)PyCapsule_Import("copium._C_API", 0);
+    if (!api && PyErr_ExceptionMatches(PyExc_ImportError)) {
+        PyErr_Clear();
+        api = (CopiumCAPI*)PyCapsule_Import("ccopium._C_API", 0);
+    }
+    if (api && api->version < COPIUM_CAPI_VERSION) {
+        PyErr_Format(
+            PyExc_ImportError,
+            "copium C API version %d is older than the %d this module was built for",
+            api->version,
+            COPIUM_CAPI_VERSION
+        );
+        return NULL;
+    }
+    return api;
+}
+
+#endif  // COPIUM_CAPI_H
@@ -9,7 +9,11 @@
  *
  * Batch copying utilities:
  *   - replicate(obj, n) - create n deep copies
+ *   - ireplicate(obj, n=None) - iterate over n deep copies, made one at a time
  *   - repeatcall(fn, n) - call fn() n times, collect results
+ *   - compile(obj)      - precompute a copy plan that replicate() can run
+ *   - parallel_deepcopy(obj, workers=None) - deepcopy over several threads (free-threaded only)
+ *   - copy_into(dst, src) - deepcopy src into the containers dst already has
  */
 #ifndef COPIUM_EXTRA_C
 #define COPIUM_EXTRA_C
@@ -20,10 +24,18 @@
 #include "_memo.c"
 #include "_deepcopy.c"
 #include "_extra.c"
+#include "_plan.c"
+#include "_replicator.c"
+#include "_parallel.c"
+#include "_snapshot.c"
+#include "_copy_into.c"
 
-PyObject* py_replicate(PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
-    (void)self;
+// Below this, compiling costs more than the batch build saves.
+#ifndef REPLICATE_BATCH_MIN
+    #define REPLICATE_BATCH_MIN 3
+#endif
 
+static PyObject* py_replicate_impl(PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
     if (UNLIKELY(nargs != 2)) {
         PyErr_SetString(PyExc_TypeError, "replicate(obj, n, /)");
         return NULL;
@@ -45,6 +57,9 @@ PyObject* py_replicate(PyObject* self, PyObject* const* args, Py_ssize_t nargs,
         return NULL;
     }
 
+    if (Py_IS_TYPE(obj, module_state.Plan_Type))
+        return plan_replicate((PlanObject*)obj, n);
+
     if (n == 0)
         return PyList_New(0);
 
@@ -64,6 +79,22 @@ PyObject* py_replicate(PyObject* self, PyObject* const* args, Py_ssize_t nargs,
         }
     }
 
+    if (n >= REPLICATE_BATCH_MIN) {
+        // Plain data: walk obj once, then build all n copies side by side.
+        PyObject* plan = plan_compile_ex(obj, 1);
+        if (plan) {
+            PyObject* out = plan_replicate((PlanObject*)plan, n);
+            Py_DECREF(plan);
+            return out;
+        }
+        if (PyErr_Occurred()) {
+            // deepcopy's own guard goes deeper than the interpreter's recursion limit.
+            if (!PyErr_ExceptionMatches(PyExc_RecursionError))
+                return NULL;
+            PyErr_Clear();
+        }
+    }
+
     {
         PyObject* out = PyList_New(n);
         if (!out)
@@ -96,6 +127,53 @@ PyObject* py_replicate(PyObject* self, PyObject* const* args, Py_ssize_t nargs,
     }
 }
 
+PyObject* py_replicate(PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* result = py_replicate_impl(args, nargs, kwnames);
+    copium_leave(outer);
+    return result;
+}
+
+static PyObject* py_ireplicate_impl(PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
+    PyObject* n_arg = nargs == 2 ? args[1] : Py_None;
+    Py_ssize_t kwcount = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    if (UNLIKELY(nargs < 1 || nargs > 2 || nargs + kwcount > 2)) {
+        PyErr_SetString(PyExc_TypeError, "ireplicate(obj, /, n=None)");
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < kwcount; i++) {
+        PyObject* name = PyTuple_GET_ITEM(kwnames, i);
+        if (PyUnicode_CompareWithASCIIString(name, "n") != 0) {
+            PyErr_Format(
+                PyExc_TypeError, "ireplicate() got an unexpected keyword argument '%U'", name
+            );
+            return NULL;
+        }
+        n_arg = args[nargs + i];
+    }
+
+    Py_ssize_t n = -1;
+    if (n_arg != Py_None) {
+        n = PyLong_AsSsize_t(n_arg);
+        if (n == -1 && PyErr_Occurred())
+            return NULL;
+        if (n < 0) {
+            PyErr_SetString(PyExc_ValueError, "n must be >= 0");
+            return NULL;
+        }
+    }
+    return replicator_new(args[0], n);
+}
+
+PyObject* py_ireplicate(
+    PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
+) {
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* result = py_ireplicate_impl(args, nargs, kwnames);
+    copium_leave(outer);
+    return result;
+}
+
 PyObject* py_repeatcall(
     PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
 ) {
@@ -127,6 +205,102 @@ PyObject* py_repeatcall(
     return build_list_by_calling_noargs(func, n);
 }
 
+PyObject* py_compile(PyObject* self, PyObject* obj) {
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* plan = plan_compile(obj);
+    copium_leave(outer);
+    return plan;
+}
+
+static Py_ssize_t parallel_default_workers(void) {
+    PyObject* os = PyImport_ImportModule("os");
+    if (!os)
+        return -1;
+    PyObject* count = PyObject_CallMethod(os, "process_cpu_count", NULL);
+    if (!count && PyErr_ExceptionMatches(PyExc_AttributeError)) {
+        PyErr_Clear();
+        count = PyObject_CallMethod(os, "cpu_count", NULL);
+    }
+    Py_DECREF(os);
+    if (!count)
+        return -1;
+    Py_ssize_t workers = count == Py_None ? 1 : PyLong_AsSsize_t(count);
+    Py_DECREF(count);
+    return workers;
+}
+
+static PyObject* py_parallel_deepcopy_impl(
+    PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
+) {
+    PyObject* workers_arg = nargs == 2 ? args[1] : Py_None;
+    Py_ssize_t kwcount = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    if (UNLIKELY(nargs < 1 || nargs > 2 || nargs + kwcount > 2)) {
+        PyErr_SetString(PyExc_TypeError, "parallel_deepcopy(obj, /, workers=None)");
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < kwcount; i++) {
+        PyObject* name = PyTuple_GET_ITEM(kwnames, i);
+        if (PyUnicode_CompareWithASCIIString(name, "workers") != 0) {
+            PyErr_Format(
+                PyExc_TypeError,
+                "parallel_deepcopy() got an unexpected keyword argument '%U'",
+                name
+            );
+            return NULL;
+        }
+        workers_arg = args[nargs + i];
+    }
+
+    PyObject* obj = args[0];
+
+    Py_ssize_t workers;
+    if (workers_arg == Py_None) {
+        workers = parallel_default_workers();
+    } else {
+        workers = PyLong_AsSsize_t(workers_arg);
+        if (workers < 1 && !PyErr_Occurred()) {
+            PyErr_SetString(PyExc_ValueError, "workers must be >= 1");
+            return NULL;
+        }
+    }
+    if (workers < 0)
+        return NULL;
+
+#if COPIUM_PARALLEL_DEEPCOPY
+    PyObject* result = parallel_deepcopy(obj, workers);
+    if (result || PyErr_Occurred())
+        return result;
+#endif
+
+    int is_tss;
+    PyMemoObject* memo = get_memo(&is_tss);
+    if (!memo)
+        return NULL;
+    PyObject* copied = deepcopy(obj, memo);
+    cleanup_memo(memo, is_tss);
+    return copied;
+}
+
+PyObject* py_parallel_deepcopy(
+    PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames
+) {
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* result = py_parallel_deepcopy_impl(args, nargs, kwnames);
+    copium_leave(outer);
+    return result;
+}
+
+PyObject* py_copy_into(PyObject* self, PyObject* const* args, Py_ssize_t nargs, PyObject* kwnames) {
+    if (UNLIKELY(nargs != 2 || (kwnames && PyTuple_GET_SIZE(kwnames) > 0))) {
+        PyErr_SetString(PyExc_TypeError, "copy_into(dst, src, /)");
+        return NULL;
+    }
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* result = copy_into_root(args[0], args[1]);
+    copium_leave(outer);
+    return result;
+}
+
 /* ------------------------------------------------------------------------- */
 
 static PyMethodDef extra_methods[] = {
@@ -136,7 +310,52 @@ static PyMethodDef extra_methods[] = {
      PyDoc_STR(
          "replicate(obj, n, /)\n--\n\n"
          "Returns n deep copies of the object in a list.\n\n"
-         "Equivalent of [deepcopy(obj) for _ in range(n)], but faster."
+         "Equivalent of [deepcopy(obj) for _ in range(n)], but faster.\n"
+         "If obj is a plan returned by compile(), the plan is run n times instead."
+     )},
+    {"ireplicate",
+     (PyCFunction)(void*)py_ireplicate,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR(
+         "ireplicate(obj, /, n=None)\n--\n\n"
+         "Returns an iterator over n deep copies of the object, or over copies without end if n\n"
+         "is None.\n\n"
+         "Each copy is made when it's asked for, so only the ones still referenced take memory.\n"
+         "Equivalent of (deepcopy(obj) for _ in range(n)), but faster. If obj is a plan returned\n"
+         "by compile(), each step runs the plan instead."
+     )},
+    {"compile",
+     (PyCFunction)py_compile,
+     METH_O,
+     PyDoc_STR(
+         "compile(obj, /)\n--\n\n"
+         "Walk obj once and return a plan that replicate() turns into deep copies of it.\n\n"
+         "Builtin containers and atomic leaves are laid out ahead of time, so running the plan\n"
+         "skips type dispatch and, unless obj holds other objects, the memo. obj must not be\n"
+         "mutated while the plan is in use."
+     )},
+    {"parallel_deepcopy",
+     (PyCFunction)(void*)py_parallel_deepcopy,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR(
+         "parallel_deepcopy(obj, /, workers=None)\n--\n\n"
+         "Deep copy obj, splitting the items of a large top-level list, tuple or dict between\n"
+         "worker threads.\n\n"
+         "The workers share one memo, so objects referenced from several chunks and cycles\n"
+         "between them still get a single copy. Only free-threaded builds copy in parallel;\n"
+         "elsewhere, and for objects too small to be worth it, this is deepcopy(obj).\n"
+         "workers defaults to os.process_cpu_count()."
+     )},
+    {"copy_into",
+     (PyCFunction)(void*)py_copy_into,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR(
+         "copy_into(dst, src, /)\n--\n\n"
+         "Make dst a deep copy of src, reusing the lists and dicts it already has, and return it.\n\n"
+         "Wherever dst holds a list or dict of the same exact type as src at the same place, its\n"
+         "contents are overwritten in place; everything else is deep copied anew. If dst itself\n"
+         "can't be reused, a new deep copy of src is returned. dst must not share containers\n"
+         "with src, and is left half updated if the copy fails."
      )},
     {"repeatcall",
      (PyCFunction)(void*)py_repeatcall,
@@ -153,12 +372,24 @@ static struct PyModuleDef extra_module_def = {
     PyModuleDef_HEAD_INIT,
     "copium.extra",
     "Batch copying utilities for copium.",
-    -1,
-    extra_methods,
+    0,
+    NULL,
     NULL,
     NULL,
     NULL,
     NULL
 };
 
+// Types of the submodule belong to main, the module whose state is entered.
+static int extra_module_exec(PyObject* module, PyObject* main) {
+    if (plan_make_type(main) < 0 || replicator_make_type(main) < 0 ||
+        snapshot_make_types(main) < 0)
+        return -1;
+    if (PyModule_AddObjectRef(module, "Plan", (PyObject*)module_state.Plan_Type) < 0)
+        return -1;
+    if (PyModule_AddObjectRef(module, "Replicator", (PyObject*)module_state.Replicator_Type) < 0)
+        return -1;
+    return PyModule_AddObjectRef(module, "Snapshotter", (PyObject*)module_state.Snapshotter_Type);
+}
+
 #endif /* COPIUM_EXTRA_C */
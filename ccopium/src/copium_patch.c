@@ -38,7 +38,7 @@ static PyFunctionObject* _get_stdlib_deepcopy(void) {
 }
 
 static PyObject* _get_copium_deepcopy(void) {
-    PyObject* copium = PyImport_ImportModule("copium");
+    PyObject* copium = PyImport_ImportModule("ccopium");
     if (!copium)
         return NULL;
 
@@ -47,10 +47,7 @@ static PyObject* _get_copium_deepcopy(void) {
     return func;
 }
 
-static PyObject* py_enable(PyObject* self, PyObject* noargs) {
-    (void)self;
-    (void)noargs;
-
+static PyObject* py_enable_impl(void) {
     PyFunctionObject* stdlib_deepcopy = _get_stdlib_deepcopy();
     if (!stdlib_deepcopy)
         return NULL;
@@ -81,6 +78,15 @@ static PyObject* py_enable(PyObject* self, PyObject* noargs) {
     Py_RETURN_TRUE;
 }
 
+// Before 3.12, patching builds its code from a template kept in the state.
+static PyObject* py_enable(PyObject* self, PyObject* noargs) {
+    (void)noargs;
+    ModuleState* outer = copium_enter(copium_module_state(self));
+    PyObject* result = py_enable_impl();
+    copium_leave(outer);
+    return result;
+}
+
 static PyObject* py_disable(PyObject* self, PyObject* noargs) {
     (void)self;
     (void)noargs;
@@ -156,8 +162,8 @@ static struct PyModuleDef patch_module_def = {
     PyModuleDef_HEAD_INIT,
     "copium.patch",
     "Patching utilities for stdlib copy module.",
-    -1,
-    patch_methods,
+    0,
+    NULL,
     NULL,
     NULL,
     NULL,
@@ -30,6 +30,7 @@ Build hash / fingerprint strategy:
     * pyproject.toml
     * This backend file
     * _copium.pth (if present)
+    * _ccopium_autopatch.py, copied from wheel-data/platlib/_copium_autopatch.py first
     * Selected environment details and build command (config_settings)
 - Used as:
     * Cache key for wheels and metadata
@@ -286,6 +287,20 @@ def _fast_copy_tree(src: Path, dst: Path) -> None:
     shutil.copytree(src, dst, copy_function=copy_function)
 
 
+def _copy_autopatch() -> None:
+    """Copy the autopatch module next to _ccopium.pth, it's shared with the Rust build.
+
+    An sdist already carries the copy and has no repository around it.
+    """
+    shared = REPOSITORY_ROOT / "wheel-data" / "platlib" / "_copium_autopatch.py"
+    copied = PROJECT_ROOT / "src" / "_ccopium_autopatch.py"
+    if not shared.exists():
+        return
+    if copied.exists() and copied.read_bytes() == shared.read_bytes():
+        return
+    _fast_copy(shared, copied)
+
+
 # ============================================================================
 # Fingerprinting
 # ============================================================================
@@ -979,6 +994,7 @@ def build_wheel(
     metadata_directory: str | None = None,
 ) -> str:
     """Build a wheel."""
+    _copy_autopatch()
     _ensure_cleanup_once()
 
     if os.environ.get("COPIUM_DISABLE_WHEEL_CACHE") == "1":
@@ -1036,6 +1052,7 @@ def build_wheel(
 
 def build_sdist(sdist_directory: str, config_settings: dict[str, Any] | None = None) -> str:
     """Build a source distribution with version injection."""
+    _copy_autopatch()
     echo("Building sdist...")
     original = _inject_extensions(build_type="sdist", config_settings=config_settings)
     try:
@@ -1050,6 +1067,7 @@ def build_editable(
     metadata_directory: str | None = None,
 ) -> str:
     """Build an editable wheel."""
+    _copy_autopatch()
     _ensure_cleanup_once()
 
     if os.environ.get("COPIUM_DISABLE_WHEEL_CACHE") == "1":
@@ -3,6 +3,7 @@ use std::ffi::CString;
 use std::mem::MaybeUninit;
 use std::os::raw::{c_char, c_int};
 use std::ptr;
+use std::sync::atomic::{AtomicBool, AtomicPtr, Ordering};
 
 use pyo3_ffi::*;
 
@@ -10,6 +11,10 @@ use crate::types::PyObjectPtr;
 
 // ── Slot types ─────────────────────────────────────────────
 
+// Slots are process-wide: every interpreter that imports copium shares them,
+// which is why the module doesn't support a per-interpreter GIL, see
+// MODULE_SLOTS in lib.rs.
+
 #[repr(transparent)]
 pub struct PtrSlot(UnsafeCell<*mut PyObject>);
 unsafe impl Sync for PtrSlot {}
@@ -29,6 +34,15 @@ impl PtrSlot {
             *self.0.get() = val;
         }
     }
+
+    /// Stores `val` unless the slot holds something already. Returns whether it did.
+    pub unsafe fn set_if_null(&self, val: *mut PyObject) -> bool {
+        unsafe {
+            (*(self.0.get() as *const AtomicPtr<PyObject>))
+                .compare_exchange(ptr::null_mut(), val, Ordering::AcqRel, Ordering::Acquire)
+                .is_ok()
+        }
+    }
 }
 
 #[repr(transparent)]
@@ -67,6 +81,15 @@ macro_rules! init_phase {
 
 init_phase!(StrEntry, ObjEntry, CacheEntry);
 
+/// A `py_type!(imported ...)` or `py_obj!(imported ...)` slot, filled by
+/// `resolve_imported` rather than at init.
+pub struct ImportedEntry {
+    pub resolve_fn: unsafe fn() -> bool,
+}
+unsafe impl Sync for ImportedEntry {}
+unsafe impl Send for ImportedEntry {}
+inventory::collect!(ImportedEntry);
+
 // ── Primitives ─────────────────────────────────────────────
 
 pub unsafe fn intern_str(s: *const c_char) -> *mut PyObject {
@@ -170,6 +193,75 @@ pub unsafe fn resolve_path_optional(path: &str) -> *mut PyObject {
     result
 }
 
+// ── Objects of modules copium doesn't import ───────────────
+
+/// Some `imported` slot is still empty.
+static IMPORTED_PENDING: AtomicBool = AtomicBool::new(true);
+
+/// Fills `slot` with `path` ("module.attr..."), if the module has been imported
+/// by now. A module that isn't fully initialized yet, or lacks the attribute,
+/// leaves it empty for a later try. Returns whether the slot is filled.
+pub unsafe fn resolve_imported_into(slot: &PtrSlot, path: &str, is_type: bool) -> bool {
+    unsafe {
+        if !slot.get().is_null() {
+            return true;
+        }
+        let mut segments = path.split('.');
+        let module_name = segments.next().unwrap_or_default();
+        let name = PyUnicode_FromStringAndSize(
+            module_name.as_ptr().cast(),
+            module_name.len() as Py_ssize_t,
+        );
+        let mut cur = if name.is_null() {
+            ptr::null_mut()
+        } else {
+            PyImport_GetModule(name)
+        };
+        name.decref_nullable();
+        for segment in segments {
+            if cur.is_null() {
+                break;
+            }
+            let next = match CString::new(segment) {
+                Ok(segment) => PyObject_GetAttrString(cur, segment.as_ptr()),
+                Err(_) => ptr::null_mut(),
+            };
+            cur.decref();
+            cur = next;
+        }
+        PyErr_Clear();
+        if cur.is_null() || (is_type && PyType_Check(cur) == 0) {
+            cur.decref_nullable();
+            return false;
+        }
+        if !slot.set_if_null(cur) {
+            cur.decref();
+        }
+        true
+    }
+}
+
+/// Fills the `imported` slots whose modules something else has imported since
+/// the last call. Until a slot is filled there can't be instances of its type,
+/// so for them an empty slot is right; call this before classifying a type.
+#[inline(always)]
+pub unsafe fn resolve_imported() {
+    if IMPORTED_PENDING.load(Ordering::Relaxed) {
+        unsafe { resolve_imported_pending() }
+    }
+}
+
+#[cold]
+unsafe fn resolve_imported_pending() {
+    let mut pending = false;
+    for e in inventory::iter::<ImportedEntry> {
+        if !unsafe { (e.resolve_fn)() } {
+            pending = true;
+        }
+    }
+    IMPORTED_PENDING.store(pending, Ordering::Relaxed);
+}
+
 unsafe fn make_globals() -> *mut PyObject {
     unsafe {
         let globals = PyDict_New();
@@ -327,8 +419,29 @@ macro_rules! __py_obj_impl {
     }};
 }
 
+#[doc(hidden)]
+#[macro_export]
+macro_rules! __py_imported_impl {
+    ($is_type:literal, $path:literal) => {{
+        static SLOT: $crate::cache::PtrSlot = $crate::cache::PtrSlot::new();
+
+        unsafe fn __resolve() -> bool {
+            unsafe { $crate::cache::resolve_imported_into(&SLOT, $path, $is_type) }
+        }
+
+        ::inventory::submit! { $crate::cache::ImportedEntry { resolve_fn: __resolve } }
+
+        unsafe { SLOT.get() }
+    }};
+}
+
+/// `py_obj!(imported "module.attr")` is null until `cache::resolve_imported`
+/// finds the module in `sys.modules`; the module is never imported for it.
 #[macro_export]
 macro_rules! py_obj {
+    (imported $path:literal) => {
+        $crate::__py_imported_impl!(false, $path)
+    };
     ($path:literal) => {
         $crate::__py_obj_impl!(required, *mut ::pyo3_ffi::PyObject, $path)
     };
@@ -343,8 +456,13 @@ macro_rules! py_obj {
     };
 }
 
+/// `py_type!(imported "module.Type")` is lazy the way `py_obj!(imported ...)`
+/// is.
 #[macro_export]
 macro_rules! py_type {
+    (imported $path:literal) => {
+        $crate::__py_imported_impl!(true, $path) as *mut ::pyo3_ffi::PyTypeObject
+    };
     ($path:literal) => {{
         static SLOT: $crate::cache::PtrSlot = $crate::cache::PtrSlot::new();
 
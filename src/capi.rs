@@ -0,0 +1,245 @@
+//! The `_C_API` capsule, laid out as `CopiumCAPI` in
+//! `ccopium/src/copium_capi.h`.
+//!
+//! Registered types live in a dict, as `{type: None}` for atomic ones and
+//! `{type: capsule of its copier, or of its buffer allocator}` otherwise.
+//! `classify_route` consults it, so a registration only costs anything when a
+//! type is first classified. Changing it drops the routes cached for the type
+//! by resetting its version tag.
+
+use std::ffi::c_void;
+use std::ptr;
+
+use pyo3_ffi::*;
+
+use crate::deepcopy;
+use crate::memo::{Memo, PyMemoObject};
+use crate::type_cache::Route;
+use crate::types::PyObjectPtr;
+
+pub const CAPI_VERSION: i32 = 2;
+
+pub type CopyFunc = unsafe extern "C" fn(*mut PyObject, *mut c_void) -> *mut PyObject;
+pub type BufferAllocFunc = unsafe extern "C" fn(*mut PyObject, *mut Py_buffer) -> *mut PyObject;
+
+#[repr(C)]
+pub struct CopiumCAPI {
+    pub version: i32,
+    pub register_atomic: unsafe extern "C" fn(*mut PyTypeObject) -> i32,
+    pub register_copier: unsafe extern "C" fn(*mut PyTypeObject, Option<CopyFunc>) -> i32,
+    pub unregister: unsafe extern "C" fn(*mut PyTypeObject) -> i32,
+    pub deepcopy: unsafe extern "C" fn(*mut PyObject, *mut c_void) -> *mut PyObject,
+    pub memoize: unsafe extern "C" fn(*mut c_void, *mut PyObject, *mut PyObject) -> i32,
+    pub recall: unsafe extern "C" fn(*mut c_void, *mut PyObject) -> *mut PyObject,
+    pub register_buffer: unsafe extern "C" fn(*mut PyTypeObject, Option<BufferAllocFunc>) -> i32,
+}
+
+/// Names of the capsules that hold the copiers and buffer allocators in the
+/// registry.
+pub const COPIER_CAPSULE: *const std::ffi::c_char = crate::cstr!("copium.copier");
+pub const BUFFER_CAPSULE: *const std::ffi::c_char = crate::cstr!("copium.buffer");
+
+static mut REGISTERED_TYPES: *mut PyObject = ptr::null_mut();
+
+static mut CAPI: CopiumCAPI = CopiumCAPI {
+    version: CAPI_VERSION,
+    register_atomic,
+    register_copier,
+    unregister,
+    deepcopy: capi_deepcopy,
+    memoize: capi_memoize,
+    recall: capi_recall,
+    register_buffer,
+};
+
+/// The route registered for `cls`, with its copier or buffer allocator capsule
+/// (null for an atomic one), if any. All are `Route::Registered`: the route is
+/// cached for every memo kind, and registrations only apply to copium's own.
+#[inline(always)]
+pub unsafe fn registered_route(cls: *mut PyTypeObject) -> Option<(Route, *mut PyObject)> {
+    unsafe {
+        let registry = REGISTERED_TYPES;
+        if std::hint::likely(registry.is_null() || PyDict_Size(registry) == 0) {
+            return None;
+        }
+        let entry = PyDict_GetItemWithError(registry, cls as *mut PyObject);
+        PyErr_Clear();
+        if entry.is_null() {
+            None
+        } else if entry == Py_None() {
+            Some((Route::Registered, ptr::null_mut()))
+        } else {
+            Some((Route::Registered, entry))
+        }
+    }
+}
+
+/// What `cls` is registered with now, as a new reference, or null.
+#[cfg(Py_GIL_DISABLED)]
+pub unsafe fn registered_entry_ref(cls: *mut PyTypeObject) -> *mut PyObject {
+    unsafe {
+        let mut entry = ptr::null_mut();
+        let registry = REGISTERED_TYPES;
+        if !registry.is_null()
+            && crate::compat::PyDict_GetItemRef(registry, cls as *mut PyObject, &mut entry) < 0
+        {
+            PyErr_Clear();
+        }
+        entry
+    }
+}
+
+/// Whether `deepcopy` handles instances of `cls` before it gets to the
+/// type's route.
+unsafe fn is_reserved(cls: *mut PyTypeObject) -> bool {
+    unsafe {
+        use crate::types::PyTypeObjectPtr;
+        crate::cache::resolve_imported();
+        cls.is_atomic_immutable()
+            || cls == ptr::addr_of_mut!(PyTuple_Type)
+            || cls == ptr::addr_of_mut!(PyList_Type)
+            || cls == ptr::addr_of_mut!(PyDict_Type)
+            || cls == ptr::addr_of_mut!(PySet_Type)
+            || cls == ptr::addr_of_mut!(PyFrozenSet_Type)
+    }
+}
+
+pub unsafe fn invalidate(cls: *mut PyTypeObject) {
+    unsafe {
+        PyType_Modified(cls);
+        // A type without a version tag is never cached: assign it a new one right away.
+        crate::ffi_ext::_PyType_Lookup(cls, crate::py_str!("__deepcopy__"));
+    }
+}
+
+/// Steals `entry`.
+unsafe fn register(cls: *mut PyTypeObject, entry: *mut PyObject) -> i32 {
+    unsafe {
+        if entry.is_null() {
+            return -1;
+        }
+        if is_reserved(cls) {
+            crate::ffi_ext::PyErr_Format(
+                PyExc_TypeError,
+                crate::cstr!("copium copies '%.200s' objects itself"),
+                (*cls).tp_name,
+            );
+            entry.decref();
+            return -1;
+        }
+        let status = PyDict_SetItem(REGISTERED_TYPES, cls as *mut PyObject, entry);
+        entry.decref();
+        if status < 0 {
+            return -1;
+        }
+        invalidate(cls);
+        0
+    }
+}
+
+unsafe extern "C" fn register_atomic(cls: *mut PyTypeObject) -> i32 {
+    unsafe { register(cls, Py_None().newref()) }
+}
+
+unsafe extern "C" fn register_copier(cls: *mut PyTypeObject, copier: Option<CopyFunc>) -> i32 {
+    unsafe {
+        let Some(copier) = copier else {
+            PyErr_SetString(PyExc_ValueError, crate::cstr!("copier must not be NULL"));
+            return -1;
+        };
+        register(
+            cls,
+            PyCapsule_New(copier as *mut c_void, COPIER_CAPSULE, None),
+        )
+    }
+}
+
+unsafe extern "C" fn register_buffer(
+    cls: *mut PyTypeObject,
+    alloc: Option<BufferAllocFunc>,
+) -> i32 {
+    unsafe {
+        let Some(alloc) = alloc else {
+            PyErr_SetString(PyExc_ValueError, crate::cstr!("alloc must not be NULL"));
+            return -1;
+        };
+        let buffer = (*cls).tp_as_buffer;
+        if buffer.is_null() || (*buffer).bf_getbuffer.is_none() {
+            crate::ffi_ext::PyErr_Format(
+                PyExc_TypeError,
+                crate::cstr!("'%.200s' objects don't export a buffer"),
+                (*cls).tp_name,
+            );
+            return -1;
+        }
+        register(
+            cls,
+            PyCapsule_New(alloc as *mut c_void, BUFFER_CAPSULE, None),
+        )
+    }
+}
+
+unsafe extern "C" fn unregister(cls: *mut PyTypeObject) -> i32 {
+    unsafe {
+        let key = cls as *mut PyObject;
+        let found = PyDict_Contains(REGISTERED_TYPES, key);
+        if found <= 0 {
+            return found;
+        }
+        if PyDict_DelItem(REGISTERED_TYPES, key) < 0 {
+            return -1;
+        }
+        invalidate(cls);
+        1
+    }
+}
+
+unsafe extern "C" fn capi_deepcopy(obj: *mut PyObject, memo_ctx: *mut c_void) -> *mut PyObject {
+    unsafe { deepcopy::deepcopy(obj, &mut *(memo_ctx as *mut PyMemoObject)).into_raw() }
+}
+
+unsafe extern "C" fn capi_memoize(
+    memo_ctx: *mut c_void,
+    original: *mut PyObject,
+    copy: *mut PyObject,
+) -> i32 {
+    unsafe {
+        let memo = &mut *(memo_ctx as *mut PyMemoObject);
+        let (probe, found) = memo.recall(original);
+        found.decref_nullable();
+        memo.memoize(original, copy, &probe)
+    }
+}
+
+unsafe extern "C" fn capi_recall(memo_ctx: *mut c_void, original: *mut PyObject) -> *mut PyObject {
+    unsafe { (*(memo_ctx as *mut PyMemoObject)).recall(original).1 }
+}
+
+pub unsafe fn init(module: *mut PyObject) -> i32 {
+    unsafe {
+        REGISTERED_TYPES = PyDict_New();
+        if REGISTERED_TYPES.is_null() {
+            return -1;
+        }
+        let capsule = PyCapsule_New(
+            ptr::addr_of_mut!(CAPI) as *mut c_void,
+            crate::cstr!("copium._C_API"),
+            None,
+        );
+        if capsule.is_null() {
+            return -1;
+        }
+        if PyModule_AddObject(module, crate::cstr!("_C_API"), capsule) < 0 {
+            capsule.decref();
+            return -1;
+        }
+        0
+    }
+}
+
+pub unsafe fn cleanup() {
+    unsafe {
+        REGISTERED_TYPES.decref_nullable();
+        REGISTERED_TYPES = ptr::null_mut();
+    }
+}
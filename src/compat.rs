@@ -69,3 +69,31 @@ pub unsafe fn PyObject_GetOptionalAttr(
 ) -> c_int {
     unsafe { _PyObject_LookupAttr(obj, name, result) }
 }
+
+#[cfg(any(Py_3_13, Py_3_14))]
+extern "C" {
+    pub fn PyDict_GetItemRef(
+        dict: *mut PyObject,
+        key: *mut PyObject,
+        result: *mut *mut PyObject,
+    ) -> c_int;
+}
+
+#[cfg(not(any(Py_3_13, Py_3_14)))]
+#[inline]
+pub unsafe fn PyDict_GetItemRef(
+    dict: *mut PyObject,
+    key: *mut PyObject,
+    result: *mut *mut PyObject,
+) -> c_int {
+    unsafe {
+        let found = PyDict_GetItemWithError(dict, key);
+        if found.is_null() {
+            *result = std::ptr::null_mut();
+            return if PyErr_Occurred().is_null() { 0 } else { -1 };
+        }
+        found.incref();
+        *result = found;
+        1
+    }
+}
@@ -3,7 +3,7 @@ use pyo3::prelude::*;
 use pyo3::types::{PyAny, PyDict};
 use pyo3_ffi::PyObject;
 
-use crate::state::{MemoMode, OnIncompatible, STATE};
+use crate::state::{MemoMode, MemoRetention, OnIncompatible, STATE};
 use crate::types::PyObjectPtr;
 
 // ══════════════════════════════════════════════════════════════
@@ -60,16 +60,133 @@ impl<'py> FromPyObject<'py, 'py> for PyOnIncompatible {
     }
 }
 
+#[derive(Clone, Copy, Debug)]
+enum PyMemoRetention {
+    Adaptive,
+    Fixed,
+    Minimal,
+}
+
+impl<'py> FromPyObject<'py, 'py> for PyMemoRetention {
+    type Error = PyErr;
+
+    fn extract(obj: Borrowed<'_, 'py, PyAny>) -> Result<Self, Self::Error> {
+        let s = obj.extract::<&str>()?;
+        match s {
+            "adaptive" => Ok(Self::Adaptive),
+            "fixed" => Ok(Self::Fixed),
+            "minimal" => Ok(Self::Minimal),
+            other => Err(PyValueError::new_err(format!(
+                "memo_retention must be 'adaptive', 'fixed', or 'minimal', got '{other}'"
+            ))),
+        }
+    }
+}
+
+// slow_copy_threshold_us and slow_copy_callback take None to turn them off,
+// so they tell it apart from omitting them.
+
+#[derive(Clone, Copy, Debug)]
+enum PySlowCopyThreshold {
+    Unchanged,
+    Off,
+    Micros(f64),
+}
+
+impl<'py> FromPyObject<'py, 'py> for PySlowCopyThreshold {
+    type Error = PyErr;
+
+    fn extract(obj: Borrowed<'_, 'py, PyAny>) -> Result<Self, Self::Error> {
+        if obj.is_none() {
+            return Ok(Self::Off);
+        }
+        let us = obj
+            .extract::<f64>()
+            .map_err(|_| PyTypeError::new_err("slow_copy_threshold_us must be a number or None"))?;
+        if !(0.0..9e12).contains(&us) {
+            return Err(PyValueError::new_err(format!(
+                "slow_copy_threshold_us must be a non-negative number, got {us}"
+            )));
+        }
+        Ok(Self::Micros(us))
+    }
+}
+
+enum PySlowCopyCallback {
+    Unchanged,
+    Off,
+    Callback(Py<PyAny>),
+}
+
+impl<'py> FromPyObject<'py, 'py> for PySlowCopyCallback {
+    type Error = PyErr;
+
+    fn extract(obj: Borrowed<'_, 'py, PyAny>) -> Result<Self, Self::Error> {
+        if obj.is_none() {
+            return Ok(Self::Off);
+        }
+        if !obj.is_callable() {
+            return Err(PyTypeError::new_err(
+                "slow_copy_callback must be callable or None",
+            ));
+        }
+        Ok(Self::Callback(obj.to_owned().unbind()))
+    }
+}
+
+// atomic_types too: None clears them.
+
+enum PyAtomicTypes {
+    Unchanged,
+    Off,
+    Types(Py<PyAny>),
+}
+
+impl<'py> FromPyObject<'py, 'py> for PyAtomicTypes {
+    type Error = PyErr;
+
+    fn extract(obj: Borrowed<'_, 'py, PyAny>) -> Result<Self, Self::Error> {
+        if obj.is_none() {
+            return Ok(Self::Off);
+        }
+        Ok(Self::Types(obj.to_owned().unbind()))
+    }
+}
+
 //  copium.config.apply()
 #[pyfunction]
-#[pyo3(signature = (*, memo=None, on_incompatible=None, suppress_warnings=None))]
+#[pyo3(signature = (
+    *,
+    memo=None,
+    on_incompatible=None,
+    suppress_warnings=None,
+    memo_retention=None,
+    slow_copy_threshold_us=PySlowCopyThreshold::Unchanged,
+    slow_copy_sample=None,
+    slow_copy_callback=PySlowCopyCallback::Unchanged,
+    atomic_types=PyAtomicTypes::Unchanged
+))]
+#[allow(clippy::too_many_arguments)]
 fn apply(
     py: Python<'_>,
     memo: Option<PyMemoMode>,
     on_incompatible: Option<PyOnIncompatible>,
     suppress_warnings: Option<Bound<'_, PyAny>>,
+    memo_retention: Option<PyMemoRetention>,
+    slow_copy_threshold_us: PySlowCopyThreshold,
+    slow_copy_sample: Option<isize>,
+    slow_copy_callback: PySlowCopyCallback,
+    atomic_types: PyAtomicTypes,
 ) -> PyResult<()> {
-    if memo.is_none() && on_incompatible.is_none() && suppress_warnings.is_none() {
+    if memo.is_none()
+        && on_incompatible.is_none()
+        && suppress_warnings.is_none()
+        && memo_retention.is_none()
+        && matches!(slow_copy_threshold_us, PySlowCopyThreshold::Unchanged)
+        && slow_copy_sample.is_none()
+        && matches!(slow_copy_callback, PySlowCopyCallback::Unchanged)
+        && matches!(atomic_types, PyAtomicTypes::Unchanged)
+    {
         if unsafe { crate::state::load_config_from_env() } < 0 {
             return Err(PyErr::take(py)
                 .unwrap_or_else(|| PyRuntimeError::new_err("load_config_from_env failed")));
@@ -109,6 +226,65 @@ fn apply(
         }
     }
 
+    if let Some(memo_retention) = memo_retention {
+        unsafe {
+            (*state).memo_retention = match memo_retention {
+                PyMemoRetention::Adaptive => MemoRetention::Adaptive,
+                PyMemoRetention::Fixed => MemoRetention::Fixed,
+                PyMemoRetention::Minimal => MemoRetention::Minimal,
+            };
+        }
+    }
+
+    match slow_copy_threshold_us {
+        PySlowCopyThreshold::Unchanged => {}
+        PySlowCopyThreshold::Off => unsafe { (*state).slow_copy_threshold_ns = -1 },
+        PySlowCopyThreshold::Micros(us) => unsafe {
+            (*state).slow_copy_threshold_ns = (us * 1000.0) as i64;
+        },
+    }
+
+    if let Some(every) = slow_copy_sample {
+        if every < 0 {
+            return Err(PyValueError::new_err(format!(
+                "slow_copy_sample must not be negative, got {every}"
+            )));
+        }
+        unsafe { (*state).slow_copy_sample = every };
+    }
+
+    let new_callback = match slow_copy_callback {
+        PySlowCopyCallback::Unchanged => None,
+        PySlowCopyCallback::Off => Some(std::ptr::null_mut()),
+        PySlowCopyCallback::Callback(callback) => Some(callback.into_ptr()),
+    };
+    if let Some(new_callback) = new_callback {
+        unsafe {
+            let old_callback = (*state).slow_copy_callback;
+            (*state).slow_copy_callback = new_callback;
+            old_callback.decref_nullable();
+        }
+    }
+
+    let new_atomic_types = match atomic_types {
+        PyAtomicTypes::Unchanged => None,
+        PyAtomicTypes::Off => Some(std::ptr::null_mut()),
+        PyAtomicTypes::Types(types) => unsafe {
+            let tuple = crate::shared_types::shared_types_from(
+                types.as_ptr(),
+                crate::cstr!("atomic_types"),
+            );
+            if tuple.is_null() {
+                return Err(PyErr::take(py)
+                    .unwrap_or_else(|| PyRuntimeError::new_err("shared_types_from failed")));
+            }
+            Some(tuple)
+        },
+    };
+    if let Some(new_atomic_types) = new_atomic_types {
+        unsafe { crate::shared_types::set_atomic_types(new_atomic_types) };
+    }
+
     if let Some(suppress_warnings_object) = suppress_warnings {
         unsafe {
             let new_tuple = if suppress_warnings_object.is_none() {
@@ -154,7 +330,12 @@ fn get(py: Python<'_>) -> PyResult<Bound<'_, PyDict>> {
     let state_pointer = std::ptr::addr_of!(STATE);
     let memo_mode = unsafe { (*state_pointer).memo_mode };
     let on_incompatible = unsafe { (*state_pointer).on_incompatible };
+    let memo_retention = unsafe { (*state_pointer).memo_retention };
     let ignored_errors = unsafe { (*state_pointer).ignored_errors };
+    let slow_copy_threshold_ns = unsafe { (*state_pointer).slow_copy_threshold_ns };
+    let slow_copy_sample = unsafe { (*state_pointer).slow_copy_sample };
+    let slow_copy_callback = unsafe { (*state_pointer).slow_copy_callback };
+    let atomic_types = unsafe { (*state_pointer).atomic_types };
     let dict = PyDict::new(py);
 
     dict.set_item(
@@ -184,6 +365,38 @@ fn get(py: Python<'_>) -> PyResult<Bound<'_, PyDict>> {
     let sw_obj = unsafe { Bound::from_owned_ptr(py, sw) }.cast_into::<pyo3::types::PyTuple>()?;
     dict.set_item("suppress_warnings", sw_obj)?;
 
+    dict.set_item(
+        "memo_retention",
+        match memo_retention {
+            MemoRetention::Adaptive => "adaptive",
+            MemoRetention::Fixed => "fixed",
+            MemoRetention::Minimal => "minimal",
+        },
+    )?;
+
+    dict.set_item(
+        "slow_copy_threshold_us",
+        (slow_copy_threshold_ns >= 0).then(|| slow_copy_threshold_ns as f64 / 1000.0),
+    )?;
+    dict.set_item("slow_copy_sample", slow_copy_sample)?;
+    let callback = if slow_copy_callback.is_null() {
+        py.None()
+    } else {
+        unsafe { Bound::from_borrowed_ptr(py, slow_copy_callback) }.unbind()
+    };
+    dict.set_item("slow_copy_callback", callback)?;
+
+    let atomic_types = unsafe {
+        if !atomic_types.is_null() {
+            atomic_types.newref()
+        } else {
+            pyo3_ffi::PyTuple_New(0)
+        }
+    };
+    let atomic_types =
+        unsafe { Bound::from_owned_ptr(py, atomic_types) }.cast_into::<pyo3::types::PyTuple>()?;
+    dict.set_item("atomic_types", atomic_types)?;
+
     Ok(dict)
 }
 
@@ -1,10 +1,10 @@
 import sys
 from copy import Error
-from typing import Any, TypeVar
+from typing import Any, Iterable, TypeVar
 
 from copium import patch, config
 
-__all__ = ["copy", "deepcopy", "Error", "patch", "config"]
+__all__ = ["copy", "deepcopy", "Error", "patch", "config", "stats"]
 
 T = TypeVar("T")
 
@@ -16,15 +16,30 @@ def copy(x: T) -> T:
     :return: shallow copy of the `x`.
     """
 
-def deepcopy(x: T, memo: dict[int, Any] | None = None) -> T:
+def deepcopy(
+    x: T, memo: dict[int, Any] | None = None, *, share: type | Iterable[type] | None = None
+) -> T:
     """
     Natively compiled deepcopy.
 
     :param x: object to deepcopy
     :param memo: treat as opaque.
+    :param share: types whose instances are shared rather than copied during this call,
+        on top of the configured atomic_types. Exact types only.
     :return: deep copy of the `x`.
     """
 
+def stats(*, reset: bool = False) -> dict[str, Any]:
+    """
+    Return how many objects took each deepcopy route, summed over all threads.
+
+    Only available when copium is built with per-route counters; raises RuntimeError otherwise.
+
+    :param reset: zero the counters after reading them.
+    :return: counter name to count; 'reduce_types' maps types that went through
+        the reduce protocol to their counts.
+    """
+
 if sys.version_info >= (3, 13):
     def replace(obj: T, /, **changes: Any) -> T:
         """
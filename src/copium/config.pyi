@@ -1,4 +1,4 @@
-from typing import Literal, Sequence, TypedDict, overload
+from typing import Callable, Iterable, Literal, Sequence, TypedDict, overload
 
 __all__ = ["apply", "get"]
 
@@ -27,6 +27,11 @@ def apply(
     memo: Literal["native"] = ...,
     on_incompatible: Literal["warn", "raise", "silent"] = ...,
     suppress_warnings: Sequence[str] | None = ...,
+    memo_retention: Literal["adaptive", "fixed", "minimal"] = ...,
+    slow_copy_threshold_us: float | None = ...,
+    slow_copy_sample: int = ...,
+    slow_copy_callback: Callable[[_SlowCopyReport], object] | None = ...,
+    atomic_types: type | Iterable[type] | None = ...,
 ) -> None:
     """
     Configure copium behavior. Only specified arguments are changed.
@@ -39,12 +44,38 @@ def apply(
         Only relevant when memo='native'.
     :param suppress_warnings: Error strings to suppress warnings for.
         None clears the list.
+    :param memo_retention: What each thread's reusable memo keeps allocated between calls.
+        'adaptive' keeps capacity that recent calls actually used (default).
+        'fixed' shrinks anything past fixed caps (128Ki table slots, 8Ki keepalive items).
+        'minimal' releases everything after every call.
+    :param slow_copy_threshold_us: Report deepcopy() calls that take at least this long,
+        whatever memo they copy with. A call made while another one on the thread is timed,
+        from a __deepcopy__ say, is part of that one. None stops reporting calls for being slow.
+    :param slow_copy_sample: Also report every nth call on each thread; 0 for none.
+    :param slow_copy_callback: Called with a dict describing each reported call.
+        None stops timing calls altogether. Exceptions it raises are unraisable.
+    :param atomic_types: Types whose instances deepcopy() returns as is, like ints and strs.
+        Exact types only; None clears them.
     """
 
+class _SlowCopyReport(TypedDict, total=True):
+    callsite: tuple[str, int, str, str] | None
+    elapsed_us: float
+    python_us: float  # in the reduce and __deepcopy__ routes
+    native_us: float
+    nodes: int  # objects copied rather than returned as is
+    memo_size: int  # both are 0 with a memo that's neither a dict nor copium's own
+    sampled: bool
+
 class _CopiumConfig(TypedDict, total=True):
     memo: Literal["native", "dict"]
     on_incompatible: Literal["warn", "raise", "silent"]
     suppress_warnings: tuple[str, ...]
+    memo_retention: Literal["adaptive", "fixed", "minimal"]
+    slow_copy_threshold_us: float | None
+    slow_copy_sample: int
+    slow_copy_callback: Callable[[_SlowCopyReport], object] | None
+    atomic_types: tuple[type, ...]
 
 def get() -> _CopiumConfig:
     """
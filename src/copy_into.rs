@@ -0,0 +1,270 @@
+//! In-place deep copies (`copium.extra.copy_into`).
+//!
+//! `copy_into(dst, src)` turns dst into a deep copy of src, keeping the
+//! containers it already has where they line up with src's. Both are walked
+//! together: a list or dict of src found where dst holds one of the same exact
+//! type gets its items overwritten in place, and everything else goes through
+//! `deepcopy`. A list is resized to fit. A dict whose keys come in the same
+//! order as src's, all of them atomic, only has its values replaced and so
+//! keeps its table; any other one is cleared and refilled, still reusing the
+//! values found under the same keys.
+//!
+//! The walk shares its memo with `deepcopy`: each container of src maps to the
+//! one that became its copy, so references between them keep their shape. A
+//! container of dst taken over is memoized as its own copy too, so one it holds
+//! in two places only gets reused for the first. dst must not share containers
+//! with src, and is left half updated if the copy fails.
+
+use pyo3_ffi::*;
+use std::ptr;
+
+use crate::deepcopy;
+use crate::memo::{Memo, PyMemoObject};
+use crate::types::{PyObjectPtr, PyTypeInfo, PyTypeObjectPtr};
+
+unsafe fn copy_into_list(memo: &mut PyMemoObject, dst: *mut PyObject, src: *mut PyObject) -> i32 {
+    unsafe {
+        let mut i = 0;
+        while i < PyList_GET_SIZE(src) {
+            let item = PyList_GET_ITEM(src, i).newref();
+            let old = if i < PyList_GET_SIZE(dst) {
+                PyList_GET_ITEM(dst, i).newref()
+            } else {
+                ptr::null_mut()
+            };
+            let copy = if old.is_null() {
+                deepcopy::deepcopy(item, memo).0
+            } else {
+                copy_into(memo, old, item)
+            };
+            item.decref();
+            if copy.is_null() {
+                old.decref_nullable();
+                return -1;
+            }
+            let status = if copy == old {
+                copy.decref();
+                0
+            } else if i < PyList_GET_SIZE(dst) {
+                PyList_SetItem(dst, i, copy)
+            } else {
+                let status = PyList_Append(dst, copy);
+                copy.decref();
+                status
+            };
+            old.decref_nullable();
+            if status < 0 {
+                return -1;
+            }
+            i += 1;
+        }
+        if PyList_GET_SIZE(dst) > i {
+            return PyList_SetSlice(dst, i, PyList_GET_SIZE(dst), ptr::null_mut());
+        }
+        0
+    }
+}
+
+/// Whether the key of dst is the one of src, as its deep copy.
+#[inline(always)]
+unsafe fn same_key(dst_key: *mut PyObject, src_key: *mut PyObject) -> bool {
+    unsafe {
+        if !deepcopy::is_atomic_element(src_key) {
+            return false;
+        }
+        // Comparing atomics runs no Python code.
+        dst_key == src_key
+            || (dst_key.class() == src_key.class()
+                && PyObject_RichCompareBool(dst_key, src_key, Py_EQ) == 1)
+    }
+}
+
+/// Replaces the values of dst if its keys are those of src in the same order.
+/// Returns 1 if it did, 0 if the keys differ (dst may have some of its values
+/// replaced already), or -1 with an exception set.
+unsafe fn copy_into_dict_values(
+    memo: &mut PyMemoObject,
+    dst: *mut PyObject,
+    src: *mut PyObject,
+) -> i32 {
+    unsafe {
+        let size = PyDict_GET_SIZE(src);
+        if PyDict_GET_SIZE(dst) != size {
+            return 0;
+        }
+        let mut dst_pos: Py_ssize_t = 0;
+        let mut result = 1;
+        let mut iter = crate::dict_iter::DictIterGuard::new(src);
+        iter.activate();
+        loop {
+            let mut key: *mut PyObject = ptr::null_mut();
+            let mut value: *mut PyObject = ptr::null_mut();
+            let next = iter.next(&mut key, &mut value);
+            if next <= 0 {
+                if next < 0 {
+                    result = -1;
+                }
+                break;
+            }
+            let mut dst_key: *mut PyObject = ptr::null_mut();
+            let mut dst_value: *mut PyObject = ptr::null_mut();
+            let same = PyDict_GET_SIZE(dst) == size
+                && PyDict_Next(dst, &mut dst_pos, &mut dst_key, &mut dst_value) != 0
+                && same_key(dst_key, key);
+            let mut copy = ptr::null_mut();
+            if same {
+                dst_key.incref();
+                dst_value.incref();
+                copy = copy_into(memo, dst_value, value);
+            }
+            key.decref();
+            value.decref();
+            if !same {
+                result = 0;
+                break;
+            }
+            // Replacing the value of a key it holds leaves dst's table as it is.
+            let status = if copy.is_null() {
+                -1
+            } else if copy == dst_value {
+                0
+            } else {
+                PyDict_SetItem(dst, dst_key, copy)
+            };
+            copy.decref_nullable();
+            dst_key.decref();
+            dst_value.decref();
+            if status < 0 {
+                result = -1;
+                break;
+            }
+        }
+        iter.cleanup();
+        result
+    }
+}
+
+unsafe fn copy_into_dict(memo: &mut PyMemoObject, dst: *mut PyObject, src: *mut PyObject) -> i32 {
+    unsafe {
+        let reused = copy_into_dict_values(memo, dst, src);
+        if reused != 0 {
+            return if reused < 0 { -1 } else { 0 };
+        }
+
+        // Values found under an atomic key still get reused for the same key of src.
+        let old = PyDict_Copy(dst);
+        if old.is_null() {
+            return -1;
+        }
+        PyDict_Clear(dst);
+        let mut result = 0;
+        let mut iter = crate::dict_iter::DictIterGuard::new(src);
+        iter.activate();
+        loop {
+            let mut key: *mut PyObject = ptr::null_mut();
+            let mut value: *mut PyObject = ptr::null_mut();
+            let next = iter.next(&mut key, &mut value);
+            if next <= 0 {
+                if next < 0 {
+                    result = -1;
+                }
+                break;
+            }
+            let mut previous = ptr::null_mut();
+            let key_copy = if deepcopy::is_atomic_element(key) {
+                previous = PyDict_GetItemWithError(old, key);
+                key.newref()
+            } else {
+                deepcopy::deepcopy(key, memo).0
+            };
+            let value_copy = if key_copy.is_null() || !PyErr_Occurred().is_null() {
+                ptr::null_mut()
+            } else if previous.is_null() {
+                deepcopy::deepcopy(value, memo).0
+            } else {
+                previous.incref();
+                let copy = copy_into(memo, previous, value);
+                previous.decref();
+                copy
+            };
+            key.decref();
+            value.decref();
+            if value_copy.is_null() {
+                key_copy.decref_nullable();
+                result = -1;
+                break;
+            }
+            if crate::compat::_PyDict_SetItem_Take2(dst, key_copy, value_copy) < 0 {
+                result = -1;
+                break;
+            }
+        }
+        iter.cleanup();
+        old.decref();
+        result
+    }
+}
+
+/// What dst becomes as a deep copy of src: dst itself if it could be reused, a
+/// new copy otherwise. Returns a new reference, or null with an exception set.
+unsafe fn copy_into(
+    memo: &mut PyMemoObject,
+    dst: *mut PyObject,
+    src: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        let cls = src.class();
+        if cls.is_literal_immutable() {
+            return src.newref();
+        }
+        let is_list = PyListObject::is(cls);
+        if (!is_list && !PyDictObject::is(cls)) || dst.class() != cls || dst == src {
+            return deepcopy::deepcopy(src, memo).0;
+        }
+
+        let (probe, found) = memo.recall(src);
+        if !found.is_null() {
+            return found;
+        }
+        // A container of dst taken over already is memoized as its own copy,
+        // and so is one of src copied so far, which dst isn't supposed to hold
+        // but mustn't get overwritten either.
+        let (dst_probe, taken) = memo.recall(dst);
+        if !taken.is_null() {
+            taken.decref();
+            return deepcopy::deepcopy(src, memo).0;
+        }
+        if memo.memoize(src, dst, &probe) < 0 || memo.memoize(dst, dst, &dst_probe) < 0 {
+            return ptr::null_mut();
+        }
+
+        if Py_EnterRecursiveCall(crate::cstr!(" while copying into an object")) != 0 {
+            return ptr::null_mut();
+        }
+        let status = if is_list {
+            copy_into_list(memo, dst, src)
+        } else {
+            copy_into_dict(memo, dst, src)
+        };
+        Py_LeaveRecursiveCall();
+        if status < 0 {
+            ptr::null_mut()
+        } else {
+            dst.newref()
+        }
+    }
+}
+
+/// Returns dst made into a deep copy of src, or a new deep copy of src if dst
+/// can't be.
+pub unsafe fn copy_into_root(dst: *mut PyObject, src: *mut PyObject) -> *mut PyObject {
+    unsafe {
+        let (memo, is_tss) = crate::memo::get_memo();
+        if memo.is_null() {
+            return ptr::null_mut();
+        }
+        let result = copy_into(&mut *memo, dst, src);
+        crate::memo::cleanup_memo(memo, is_tss);
+        result
+    }
+}
@@ -0,0 +1,159 @@
+//! Work stack of the container traversal in `deepcopy.rs`.
+//!
+//! One frame per list, tuple, dict, set or frozenset whose items are being
+//! copied. Frames live in fixed-size boxed segments that are never moved: a
+//! frame's address stays put while it's on the stack, which the 3.14 dict
+//! watcher relies on (`DictIterGuard` is linked into a global list) and which
+//! lets a nested traversal push on top of frames still referenced from below.
+//! The native memo owns one, so the thread's memo keeps its segments between
+//! calls.
+
+use pyo3_ffi::*;
+use std::hint::unlikely;
+use std::mem::MaybeUninit;
+use std::ptr;
+
+use crate::dict_iter::DictIterGuard;
+
+const FRAMES_PER_SEGMENT: usize = 64;
+/// Segments a reused memo holds on to, i.e. 256 levels.
+pub const RETAIN_SEGMENTS: usize = 4;
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum FrameKind {
+    List,
+    Tuple,
+    Dict,
+    Set,
+    Frozenset,
+}
+
+pub struct CopyFrame<P> {
+    /// Borrowed; whoever pushed the frame keeps it alive.
+    pub original: *mut PyObject,
+    /// List, dict, set: the copy, already in the memo; tuple, frozenset: a
+    /// tuple of item copies.
+    pub copied: *mut PyObject,
+    /// Set, and list and dict without a GIL: the items, taken before the copy
+    /// is memoized.
+    pub snapshot: *mut PyObject,
+    /// List item, dict key or dict value whose copy is being made.
+    pub pending: *mut PyObject,
+    /// Dict: copy of the key whose value is being copied.
+    pub key_copy: *mut PyObject,
+    /// Dict: value of that key, copied next.
+    pub value: *mut PyObject,
+    pub probe: P,
+    pub index: Py_ssize_t,
+    pub size: Py_ssize_t,
+    /// Frozenset: iteration position; cloned dict: see `dict_clone::replace`;
+    /// list without a GIL: index of the snapshot's first item.
+    pub pos: Py_ssize_t,
+    pub iter: Option<DictIterGuard>,
+    pub kind: FrameKind,
+    /// Tuple: no item copy differed from its original so far.
+    pub all_same: bool,
+    /// Dict: `copied` started as `PyDict_Copy(original)`, see `dict_clone`.
+    pub clone: bool,
+    /// List: its dicts are taken as records, see `dict_clone`, until one
+    /// isn't one.
+    pub records: bool,
+}
+
+impl<P> CopyFrame<P> {
+    #[inline(always)]
+    pub fn new(
+        kind: FrameKind,
+        original: *mut PyObject,
+        copied: *mut PyObject,
+        size: Py_ssize_t,
+        probe: P,
+    ) -> Self {
+        Self {
+            original,
+            copied,
+            snapshot: ptr::null_mut(),
+            pending: ptr::null_mut(),
+            key_copy: ptr::null_mut(),
+            value: ptr::null_mut(),
+            probe,
+            index: 0,
+            size,
+            pos: 0,
+            iter: None,
+            kind,
+            all_same: true,
+            clone: false,
+            records: true,
+        }
+    }
+}
+
+type Segment<P> = [MaybeUninit<CopyFrame<P>>; FRAMES_PER_SEGMENT];
+
+pub struct CopyStack<P> {
+    segments: Vec<Box<Segment<P>>>,
+    depth: usize,
+}
+
+impl<P> CopyStack<P> {
+    pub const fn new() -> Self {
+        Self {
+            segments: Vec::new(),
+            depth: 0,
+        }
+    }
+
+    #[inline(always)]
+    pub fn depth(&self) -> usize {
+        self.depth
+    }
+
+    /// Moves `frame` on top and returns where it landed, which stays valid
+    /// until it's popped.
+    #[inline(always)]
+    pub fn push(&mut self, frame: CopyFrame<P>) -> *mut CopyFrame<P> {
+        let (segment, slot) = (
+            self.depth / FRAMES_PER_SEGMENT,
+            self.depth % FRAMES_PER_SEGMENT,
+        );
+        if unlikely(segment == self.segments.len()) {
+            self.grow();
+        }
+        self.depth += 1;
+        self.segments[segment][slot].write(frame)
+    }
+
+    #[cold]
+    fn grow(&mut self) {
+        self.segments.push(Box::new(
+            [const { MaybeUninit::uninit() }; FRAMES_PER_SEGMENT],
+        ));
+    }
+
+    /// The top frame. The stack must not be empty.
+    #[inline(always)]
+    pub fn top(&mut self) -> *mut CopyFrame<P> {
+        debug_assert!(self.depth > 0);
+        let depth = self.depth - 1;
+        self.segments[depth / FRAMES_PER_SEGMENT][depth % FRAMES_PER_SEGMENT].as_mut_ptr()
+    }
+
+    /// Drops the top frame in place; references it still holds are the
+    /// caller's to release first.
+    #[inline(always)]
+    pub fn pop(&mut self) {
+        let top = self.top();
+        self.depth -= 1;
+        unsafe { ptr::drop_in_place(top) };
+    }
+
+    /// Frees all but the first `keep` segments. Only called with the stack empty.
+    pub fn shrink_to(&mut self, keep: usize) {
+        debug_assert!(self.depth == 0);
+        self.segments.truncate(keep);
+        if keep == 0 {
+            self.segments.shrink_to_fit();
+        }
+    }
+}
@@ -2,10 +2,15 @@ use pyo3_ffi::*;
 use std::hint::{likely, unlikely};
 use std::ptr;
 
+use crate::copy_stack::{CopyFrame, CopyStack, FrameKind};
 use crate::critical_section::with_critical_section_raw;
+use crate::dict_clone;
 use crate::dict_iter::DictIterGuard;
 use crate::memo::Memo;
-use crate::{ffi_ext::*, py_str};
+use crate::slow_copy::slow_copy_route;
+use crate::stats::stat;
+use crate::type_cache::{self, Route};
+use crate::{ffi_ext::*, py_str, py_type};
 
 use crate::types::*;
 
@@ -81,363 +86,1565 @@ unsafe fn is_prememo_atomic<M: Memo>(cls: *mut PyTypeObject) -> bool {
     }
 }
 
-#[inline(always)]
-unsafe fn is_postmemo_atomic<M: Memo>(cls: *mut PyTypeObject) -> bool {
-    if !M::RECALL_CAN_ERROR {
-        return cls.is_builtin_immutable() || cls.is_type_subclass() || cls.is_stdlib_immutable();
-    }
-
-    #[cfg(Py_3_14)]
-    {
-        cls.is_stdlib_immutable()
-    }
-
-    #[cfg(not(Py_3_14))]
-    {
-        cls.is_atomic_immutable()
-    }
-}
-
 #[inline(always)]
 pub unsafe fn deepcopy<M: Memo>(object: *mut PyObject, memo: &mut M) -> PyResult {
     unsafe {
         let cls = object.class();
 
         if likely(is_prememo_atomic::<M>(cls)) {
+            stat!(PrememoAtomic);
             return PyResult::ok(object.newref());
         }
 
         let (probe, found) = memo.recall(object);
         if !found.is_null() {
+            stat!(MemoHit);
             return PyResult::ok(found);
         }
         if M::RECALL_CAN_ERROR && unlikely(!PyErr_Occurred().is_null()) {
             return PyResult::error();
         }
 
-        if let Some(object) = PyTupleObject::cast_exact(object, cls) {
-            return protect_stack!(object.deepcopy(memo, probe));
+        let copy = deepcopy_unmemoized(object, cls, memo, probe);
+        memo.settle(object, copy)
+    }
+}
+
+/// The part of `deepcopy` after the memo missed on `object`.
+#[inline(always)]
+unsafe fn deepcopy_unmemoized<M: Memo>(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        if PyTupleObject::is(cls)
+            || PyDictObject::is(cls)
+            || PyListObject::is(cls)
+            || PySetObject::is(cls)
+        {
+            return protect_stack!(deepcopy_containers(object, cls, memo, probe));
         }
-        if let Some(object) = PyDictObject::cast_exact(object, cls) {
-            return protect_stack!(object.deepcopy(memo, probe));
+
+        // deepcopy(x, share=...)
+        if crate::shared_types::is_shared_by_call(cls) {
+            stat!(Atomic);
+            return PyResult::ok(object.newref());
         }
-        if let Some(object) = PyListObject::cast_exact(object, cls) {
-            return protect_stack!(object.deepcopy(memo, probe));
+
+        let (route, dunder_deepcopy) = route_of(cls);
+        let copied = copy_by_route(object, cls, route, dunder_deepcopy, memo, probe);
+        route_object_release(dunder_deepcopy);
+        copied
+    }
+}
+
+#[inline(always)]
+unsafe fn copy_by_route<M: Memo>(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    route: Route,
+    dunder_deepcopy: *mut PyObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        match route {
+            Route::Atomic => {
+                stat!(Atomic);
+                PyResult::ok(object.newref())
+            }
+            Route::Native => {
+                if PyFrozensetObject::is(cls) {
+                    return protect_stack!(deepcopy_containers(object, cls, memo, probe));
+                }
+                if let Some(object) = PyByteArrayObject::cast_exact(object, cls) {
+                    return object.deepcopy(memo, probe);
+                }
+                if PyMethodObject::is(cls) {
+                    let object = object as *mut PyMethodObject;
+                    return object.deepcopy(memo, probe);
+                }
+                if has_registered_reductor(cls) {
+                    return reconstruct(object, cls, memo, probe);
+                }
+                if instance_follows_type(object, cls, true) {
+                    return protect_stack!(deepcopy_collection(object, cls, memo, probe));
+                }
+                object.deepcopy(memo, probe)
+            }
+            Route::Stdlib | Route::Tzinfo | Route::Buffer if has_registered_reductor(cls) => {
+                reconstruct(object, cls, memo, probe)
+            }
+            Route::Stdlib => {
+                stat!(Atomic);
+                PyResult::ok(object.newref())
+            }
+            Route::Tzinfo => match tzinfo_is_atomic(object) {
+                atomic if atomic < 0 => PyResult::error(),
+                0 => reconstruct(object, cls, memo, probe),
+                _ => {
+                    stat!(Atomic);
+                    PyResult::ok(object.newref())
+                }
+            },
+            Route::Registered => {
+                let native = memo.as_native_memo();
+                if native.is_null() {
+                    // Registrations only apply to copium's own memo.
+                    return object.deepcopy(memo, probe);
+                }
+                if dunder_deepcopy.is_null() {
+                    stat!(Atomic);
+                    return PyResult::ok(object.newref());
+                }
+                if PyCapsule_IsValid(dunder_deepcopy, crate::capi::BUFFER_CAPSULE) != 0 {
+                    let mut view = std::mem::MaybeUninit::<Py_buffer>::uninit();
+                    if !exported_flat_buffer(object, view.as_mut_ptr()) {
+                        // Objects or strides in it: copied as if it weren't registered.
+                        return object.deepcopy(memo, probe);
+                    }
+                    return deepcopy_exported_buffer(
+                        object,
+                        dunder_deepcopy,
+                        &mut *view.as_mut_ptr(),
+                        memo,
+                        probe,
+                    );
+                }
+                protect_stack!(deepcopy_registered(
+                    object,
+                    dunder_deepcopy,
+                    native,
+                    memo,
+                    probe
+                ))
+            }
+            Route::Buffer => deepcopy_buffer(object, dunder_deepcopy, memo, probe),
+            Route::Subclass if instance_follows_type(object, cls, true) => {
+                protect_stack!(deepcopy_subclass(object, cls, dunder_deepcopy, memo, probe))
+            }
+            Route::Custom if instance_follows_type(object, cls, false) => {
+                slow_copy_route!(deepcopy_custom_unbound(
+                    object,
+                    dunder_deepcopy,
+                    memo,
+                    probe
+                ))
+            }
+            Route::Reduce
+                if instance_follows_type(
+                    object,
+                    cls,
+                    type_cache::reduce_plan(cls).reads_dict(),
+                ) =>
+            {
+                reconstruct(object, cls, memo, probe)
+            }
+            _ => object.deepcopy(memo, probe),
+        }
+    }
+}
+
+/// The route for instances of `cls`, and what it copies them with, see
+/// `type_cache::route`. That's borrowed from the type: with the GIL, nothing
+/// can replace it before it's used. Without the GIL, another thread can replace
+/// the attribute it was looked up as and free it at any time, so there it's a
+/// new reference, looked up again to check the cached one is still current.
+/// `route_object_release` gives it back.
+#[inline(always)]
+unsafe fn route_of(cls: *mut PyTypeObject) -> (Route, *mut PyObject) {
+    unsafe {
+        let (mut route, mut object) = type_cache::route(cls);
+        if unlikely(route == Route::Unknown) {
+            (route, object) = classify_route(cls);
+            type_cache::set_route(cls, route, object);
         }
-        if let Some(object) = PySetObject::cast_exact(object, cls) {
-            return protect_stack!(object.deepcopy(memo, probe));
+        #[cfg(Py_GIL_DISABLED)]
+        if !object.is_null() {
+            match route_object_acquire(cls, route, object) {
+                Some(acquired) => object = acquired,
+                None => {
+                    // Replaced since: the version tag changed with it, so
+                    // classify anew. Should it get replaced once more in
+                    // between, look it up on the instance.
+                    (route, object) = classify_route(cls);
+                    type_cache::set_route(cls, route, object);
+                    if !object.is_null() {
+                        match route_object_acquire(cls, route, object) {
+                            Some(acquired) => object = acquired,
+                            None => return (Route::Lookup, ptr::null_mut()),
+                        }
+                    }
+                }
+            }
         }
+        (route, object)
+    }
+}
 
-        if unlikely(is_postmemo_atomic::<M>(cls)) {
-            return PyResult::ok(object.newref());
+/// `cached`, as a new reference, if it's still what `cls` looks it up as for
+/// `route`.
+#[cfg(Py_GIL_DISABLED)]
+unsafe fn route_object_acquire(
+    cls: *mut PyTypeObject,
+    route: Route,
+    cached: *mut PyObject,
+) -> Option<*mut PyObject> {
+    unsafe {
+        let found = match route {
+            Route::Registered => crate::capi::registered_entry_ref(cls),
+            Route::Buffer => _PyType_LookupRef(cls, py_str!("__copy__")),
+            Route::Custom => _PyType_LookupRef(cls, py_str!("__deepcopy__")),
+            Route::Subclass => {
+                let found = _PyType_LookupRef(cls, py_str!("__getnewargs__"));
+                if found == cached {
+                    found
+                } else {
+                    // Or the function of the `__new__` namedtuple() generated,
+                    // see `keeps_builtin_reduce`.
+                    found.decref_nullable();
+                    let descr = _PyType_LookupRef(cls, py_str!("__new__"));
+                    let func = if !descr.is_null()
+                        && descr.class() == ptr::addr_of_mut!(PyStaticMethod_Type)
+                    {
+                        descr.getattr(py_str!("__func__"))
+                    } else {
+                        ptr::null_mut()
+                    };
+                    PyErr_Clear();
+                    descr.decref_nullable();
+                    func
+                }
+            }
+            _ => return Some(cached.newref()),
+        };
+        if found == cached {
+            return Some(found);
         }
+        found.decref_nullable();
+        None
+    }
+}
+
+#[inline(always)]
+unsafe fn route_object_release(object: *mut PyObject) {
+    #[cfg(Py_GIL_DISABLED)]
+    unsafe {
+        object.decref_nullable();
+    }
+    #[cfg(not(Py_GIL_DISABLED))]
+    let _ = object;
+}
 
-        if let Some(object) = PyFrozensetObject::cast_exact(object, cls) {
-            return protect_stack!(object.deepcopy(memo, probe));
+/// Decides how instances of `cls` are copied once they got past the exact
+/// builtin containers. Everything derived here only depends on the type, so
+/// the result is cached per `tp_version_tag`.
+unsafe fn classify_route(cls: *mut PyTypeObject) -> (Route, *mut PyObject) {
+    unsafe {
+        // The stdlib types below are only looked up once their modules got imported.
+        crate::cache::resolve_imported();
+        if let Some(registered) = crate::capi::registered_route(cls) {
+            return registered;
         }
-        if let Some(object) = PyByteArrayObject::cast_exact(object, cls) {
-            return object.deepcopy(memo, probe);
+        // Whichever subset is_prememo_atomic let through for this memo kind,
+        // the rest of the atomic set is due here, after the memo lookup.
+        if cls.is_atomic_immutable() || crate::shared_types::is_configured_atomic(cls) {
+            return (Route::Atomic, ptr::null_mut());
         }
-        if let Some(object) = PyMethodObject::cast_exact(object, cls) {
-            return object.deepcopy(memo, probe);
+        if PyFrozensetObject::is(cls) || PyByteArrayObject::is(cls) || PyMethodObject::is(cls) {
+            return (Route::Native, ptr::null_mut());
+        }
+        // These check copyreg.dispatch_table on each copy: a reductor can be
+        // registered after a first copy classified the type.
+        if cls.is_stdlib_container() {
+            return (Route::Native, ptr::null_mut());
+        }
+        if cls.is_stdlib_value() {
+            return (Route::Stdlib, ptr::null_mut());
+        }
+        if crate::types::is_enum_member_type(cls) {
+            return (Route::Atomic, ptr::null_mut());
+        }
+        if cls.is_stdlib_tzinfo_holder() {
+            return (Route::Tzinfo, ptr::null_mut());
+        }
+        if cls.is_stdlib_buffer() {
+            let dunder_copy = crate::ffi_ext::_PyType_Lookup(cls, py_str!("__copy__"));
+            if !dunder_copy.is_null() {
+                return (Route::Buffer, dunder_copy);
+            }
+        }
+        // Instance attribute lookup only mirrors the type's MRO with the stock getattro.
+        if (*cls).tp_getattro.map(|f| f as usize) != Some(PyObject_GenericGetAttr as usize) {
+            return (Route::Lookup, ptr::null_mut());
         }
 
-        object.deepcopy(memo, probe)
+        let dunder_deepcopy = crate::ffi_ext::_PyType_Lookup(cls, py_str!("__deepcopy__"));
+        if dunder_deepcopy.is_null() {
+            match crate::reduce::keeps_builtin_reduce(cls) {
+                Some(getnewargs) => (Route::Subclass, getnewargs),
+                None => (Route::Reduce, ptr::null_mut()),
+            }
+        } else if dunder_deepcopy.class() == ptr::addr_of_mut!(PyFunction_Type) {
+            // A plain function binds to `obj` and nothing else, so calling it
+            // with `(obj, memo)` is exactly what the bound method would do.
+            (Route::Custom, dunder_deepcopy)
+        } else if dunder_deepcopy.class() == ptr::addr_of_mut!(crate::ffi_ext::PyMethodDescr_Type)
+            && PyType_IsSubtype(cls, crate::ffi_ext::PyDescr_TYPE(dunder_deepcopy)) != 0
+        {
+            // So does a C method of a class `cls` derives from, e.g. a
+            // `__deepcopy__` written in an extension.
+            (Route::Custom, dunder_deepcopy)
+        } else {
+            (Route::Lookup, ptr::null_mut())
+        }
     }
 }
 
-impl PyDeepCopy for *mut PyListObject {
-    unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
-        unsafe {
-            let sz = self.length();
-            let copied = check!(py_list_new(sz));
+/// Whether the tzinfo of a datetime or time, if any, leaves it its own deep
+/// copy. -1 on error.
+unsafe fn tzinfo_is_atomic(object: *mut PyObject) -> i32 {
+    unsafe {
+        let tzinfo = object.getattr(py_str!("tzinfo"));
+        if tzinfo.is_null() {
+            return -1;
+        }
+        let mut atomic = true;
+        if !tzinfo.is_none() {
+            let cls = tzinfo.class();
+            let (mut route, mut dunder_deepcopy) = type_cache::route(cls);
+            if route == Route::Unknown {
+                (route, dunder_deepcopy) = classify_route(cls);
+                type_cache::set_route(cls, route, dunder_deepcopy);
+            }
+            atomic = route == Route::Atomic
+                || (route == Route::Stdlib && !crate::types::has_registered_reductor(cls));
+        }
+        tzinfo.decref();
+        atomic as i32
+    }
+}
+
+/// Whether `object` resolves `__deepcopy__` the way its type's cached route
+/// says, i.e. its instance `__dict__` doesn't shadow the type with its own.
+/// A managed dict (3.11+) is looked into without materializing it, see
+/// `dict_clone::managed_dict_has_deepcopy`. Where its layout isn't known,
+/// peeking materializes it, which is only worth it when the caller is about
+/// to read the dict anyway; otherwise report `false` and let the caller fall
+/// back to the attribute lookup.
+unsafe fn instance_follows_type(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    reads_dict: bool,
+) -> bool {
+    unsafe {
+        if (*cls).tp_dictoffset == 0 {
+            return true;
+        }
+        #[cfg(Py_3_11)]
+        {
+            let managed = tp_flags_of(cls) & crate::ffi_ext::TPFLAGS_MANAGED_DICT != 0;
+            if managed {
+                if let Some(found) = dict_clone::managed_dict_has_deepcopy(object, cls) {
+                    return !found;
+                }
+                if !reads_dict {
+                    return false;
+                }
+            }
+        }
+        #[cfg(not(Py_3_11))]
+        let _ = reads_dict;
+
+        let dictptr = crate::ffi_ext::_PyObject_GetDictPtr(object);
+        if dictptr.is_null() || (*dictptr).is_null() {
+            return true;
+        }
+        PyDict_Contains(*dictptr, py_str!("__deepcopy__")) == 0
+    }
+}
+
+unsafe fn deepcopy_subclass<M: Memo>(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    getnewargs: *mut PyObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        let result = crate::reduce::deepcopy_subclass(object, cls, getnewargs, memo, probe);
+        if result.is_null() {
+            PyResult::error()
+        } else {
+            PyResult::ok(result)
+        }
+    }
+}
+
+#[inline(always)]
+unsafe fn reconstruct<M: Memo>(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        let result = slow_copy_route!(crate::reduce::reconstruct(object, cls, memo, probe));
+        if result.is_null() {
+            PyResult::error()
+        } else {
+            PyResult::ok(result)
+        }
+    }
+}
+
+// Container traversal.
+//
+// Exact lists, tuples, dicts, sets and frozensets are copied without
+// recursing: each one gets a frame on the memo's `CopyStack` that tracks how
+// far its items got, and a container found among them is pushed on top and
+// finished before its parent goes on. How deep such a graph can go is only
+// bounded by memory. Any other item goes through `deepcopy_unmemoized` as
+// before, so the reduce and `__deepcopy__` routes still recurse, and each
+// traversal they start counts as one level for `protect_stack!`.
+
+#[inline(always)]
+fn is_traversed_container(cls: *mut PyTypeObject) -> bool {
+    PyListObject::is(cls)
+        || PyDictObject::is(cls)
+        || PyTupleObject::is(cls)
+        || PySetObject::is(cls)
+        || PyFrozensetObject::is(cls)
+}
+
+/// What `copy_item` made of an item.
+enum ItemCopy<P> {
+    Copied(*mut PyObject),
+    /// A container that needs a frame of its own, to be memoized with this probe.
+    Frame(P),
+    Error,
+}
+
+/// What `copy_frame_start` made of a container.
+enum Start<F> {
+    Frame(F),
+    /// A copy that needed no traversal, memoized as needed.
+    Copied(*mut PyObject),
+    Error,
+}
+
+/// What `copy_frame_advance` stopped at.
+enum Advance<P> {
+    /// An item that is a container of its own; the frame keeps it alive.
+    Child(*mut PyObject, P),
+    Done,
+    Error,
+}
+
+/// Copies an item of a container, where the caller knows of `held`
+/// references to it (the container's own plus the ones it took). When that's
+/// all there is, the item can't come up again, so its memo lookup and insert
+/// are elided (see `PyMemoObject::defer`).
+#[inline(always)]
+unsafe fn copy_item<M: Memo>(
+    item: *mut PyObject,
+    memo: &mut M,
+    held: Py_ssize_t,
+) -> ItemCopy<M::Probe> {
+    unsafe {
+        let cls = item.class();
+
+        if likely(is_prememo_atomic::<M>(cls)) {
+            stat!(PrememoAtomic);
+            return ItemCopy::Copied(item.newref());
+        }
+        if item.refcount() == held
+            && (PyListObject::is(cls)
+                || PyDictObject::is(cls)
+                || PyTupleObject::is(cls)
+                || PySetObject::is(cls))
+        {
+            if let Some(probe) = memo.deferred_probe() {
+                return ItemCopy::Frame(probe);
+            }
+        }
 
-            for i in 0..sz {
+        let (probe, found) = memo.recall(item);
+        if !found.is_null() {
+            stat!(MemoHit);
+            return ItemCopy::Copied(found);
+        }
+        if M::RECALL_CAN_ERROR && unlikely(!PyErr_Occurred().is_null()) {
+            return ItemCopy::Error;
+        }
+        if is_traversed_container(cls) {
+            return ItemCopy::Frame(probe);
+        }
+
+        let copy = deepcopy_unmemoized(item, cls, memo, probe);
+        let copy = memo.settle(item, copy);
+        if copy.is_error() {
+            ItemCopy::Error
+        } else {
+            ItemCopy::Copied(copy.into_raw())
+        }
+    }
+}
+
+/// How many of `seq`'s first `n` items lead with a literal immutable, i.e.
+/// are their own deep copies. Types are checked four at a time, so that a
+/// long run of them costs a branch per four.
+#[inline(always)]
+unsafe fn atomic_prefix<S: PySeqPtr + Copy>(seq: S, n: Py_ssize_t) -> Py_ssize_t {
+    unsafe {
+        let atomic = |i| seq.get_borrowed_unchecked(i).class().is_literal_immutable();
+        let mut i = 0;
+        while i + 4 <= n && atomic(i) & atomic(i + 1) & atomic(i + 2) & atomic(i + 3) {
+            i += 4;
+        }
+        while i < n && atomic(i) {
+            i += 1;
+        }
+        i
+    }
+}
+
+/// Whether a set element is its own deep copy: a literal immutable, or a
+/// tuple of them.
+#[inline(always)]
+pub(crate) unsafe fn is_atomic_element(item: *mut PyObject) -> bool {
+    unsafe {
+        let cls = item.class();
+        if cls.is_literal_immutable() {
+            return true;
+        }
+        let Some(tuple) = PyTupleObject::cast_exact(item, cls) else {
+            return false;
+        };
+        (0..tuple.length()).all(|i| {
+            let item = tuple.get_borrowed_unchecked(i);
+            item.class().is_literal_immutable()
+        })
+    }
+}
+
+// Without a GIL, a list or dict is read in one critical section when its frame
+// starts: the items its frame goes on to copy are a snapshot taken there, like
+// a set's. Its size is still checked along the way, as iterating over it
+// would, so that growing or shrinking it under the copy raises. Its copy is
+// filled without locking for as long as the memo says it's unpublished; from
+// then on, another thread could be at it too.
+
+/// Items of `dict` as a `(key, value, key, value, ...)` tuple.
+#[cfg(Py_GIL_DISABLED)]
+unsafe fn dict_snapshot(dict: *mut PyObject) -> *mut PyTupleObject {
+    unsafe {
+        with_critical_section_raw(dict, || {
+            let snapshot = py_tuple_new(2 * (dict as *mut PyDictObject).len());
+            if snapshot.is_null() {
+                return snapshot;
+            }
+            let mut pos: Py_ssize_t = 0;
+            let mut i: Py_ssize_t = 0;
+            let mut key: *mut PyObject = ptr::null_mut();
+            let mut value: *mut PyObject = ptr::null_mut();
+            while PyDict_Next(dict, &mut pos, &mut key, &mut value) != 0 {
+                snapshot.set_slot_steal_unchecked(i, key.newref());
+                snapshot.set_slot_steal_unchecked(i + 1, value.newref());
+                i += 2;
+            }
+            snapshot
+        })
+    }
+}
+
+#[inline(always)]
+unsafe fn set_items_all_atomic<S: PySetPtr + Copy>(set: S) -> bool {
+    unsafe {
+        let mut pos: Py_ssize_t = 0;
+        let mut item: *mut PyObject = ptr::null_mut();
+        let mut hash: Py_hash_t = 0;
+        while set.next_entry(&mut pos, &mut item, &mut hash) != 0 {
+            if !is_atomic_element(item) {
+                return false;
+            }
+        }
+        true
+    }
+}
+
+/// A frame to copy `original` with. Lists, dicts and sets are memoized before
+/// their items are copied, so that the items can refer back to them; tuples
+/// and frozensets once they're built.
+///
+/// Atomic items that a list or tuple leads with are taken in one go. A tuple
+/// of nothing else is returned as is, and such a list needs no frame. A set or
+/// frozenset of atomic elements neither: its copy is the same elements in the
+/// same table. `PySet_New` clones that table with the stored hashes instead of
+/// hashing and probing each element again, and a frozenset is returned as is.
+unsafe fn copy_frame_start<M: Memo>(
+    original: *mut PyObject,
+    cls: *mut PyTypeObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> Start<CopyFrame<M::Probe>> {
+    unsafe {
+        if let Some(list) = PyListObject::cast_exact(original, cls) {
+            stat!(List);
+            let sz = list.length();
+            let copied = py_list_new(sz);
+            if copied.is_null() {
+                return Start::Error;
+            }
+
+            let (atomic, snapshot) = with_critical_section_raw(original, || {
+                let n = sz.min(list.length());
+                let atomic = atomic_prefix(list, n);
+                ptr::copy_nonoverlapping((*list).ob_item, (*copied).ob_item, atomic as usize);
+                for i in 0..atomic {
+                    copied.get_borrowed_unchecked(i).incref();
+                }
+                #[cfg(Py_GIL_DISABLED)]
+                let snapshot = if atomic < sz {
+                    py_tuple_new(n - atomic)
+                } else {
+                    ptr::null_mut()
+                };
+                #[cfg(Py_GIL_DISABLED)]
+                if !snapshot.is_null() {
+                    for i in atomic..n {
+                        let item = list.get_borrowed_unchecked(i).newref();
+                        snapshot.set_slot_steal_unchecked(i - atomic, item);
+                    }
+                }
+                #[cfg(not(Py_GIL_DISABLED))]
+                let snapshot: *mut PyTupleObject = ptr::null_mut();
+                (atomic, snapshot)
+            });
+            if cfg!(Py_GIL_DISABLED) && unlikely(atomic < sz && snapshot.is_null()) {
+                copied.decref();
+                return Start::Error;
+            }
+            for i in atomic..sz {
                 let ellipsis = Py_Ellipsis();
                 #[cfg(not(any(Py_3_12, Py_3_12, Py_3_13, Py_3_14)))]
                 ellipsis.incref();
                 copied.set_slot_steal_unchecked(i, ellipsis);
             }
 
-            if memo.memoize(self as _, copied as _, &probe) < 0 {
+            if memo.memoize(original, copied as _, &probe) < 0 {
+                snapshot.decref_nullable();
                 copied.decref();
-                return PyResult::error();
+                return Start::Error;
+            }
+            if atomic == sz {
+                return Start::Copied(copied as _);
             }
+            let mut frame = CopyFrame::new(FrameKind::List, original, copied as _, sz, probe);
+            frame.index = atomic;
+            frame.snapshot = snapshot as _;
+            frame.pos = atomic;
+            return Start::Frame(frame);
+        }
 
-            for i in 0..sz {
-                let item = self.get_owned_check_bounds(i);
-                if unlikely(item.is_null()) {
-                    PyErr_SetString(
-                        PyExc_RuntimeError,
-                        crate::cstr!("list changed size during iteration"),
-                    );
-                    memo.forget(self as _, &probe);
+        if let Some(tuple) = PyTupleObject::cast_exact(original, cls) {
+            stat!(Tuple);
+            let sz = tuple.length();
+            let atomic = atomic_prefix(tuple, sz);
+            if atomic == sz {
+                return Start::Copied(original.newref());
+            }
+            let copied = py_tuple_new(sz);
+            if copied.is_null() {
+                return Start::Error;
+            }
+            for i in 0..atomic {
+                copied.set_slot_steal_unchecked(i, tuple.get_borrowed_unchecked(i).newref());
+            }
+            let mut frame = CopyFrame::new(FrameKind::Tuple, original, copied as _, sz, probe);
+            frame.index = atomic;
+            return Start::Frame(frame);
+        }
+
+        #[cfg(Py_GIL_DISABLED)]
+        if PyDictObject::cast_exact(original, cls).is_some() {
+            stat!(Dict);
+            let snapshot = dict_snapshot(original);
+            if snapshot.is_null() {
+                return Start::Error;
+            }
+            let sz = snapshot.length() / 2;
+            let copied = py_dict_new(sz) as *mut PyObject;
+            if copied.is_null() {
+                snapshot.decref();
+                return Start::Error;
+            }
+            if memo.memoize(original, copied, &probe) < 0 {
+                snapshot.decref();
+                copied.decref();
+                return Start::Error;
+            }
+            let mut frame = CopyFrame::new(FrameKind::Dict, original, copied, sz, probe);
+            frame.snapshot = snapshot as _;
+            return Start::Frame(frame);
+        }
+
+        #[cfg(not(Py_GIL_DISABLED))]
+        if let Some(dict) = PyDictObject::cast_exact(original, cls) {
+            stat!(Dict);
+            let clone = dict_clone::keys_all_atomic(original);
+            let copied = if clone {
+                PyDict_Copy(original)
+            } else {
+                py_dict_new(dict.len()) as *mut PyObject
+            };
+            if copied.is_null() {
+                return Start::Error;
+            }
+            if memo.memoize(original, copied, &probe) < 0 {
+                copied.decref();
+                return Start::Error;
+            }
+            let mut frame = CopyFrame::new(FrameKind::Dict, original, copied, 0, probe);
+            frame.iter = Some(DictIterGuard::new(original));
+            frame.clone = clone;
+            return Start::Frame(frame);
+        }
+
+        if let Some(set) = PySetObject::cast_exact(original, cls) {
+            stat!(Set);
+            let mut atomic = false;
+            with_critical_section_raw(original, || atomic = set_items_all_atomic(set));
+            if atomic {
+                let copied = PySet_New(original);
+                if copied.is_null() {
+                    return Start::Error;
+                }
+                // `original` may have changed since it was checked; the clone can't have.
+                #[cfg(Py_GIL_DISABLED)]
+                if unlikely(!set_items_all_atomic(copied as *mut PySetObject)) {
                     copied.decref();
-                    return PyResult::error();
+                    return copy_frame_start(original, cls, memo, probe);
                 }
+                if memo.memoize(original, copied, &probe) < 0 {
+                    copied.decref();
+                    return Start::Error;
+                }
+                return Start::Copied(copied);
+            }
 
-                let item_copy = deepcopy(item, memo);
-                item.decref();
+            let sz = set.len();
+            if sz < 0 {
+                return Start::Error;
+            }
+            let snapshot = py_tuple_new(sz);
+            if snapshot.is_null() {
+                return Start::Error;
+            }
 
-                if unlikely(item_copy.is_error()) {
-                    memo.forget(self as _, &probe);
-                    copied.decref();
-                    return PyResult::error();
+            let mut i: Py_ssize_t = 0;
+            with_critical_section_raw(original, || {
+                let mut pos: Py_ssize_t = 0;
+                let mut item: *mut PyObject = ptr::null_mut();
+                let mut hash: Py_hash_t = 0;
+                while set.next_entry(&mut pos, &mut item, &mut hash) != 0 {
+                    item.incref();
+                    snapshot.set_slot_steal_unchecked(i, item);
+                    i += 1;
+                }
+            });
+
+            let copied = py_set_new();
+            if copied.is_null() {
+                snapshot.decref();
+                return Start::Error;
+            }
+            if memo.memoize(original, copied as _, &probe) < 0 {
+                snapshot.decref();
+                copied.decref();
+                return Start::Error;
+            }
+            let mut frame = CopyFrame::new(FrameKind::Set, original, copied as _, i, probe);
+            frame.snapshot = snapshot as _;
+            return Start::Frame(frame);
+        }
+
+        stat!(Frozenset);
+        let frozenset = original as *mut PyFrozensetObject;
+        let sz = frozenset.len();
+        if sz < 0 {
+            return Start::Error;
+        }
+
+        // stdlib exercises memo usability before reconstructing frozenset
+        // members via the reduce-style path, so malformed mappings must
+        // fail here rather than later in nested copies.
+        if memo.ensure_memo_is_valid() < 0 {
+            return Start::Error;
+        }
+        if set_items_all_atomic(frozenset) {
+            return Start::Copied(original.newref());
+        }
+
+        let items = py_tuple_new(sz);
+        if items.is_null() {
+            return Start::Error;
+        }
+        let mut frame = CopyFrame::new(FrameKind::Frozenset, original, items as _, sz, probe);
+        frame.all_same = true;
+        Start::Frame(frame)
+    }
+}
+
+/// The list item at `frame.index`, as a new reference, or null with an
+/// exception set.
+#[inline(always)]
+unsafe fn copy_frame_list_item<P>(frame: &CopyFrame<P>) -> *mut PyObject {
+    unsafe {
+        let original = frame.original as *mut PyListObject;
+        #[cfg(Py_GIL_DISABLED)]
+        let item = {
+            let snapshot = frame.snapshot as *mut PyTupleObject;
+            let i = frame.index - frame.pos;
+            if likely(i < snapshot.length() && frame.index < original.length()) {
+                snapshot.get_borrowed_unchecked(i).newref()
+            } else {
+                ptr::null_mut()
+            }
+        };
+        #[cfg(not(Py_GIL_DISABLED))]
+        let item = original.get_owned_check_bounds(frame.index);
+        if unlikely(item.is_null()) {
+            PyErr_SetString(
+                PyExc_RuntimeError,
+                crate::cstr!("list changed size during iteration"),
+            );
+        }
+        item
+    }
+}
+
+/// Stores the copy of the list item at `frame.index`. Steals `copy`.
+#[inline(always)]
+unsafe fn copy_frame_list_store<M: Memo>(
+    frame: &CopyFrame<M::Probe>,
+    memo: &M,
+    copy: *mut PyObject,
+) -> i32 {
+    unsafe {
+        let copied = frame.copied as *mut PyListObject;
+        let (i, sz) = (frame.index, frame.size);
+        if cfg!(Py_GIL_DISABLED) && memo.unpublished() {
+            copied.set_slot_steal_unchecked(i, copy);
+            return 0;
+        }
+        // Though highly unlikely, since we're exposing list in memo, it theoretically could change.
+        let mut size_changed = false;
+        with_critical_section_raw(copied as _, || {
+            if unlikely(copied.length() != sz) {
+                size_changed = true;
+            } else {
+                #[cfg(not(any(Py_3_12, Py_3_13, Py_3_14)))]
+                let old_item = copied.get_borrowed_unchecked(i);
+                copied.set_slot_steal_unchecked(i, copy);
+                #[cfg(not(any(Py_3_12, Py_3_13, Py_3_14)))]
+                old_item.decref();
+            }
+        });
+        if unlikely(size_changed) {
+            copy.decref();
+            PyErr_SetString(
+                PyExc_RuntimeError,
+                crate::cstr!("list changed size during iteration"),
+            );
+            return -1;
+        }
+        0
+    }
+}
+
+/// The dict's next key and value, as `DictIterGuard::next` has them.
+#[inline(always)]
+unsafe fn copy_frame_dict_next<P>(
+    frame: &mut CopyFrame<P>,
+    key: &mut *mut PyObject,
+    value: &mut *mut PyObject,
+) -> i32 {
+    unsafe {
+        #[cfg(Py_GIL_DISABLED)]
+        {
+            if unlikely((frame.original as *mut PyDictObject).len() != frame.size) {
+                PyErr_SetString(
+                    PyExc_RuntimeError,
+                    crate::cstr!("dictionary changed size during iteration"),
+                );
+                return -1;
+            }
+            if frame.index == frame.size {
+                return 0;
+            }
+            let snapshot = frame.snapshot as *mut PyTupleObject;
+            let i = 2 * frame.index;
+            frame.index += 1;
+            *key = snapshot.get_borrowed_unchecked(i).newref();
+            *value = snapshot.get_borrowed_unchecked(i + 1).newref();
+            1
+        }
+        #[cfg(not(Py_GIL_DISABLED))]
+        frame.iter.as_mut().unwrap_unchecked().next(key, value)
+    }
+}
+
+/// Stores a dict entry's copies. Steals both.
+#[inline(always)]
+unsafe fn copy_frame_dict_store<P>(
+    frame: &mut CopyFrame<P>,
+    key_copy: *mut PyObject,
+    copy: *mut PyObject,
+) -> i32 {
+    unsafe {
+        if frame.clone {
+            return dict_clone::replace(frame.copied, &mut frame.pos, key_copy, copy);
+        }
+        (frame.copied as *mut PyDictObject).set_item_steal_two(key_copy, copy)
+    }
+}
+
+/// Whether the list frame takes `item` as a record (see `dict_clone`): its
+/// clone is then its copy, with no frame of its own. The frame stops looking
+/// after a dict that isn't one.
+#[inline(always)]
+unsafe fn takes_record<M: Memo>(frame: &mut CopyFrame<M::Probe>, item: *mut PyObject) -> bool {
+    unsafe {
+        if M::RECALL_CAN_ERROR || !frame.records || !PyDictObject::is(item.class()) {
+            return false;
+        }
+        frame.records = dict_clone::is_record(item);
+        frame.records
+    }
+}
+
+/// Copies the frame's items in order until one is a container of its own.
+#[inline(always)]
+unsafe fn copy_frame_advance<M: Memo>(
+    frame: &mut CopyFrame<M::Probe>,
+    memo: &mut M,
+) -> Advance<M::Probe> {
+    unsafe {
+        match frame.kind {
+            FrameKind::List => {
+                while frame.index < frame.size {
+                    let item = copy_frame_list_item(frame);
+                    if unlikely(item.is_null()) {
+                        return Advance::Error;
+                    }
+                    match copy_item(item, memo, 2) {
+                        ItemCopy::Copied(copy) => {
+                            item.decref();
+                            if copy_frame_list_store(frame, memo, copy) < 0 {
+                                return Advance::Error;
+                            }
+                        }
+                        ItemCopy::Frame(probe) => {
+                            if takes_record::<M>(frame, item) {
+                                stat!(Dict);
+                                let copy = PyDict_Copy(item);
+                                let failed = copy.is_null() || memo.memoize(item, copy, &probe) < 0;
+                                item.decref();
+                                if failed {
+                                    copy.decref_nullable();
+                                    return Advance::Error;
+                                }
+                                if copy_frame_list_store(frame, memo, copy) < 0 {
+                                    return Advance::Error;
+                                }
+                                frame.index += 1;
+                                continue;
+                            }
+                            frame.pending = item;
+                            return Advance::Child(item, probe);
+                        }
+                        ItemCopy::Error => {
+                            item.decref();
+                            return Advance::Error;
+                        }
+                    }
+                    frame.index += 1;
                 }
+                Advance::Done
+            }
 
-                let raw = item_copy.into_raw();
-                let mut size_changed = false;
-                with_critical_section_raw(copied as _, || {
-                    if unlikely(copied.length() != sz) {
-                        size_changed = true;
+            FrameKind::Tuple => {
+                let original = frame.original as *mut PyTupleObject;
+                let copied = frame.copied as *mut PyTupleObject;
+                while frame.index < frame.size {
+                    let item = original.get_borrowed_unchecked(frame.index);
+                    match copy_item(item, memo, 1) {
+                        ItemCopy::Copied(copy) => {
+                            if copy != item {
+                                frame.all_same = false;
+                            }
+                            copied.set_slot_steal_unchecked(frame.index, copy);
+                        }
+                        ItemCopy::Frame(probe) => return Advance::Child(item, probe),
+                        ItemCopy::Error => return Advance::Error,
+                    }
+                    frame.index += 1;
+                }
+                Advance::Done
+            }
+
+            FrameKind::Dict => {
+                let copied = frame.copied as *mut PyDictObject;
+                loop {
+                    let mut value = frame.value;
+                    if !value.is_null() {
+                        // Back from copying the key: its value is next.
+                        frame.value = ptr::null_mut();
                     } else {
-                        #[cfg(not(any(Py_3_12, Py_3_13, Py_3_14)))]
-                        let old_item = copied.get_borrowed_unchecked(i);
-                        copied.set_slot_steal_unchecked(i, raw);
-                        #[cfg(not(any(Py_3_12, Py_3_13, Py_3_14)))]
-                        old_item.decref();
+                        let mut key: *mut PyObject = ptr::null_mut();
+                        let flag = copy_frame_dict_next(frame, &mut key, &mut value);
+                        if flag == 0 {
+                            return Advance::Done;
+                        }
+                        if flag < 0 {
+                            return Advance::Error;
+                        }
+                        if frame.clone {
+                            // An atomic key is its own copy, already in place.
+                            frame.key_copy = key;
+                        } else {
+                            match copy_item(key, memo, 2) {
+                                ItemCopy::Copied(copy) => {
+                                    key.decref();
+                                    frame.key_copy = copy;
+                                }
+                                ItemCopy::Frame(probe) => {
+                                    frame.pending = key;
+                                    frame.value = value;
+                                    return Advance::Child(key, probe);
+                                }
+                                ItemCopy::Error => {
+                                    key.decref();
+                                    value.decref();
+                                    return Advance::Error;
+                                }
+                            }
+                        }
+                    }
+
+                    match copy_item(value, memo, 2) {
+                        ItemCopy::Copied(copy) => {
+                            value.decref();
+                            let key_copy = frame.key_copy;
+                            frame.key_copy = ptr::null_mut();
+                            if copy_frame_dict_store(frame, key_copy, copy) < 0 {
+                                return Advance::Error;
+                            }
+                        }
+                        ItemCopy::Frame(probe) => {
+                            frame.pending = value;
+                            return Advance::Child(value, probe);
+                        }
+                        ItemCopy::Error => {
+                            value.decref();
+                            return Advance::Error;
+                        }
                     }
-                });
-                if unlikely(size_changed) {
-                    raw.decref();
-                    PyErr_SetString(
-                        PyExc_RuntimeError,
-                        crate::cstr!("list changed size during iteration"),
-                    );
-                    memo.forget(self as _, &probe);
-                    copied.decref();
-                    return PyResult::error();
                 }
             }
 
-            PyResult::ok(copied as _)
+            FrameKind::Set => {
+                let snapshot = frame.snapshot as *mut PyTupleObject;
+                let copied = frame.copied as *mut PySetObject;
+                while frame.index < frame.size {
+                    let item = snapshot.get_borrowed_unchecked(frame.index);
+                    match copy_item(item, memo, 2) {
+                        ItemCopy::Copied(copy) => {
+                            let rc = copied.add_item(copy);
+                            copy.decref();
+                            if rc < 0 {
+                                return Advance::Error;
+                            }
+                        }
+                        ItemCopy::Frame(probe) => return Advance::Child(item, probe),
+                        ItemCopy::Error => return Advance::Error,
+                    }
+                    frame.index += 1;
+                }
+                Advance::Done
+            }
+
+            FrameKind::Frozenset => {
+                let original = frame.original as *mut PyFrozensetObject;
+                let items = frame.copied as *mut PyTupleObject;
+                while frame.index < frame.size {
+                    let mut item: *mut PyObject = ptr::null_mut();
+                    let mut hash: Py_hash_t = 0;
+                    if original.next_entry(&mut frame.pos, &mut item, &mut hash) == 0 {
+                        break;
+                    }
+                    match copy_item(item, memo, 1) {
+                        ItemCopy::Copied(copy) => {
+                            if copy != item {
+                                frame.all_same = false;
+                            }
+                            items.set_slot_steal_unchecked(frame.index, copy);
+                        }
+                        ItemCopy::Frame(probe) => {
+                            frame.pending = item;
+                            return Advance::Child(item, probe);
+                        }
+                        ItemCopy::Error => return Advance::Error,
+                    }
+                    frame.index += 1;
+                }
+                Advance::Done
+            }
         }
     }
 }
-
-impl PyDeepCopy for *mut PyTupleObject {
-    unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
-        unsafe {
-            let sz = self.length();
-            let copied = check!(py_tuple_new(sz));
-
-            let mut all_same = true;
-            for i in 0..sz {
-                let item = self.get_borrowed_unchecked(i);
-                let item_copy = deepcopy(item, memo);
-                if unlikely(item_copy.is_error()) {
-                    copied.decref();
-                    return PyResult::error();
+
+/// Puts the copy of the child `copy_frame_advance` stopped at into the
+/// frame's copy, and moves past it. Steals `copy`.
+unsafe fn copy_frame_deliver<M: Memo>(
+    frame: &mut CopyFrame<M::Probe>,
+    memo: &M,
+    copy: *mut PyObject,
+) -> i32 {
+    unsafe {
+        match frame.kind {
+            FrameKind::List => {
+                frame.pending.decref();
+                frame.pending = ptr::null_mut();
+                if copy_frame_list_store(frame, memo, copy) < 0 {
+                    return -1;
                 }
-                let raw = item_copy.into_raw();
-                if raw != item {
-                    all_same = false;
+                frame.index += 1;
+                0
+            }
+            FrameKind::Tuple => {
+                let original = frame.original as *mut PyTupleObject;
+                if copy != original.get_borrowed_unchecked(frame.index) {
+                    frame.all_same = false;
                 }
-                copied.set_slot_steal_unchecked(i, raw);
+                (frame.copied as *mut PyTupleObject).set_slot_steal_unchecked(frame.index, copy);
+                frame.index += 1;
+                0
             }
-
-            if all_same {
-                copied.decref();
-                return PyResult::ok(self.newref());
+            FrameKind::Dict => {
+                frame.pending.decref();
+                frame.pending = ptr::null_mut();
+                if !frame.value.is_null() {
+                    frame.key_copy = copy;
+                    return 0;
+                }
+                let key_copy = frame.key_copy;
+                frame.key_copy = ptr::null_mut();
+                copy_frame_dict_store(frame, key_copy, copy)
             }
-
-            let existing = memo.recall_probed(self as _, &probe);
-            if unlikely(!existing.is_null()) {
-                copied.decref();
-                return PyResult::ok(existing);
+            FrameKind::Set => {
+                let rc = (frame.copied as *mut PySetObject).add_item(copy);
+                copy.decref();
+                frame.index += 1;
+                rc
             }
-
-            if memo.memoize(self as _, copied as _, &probe) < 0 {
-                copied.decref();
-                return PyResult::error();
+            FrameKind::Frozenset => {
+                if copy != frame.pending {
+                    frame.all_same = false;
+                }
+                frame.pending = ptr::null_mut();
+                (frame.copied as *mut PyTupleObject).set_slot_steal_unchecked(frame.index, copy);
+                frame.index += 1;
+                0
             }
-
-            PyResult::ok(copied as _)
         }
     }
 }
 
-impl PyDeepCopy for *mut PyDictObject {
-    unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
-        unsafe {
-            let copied = check!(py_dict_new(self.len()));
-
-            if memo.memoize(self as _, copied as _, &probe) < 0 {
-                copied.decref();
-                return PyResult::error();
+/// The copy of the frame's original once all its items are copied. Releases
+/// what the frame holds either way.
+unsafe fn copy_frame_finish<M: Memo>(frame: &mut CopyFrame<M::Probe>, memo: &mut M) -> PyResult {
+    unsafe {
+        let mut copied = frame.copied;
+        match frame.kind {
+            FrameKind::List | FrameKind::Dict => {
+                // Set without a GIL, see `dict_snapshot`.
+                frame.snapshot.decref_nullable();
+                return PyResult::ok(copied);
             }
-
-            let mut guard = DictIterGuard::new(self as _);
-            guard.activate();
-            let mut key: *mut PyObject = ptr::null_mut();
-            let mut value: *mut PyObject = ptr::null_mut();
-
-            loop {
-                let flag = guard.next(&mut key, &mut value);
-                if flag == 0 {
-                    break;
-                }
-                if flag < 0 {
-                    memo.forget(self as _, &probe);
+            FrameKind::Set => {
+                frame.snapshot.decref();
+                return PyResult::ok(copied);
+            }
+            FrameKind::Tuple => {
+                if frame.all_same {
                     copied.decref();
-                    return PyResult::error();
+                    return PyResult::ok(frame.original.newref());
                 }
-
-                let key_copy = deepcopy(key, memo);
-                key.decref();
-                if unlikely(key_copy.is_error()) {
-                    value.decref();
-                    memo.forget(self as _, &probe);
+                let existing = memo.recall_probed(frame.original, &frame.probe);
+                if unlikely(!existing.is_null()) {
                     copied.decref();
-                    return PyResult::error();
+                    return PyResult::ok(existing);
                 }
-
-                let val_copy = deepcopy(value, memo);
-                value.decref();
-                if unlikely(val_copy.is_error()) {
-                    key_copy.into_raw().decref();
-                    memo.forget(self as _, &probe);
-                    copied.decref();
-                    return PyResult::error();
+            }
+            FrameKind::Frozenset => {
+                let items = copied;
+                if frame.all_same {
+                    items.decref();
+                    return PyResult::ok(frame.original.newref());
                 }
-
-                let rc = copied.set_item_steal_two(key_copy.into_raw(), val_copy.into_raw());
-
-                if unlikely(rc < 0) {
-                    memo.forget(self as _, &probe);
-                    copied.decref();
+                copied = frozenset_from(items);
+                items.decref();
+                if copied.is_null() {
                     return PyResult::error();
                 }
             }
+        }
 
-            PyResult::ok(copied as _)
+        if memo.memoize(frame.original, copied, &frame.probe) < 0 {
+            copied.decref();
+            return PyResult::error();
         }
+        PyResult::ok(copied)
     }
 }
 
-impl PyDeepCopy for *mut PySetObject {
-    unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
-        unsafe {
-            let sz = self.len();
-            if sz < 0 {
-                return PyResult::error();
+/// Releases what the frame holds after an error, and takes its copy back out
+/// of the memo. A dict's iterator goes when the frame is popped.
+#[cold]
+unsafe fn copy_frame_abort<M: Memo>(frame: &mut CopyFrame<M::Probe>, memo: &mut M) {
+    unsafe {
+        match frame.kind {
+            FrameKind::List | FrameKind::Dict => {
+                frame.snapshot.decref_nullable();
+                frame.pending.decref_nullable();
+                frame.key_copy.decref_nullable();
+                frame.value.decref_nullable();
+                memo.forget(frame.original, &frame.probe);
             }
-            let snapshot = check!(py_tuple_new(sz));
+            FrameKind::Set => {
+                frame.snapshot.decref();
+                memo.forget(frame.original, &frame.probe);
+            }
+            FrameKind::Tuple | FrameKind::Frozenset => {}
+        }
+        frame.copied.decref();
+    }
+}
 
-            let mut i: Py_ssize_t = 0;
-            with_critical_section_raw(self as _, || {
-                let mut pos: Py_ssize_t = 0;
-                let mut item: *mut PyObject = ptr::null_mut();
-                let mut hash: Py_hash_t = 0;
-                while self.next_entry(&mut pos, &mut item, &mut hash) != 0 {
-                    item.incref();
-                    snapshot.set_slot_steal_unchecked(i, item);
-                    i += 1;
-                }
-            });
+#[inline(always)]
+unsafe fn copy_stack_push<M: Memo>(
+    stack: *mut CopyStack<M::Probe>,
+    original: *mut PyObject,
+    cls: *mut PyTypeObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> Start<*mut CopyFrame<M::Probe>> {
+    unsafe {
+        let frame = match copy_frame_start(original, cls, memo, probe) {
+            Start::Frame(frame) => (*stack).push(frame),
+            Start::Copied(copy) => return Start::Copied(copy),
+            Start::Error => return Start::Error,
+        };
+        // Only once it stays put can the guard link itself to the watcher.
+        if let Some(iter) = (*frame).iter.as_mut() {
+            iter.activate();
+        }
+        Start::Frame(frame)
+    }
+}
 
-            let copied = py_set_new();
-            if copied.is_null() {
-                snapshot.decref();
-                return PyResult::error();
-            }
+/// Copies an exact list, tuple, dict, set or frozenset, along with every such
+/// container among its items, on the memo's work stack.
+unsafe fn deepcopy_containers<M: Memo>(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        let stack = memo.copy_stack();
+        if stack.is_null() {
+            let mut own = CopyStack::new();
+            return traverse(object, cls, memo, probe, &mut own);
+        }
+        traverse(object, cls, memo, probe, stack)
+    }
+}
 
-            if memo.memoize(self as _, copied as _, &probe) < 0 {
-                snapshot.decref();
-                copied.decref();
-                return PyResult::error();
+// A raw pointer, not a reference: a nested traversal started from an item
+// pushes onto the same stack.
+unsafe fn traverse<M: Memo>(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    memo: &mut M,
+    probe: M::Probe,
+    stack: *mut CopyStack<M::Probe>,
+) -> PyResult {
+    unsafe {
+        let below = (*stack).depth();
+        let mut frame = match copy_stack_push(stack, object, cls, memo, probe) {
+            Start::Frame(frame) => frame,
+            Start::Copied(copy) => return PyResult::ok(copy),
+            Start::Error => return PyResult::error(),
+        };
+
+        loop {
+            match copy_frame_advance(&mut *frame, memo) {
+                Advance::Child(child, child_probe) => {
+                    // The child's items are copied before the frame's next one.
+                    match copy_stack_push(stack, child, child.class(), memo, child_probe) {
+                        Start::Frame(pushed) => frame = pushed,
+                        Start::Copied(copy) => {
+                            let copy = memo.settle(child, PyResult::ok(copy));
+                            if copy.is_error()
+                                || unlikely(
+                                    copy_frame_deliver(&mut *frame, memo, copy.into_raw()) < 0,
+                                )
+                            {
+                                break;
+                            }
+                        }
+                        Start::Error => break,
+                    }
+                    continue;
+                }
+                Advance::Error => break,
+                Advance::Done => {}
             }
 
-            for j in 0..i {
-                let item = snapshot.get_borrowed_unchecked(j);
-                let item_copy = deepcopy(item, memo);
-                if item_copy.is_error() {
-                    snapshot.decref();
-                    memo.forget(self as _, &probe);
-                    copied.decref();
-                    return PyResult::error();
-                }
-                let raw = item_copy.into_raw();
-                let rc = copied.add_item(raw);
-                raw.decref();
-                if rc < 0 {
-                    snapshot.decref();
-                    memo.forget(self as _, &probe);
-                    copied.decref();
-                    return PyResult::error();
-                }
+            let finished = (*frame).original;
+            let copy = copy_frame_finish(&mut *frame, memo);
+            (*stack).pop();
+            if (*stack).depth() == below {
+                return copy;
             }
+            frame = (*stack).top();
+            let copy = memo.settle(finished, copy);
+            if copy.is_error()
+                || unlikely(copy_frame_deliver(&mut *frame, memo, copy.into_raw()) < 0)
+            {
+                break;
+            }
+        }
 
-            snapshot.decref();
-            PyResult::ok(copied as _)
+        while (*stack).depth() != below {
+            copy_frame_abort(&mut *(*stack).top(), memo);
+            (*stack).pop();
         }
+        PyResult::error()
     }
 }
 
-impl PyDeepCopy for *mut PyFrozensetObject {
-    unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
-        unsafe {
-            let sz = self.len();
-            if sz < 0 {
-                return PyResult::error();
+// collections containers, rebuilt the way deepcopy rebuilds them from their
+// `__reduce_ex__`, minus the trip through Python: an empty instance goes in
+// the memo first, then gets copies of the items. Counter and defaultdict
+// don't override item assignment, so theirs go in through the dict API; an
+// OrderedDict keeps its own order.
+
+/// Fills `copied`, a new dict or dict subclass, with copies of the items of
+/// the dict `original`.
+pub(crate) unsafe fn deepcopy_dict_items_into<M: Memo>(
+    copied: *mut PyObject,
+    original: *mut PyObject,
+    memo: &mut M,
+) -> i32 {
+    unsafe {
+        let mut iter = DictIterGuard::new(original);
+        iter.activate();
+        let status = loop {
+            let mut key: *mut PyObject = ptr::null_mut();
+            let mut value: *mut PyObject = ptr::null_mut();
+            let next = iter.next(&mut key, &mut value);
+            if next <= 0 {
+                break next;
             }
-
-            // stdlib exercises memo usability before reconstructing frozenset
-            // members via the reduce-style path, so malformed mappings must
-            // fail here rather than later in nested copies.
-            if memo.ensure_memo_is_valid() < 0 {
-                return PyResult::error();
+            let key_copy = deepcopy(key, memo).into_raw();
+            let value_copy = if key_copy.is_null() {
+                ptr::null_mut()
+            } else {
+                deepcopy(value, memo).into_raw()
+            };
+            key.decref();
+            value.decref();
+            if value_copy.is_null() {
+                key_copy.decref_nullable();
+                break -1;
             }
-
-            let snapshot = check!(py_tuple_new(sz));
-
-            let mut pos: Py_ssize_t = 0;
-            let mut item: *mut PyObject = ptr::null_mut();
-            let mut hash: Py_hash_t = 0;
-            let mut i: Py_ssize_t = 0;
-            while self.next_entry(&mut pos, &mut item, &mut hash) != 0 {
-                item.incref();
-                snapshot.set_slot_steal_unchecked(i, item);
-                i += 1;
+            if crate::compat::_PyDict_SetItem_Take2(copied, key_copy, value_copy) < 0 {
+                break -1;
             }
+        };
+        iter.cleanup();
+        status
+    }
+}
 
-            let items = py_tuple_new(i);
-            if items.is_null() {
-                snapshot.decref();
-                return PyResult::error();
+unsafe fn deepcopy_ordereddict_items_into<M: Memo>(
+    copied: *mut PyObject,
+    original: *mut PyObject,
+    memo: &mut M,
+) -> i32 {
+    unsafe {
+        let iterator = original.get_iter();
+        if iterator.is_null() {
+            return -1;
+        }
+        loop {
+            let key = PyIter_Next(iterator);
+            if key.is_null() {
+                break;
             }
-
-            for j in 0..i {
-                let orig = snapshot.get_borrowed_unchecked(j);
-                let item_copy = deepcopy(orig, memo);
-                if item_copy.is_error() {
-                    snapshot.decref();
-                    items.decref();
-                    return PyResult::error();
+            let value = PyDict_GetItemWithError(original, key);
+            if value.is_null() {
+                if PyErr_Occurred().is_null() {
+                    PyErr_SetObject(PyExc_KeyError, key);
                 }
-                items.set_slot_steal_unchecked(j, item_copy.into_raw());
+                key.decref();
+                break;
+            }
+            value.incref();
+            let key_copy = deepcopy(key, memo).into_raw();
+            let value_copy = if key_copy.is_null() {
+                ptr::null_mut()
+            } else {
+                deepcopy(value, memo).into_raw()
+            };
+            key.decref();
+            value.decref();
+            let status = if value_copy.is_null() {
+                -1
+            } else {
+                PyObject_SetItem(copied, key_copy, value_copy)
+            };
+            key_copy.decref_nullable();
+            value_copy.decref_nullable();
+            if status < 0 {
+                break;
             }
-            snapshot.decref();
+        }
+        iterator.decref();
+        if PyErr_Occurred().is_null() {
+            0
+        } else {
+            -1
+        }
+    }
+}
 
-            let copied = frozenset_from(items as _);
-            items.decref();
-            if copied.is_null() {
-                return PyResult::error();
+unsafe fn deepcopy_deque_items_into<M: Memo>(
+    copied: *mut PyObject,
+    original: *mut PyObject,
+    memo: &mut M,
+) -> i32 {
+    unsafe {
+        let items = PySequence_List(original) as *mut PyListObject;
+        if items.is_null() {
+            return -1;
+        }
+        for i in 0..items.length() {
+            let item = items.get_borrowed_unchecked(i);
+            let copy = deepcopy(item, memo);
+            if copy.is_error() {
+                items.decref();
+                return -1;
             }
+            // The list holds the only reference it had to item.
+            items.set_slot_steal_unchecked(i, copy.into_raw());
+            item.decref();
+        }
+        let extend = copied.getattr(py_str!("extend"));
+        let result = if extend.is_null() {
+            ptr::null_mut()
+        } else {
+            extend.call_one(items as _)
+        };
+        extend.decref_nullable();
+        items.decref();
+        if result.is_null() {
+            return -1;
+        }
+        result.decref();
+        0
+    }
+}
 
-            if memo.memoize(self as _, copied, &probe) < 0 {
-                copied.decref();
-                return PyResult::error();
+unsafe fn deepcopy_collection<M: Memo>(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        stat!(Collections);
+        let ordered = cls == py_type!(imported "collections.OrderedDict");
+        let deque = cls == py_type!(imported "collections.deque");
+        let copied = if ordered {
+            // Instance attributes are state that `__reduce_ex__` would have to carry over.
+            let dictptr = crate::ffi_ext::_PyObject_GetDictPtr(object);
+            if !dictptr.is_null() && !(*dictptr).is_null() && PyDict_Size(*dictptr) > 0 {
+                return reconstruct(object, cls, memo, probe);
             }
+            (cls as *mut PyObject).call()
+        } else if cls == py_type!(imported "collections.defaultdict") {
+            // The factory is an argument of the reconstruction: copied before the instance exists.
+            let factory = check!(object.getattr(py_str!("default_factory")));
+            let factory_copy = deepcopy(factory, memo);
+            factory.decref();
+            let factory_copy = check!(factory_copy.into_raw());
+            let copied = (cls as *mut PyObject).call_one(factory_copy);
+            factory_copy.decref();
+            copied
+        } else if deque {
+            let maxlen = check!(object.getattr(py_str!("maxlen")));
+            let empty = py_tuple_new(0);
+            let copied = if empty.is_null() {
+                ptr::null_mut()
+            } else {
+                let args = [empty as *mut PyObject, maxlen];
+                PyObject_Vectorcall(cls as _, args.as_ptr(), 2, ptr::null_mut())
+            };
+            empty.decref_nullable();
+            maxlen.decref();
+            copied
+        } else {
+            // Counter: its `__init__` only gets to add items, and its `__reduce__`
+            // drops the instance `__dict__`, so an instance fresh from `tp_new`
+            // is what reduction would start from.
+            let args = check!(py_tuple_new(0));
+            let copied = crate::reduce::call_tp_new(cls, args as _, ptr::null_mut());
+            args.decref();
+            copied
+        };
+        let copied = check!(copied);
+        if memo.memoize(object, copied, &probe) < 0 {
+            copied.decref();
+            return PyResult::error();
+        }
 
-            PyResult::ok(copied)
+        let status = if ordered {
+            deepcopy_ordereddict_items_into(copied, object, memo)
+        } else if deque {
+            deepcopy_deque_items_into(copied, object, memo)
+        } else {
+            deepcopy_dict_items_into(copied, object, memo)
+        };
+        if status < 0 {
+            memo.forget(object, &probe);
+            copied.decref();
+            return PyResult::error();
         }
+        PyResult::ok(copied)
     }
 }
 
 impl PyDeepCopy for *mut PyByteArrayObject {
     unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
         unsafe {
+            stat!(Bytearray);
             let sz = self.len();
             let copied = check!(py_bytearray_new(sz));
 
@@ -458,6 +1665,7 @@ impl PyDeepCopy for *mut PyByteArrayObject {
 impl PyDeepCopy for *mut PyMethodObject {
     unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
         unsafe {
+            stat!(Method);
             let func = self.function();
             let instance = self.self_obj();
 
@@ -488,22 +1696,181 @@ impl PyDeepCopy for *mut PyMethodObject {
 impl PyDeepCopy for *mut PyObject {
     unsafe fn deepcopy<M: Memo>(self, memo: &mut M, probe: M::Probe) -> PyResult {
         unsafe {
+            if memo.expose() < 0 {
+                return PyResult::error();
+            }
             let mut custom_deepcopy_method: *mut PyObject = ptr::null_mut();
             let has = self.get_optional_attr(py_str!("__deepcopy__"), &mut custom_deepcopy_method);
             if has < 0 {
                 return PyResult::error();
             }
             if has > 0 {
-                return deepcopy_custom(self, custom_deepcopy_method, memo, probe);
+                return slow_copy_route!(deepcopy_custom(
+                    self,
+                    custom_deepcopy_method,
+                    memo,
+                    probe
+                ));
             }
 
-            let result = crate::reduce::reconstruct(self, self.class(), memo, probe);
-            if result.is_null() {
-                PyResult::error()
-            } else {
-                PyResult::ok(result)
+            reconstruct(self, self.class(), memo, probe)
+        }
+    }
+}
+
+/// Copies `object` with the copier its type got registered with through
+/// `_C_API`. `native` is `memo` itself, as the copier gets to see it.
+unsafe fn deepcopy_registered<M: Memo>(
+    object: *mut PyObject,
+    copier: *mut PyObject,
+    native: *mut crate::memo::PyMemoObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        stat!(CApi);
+        if memo.expose() < 0 {
+            return PyResult::error();
+        }
+        let copy = PyCapsule_GetPointer(copier, crate::capi::COPIER_CAPSULE);
+        if copy.is_null() {
+            return PyResult::error();
+        }
+        let copy = std::mem::transmute::<*mut std::ffi::c_void, crate::capi::CopyFunc>(copy);
+
+        let copied = check!(copy(object, native as *mut std::ffi::c_void));
+        if copied != object && memo.memoize(object, copied, &probe) < 0 {
+            copied.decref();
+            return PyResult::error();
+        }
+        PyResult::ok(copied)
+    }
+}
+
+/// Exact `array.array`: holds nothing but C values, so a shallow copy of the
+/// buffer is the deep copy. One memcpy through its own `__copy__`, without
+/// escaping the memo for a `__deepcopy__` that only ever calls the same thing.
+unsafe fn deepcopy_buffer<M: Memo>(
+    object: *mut PyObject,
+    dunder_copy: *mut PyObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        stat!(Buffer);
+        let copied = check!(dunder_copy.call_one(object));
+        if memo.memoize(object, copied, &probe) < 0 {
+            copied.decref();
+            return PyResult::error();
+        }
+        PyResult::ok(copied)
+    }
+}
+
+/// Whether `format`, a struct module one, has objects in it. Field names
+/// (`:name:`) don't count.
+unsafe fn format_holds_objects(format: *const std::ffi::c_char) -> bool {
+    unsafe {
+        if format.is_null() {
+            return false;
+        }
+        let mut in_name = false;
+        for &byte in std::ffi::CStr::from_ptr(format).to_bytes() {
+            if byte == b':' {
+                in_name = !in_name;
+            } else if !in_name && byte == b'O' {
+                return true;
             }
         }
+        false
+    }
+}
+
+/// Fills in `view` with the buffer of an instance of a type registered with
+/// `register_buffer`, if it's one a memcpy copies: C-contiguous, and holding
+/// nothing but C values.
+unsafe fn exported_flat_buffer(object: *mut PyObject, view: *mut Py_buffer) -> bool {
+    unsafe {
+        if PyObject_GetBuffer(object, view, PyBUF_RECORDS_RO) < 0 {
+            // Copied as if it weren't registered, which raises again if it's due.
+            PyErr_Clear();
+            return false;
+        }
+        if PyBuffer_IsContiguous(view, b'C' as std::ffi::c_char) != 0
+            && !format_holds_objects((*view).format)
+        {
+            return true;
+        }
+        PyBuffer_Release(view);
+        false
+    }
+}
+
+unsafe fn copy_buffer_into(copied: *mut PyObject, view: &Py_buffer, cls: *mut PyTypeObject) -> i32 {
+    unsafe {
+        let mut target = std::mem::MaybeUninit::<Py_buffer>::uninit();
+        if PyObject_GetBuffer(
+            copied,
+            target.as_mut_ptr(),
+            PyBUF_WRITABLE | PyBUF_C_CONTIGUOUS,
+        ) < 0
+        {
+            return -1;
+        }
+        let target = target.as_mut_ptr();
+        let status = if (*target).len == view.len {
+            ptr::copy_nonoverlapping(
+                view.buf as *const u8,
+                (*target).buf as *mut u8,
+                view.len as usize,
+            );
+            0
+        } else {
+            PyErr_Format(
+                PyExc_ValueError,
+                crate::cstr!("the buffer allocator of '%.200s' made %zd bytes for %zd"),
+                (*cls).tp_name,
+                (*target).len,
+                view.len,
+            );
+            -1
+        };
+        PyBuffer_Release(target);
+        status
+    }
+}
+
+/// A registered buffer exporter: a new instance from its allocator, filled in
+/// with one memcpy. Releases `view`, which `exported_flat_buffer` filled in.
+unsafe fn deepcopy_exported_buffer<M: Memo>(
+    object: *mut PyObject,
+    registered: *mut PyObject,
+    view: &mut Py_buffer,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        stat!(Buffer);
+        let alloc = PyCapsule_GetPointer(registered, crate::capi::BUFFER_CAPSULE);
+        let mut copied = ptr::null_mut();
+        if !alloc.is_null() && memo.expose() == 0 {
+            let alloc =
+                std::mem::transmute::<*mut std::ffi::c_void, crate::capi::BufferAllocFunc>(alloc);
+            copied = alloc(object, view);
+        }
+        if !copied.is_null() && copy_buffer_into(copied, view, object.class()) < 0 {
+            copied.decref();
+            copied = ptr::null_mut();
+        }
+        PyBuffer_Release(view);
+        if copied.is_null() {
+            return PyResult::error();
+        }
+        if memo.memoize(object, copied, &probe) < 0 {
+            copied.decref();
+            return PyResult::error();
+        }
+        PyResult::ok(copied)
     }
 }
 
@@ -514,6 +1881,11 @@ unsafe fn deepcopy_custom<M: Memo>(
     probe: M::Probe,
 ) -> PyResult {
     unsafe {
+        if memo.escape() < 0 {
+            custom_deepcopy_method.decref();
+            return PyResult::error();
+        }
+        stat!(Deepcopy);
         let checkpoint = memo.checkpoint();
         let mut copied = custom_deepcopy_method.call_one(memo.as_call_arg());
 
@@ -533,6 +1905,61 @@ unsafe fn deepcopy_custom<M: Memo>(
 
         custom_deepcopy_method.decref();
 
+        memoize_custom_result(object, copied, memo, probe)
+    }
+}
+
+/// Same as `deepcopy_custom`, but with `__deepcopy__` taken unbound from the
+/// type, so no bound method is created unless the dict memo retry needs one.
+unsafe fn deepcopy_custom_unbound<M: Memo>(
+    object: *mut PyObject,
+    dunder_deepcopy: *mut PyObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
+        if memo.escape() < 0 {
+            return PyResult::error();
+        }
+        stat!(Deepcopy);
+        // The call may drop the type's last reference to the function.
+        dunder_deepcopy.incref();
+        let checkpoint = memo.checkpoint();
+        let args = [object, memo.as_call_arg()];
+        let mut copied = PyObject_Vectorcall(dunder_deepcopy, args.as_ptr(), 2, ptr::null_mut());
+
+        if copied.is_null() {
+            if let Some(saved_checkpoint) = checkpoint {
+                let native_memo = memo.as_native_memo();
+                if !native_memo.is_null() {
+                    let bound = py_method_new(dunder_deepcopy, object) as *mut PyObject;
+                    if !bound.is_null() {
+                        copied = crate::fallback::maybe_retry_with_dict_memo(
+                            object,
+                            bound,
+                            &mut *native_memo,
+                            saved_checkpoint,
+                        );
+                        bound.decref();
+                    }
+                }
+            }
+        }
+
+        dunder_deepcopy.decref();
+
+        memoize_custom_result(object, copied, memo, probe)
+    }
+}
+
+#[inline(always)]
+unsafe fn memoize_custom_result<M: Memo>(
+    object: *mut PyObject,
+    copied: *mut PyObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> PyResult {
+    unsafe {
         if copied.is_null() {
             return PyResult::error();
         }
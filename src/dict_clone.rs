@@ -0,0 +1,305 @@
+//! Dict copies that start as a clone of the original's table.
+//!
+//! When every key of a dict is a literal immutable, its deep copy has the
+//! very same keys in the very same order. `PyDict_Copy` then makes that copy
+//! at the table level: it clones the keys object with the cached hashes (or
+//! shares a split table's keys) instead of inserting entries one by one. All
+//! that's left is to swap each value for its copy, which is written straight
+//! into the entry that holds it.
+//!
+//! A list of records, dicts whose keys and values are all literal immutables
+//! (rows of an API response or a query), goes further: the clone of such a
+//! dict is its deep copy, done. The list takes it for such an item right away
+//! instead of pushing a frame that would only go over its values to put every
+//! one of them back. A table of str keys only has atomic keys by its kind, so
+//! telling a record apart is a scan over its values alone. The rows of a list
+//! tend to be shaped alike, so it stops looking after a dict that isn't one.
+//!
+//! Only done where the table layout is known: 3.11+ with the GIL. Elsewhere
+//! no dict qualifies.
+
+use pyo3_ffi::*;
+
+#[cfg(all(Py_3_11, not(Py_GIL_DISABLED)))]
+mod layout {
+    use pyo3_ffi::*;
+    use std::ptr;
+
+    // Mirrors of CPython's internal pycore_dict.h.
+    #[repr(C)]
+    pub struct DictObject {
+        pub ob_base: PyObject,
+        pub ma_used: Py_ssize_t,
+        pub ma_version_tag: u64,
+        pub ma_keys: *mut DictKeys,
+        pub ma_values: *mut DictValues,
+    }
+
+    #[repr(C)]
+    pub struct DictKeys {
+        pub dk_refcnt: Py_ssize_t,
+        pub dk_log2_size: u8,
+        pub dk_log2_index_bytes: u8,
+        pub dk_kind: u8,
+        pub dk_version: u32,
+        pub dk_usable: Py_ssize_t,
+        pub dk_nentries: Py_ssize_t,
+        pub dk_indices: [u8; 0],
+    }
+
+    #[repr(C)]
+    pub struct DictValues {
+        /// capacity, size, embedded, valid
+        #[cfg(Py_3_13)]
+        pub header: [u8; 4],
+        pub values: [*mut PyObject; 0],
+    }
+
+    #[repr(C)]
+    pub struct KeyEntry {
+        pub me_hash: Py_hash_t,
+        pub me_key: *mut PyObject,
+        pub me_value: *mut PyObject,
+    }
+
+    #[repr(C)]
+    pub struct UnicodeEntry {
+        pub me_key: *mut PyObject,
+        pub me_value: *mut PyObject,
+    }
+
+    pub const DICT_KEYS_GENERAL: u8 = 0;
+
+    /// The managed `__dict__` of `object`, null if not materialized, and
+    /// whether its attributes are kept inline, as values for its type's
+    /// shared keys, instead. Mirrors CPython's internal pycore_object.h.
+    #[inline(always)]
+    pub unsafe fn managed_dict(
+        object: *mut PyObject,
+        cls: *mut PyTypeObject,
+    ) -> (*mut PyObject, bool) {
+        unsafe {
+            let preheader = object as *mut *mut PyObject;
+            #[cfg(Py_3_13)]
+            {
+                use crate::ffi_ext::{tp_flags_of, TPFLAGS_INLINE_VALUES};
+
+                // The values follow the object header, `valid` is the last
+                // byte of theirs.
+                let dict = *preheader.offset(-3);
+                let inline = dict.is_null()
+                    && tp_flags_of(cls) & TPFLAGS_INLINE_VALUES != 0
+                    && (*(object.add(1) as *mut DictValues)).header[3] != 0;
+                (dict, inline)
+            }
+            #[cfg(all(Py_3_12, not(Py_3_13)))]
+            {
+                let _ = cls;
+                let dict_or_values = *preheader.offset(-3);
+                if dict_or_values as usize & 1 != 0 {
+                    return (ptr::null_mut(), true);
+                }
+                (dict_or_values, false)
+            }
+            #[cfg(not(Py_3_12))]
+            {
+                let _ = cls;
+                (*preheader.offset(-3), !(*preheader.offset(-4)).is_null())
+            }
+        }
+    }
+
+    /// Start of the entries of `keys`, past its indices.
+    #[inline(always)]
+    pub unsafe fn entries(keys: *mut DictKeys) -> *mut u8 {
+        unsafe {
+            let indices = ptr::addr_of_mut!((*keys).dk_indices) as *mut u8;
+            indices.add(1usize << (*keys).dk_log2_index_bytes)
+        }
+    }
+
+    /// Key and value slot of the i-th entry of `dict`'s table. The value is
+    /// null for an unused entry.
+    #[inline(always)]
+    pub unsafe fn entry(
+        dict: *mut DictObject,
+        i: Py_ssize_t,
+    ) -> (*mut PyObject, *mut *mut PyObject) {
+        unsafe {
+            let keys = (*dict).ma_keys;
+            let entries = entries(keys);
+            let values = (*dict).ma_values;
+            if !values.is_null() {
+                let key = (*(entries as *mut UnicodeEntry).offset(i)).me_key;
+                let slots = ptr::addr_of_mut!((*values).values) as *mut *mut PyObject;
+                return (key, slots.offset(i));
+            }
+            if (*keys).dk_kind != DICT_KEYS_GENERAL {
+                let entry = (entries as *mut UnicodeEntry).offset(i);
+                return ((*entry).me_key, &mut (*entry).me_value);
+            }
+            let entry = (entries as *mut KeyEntry).offset(i);
+            ((*entry).me_key, &mut (*entry).me_value)
+        }
+    }
+}
+
+/// Whether a deep copy of `dict` would come out with its keys as they are,
+/// and so can start as its clone.
+#[inline(always)]
+pub unsafe fn keys_all_atomic(dict: *mut PyObject) -> bool {
+    #[cfg(all(Py_3_11, not(Py_GIL_DISABLED)))]
+    unsafe {
+        use crate::types::{PyObjectPtr, PyTypeObjectPtr};
+        use std::ptr;
+
+        let mut pos: Py_ssize_t = 0;
+        let mut key: *mut PyObject = ptr::null_mut();
+        let mut value: *mut PyObject = ptr::null_mut();
+        while PyDict_Next(dict, &mut pos, &mut key, &mut value) != 0 {
+            if !key.class().is_literal_immutable() {
+                return false;
+            }
+        }
+        true
+    }
+    #[cfg(not(all(Py_3_11, not(Py_GIL_DISABLED))))]
+    {
+        let _ = dict;
+        false
+    }
+}
+
+/// Whether the clone of `dict` is its deep copy: its keys and values are all
+/// literal immutables.
+#[inline(always)]
+pub unsafe fn is_record(dict: *mut PyObject) -> bool {
+    #[cfg(all(Py_3_11, not(Py_GIL_DISABLED)))]
+    unsafe {
+        use crate::types::{PyObjectPtr, PyTypeObjectPtr};
+        use layout::*;
+        use std::ptr;
+
+        let dict = dict as *mut DictObject;
+        let keys = (*dict).ma_keys;
+        let n = (*keys).dk_nentries;
+        let atomic = |object: *mut PyObject| object.class().is_literal_immutable();
+        let values = (*dict).ma_values;
+        if !values.is_null() {
+            let slots = ptr::addr_of_mut!((*values).values) as *mut *mut PyObject;
+            return (0..n).all(|i| {
+                let value = *slots.offset(i);
+                value.is_null() || atomic(value)
+            });
+        }
+        if (*keys).dk_kind != DICT_KEYS_GENERAL {
+            let entries = entries(keys) as *mut UnicodeEntry;
+            return (0..n).all(|i| {
+                let value = (*entries.offset(i)).me_value;
+                value.is_null() || atomic(value)
+            });
+        }
+        let entries = entries(keys) as *mut KeyEntry;
+        (0..n).all(|i| {
+            let entry = entries.offset(i);
+            (*entry).me_value.is_null() || (atomic((*entry).me_value) && atomic((*entry).me_key))
+        })
+    }
+    #[cfg(not(all(Py_3_11, not(Py_GIL_DISABLED))))]
+    {
+        let _ = dict;
+        false
+    }
+}
+
+/// Replaces the value of `key` in `clone` with `value`. Steals both.
+/// `cursor` is the entry past the last one replaced: keys come in the
+/// clone's order, so the entry is normally the next used one. If it isn't
+/// (a split table keeping another order, or Python code that got hold of the
+/// clone through the memo changed it) the value goes in by lookup instead.
+#[inline(always)]
+pub unsafe fn replace(
+    clone: *mut PyObject,
+    cursor: &mut Py_ssize_t,
+    key: *mut PyObject,
+    value: *mut PyObject,
+) -> i32 {
+    unsafe {
+        #[cfg(all(Py_3_11, not(Py_GIL_DISABLED)))]
+        {
+            use crate::types::PyObjectPtr;
+
+            let dict = clone as *mut layout::DictObject;
+            let n = (*(*dict).ma_keys).dk_nentries;
+            let mut i = *cursor;
+            while i < n {
+                let (entry_key, slot) = layout::entry(dict, i);
+                i += 1;
+                if (*slot).is_null() {
+                    continue;
+                }
+                if std::hint::unlikely(entry_key != key) {
+                    break;
+                }
+                let old = *slot;
+                *slot = value;
+                *cursor = i;
+                // The clone is only tracked if the original was: a copy may
+                // need it when its original didn't.
+                if std::hint::unlikely(PyObject_GC_IsTracked(clone) == 0)
+                    && PyObject_IS_GC(value) != 0
+                {
+                    PyObject_GC_Track(clone as _);
+                }
+                key.decref();
+                old.decref();
+                return 0;
+            }
+        }
+        let _ = cursor;
+        crate::compat::_PyDict_SetItem_Take2(clone, key, value)
+    }
+}
+
+/// Whether the managed `__dict__` (3.11+) of `object` has a `__deepcopy__`,
+/// found without materializing it: until it is, the attributes are kept
+/// inline, and those can only be named so if the type's shared keys have
+/// it, whether or not `object` has a value for it. Names set through
+/// `setattr()` are interned, `object.__setattr__()` takes them as they are.
+/// `None` where the layout isn't known.
+#[inline(always)]
+pub unsafe fn managed_dict_has_deepcopy(
+    object: *mut PyObject,
+    cls: *mut PyTypeObject,
+) -> Option<bool> {
+    #[cfg(all(Py_3_11, not(Py_GIL_DISABLED)))]
+    unsafe {
+        use layout::*;
+
+        let name = crate::py_str!("__deepcopy__");
+        let (dict, inline) = managed_dict(object, cls);
+        if !dict.is_null() {
+            return Some(PyDict_Contains(dict, name) != 0);
+        }
+        if !inline {
+            return Some(false);
+        }
+        let keys = (*(cls as *mut PyHeapTypeObject)).ht_cached_keys as *mut DictKeys;
+        if keys.is_null() {
+            return Some(true);
+        }
+        let entries = entries(keys) as *mut UnicodeEntry;
+        Some((0..(*keys).dk_nentries).any(|i| {
+            let key = (*entries.offset(i)).me_key;
+            key == name
+                || (!key.is_null()
+                    && PyUnicode_GET_LENGTH(key) == PyUnicode_GET_LENGTH(name)
+                    && PyUnicode_Compare(key, name) == 0)
+        }))
+    }
+    #[cfg(not(all(Py_3_11, not(Py_GIL_DISABLED))))]
+    {
+        let _ = (object, cls);
+        None
+    }
+}
@@ -4,6 +4,9 @@ use std::ptr;
 use crate::deepcopy;
 use crate::types::{PyObjectPtr, PyTypeObjectPtr};
 
+/// Below this, compiling costs more than the batch build saves.
+const REPLICATE_BATCH_MIN: std::ffi::c_long = 3;
+
 unsafe extern "C" fn py_replicate(
     _self: *mut PyObject,
     args: *const *mut PyObject,
@@ -33,6 +36,10 @@ unsafe extern "C" fn py_replicate(
             return ptr::null_mut();
         }
 
+        if crate::plan::is_plan(obj) {
+            return crate::plan::replicate(obj, n as Py_ssize_t);
+        }
+
         if n == 0 {
             return PyList_New(0);
         }
@@ -49,6 +56,23 @@ unsafe extern "C" fn py_replicate(
             return out;
         }
 
+        if n >= REPLICATE_BATCH_MIN {
+            // Plain data: walk obj once, then build all n copies side by side.
+            let plan = crate::plan::compile_ex(obj, true);
+            if !plan.is_null() {
+                let out = crate::plan::replicate(plan, n as Py_ssize_t);
+                plan.decref();
+                return out;
+            }
+            if !PyErr_Occurred().is_null() {
+                // deepcopy's own guard goes deeper than the interpreter's recursion limit.
+                if PyErr_ExceptionMatches(PyExc_RecursionError) == 0 {
+                    return ptr::null_mut();
+                }
+                PyErr_Clear();
+            }
+        }
+
         let out = PyList_New(n as Py_ssize_t);
         if out.is_null() {
             return ptr::null_mut();
@@ -122,7 +146,168 @@ unsafe extern "C" fn py_repeatcall(
     }
 }
 
-static mut EXTRA_METHODS: [PyMethodDef; 3] = [PyMethodDef::zeroed(); 3];
+unsafe extern "C" fn py_compile(_self: *mut PyObject, obj: *mut PyObject) -> *mut PyObject {
+    unsafe { crate::plan::compile(obj) }
+}
+
+unsafe fn parallel_default_workers() -> Py_ssize_t {
+    unsafe {
+        let os = PyImport_ImportModule(crate::cstr!("os"));
+        if os.is_null() {
+            return -1;
+        }
+        let mut count_fn = PyObject_GetAttrString(os, crate::cstr!("process_cpu_count"));
+        if count_fn.is_null() && PyErr_ExceptionMatches(PyExc_AttributeError) != 0 {
+            PyErr_Clear();
+            count_fn = PyObject_GetAttrString(os, crate::cstr!("cpu_count"));
+        }
+        os.decref();
+        if count_fn.is_null() {
+            return -1;
+        }
+        let count = PyObject_CallNoArgs(count_fn);
+        count_fn.decref();
+        if count.is_null() {
+            return -1;
+        }
+        let workers = if count == Py_None() {
+            1
+        } else {
+            PyLong_AsSsize_t(count)
+        };
+        count.decref();
+        workers
+    }
+}
+
+unsafe extern "C" fn py_parallel_deepcopy(
+    _self: *mut PyObject,
+    args: *const *mut PyObject,
+    nargs: Py_ssize_t,
+    kwnames: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        let mut workers_arg = if nargs == 2 { *args.add(1) } else { Py_None() };
+        let kwcount = if kwnames.is_null() {
+            0
+        } else {
+            PyTuple_Size(kwnames)
+        };
+        if nargs < 1 || nargs > 2 || nargs + kwcount > 2 {
+            PyErr_SetString(
+                PyExc_TypeError,
+                crate::cstr!("parallel_deepcopy(obj, /, workers=None)"),
+            );
+            return ptr::null_mut();
+        }
+        for i in 0..kwcount {
+            let name = PyTuple_GetItem(kwnames, i);
+            if PyUnicode_CompareWithASCIIString(name, crate::cstr!("workers")) != 0 {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    crate::cstr!("parallel_deepcopy() got an unexpected keyword argument '%U'"),
+                    name,
+                );
+                return ptr::null_mut();
+            }
+            workers_arg = *args.add((nargs + i) as usize);
+        }
+
+        let obj = *args;
+
+        let workers = if workers_arg == Py_None() {
+            parallel_default_workers()
+        } else {
+            let workers = PyLong_AsSsize_t(workers_arg);
+            if workers < 1 && PyErr_Occurred().is_null() {
+                PyErr_SetString(PyExc_ValueError, crate::cstr!("workers must be >= 1"));
+                return ptr::null_mut();
+            }
+            workers
+        };
+        if workers < 0 {
+            return ptr::null_mut();
+        }
+
+        #[cfg(Py_GIL_DISABLED)]
+        {
+            let result = crate::parallel::parallel_deepcopy(obj, workers as usize);
+            if !result.is_null() || !PyErr_Occurred().is_null() {
+                return result;
+            }
+        }
+
+        let (memo, is_tss) = crate::memo::get_memo();
+        if memo.is_null() {
+            return ptr::null_mut();
+        }
+        let copy = deepcopy::deepcopy(obj, &mut *memo);
+        crate::memo::cleanup_memo(memo, is_tss);
+        copy.into_raw()
+    }
+}
+
+unsafe extern "C" fn py_ireplicate(
+    _self: *mut PyObject,
+    args: *const *mut PyObject,
+    nargs: Py_ssize_t,
+    kwnames: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        let mut n_arg = if nargs == 2 { *args.add(1) } else { Py_None() };
+        let kwcount = if kwnames.is_null() {
+            0
+        } else {
+            PyTuple_Size(kwnames)
+        };
+        if nargs < 1 || nargs > 2 || nargs + kwcount > 2 {
+            PyErr_SetString(PyExc_TypeError, crate::cstr!("ireplicate(obj, /, n=None)"));
+            return ptr::null_mut();
+        }
+        for i in 0..kwcount {
+            let name = PyTuple_GetItem(kwnames, i);
+            if PyUnicode_CompareWithASCIIString(name, crate::cstr!("n")) != 0 {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    crate::cstr!("ireplicate() got an unexpected keyword argument '%U'"),
+                    name,
+                );
+                return ptr::null_mut();
+            }
+            n_arg = *args.add((nargs + i) as usize);
+        }
+
+        let mut n = -1;
+        if n_arg != Py_None() {
+            n = PyLong_AsSsize_t(n_arg);
+            if n == -1 && !PyErr_Occurred().is_null() {
+                return ptr::null_mut();
+            }
+            if n < 0 {
+                PyErr_SetString(PyExc_ValueError, crate::cstr!("n must be >= 0"));
+                return ptr::null_mut();
+            }
+        }
+        crate::replicator::replicator_new(*args, n)
+    }
+}
+
+unsafe extern "C" fn py_copy_into(
+    _self: *mut PyObject,
+    args: *const *mut PyObject,
+    nargs: Py_ssize_t,
+    kwnames: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        if nargs != 2 || (!kwnames.is_null() && PyTuple_Size(kwnames) > 0) {
+            PyErr_SetString(PyExc_TypeError, crate::cstr!("copy_into(dst, src, /)"));
+            return ptr::null_mut();
+        }
+        crate::copy_into::copy_into_root(*args, *args.add(1))
+    }
+}
+
+static mut EXTRA_METHODS: [PyMethodDef; 7] = [PyMethodDef::zeroed(); 7];
 
 static mut EXTRA_MODULE_DEF: PyModuleDef = PyModuleDef {
     m_base: PyModuleDef_HEAD_INIT,
@@ -145,7 +330,7 @@ pub unsafe fn create_module(parent: *mut PyObject) -> i32 {
             },
             ml_flags: METH_FASTCALL | METH_KEYWORDS,
             ml_doc: crate::cstr!(
-                "replicate(obj, n, /)\n--\n\nReturns n deep copies of the object in a list."
+                "replicate(obj, n, /)\n--\n\nReturns n deep copies of the object in a list.\n\nIf obj is a plan returned by compile(), the plan is run n times instead."
             ),
         };
         EXTRA_METHODS[1] = PyMethodDef {
@@ -158,7 +343,52 @@ pub unsafe fn create_module(parent: *mut PyObject) -> i32 {
                 "repeatcall(function, size, /)\n--\n\nCall function repeatedly size times."
             ),
         };
-        EXTRA_METHODS[2] = PyMethodDef::zeroed();
+        EXTRA_METHODS[2] = PyMethodDef {
+            ml_name: crate::cstr!("compile"),
+            ml_meth: PyMethodDefPointer { PyCFunction: py_compile },
+            ml_flags: METH_O,
+            ml_doc: crate::cstr!(
+                "compile(obj, /)\n--\n\nWalk obj once and return a plan that replicate() turns into deep copies of it."
+            ),
+        };
+        EXTRA_METHODS[3] = PyMethodDef {
+            ml_name: crate::cstr!("parallel_deepcopy"),
+            ml_meth: PyMethodDefPointer {
+                PyCFunctionFastWithKeywords: py_parallel_deepcopy,
+            },
+            ml_flags: METH_FASTCALL | METH_KEYWORDS,
+            ml_doc: crate::cstr!(
+                "parallel_deepcopy(obj, /, workers=None)\n--\n\nDeep copy obj, splitting the items of a large top-level list, tuple or dict between\nworker threads.\n\nThe workers share one memo, so objects referenced from several chunks and cycles\nbetween them still get a single copy. Only free-threaded builds copy in parallel;\nelsewhere, and for objects too small to be worth it, this is deepcopy(obj).\nworkers defaults to os.process_cpu_count()."
+            ),
+        };
+        EXTRA_METHODS[4] = PyMethodDef {
+            ml_name: crate::cstr!("copy_into"),
+            ml_meth: PyMethodDefPointer {
+                PyCFunctionFastWithKeywords: py_copy_into,
+            },
+            ml_flags: METH_FASTCALL | METH_KEYWORDS,
+            ml_doc: crate::cstr!(
+                "copy_into(dst, src, /)\n--\n\nMake dst a deep copy of src, reusing the lists and dicts it already has, and return it.\n\nWherever dst holds a list or dict of the same exact type as src at the same place, its\ncontents are overwritten in place; everything else is deep copied anew. If dst itself\ncan't be reused, a new deep copy of src is returned. dst must not share containers\nwith src, and is left half updated if the copy fails."
+            ),
+        };
+        EXTRA_METHODS[5] = PyMethodDef {
+            ml_name: crate::cstr!("ireplicate"),
+            ml_meth: PyMethodDefPointer {
+                PyCFunctionFastWithKeywords: py_ireplicate,
+            },
+            ml_flags: METH_FASTCALL | METH_KEYWORDS,
+            ml_doc: crate::cstr!(
+                "ireplicate(obj, /, n=None)\n--\n\nReturns an iterator over n deep copies of the object, or over copies without end if n\nis None.\n\nEach copy is made when it's asked for, so only the ones still referenced take memory.\nEquivalent of (deepcopy(obj) for _ in range(n)), but faster. If obj is a plan returned\nby compile(), each step runs the plan instead."
+            ),
+        };
+        EXTRA_METHODS[6] = PyMethodDef::zeroed();
+
+        if crate::plan::plan_ready_type() < 0
+            || crate::snapshot::snapshotter_ready_type() < 0
+            || crate::replicator::replicator_ready_type() < 0
+        {
+            return -1;
+        }
 
         EXTRA_MODULE_DEF.m_methods = ptr::addr_of_mut!(EXTRA_METHODS).cast::<PyMethodDef>();
 
@@ -167,6 +397,29 @@ pub unsafe fn create_module(parent: *mut PyObject) -> i32 {
             return -1;
         }
 
+        let plan_type = ptr::addr_of_mut!(crate::plan::Plan_Type) as *mut PyObject;
+        if PyModule_AddObject(module, crate::cstr!("Plan"), plan_type.newref()) < 0 {
+            module.decref();
+            return -1;
+        }
+        let snapshotter_type =
+            ptr::addr_of_mut!(crate::snapshot::Snapshotter_Type) as *mut PyObject;
+        if PyModule_AddObject(
+            module,
+            crate::cstr!("Snapshotter"),
+            snapshotter_type.newref(),
+        ) < 0
+        {
+            module.decref();
+            return -1;
+        }
+        let replicator_type =
+            ptr::addr_of_mut!(crate::replicator::Replicator_Type) as *mut PyObject;
+        if PyModule_AddObject(module, crate::cstr!("Replicator"), replicator_type.newref()) < 0 {
+            module.decref();
+            return -1;
+        }
+
         crate::add_submodule(parent, crate::cstr!("extra"), module)
     }
 }
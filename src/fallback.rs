@@ -5,6 +5,7 @@ use std::ptr;
 use crate::ffi_ext::PyUnicode_FromFormat;
 use crate::memo::{MemoCheckpoint, PyMemoObject};
 use crate::state::{OnIncompatible, STATE};
+use crate::stats::stat;
 use crate::types::PyObjectPtr;
 
 macro_rules! cleanup_traceback_build {
@@ -217,7 +218,7 @@ unsafe fn make_expression_with_memo(expression: *mut PyObject) -> *mut PyObject
     }
 }
 
-unsafe fn get_caller_frame_info() -> *mut PyObject {
+pub(crate) unsafe fn get_caller_frame_info() -> *mut PyObject {
     unsafe {
         let mut result: *mut PyObject = ptr::null_mut();
         let mut linecache_module: *mut PyObject = ptr::null_mut();
@@ -238,6 +239,11 @@ unsafe fn get_caller_frame_info() -> *mut PyObject {
 
         while !frame.is_null() {
             code = PyFrame_GetCode(frame);
+            #[cfg(not(Py_3_12))]
+            if !code.is_null() && crate::patch::is_patched_code(code as *mut PyObject) {
+                (code as *mut PyObject).decref();
+                code = ptr::null_mut();
+            }
             if code.is_null() {
                 let back = PyFrame_GetBack(frame);
                 (frame as *mut PyObject).decref();
@@ -753,6 +759,8 @@ pub unsafe fn maybe_retry_with_dict_memo(
             return ptr::null_mut();
         }
 
+        stat!(DictMemoRetry);
+
         #[allow(deprecated)]
         PyErr_Fetch(
             &mut exception_type,
@@ -17,8 +17,36 @@ extern "C" {
     pub static mut PyMethod_Type: PyTypeObject;
     pub static mut _PyNone_Type: PyTypeObject;
     pub static mut _PyNotImplemented_Type: PyTypeObject;
+    pub static mut PyMethodDescr_Type: PyTypeObject;
+    pub static mut PyMemberDescr_Type: PyTypeObject;
+    pub static mut PyStaticMethod_Type: PyTypeObject;
 }
 
+/// PyDescr_TYPE is a macro in CPython; access via struct layout.
+#[repr(C)]
+pub struct PyDescrObject {
+    pub ob_base: PyObject,
+    pub d_type: *mut PyTypeObject,
+    pub d_name: *mut PyObject,
+    pub d_qualname: *mut PyObject,
+}
+
+#[inline(always)]
+pub unsafe fn PyDescr_TYPE(d: *mut PyObject) -> *mut PyTypeObject {
+    unsafe { (*(d as *mut PyDescrObject)).d_type }
+}
+
+/// The descriptor `__slots__` and `tp_members` entries get.
+#[repr(C)]
+pub struct PyMemberDescrObject {
+    pub d_common: PyDescrObject,
+    pub d_member: *mut PyMemberDef,
+}
+
+/// `PyMemberDef.type_code` and `flags` values, from `descrobject.h`.
+pub const Py_T_OBJECT_EX: core::ffi::c_int = 16;
+pub const Py_READONLY: core::ffi::c_int = 1;
+
 /// PyMethod_Function is a macro in CPython; access via struct layout.
 #[repr(C)]
 pub struct PyMethodObject {
@@ -54,8 +82,22 @@ extern "C" {
     #[cfg(Py_3_12)]
     pub fn PyFunction_SetVectorcall(callable: *mut PyObject, vc: vectorcallfunc);
     pub fn PyVectorcall_Function(callable: *mut PyObject) -> Option<vectorcallfunc>;
+    /// Borrowed reference (or null) from the type's MRO, without raising.
+    pub fn _PyType_Lookup(tp: *mut PyTypeObject, name: *mut PyObject) -> *mut PyObject;
+    /// `_PyType_Lookup`, as a new reference.
+    #[cfg(Py_GIL_DISABLED)]
+    pub fn _PyType_LookupRef(tp: *mut PyTypeObject, name: *mut PyObject) -> *mut PyObject;
+    pub fn _PyObject_GetDictPtr(obj: *mut PyObject) -> *mut *mut PyObject;
 }
 
+/// Instances keep their `__dict__` (or inline values) at a fixed pre-header slot.
+#[cfg(Py_3_11)]
+pub const TPFLAGS_MANAGED_DICT: c_ulong = 1 << 4;
+
+/// Instances keep their attributes as values right after the object header.
+#[cfg(Py_3_13)]
+pub const TPFLAGS_INLINE_VALUES: c_ulong = 1 << 2;
+
 #[inline(always)]
 pub unsafe fn PySequence_Fast_GET_SIZE(o: *mut PyObject) -> Py_ssize_t {
     unsafe { Py_SIZE(o) }
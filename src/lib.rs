@@ -11,19 +11,32 @@ mod ffi_ext;
 mod about;
 #[allow(dead_code)]
 mod cache;
+mod capi;
 mod compat;
 mod config;
 mod copy;
+mod copy_into;
+mod copy_stack;
 mod critical_section;
 mod deepcopy;
+mod dict_clone;
 mod dict_iter;
 mod extra;
 mod fallback;
 mod memo;
+#[cfg(Py_GIL_DISABLED)]
+mod parallel;
 mod patch;
+mod plan;
 mod recursion;
 mod reduce;
+mod replicator;
+mod shared_types;
+mod slow_copy;
+mod snapshot;
 mod state;
+mod stats;
+mod type_cache;
 mod types;
 
 use crate::memo::PyMemoObject;
@@ -39,7 +52,7 @@ unsafe extern "C" fn py_copy(_self: *mut PyObject, obj: *mut PyObject) -> *mut P
 }
 
 // ══════════════════════════════════════════════════════════════
-//  deepcopy(x, memo=None, /) — METH_FASTCALL | METH_KEYWORDS
+//  deepcopy(x, memo=None, /, *, share=None) — METH_FASTCALL | METH_KEYWORDS
 // ══════════════════════════════════════════════════════════════
 
 pub(crate) unsafe extern "C" fn py_deepcopy(
@@ -51,6 +64,7 @@ pub(crate) unsafe extern "C" fn py_deepcopy(
     unsafe {
         let mut obj: *mut PyObject = ptr::null_mut();
         let mut memo_arg: *mut PyObject = Py_None();
+        let mut share: *mut PyObject = ptr::null_mut();
 
         // ── Fast path: no keyword arguments ─────────────────
         let kwcount = if kwnames.is_null() {
@@ -121,6 +135,8 @@ pub(crate) unsafe extern "C" fn py_deepcopy(
                     }
                     memo_arg = val;
                     seen_memo_kw = true;
+                } else if PyUnicode_CompareWithASCIIString(name, cstr!("share")) == 0 {
+                    share = val;
                 } else {
                     PyErr_Format(
                         PyExc_TypeError,
@@ -140,6 +156,17 @@ pub(crate) unsafe extern "C" fn py_deepcopy(
             }
         }
 
+        // deepcopy(x, share=...)
+        if unlikely(!share.is_null() && share != Py_None()) {
+            return shared_types::deepcopy_sharing(obj, memo_arg, share);
+        }
+        deepcopy_top(obj, memo_arg)
+    }
+}
+
+/// `deepcopy` once its arguments are parsed.
+pub(crate) unsafe fn deepcopy_top(obj: *mut PyObject, memo_arg: *mut PyObject) -> *mut PyObject {
+    unsafe {
         // ── Dispatch based on memo type ─────────────────────
         if likely(memo_arg == Py_None()) {
             let tp = obj.class();
@@ -152,6 +179,11 @@ pub(crate) unsafe extern "C" fn py_deepcopy(
                 if unlikely(pm.is_null()) {
                     return ptr::null_mut();
                 }
+                // copium.config.apply(slow_copy_callback=...)
+                if unlikely(!STATE.slow_copy_callback.is_null()) {
+                    let release = |pm: &mut PyMemoObject| memo::cleanup_memo(pm, is_tss);
+                    return slow_copy::deepcopy_sampled(obj, &mut *pm, release).into_raw();
+                }
                 let result = deepcopy::deepcopy(obj, &mut *pm);
                 memo::cleanup_memo(pm, is_tss);
                 return result.into_raw();
@@ -163,7 +195,7 @@ pub(crate) unsafe extern "C" fn py_deepcopy(
                 return ptr::null_mut();
             }
             let mut m = DictMemo::new(dict as _);
-            let result = deepcopy::deepcopy(obj, &mut m);
+            let result = deepcopy_with(obj, &mut m);
             drop(m);
             dict.decref();
             return result.into_raw();
@@ -172,23 +204,35 @@ pub(crate) unsafe extern "C" fn py_deepcopy(
         let memo_type = memo_arg.class();
 
         if let Some(memo) = PyMemoObject::cast_exact(memo_arg, memo_type) {
-            let result = deepcopy::deepcopy(obj, &mut *memo);
+            let result = deepcopy_with(obj, &mut *memo);
             return result.into_raw();
         }
 
         if let Some(memo) = PyDictObject::cast_exact(memo_arg, memo_type) {
             let mut m = DictMemo::new(memo);
-            let result = deepcopy::deepcopy(obj, &mut m);
+            let result = deepcopy_with(obj, &mut m);
             return result.into_raw();
         }
 
         // Any other mapping-like object
         let mut m = AnyMemo::new(memo_arg);
-        let result = deepcopy::deepcopy(obj, &mut m);
+        let result = deepcopy_with(obj, &mut m);
         result.into_raw()
     }
 }
 
+/// Top-level `deepcopy` with a memo that isn't the thread's own.
+#[inline(always)]
+unsafe fn deepcopy_with<M: memo::Memo>(obj: *mut PyObject, memo: &mut M) -> deepcopy::PyResult {
+    unsafe {
+        // copium.config.apply(slow_copy_callback=...)
+        if unlikely(!STATE.slow_copy_callback.is_null()) {
+            return slow_copy::deepcopy_sampled(obj, memo, |_| {});
+        }
+        deepcopy::deepcopy(obj, memo)
+    }
+}
+
 // ══════════════════════════════════════════════════════════════
 //  replace(obj, /, **changes) — 3.13+ only
 // ══════════════════════════════════════════════════════════════
@@ -270,7 +314,7 @@ unsafe extern "C" fn py_replace(
 //  Module definition
 // ══════════════════════════════════════════════════════════════
 
-static mut MAIN_METHODS: [PyMethodDef; 4] = [PyMethodDef::zeroed(); 4];
+static mut MAIN_METHODS: [PyMethodDef; 5] = [PyMethodDef::zeroed(); 5];
 
 unsafe fn init_methods() {
     unsafe {
@@ -292,7 +336,21 @@ unsafe fn init_methods() {
                 PyCFunctionFastWithKeywords: py_deepcopy,
             },
             ml_flags: METH_FASTCALL | METH_KEYWORDS,
-            ml_doc: cstr!("deepcopy(x, memo=None, /)\n--\n\nReturn a deep copy of obj."),
+            ml_doc: cstr!(
+                "deepcopy(x, memo=None, /, *, share=None)\n--\n\nReturn a deep copy of obj.\n\n\
+                 :param share: a type or types whose instances are shared rather than copied \
+                 during this call."
+            ),
+        };
+        i += 1;
+
+        MAIN_METHODS[i] = PyMethodDef {
+            ml_name: cstr!("stats"),
+            ml_meth: PyMethodDefPointer {
+                PyCFunctionFastWithKeywords: stats::py_stats,
+            },
+            ml_flags: METH_FASTCALL | METH_KEYWORDS,
+            ml_doc: cstr!("stats(*, reset=False)\n--\n\nReturn how many objects took each deepcopy route, summed over all threads.\n\n'reduce_types' maps the types that went through the reduce protocol to their counts.\nOnly available when built with the 'stats' feature; raises RuntimeError otherwise."),
         };
         i += 1;
 
@@ -380,6 +438,10 @@ unsafe extern "C" fn orcopium_exec(module: *mut PyObject) -> i32 {
             return -1;
         }
 
+        if capi::init(module) < 0 {
+            return -1;
+        }
+
         0
     }
 }
@@ -387,16 +449,25 @@ unsafe extern "C" fn orcopium_exec(module: *mut PyObject) -> i32 {
 unsafe extern "C" fn orcopium_free(_: *mut c_void) {
     unsafe {
         dict_iter::dict_iter_module_cleanup();
+        capi::cleanup();
         state::cleanup();
     }
 }
 
-#[cfg(all(Py_3_14, Py_GIL_DISABLED))]
-static mut MODULE_SLOTS: [PyModuleDef_Slot; 3] = [
+const MODULE_SLOT_COUNT: usize = 2 + cfg!(all(Py_3_14, Py_GIL_DISABLED)) as usize;
+
+// No Py_mod_multiple_interpreters slot: module state lives in statics (the
+// cache.rs slots, STATE in state.rs, the capi.rs registry and the static type
+// objects), which the default lets subinterpreters sharing the main GIL use,
+// but not isolated ones.
+// Declaring Py_MOD_PER_INTERPRETER_GIL_SUPPORTED would take moving all of that
+// into module state first; see "Subinterpreters" in the README.
+static mut MODULE_SLOTS: [PyModuleDef_Slot; MODULE_SLOT_COUNT] = [
     PyModuleDef_Slot {
         slot: Py_mod_exec,
         value: orcopium_exec as *mut _,
     },
+    #[cfg(all(Py_3_14, Py_GIL_DISABLED))]
     PyModuleDef_Slot {
         slot: Py_mod_gil,
         value: Py_MOD_GIL_NOT_USED,
@@ -407,18 +478,6 @@ static mut MODULE_SLOTS: [PyModuleDef_Slot; 3] = [
     },
 ];
 
-#[cfg(not(all(Py_3_14, Py_GIL_DISABLED)))]
-static mut MODULE_SLOTS: [PyModuleDef_Slot; 2] = [
-    PyModuleDef_Slot {
-        slot: Py_mod_exec,
-        value: orcopium_exec as *mut _,
-    },
-    PyModuleDef_Slot {
-        slot: 0,
-        value: ptr::null_mut(),
-    },
-];
-
 static mut MODULE_DEF: PyModuleDef = PyModuleDef {
     m_base: PyModuleDef_HEAD_INIT,
     m_name: b"copium\0".as_ptr().cast(),
@@ -115,6 +115,24 @@ impl Memo for DictMemo {
     unsafe fn ensure_memo_is_valid(&mut self) -> i32 {
         unsafe { self.ensure_keepalive() }
     }
+
+    /// The keep-alive list isn't a copy.
+    unsafe fn copied_counts(&mut self) -> (usize, usize) {
+        unsafe {
+            let entries = self.dict.len() as usize;
+            let pykey = PyLong_FromVoidPtr(self.dict as *mut c_void);
+            let keeps = if pykey.is_null() {
+                -1
+            } else {
+                PyDict_Contains(self.dict as *mut PyObject, pykey)
+            };
+            pykey.decref_nullable();
+            if keeps < 0 {
+                PyErr_Clear();
+            }
+            (entries - (keeps > 0) as usize, entries)
+        }
+    }
 }
 
 impl Drop for DictMemo {
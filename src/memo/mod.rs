@@ -2,16 +2,24 @@ mod any;
 mod dict;
 mod native;
 mod pytype;
+#[cfg_attr(not(Py_GIL_DISABLED), allow(dead_code))]
+mod sharded;
 mod table;
 mod tss;
 
 use pyo3_ffi::*;
 use std::ptr;
 
+use crate::copy_stack::CopyStack;
+use crate::deepcopy::PyResult;
+
 pub use any::AnyMemo;
 pub use dict::DictMemo;
 pub use native::PyMemoObject;
 pub use pytype::{memo_ready_type, Memo_Type};
+pub use sharded::ShardedMemo;
+#[cfg(Py_GIL_DISABLED)]
+pub(crate) use table::hash_pointer;
 pub use table::{KeepaliveVec, MemoTable, UndoLog};
 pub use tss::{cleanup_memo, get_memo, pymemo_alloc};
 
@@ -44,6 +52,52 @@ pub trait Memo: Sized {
 
     unsafe fn as_call_arg(&mut self) -> *mut PyObject;
 
+    /// Called with whatever copying `original` produced, right after. A memo
+    /// shared between threads gives back the copy that got memoized first.
+    #[inline(always)]
+    unsafe fn settle(&mut self, original: *mut PyObject, copy: PyResult) -> PyResult {
+        let _ = original;
+        copy
+    }
+
+    /// Probe for copying a container that nothing but its parent refers to,
+    /// or `None` when this memo can't elide the lookup for it.
+    #[inline(always)]
+    unsafe fn deferred_probe(&mut self) -> Option<Self::Probe> {
+        None
+    }
+
+    /// Called right before `as_call_arg` hands the memo to Python code.
+    #[inline(always)]
+    unsafe fn escape(&mut self) -> i32 {
+        0
+    }
+
+    /// Whether the copies of this memo's containers can't have been seen by
+    /// another thread yet: nothing but the memo leads to them, and no Python
+    /// code has got hold of it.
+    #[inline(always)]
+    fn unpublished(&self) -> bool {
+        false
+    }
+
+    /// Called right before code other than copium's own gets to run mid-copy,
+    /// with or without the memo.
+    #[inline(always)]
+    unsafe fn keep_originals(&mut self) {}
+
+    /// Called right before reductions, copiers and attribute lookups: they may
+    /// hand back originals whose copies were deferred, or drop the last
+    /// reference to memoized ones. The memo has to know of both by then.
+    #[inline(always)]
+    unsafe fn expose(&mut self) -> i32 {
+        unsafe {
+            let status = self.escape();
+            self.keep_originals();
+            status
+        }
+    }
+
     #[inline(always)]
     unsafe fn ensure_memo_is_valid(&mut self) -> i32 {
         0
@@ -54,8 +108,22 @@ pub trait Memo: Sized {
         None
     }
 
+    /// Work stack for the container traversal, or null to have the traversal
+    /// use one of its own.
+    #[inline(always)]
+    unsafe fn copy_stack(&mut self) -> *mut CopyStack<Self::Probe> {
+        ptr::null_mut()
+    }
+
     #[inline(always)]
     unsafe fn as_native_memo(&mut self) -> *mut PyMemoObject {
         ptr::null_mut()
     }
+
+    /// Copies this memo holds, and the entries it holds them with, for the
+    /// slow-copy sampler; zeros when telling would call into Python.
+    #[inline(always)]
+    unsafe fn copied_counts(&mut self) -> (usize, usize) {
+        (0, 0)
+    }
 }
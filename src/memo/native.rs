@@ -1,5 +1,11 @@
-use super::{KeepaliveVec, Memo, MemoCheckpoint, MemoTable, UndoLog};
-use crate::memo::table::{hash_pointer, TOMBSTONE};
+use super::{KeepaliveVec, Memo, MemoCheckpoint, MemoTable, ShardedMemo, UndoLog};
+use crate::copy_stack::{self, CopyStack};
+use crate::deepcopy::PyResult;
+use crate::memo::table::{
+    hash_pointer, DEFERRED, KEEP_RETAIN_MAX, KEEP_RETAIN_TARGET, MEMO_RETAIN_MAX_SLOTS,
+    MEMO_RETAIN_SHRINK_TO,
+};
+use crate::state::{MemoRetention, STATE};
 use crate::types::PyObjectPtr;
 use pyo3_ffi::*;
 use std::ffi::c_void;
@@ -13,6 +19,28 @@ pub struct PyMemoObject {
     pub keepalive: KeepaliveVec,
     pub undo_log: UndoLog,
     pub dict_proxy: *mut PyObject,
+    /// `(original, copy)` pairs whose table insert was elided, see `defer`.
+    pub deferred: KeepaliveVec,
+    /// Set while the memo hasn't been handed to Python code.
+    pub defer_unique: bool,
+    /// Set while `keepalive` holds none of the table's keys, see `keep_originals`.
+    pub lazy_keepalive: bool,
+    /// Decaying high-water marks of recent calls on this thread, see `reset`.
+    pub recent_entries: usize,
+    pub recent_items: usize,
+    /// When set, lookups and inserts go to this memo instead of `table`, see `sharded`.
+    #[cfg(Py_GIL_DISABLED)]
+    pub shared: *const ShardedMemo,
+    /// Frames of the container traversal, see `deepcopy_containers`.
+    pub stack: CopyStack<usize>,
+}
+
+/// Adaptive high-water marks lose 1/8 per call.
+const RETAIN_DECAY_SHIFT: u32 = 3;
+
+#[inline(always)]
+fn decay(recent: usize, now: usize) -> usize {
+    (recent - (recent >> RETAIN_DECAY_SHIFT)).max(now)
 }
 
 impl PyMemoObject {
@@ -22,21 +50,154 @@ impl PyMemoObject {
             ptr::write(ptr::addr_of_mut!(self.keepalive), KeepaliveVec::new());
             ptr::write(ptr::addr_of_mut!(self.undo_log), UndoLog::new());
             ptr::write(ptr::addr_of_mut!(self.dict_proxy), ptr::null_mut());
+            ptr::write(ptr::addr_of_mut!(self.deferred), KeepaliveVec::new());
+            ptr::write(ptr::addr_of_mut!(self.defer_unique), false);
+            ptr::write(ptr::addr_of_mut!(self.lazy_keepalive), false);
+            ptr::write(ptr::addr_of_mut!(self.recent_entries), 0);
+            ptr::write(ptr::addr_of_mut!(self.recent_items), 0);
+            #[cfg(Py_GIL_DISABLED)]
+            ptr::write(ptr::addr_of_mut!(self.shared), ptr::null());
+            ptr::write(ptr::addr_of_mut!(self.stack), CopyStack::new());
+        }
+    }
+
+    #[inline(always)]
+    pub(crate) fn shared(&self) -> Option<&ShardedMemo> {
+        #[cfg(Py_GIL_DISABLED)]
+        {
+            unsafe { self.shared.as_ref() }
+        }
+        #[cfg(not(Py_GIL_DISABLED))]
+        {
+            None
+        }
+    }
+
+    /// Borrowed copy memoized for `key`, or null.
+    #[inline(always)]
+    pub(crate) fn lookup_key(&self, key: usize) -> *mut PyObject {
+        let hash = hash_pointer(key);
+        match self.shared() {
+            Some(shared) => shared.lookup(key, hash),
+            None => self.table.lookup_h(key, hash),
         }
     }
 
+    // Empty the memo for reuse, keeping what the retention policy allows.
+    //
+    // "fixed" shrinks whatever grew past the `*_RETAIN_*` caps. "minimal"
+    // gives everything back. "adaptive" keeps decaying high-water marks of
+    // how many table entries and keepalive items recent calls needed, holds
+    // on to capacity for that and releases anything more than twice over it.
+    // A thread that keeps alternating small and huge copies keeps the huge
+    // table; once the huge copies stop, the mark halves about every 5 calls.
     pub fn reset(&mut self) {
+        let retention = unsafe { (*ptr::addr_of!(STATE)).memo_retention };
+        let (table_limit, table_target, items_limit, items_target) = match retention {
+            MemoRetention::Fixed => (
+                MEMO_RETAIN_MAX_SLOTS,
+                MEMO_RETAIN_SHRINK_TO,
+                KEEP_RETAIN_MAX,
+                KEEP_RETAIN_TARGET,
+            ),
+            MemoRetention::Minimal => {
+                self.recent_entries = 0;
+                self.recent_items = 0;
+                let table_min = MemoTable::slots_for(0);
+                (table_min, table_min, 0, 0)
+            }
+            MemoRetention::Adaptive => {
+                let items = self
+                    .keepalive
+                    .items
+                    .len()
+                    .max(self.deferred.items.len())
+                    .max(self.undo_log.keys.len());
+                self.recent_entries = decay(self.recent_entries, self.table.used);
+                self.recent_items = decay(self.recent_items, items);
+                let table_target = MemoTable::slots_for(self.recent_entries);
+                (
+                    table_target * 2,
+                    table_target,
+                    (self.recent_items * 2).max(KEEP_RETAIN_TARGET),
+                    self.recent_items,
+                )
+            }
+        };
+
         self.keepalive.clear();
-        self.keepalive.shrink_if_large();
+        self.keepalive.shrink_to(items_limit, items_target);
         self.undo_log.clear();
-        self.undo_log.shrink_if_large();
-        self.table.reset();
+        self.undo_log.shrink_to(items_limit, items_target);
+        self.deferred.clear();
+        self.deferred.shrink_to(items_limit, items_target);
+        self.table.reset(table_limit, table_target);
+        self.stack
+            .shrink_to(if retention == MemoRetention::Minimal {
+                0
+            } else {
+                copy_stack::RETAIN_SEGMENTS
+            });
         if !self.dict_proxy.is_null() {
             unsafe { self.dict_proxy.decref() };
             self.dict_proxy = ptr::null_mut();
         }
     }
 
+    // Refcount-1 memo elision.
+    //
+    // A container that only its parent refers to can't be reached a second
+    // time while the parent is being copied, so nothing will ever look it up.
+    // Such children are copied with the `DEFERRED` probe: the lookup is
+    // skipped and `memoize` only records the pair here. `escape` moves the
+    // records into the table right before Python code gets hold of the memo,
+    // so a `__deepcopy__` sees exactly what it would have without the elision.
+    #[inline(always)]
+    fn defer(&mut self, original: *mut PyObject, copy: *mut PyObject) {
+        self.deferred.append(original);
+        self.deferred.append(copy);
+    }
+
+    // Lazy keepalive.
+    //
+    // The keepalive is there for code other than copium's own: a `__deepcopy__`
+    // or a reduction may drop the last reference to an original that's
+    // already memoized, or hand out temporaries (a `__reduce_ex__` state) that
+    // only live for the call, and a new object at the same address would then
+    // hit the memo. While a copy only takes native routes, every memoized
+    // original stays reachable from the object being copied, so `memoize`
+    // leaves the keepalive alone and this fills it in from the table's keys
+    // right before anything else runs. `memo[id(memo)]` then lists them in
+    // table order rather than in the order they were memoized. Free-threaded
+    // builds keep every original right away: another thread may drop one
+    // mid-copy.
+    #[cold]
+    pub(crate) fn fill_keepalive(&mut self) {
+        self.lazy_keepalive = false;
+        self.keepalive.items.reserve(self.table.used);
+        for (key, _) in self.table.entries() {
+            self.keepalive.append(key as *mut PyObject);
+        }
+    }
+
+    #[cold]
+    fn flush_deferred(&mut self) -> i32 {
+        self.defer_unique = false;
+        if self.lazy_keepalive {
+            self.fill_keepalive();
+        }
+        for pair in self.deferred.items.chunks_exact(2) {
+            let (original, copy) = (pair[0], pair[1]);
+            let key = original as usize;
+            if self.table.insert_h(key, copy, hash_pointer(key)) < 0 {
+                return -1;
+            }
+            self.keepalive.append(original);
+        }
+        self.deferred.clear();
+        0
+    }
+
     #[inline(always)]
     pub fn checkpoint(&self) -> MemoCheckpoint {
         self.undo_log.keys.len()
@@ -53,6 +214,13 @@ impl PyMemoObject {
     }
 
     pub(crate) fn insert_logged(&mut self, key: usize, value: *mut PyObject, hash: usize) -> i32 {
+        if let Some(shared) = self.shared() {
+            return if shared.insert(key, value, hash, false).is_null() {
+                -1
+            } else {
+                0
+            };
+        }
         if self.table.insert_h(key, value, hash) < 0 {
             return -1;
         }
@@ -68,25 +236,18 @@ impl PyMemoObject {
                 return ptr::null_mut();
             }
 
-            if self.table.slots.is_null() {
-                return dict;
-            }
-
-            for i in 0..self.table.size {
-                let entry = &*self.table.slots.add(i);
-                if entry.key != 0 && entry.key != TOMBSTONE {
-                    let pykey = PyLong_FromVoidPtr(entry.key as *mut c_void);
-                    if pykey.is_null() {
-                        dict.decref();
-                        return ptr::null_mut();
-                    }
-                    if PyDict_SetItem(dict, pykey, entry.value) < 0 {
-                        pykey.decref();
-                        dict.decref();
-                        return ptr::null_mut();
-                    }
+            for (key, value) in self.table.entries() {
+                let pykey = PyLong_FromVoidPtr(key as *mut c_void);
+                if pykey.is_null() {
+                    dict.decref();
+                    return ptr::null_mut();
+                }
+                if PyDict_SetItem(dict, pykey, value) < 0 {
                     pykey.decref();
+                    dict.decref();
+                    return ptr::null_mut();
                 }
+                pykey.decref();
             }
 
             dict
@@ -144,7 +305,10 @@ impl Memo for PyMemoObject {
     #[inline(always)]
     unsafe fn recall_probed(&mut self, object: *mut PyObject, probe: &usize) -> *mut PyObject {
         let key = object as usize;
-        let found = self.table.lookup_h(key, *probe);
+        let found = match self.shared() {
+            Some(shared) => shared.lookup(key, *probe),
+            None => self.table.lookup_h(key, *probe),
+        };
         if !found.is_null() {
             unsafe { found.incref() };
         }
@@ -158,16 +322,37 @@ impl Memo for PyMemoObject {
         copy: *mut PyObject,
         probe: &usize,
     ) -> i32 {
+        if *probe == DEFERRED {
+            self.defer(original, copy);
+            return 0;
+        }
         let key = original as usize;
+        if let Some(shared) = self.shared() {
+            return if shared.insert(key, copy, *probe, true).is_null() {
+                -1
+            } else {
+                0
+            };
+        }
         if unlikely(self.table.insert_h(key, copy, *probe) < 0) {
             return -1;
         }
-        self.keepalive.append(original);
+        if !self.lazy_keepalive {
+            self.keepalive.append(original);
+        }
         0
     }
 
     #[cold]
     unsafe fn forget(&mut self, original: *mut PyObject, probe: &usize) {
+        // A deferred record of a failed copy is harmless: the whole copy is unwinding.
+        if *probe == DEFERRED {
+            return;
+        }
+        // Another worker may already hold on to the entry; the whole parallel copy fails anyway.
+        if self.shared().is_some() {
+            return;
+        }
         let _ = self.table.remove_h(original as usize, *probe);
     }
 
@@ -175,17 +360,82 @@ impl Memo for PyMemoObject {
         self as *mut PyMemoObject as *mut PyObject
     }
 
+    #[inline(always)]
+    unsafe fn settle(&mut self, original: *mut PyObject, copy: PyResult) -> PyResult {
+        let Some(shared) = self.shared() else {
+            return copy;
+        };
+        if copy.is_error() {
+            return copy;
+        }
+        let key = original as usize;
+        let winner = shared.lookup(key, hash_pointer(key));
+        if winner.is_null() || winner == copy.0 {
+            return copy;
+        }
+        unsafe {
+            copy.0.decref();
+            PyResult::ok(winner.newref())
+        }
+    }
+
+    #[inline(always)]
+    unsafe fn deferred_probe(&mut self) -> Option<usize> {
+        // Free-threaded builds don't get a stable refcount to reason about.
+        if cfg!(Py_GIL_DISABLED) || !self.defer_unique {
+            None
+        } else {
+            Some(DEFERRED)
+        }
+    }
+
+    #[inline(always)]
+    fn unpublished(&self) -> bool {
+        // Cleared by `escape`, and never set on a memo shared between threads.
+        self.defer_unique
+    }
+
+    #[inline(always)]
+    unsafe fn escape(&mut self) -> i32 {
+        if self.defer_unique {
+            self.flush_deferred()
+        } else {
+            0
+        }
+    }
+
+    #[inline(always)]
+    unsafe fn keep_originals(&mut self) {
+        if self.lazy_keepalive {
+            self.fill_keepalive();
+        }
+    }
+
     unsafe fn checkpoint(&mut self) -> Option<MemoCheckpoint> {
         Some(PyMemoObject::checkpoint(self))
     }
 
+    #[inline(always)]
+    unsafe fn copy_stack(&mut self) -> *mut CopyStack<usize> {
+        &mut self.stack
+    }
+
     unsafe fn as_native_memo(&mut self) -> *mut PyMemoObject {
         self
     }
+
+    unsafe fn copied_counts(&mut self) -> (usize, usize) {
+        let used = self.table.used;
+        (used + self.deferred.items.len() / 2, used)
+    }
 }
 
 impl Drop for PyMemoObject {
     fn drop(&mut self) {
-        self.reset();
+        // The table and vectors release their references when they drop.
+        if !self.dict_proxy.is_null() {
+            unsafe { self.dict_proxy.decref() };
+            self.dict_proxy = ptr::null_mut();
+        }
     }
 }
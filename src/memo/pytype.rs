@@ -4,7 +4,7 @@ use std::ptr;
 
 use super::native::PyMemoObject;
 use crate::ffi_ext::PyUnicode_FromFormat;
-use crate::memo::table::{hash_pointer, TOMBSTONE};
+use crate::memo::table::hash_pointer;
 use crate::types::{PyObjectPtr, PyObjectSlotPtr};
 
 #[allow(non_upper_case_globals)]
@@ -29,6 +29,9 @@ static mut KEEPALIVE_LIST_METHODS_TABLE: [PyMethodDef; 3] = unsafe { std::mem::z
 
 unsafe fn keepalive_list_new(owner: *mut PyMemoObject) -> *mut PyObject {
     unsafe {
+        if (*owner).lazy_keepalive {
+            (*owner).fill_keepalive();
+        }
         let obj = PyObject_GC_New::<PyKeepaliveListObject>(ptr::addr_of_mut!(KEEPALIVE_LIST_TYPE));
         if obj.is_null() {
             return ptr::null_mut();
@@ -274,6 +277,7 @@ unsafe extern "C" fn memo_finalize(obj: *mut PyObject) {
         let self_ = obj as *mut PyMemoObject;
         (*self_).table.clear();
         (*self_).keepalive.clear();
+        (*self_).deferred.clear();
         if !(*self_).dict_proxy.is_null() {
             (*self_).dict_proxy.decref();
             (*self_).dict_proxy = ptr::null_mut();
@@ -290,19 +294,14 @@ unsafe extern "C" fn memo_traverse(
         let self_ = obj as *mut PyMemoObject;
         let inner = &*self_;
 
-        if !inner.table.slots.is_null() {
-            for i in 0..inner.table.size {
-                let entry = &*inner.table.slots.add(i);
-                if entry.key != 0 && entry.key != TOMBSTONE && !entry.value.is_null() {
-                    let rc = visit(entry.value, arg);
-                    if rc != 0 {
-                        return rc;
-                    }
-                }
+        for (_, value) in inner.table.entries() {
+            let rc = visit(value, arg);
+            if rc != 0 {
+                return rc;
             }
         }
 
-        for &item in &inner.keepalive.items {
+        for &item in inner.keepalive.items.iter().chain(&inner.deferred.items) {
             if !item.is_null() {
                 let rc = visit(item, arg);
                 if rc != 0 {
@@ -327,6 +326,7 @@ unsafe extern "C" fn memo_clear_gc(obj: *mut PyObject) -> std::ffi::c_int {
         let self_ = obj as *mut PyMemoObject;
         (*self_).table.clear();
         (*self_).keepalive.clear();
+        (*self_).deferred.clear();
         if !(*self_).dict_proxy.is_null() {
             (*self_).dict_proxy.decref();
             (*self_).dict_proxy = ptr::null_mut();
@@ -394,19 +394,14 @@ unsafe extern "C" fn memo_iter(obj: *mut PyObject) -> *mut PyObject {
             return ptr::null_mut();
         }
 
-        if !table.slots.is_null() {
-            for i in 0..table.size {
-                let entry = &*table.slots.add(i);
-                if entry.key != 0 && entry.key != TOMBSTONE {
-                    let py_key = PyLong_FromVoidPtr(entry.key as *mut c_void);
-                    if py_key.is_null() || PyList_Append(list, py_key) < 0 {
-                        py_key.decref_nullable();
-                        list.decref();
-                        return ptr::null_mut();
-                    }
-                    py_key.decref();
-                }
+        for (key, _) in table.entries() {
+            let py_key = PyLong_FromVoidPtr(key as *mut c_void);
+            if py_key.is_null() || PyList_Append(list, py_key) < 0 {
+                py_key.decref_nullable();
+                list.decref();
+                return ptr::null_mut();
             }
+            py_key.decref();
         }
 
         if !(*self_).keepalive.items.is_empty() {
@@ -462,7 +457,7 @@ unsafe extern "C" fn memo_mp_subscript(obj: *mut PyObject, pykey: *mut PyObject)
             return memo_keepalive_proxy(self_);
         }
 
-        let found = (*self_).table.lookup_h(key, hash_pointer(key));
+        let found = (*self_).lookup_key(key);
         if found.is_null() {
             PyErr_SetObject(PyExc_KeyError, pykey);
             return ptr::null_mut();
@@ -560,7 +555,7 @@ unsafe extern "C" fn memo_sq_contains(obj: *mut PyObject, pykey: *mut PyObject)
             return 1;
         }
 
-        let found = (*self_).table.lookup_h(key, hash_pointer(key));
+        let found = (*self_).lookup_key(key);
         if found.is_null() {
             0
         } else {
@@ -610,7 +605,7 @@ unsafe extern "C" fn memo_py_get(
             return ptr::null_mut();
         }
 
-        let found = (*self_).table.lookup_h(key, hash_pointer(key));
+        let found = (*self_).lookup_key(key);
         if !found.is_null() {
             return found.newref();
         }
@@ -647,15 +642,10 @@ unsafe extern "C" fn memo_py_values(obj: *mut PyObject, _: *mut PyObject) -> *mu
         }
 
         let mut idx: Py_ssize_t = 0;
-        if !(*self_).table.slots.is_null() {
-            for i in 0..(*self_).table.size {
-                let entry = &*(*self_).table.slots.add(i);
-                if entry.key != 0 && entry.key != TOMBSTONE {
-                    entry.value.incref();
-                    PyList_SetItem(list, idx, entry.value);
-                    idx += 1;
-                }
-            }
+        for (_, value) in (*self_).table.entries() {
+            value.incref();
+            PyList_SetItem(list, idx, value);
+            idx += 1;
         }
 
         if !(*self_).keepalive.items.is_empty() {
@@ -685,19 +675,14 @@ unsafe extern "C" fn memo_py_keys(obj: *mut PyObject, _: *mut PyObject) -> *mut
         }
 
         let mut idx: Py_ssize_t = 0;
-        if !(*self_).table.slots.is_null() {
-            for i in 0..(*self_).table.size {
-                let entry = &*(*self_).table.slots.add(i);
-                if entry.key != 0 && entry.key != TOMBSTONE {
-                    let py_key = PyLong_FromVoidPtr(entry.key as *mut c_void);
-                    if py_key.is_null() {
-                        list.decref();
-                        return ptr::null_mut();
-                    }
-                    PyList_SetItem(list, idx, py_key);
-                    idx += 1;
-                }
+        for (key, _) in (*self_).table.entries() {
+            let py_key = PyLong_FromVoidPtr(key as *mut c_void);
+            if py_key.is_null() {
+                list.decref();
+                return ptr::null_mut();
             }
+            PyList_SetItem(list, idx, py_key);
+            idx += 1;
         }
 
         if !(*self_).keepalive.items.is_empty() {
@@ -727,28 +712,23 @@ unsafe extern "C" fn memo_py_items(obj: *mut PyObject, _: *mut PyObject) -> *mut
         }
 
         let mut idx: Py_ssize_t = 0;
-        if !(*self_).table.slots.is_null() {
-            for i in 0..(*self_).table.size {
-                let entry = &*(*self_).table.slots.add(i);
-                if entry.key != 0 && entry.key != TOMBSTONE {
-                    let py_key = PyLong_FromVoidPtr(entry.key as *mut c_void);
-                    if py_key.is_null() {
-                        list.decref();
-                        return ptr::null_mut();
-                    }
-                    let pair = PyTuple_New(2);
-                    if pair.is_null() {
-                        py_key.decref();
-                        list.decref();
-                        return ptr::null_mut();
-                    }
-                    PyTuple_SetItem(pair, 0, py_key);
-                    entry.value.incref();
-                    PyTuple_SetItem(pair, 1, entry.value);
-                    PyList_SetItem(list, idx, pair);
-                    idx += 1;
-                }
+        for (key, value) in (*self_).table.entries() {
+            let py_key = PyLong_FromVoidPtr(key as *mut c_void);
+            if py_key.is_null() {
+                list.decref();
+                return ptr::null_mut();
             }
+            let pair = PyTuple_New(2);
+            if pair.is_null() {
+                py_key.decref();
+                list.decref();
+                return ptr::null_mut();
+            }
+            PyTuple_SetItem(pair, 0, py_key);
+            value.incref();
+            PyTuple_SetItem(pair, 1, value);
+            PyList_SetItem(list, idx, pair);
+            idx += 1;
         }
 
         if !(*self_).keepalive.items.is_empty() {
@@ -810,12 +790,21 @@ unsafe extern "C" fn memo_py_setdefault(
             return memo_keepalive_proxy(self_);
         }
 
-        let found = (*self_).table.lookup_h(key, hash_pointer(key));
+        let found = (*self_).lookup_key(key);
         if !found.is_null() {
             return found.newref();
         }
 
         let default_value = if nargs == 2 { *args.add(1) } else { Py_None() };
+        if let Some(shared) = (*self_).shared() {
+            // Another worker may have set it in the meantime.
+            let value = shared.insert(key, default_value, hash_pointer(key), false);
+            return if value.is_null() {
+                ptr::null_mut()
+            } else {
+                value.newref()
+            };
+        }
         if (*self_).insert_logged(key, default_value, hash_pointer(key)) < 0 {
             return ptr::null_mut();
         }
@@ -0,0 +1,88 @@
+//! Memo shared by the workers of one `parallel_deepcopy()` call, striped over
+//! independently locked tables by the top bits of the hash (the tables
+//! themselves probe with the low ones).
+//!
+//! Nothing is removed before the whole call is over, so a looked-up copy stays
+//! valid after the shard is unlocked. Two workers can still both miss on the
+//! same original and both copy it: inserts keep whichever copy got there
+//! first, and `deepcopy()` settles on that one once its own copy is done, so
+//! every original still ends up with a single copy.
+
+use super::{KeepaliveVec, MemoTable};
+use pyo3_ffi::*;
+use std::sync::Mutex;
+
+const SHARDS_LOG2: u32 = 6;
+const SHARDS: usize = 1 << SHARDS_LOG2;
+
+struct Shard {
+    table: MemoTable,
+    /// Originals memoized through `insert(.., keep = true)`.
+    keepalive: KeepaliveVec,
+}
+
+// Only ever touched by threads attached to the interpreter, under the lock.
+unsafe impl Send for Shard {}
+
+#[repr(align(64))]
+struct PaddedShard(Mutex<Shard>);
+
+pub struct ShardedMemo {
+    shards: Box<[PaddedShard]>,
+}
+
+impl ShardedMemo {
+    pub fn new() -> Self {
+        let shards = (0..SHARDS)
+            .map(|_| {
+                PaddedShard(Mutex::new(Shard {
+                    table: MemoTable::new(),
+                    keepalive: KeepaliveVec::new(),
+                }))
+            })
+            .collect();
+        Self { shards }
+    }
+
+    #[inline(always)]
+    fn shard(&self, hash: usize) -> std::sync::MutexGuard<'_, Shard> {
+        let index = hash >> (usize::BITS - SHARDS_LOG2);
+        // A worker never panics while holding a shard, but don't let one poison the rest.
+        match self.shards[index].0.lock() {
+            Ok(guard) => guard,
+            Err(poisoned) => poisoned.into_inner(),
+        }
+    }
+
+    /// Borrowed copy of `key`, or null.
+    #[inline(always)]
+    pub fn lookup(&self, key: usize, hash: usize) -> *mut PyObject {
+        self.shard(hash).table.lookup_h(key, hash)
+    }
+
+    /// Insert unless `key` already has a copy. Returns the borrowed copy that
+    /// is in the memo, or null with an exception set. `keep` also keeps `key`
+    /// alive for as long as the memo.
+    pub fn insert(
+        &self,
+        key: usize,
+        value: *mut PyObject,
+        hash: usize,
+        keep: bool,
+    ) -> *mut PyObject {
+        let mut shard = self.shard(hash);
+        let found = shard.table.lookup_h(key, hash);
+        if !found.is_null() {
+            return found;
+        }
+        if shard.table.insert_h(key, value, hash) < 0 {
+            drop(shard);
+            unsafe { PyErr_NoMemory() };
+            return std::ptr::null_mut();
+        }
+        if keep {
+            shard.keepalive.append(key as *mut PyObject);
+        }
+        value
+    }
+}
@@ -1,28 +1,188 @@
 use pyo3_ffi::*;
-use std::hint::likely;
+use std::hint::{likely, unlikely};
 use std::ptr;
 
+use crate::stats::stat;
 use crate::types::PyObjectPtr;
 
-pub(crate) const TOMBSTONE: usize = usize::MAX;
+pub(super) const MEMO_RETAIN_MAX_SLOTS: usize = 1 << 17;
+pub(super) const MEMO_RETAIN_SHRINK_TO: usize = 1 << 13;
+pub(super) const KEEP_RETAIN_MAX: usize = 1 << 13;
+pub(super) const KEEP_RETAIN_TARGET: usize = 1 << 10;
+
+// ── Group probing ──────────────────────────────────────────
+//
+// Swiss-table layout: one control byte per slot and keys and values in arrays
+// of their own. A full slot's control byte holds the low 7 bits of its hash,
+// so probing compares a whole group of `GROUP_WIDTH` control bytes at once and
+// only touches the keys that matched. The first `GROUP_WIDTH - 1` control
+// bytes are mirrored past the end, which lets a group be loaded at any slot.
+//
+// Each match returns a bitmask with one bit per matching control byte, spaced
+// `1 << MASK_SHIFT` bits apart.
+
+const GROUP_WIDTH: usize = 16;
+const CTRL_EMPTY: u8 = 0x80;
+const CTRL_DELETED: u8 = 0xFE;
 
-const MEMO_RETAIN_MAX_SLOTS: usize = 1 << 17;
-const MEMO_RETAIN_SHRINK_TO: usize = 1 << 13;
-const KEEP_RETAIN_MAX: usize = 1 << 13;
-const KEEP_RETAIN_TARGET: usize = 1 << 10;
+#[inline(always)]
+fn is_full(ctrl: u8) -> bool {
+    ctrl < 0x80
+}
+
+#[cfg(any(
+    target_arch = "x86_64",
+    all(target_arch = "x86", target_feature = "sse2")
+))]
+mod group {
+    #[cfg(target_arch = "x86")]
+    use std::arch::x86::*;
+    #[cfg(target_arch = "x86_64")]
+    use std::arch::x86_64::*;
+
+    pub(super) const MASK_SHIFT: u32 = 0;
+
+    #[derive(Clone, Copy)]
+    pub(super) struct Group(__m128i);
+
+    impl Group {
+        #[inline(always)]
+        pub(super) unsafe fn load(ctrl: *const u8) -> Self {
+            unsafe { Group(_mm_loadu_si128(ctrl as *const __m128i)) }
+        }
+
+        #[inline(always)]
+        pub(super) fn match_byte(self, byte: u8) -> u64 {
+            unsafe {
+                _mm_movemask_epi8(_mm_cmpeq_epi8(self.0, _mm_set1_epi8(byte as i8))) as u16 as u64
+            }
+        }
+
+        /// Empty or deleted: the only control bytes with the high bit set.
+        #[inline(always)]
+        pub(super) fn match_free(self) -> u64 {
+            unsafe { _mm_movemask_epi8(self.0) as u16 as u64 }
+        }
+    }
+}
+
+#[cfg(target_arch = "aarch64")]
+mod group {
+    use std::arch::aarch64::*;
+
+    pub(super) const MASK_SHIFT: u32 = 2;
+
+    #[derive(Clone, Copy)]
+    pub(super) struct Group(uint8x16_t);
+
+    /// Narrows a 0x00/0xFF byte vector to a nibble per byte and keeps one bit
+    /// of each nibble.
+    #[inline(always)]
+    fn bits(cmp: uint8x16_t) -> u64 {
+        unsafe {
+            let narrowed = vshrn_n_u16::<4>(vreinterpretq_u16_u8(cmp));
+            vget_lane_u64::<0>(vreinterpret_u64_u8(narrowed)) & 0x8888_8888_8888_8888
+        }
+    }
 
-pub(crate) struct MemoEntry {
-    pub(crate) key: usize,
-    pub(crate) value: *mut PyObject,
+    impl Group {
+        #[inline(always)]
+        pub(super) unsafe fn load(ctrl: *const u8) -> Self {
+            unsafe { Group(vld1q_u8(ctrl)) }
+        }
+
+        #[inline(always)]
+        pub(super) fn match_byte(self, byte: u8) -> u64 {
+            unsafe { bits(vceqq_u8(self.0, vdupq_n_u8(byte))) }
+        }
+
+        #[inline(always)]
+        pub(super) fn match_free(self) -> u64 {
+            unsafe { bits(vcgeq_u8(self.0, vdupq_n_u8(0x80))) }
+        }
+    }
 }
 
+#[cfg(not(any(
+    target_arch = "x86_64",
+    all(target_arch = "x86", target_feature = "sse2"),
+    target_arch = "aarch64"
+)))]
+mod group {
+    use super::GROUP_WIDTH;
+
+    pub(super) const MASK_SHIFT: u32 = 0;
+
+    #[derive(Clone, Copy)]
+    pub(super) struct Group([u8; GROUP_WIDTH]);
+
+    impl Group {
+        #[inline(always)]
+        pub(super) unsafe fn load(ctrl: *const u8) -> Self {
+            unsafe { Group(std::ptr::read_unaligned(ctrl as *const [u8; GROUP_WIDTH])) }
+        }
+
+        #[inline(always)]
+        pub(super) fn match_byte(self, byte: u8) -> u64 {
+            let mut mask = 0;
+            for (i, &ctrl) in self.0.iter().enumerate() {
+                mask |= ((ctrl == byte) as u64) << i;
+            }
+            mask
+        }
+
+        #[inline(always)]
+        pub(super) fn match_free(self) -> u64 {
+            let mut mask = 0;
+            for (i, &ctrl) in self.0.iter().enumerate() {
+                mask |= ((ctrl >> 7) as u64) << i;
+            }
+            mask
+        }
+    }
+}
+
+use group::{Group, MASK_SHIFT};
+
+/// Offset within the group of the lowest match; `mask` must be nonzero.
+#[inline(always)]
+fn lowest(mask: u64) -> usize {
+    (mask.trailing_zeros() >> MASK_SHIFT) as usize
+}
+
+#[inline(always)]
+fn h1(hash: usize) -> usize {
+    hash >> 7
+}
+
+#[inline(always)]
+fn h2(hash: usize) -> u8 {
+    (hash & 0x7F) as u8
+}
+
+// ── MemoTable ──────────────────────────────────────────────
+
+/// Field order is relied on by tests/test_memo_retention.py: `size` and
+/// `used` sit right after the first pointer.
+#[repr(C)]
 pub struct MemoTable {
-    pub(crate) slots: *mut MemoEntry,
+    /// `size + GROUP_WIDTH - 1` control bytes, stored after `keys` and
+    /// `values` in the allocation that `keys` points to.
+    pub(crate) ctrl: *mut u8,
+    /// Power-of-two capacity, at least `GROUP_WIDTH`.
     pub(crate) size: usize,
     pub(crate) used: usize,
+    /// Live entries plus tombstones.
     pub(crate) filled: usize,
+    keys: *mut usize,
+    /// Strong references for full slots.
+    values: *mut *mut PyObject,
 }
 
+/// Probe passed in place of a real hash for originals memoized through
+/// `PyMemoObject::defer`. `hash_pointer` never produces it.
+pub(crate) const DEFERRED: usize = usize::MAX;
+
 #[inline(always)]
 pub(crate) fn hash_pointer(ptr: usize) -> usize {
     let mut h = ptr;
@@ -31,215 +191,263 @@ pub(crate) fn hash_pointer(ptr: usize) -> usize {
     h ^= h >> 33;
     h = h.wrapping_mul(0xc4ceb9fe1a85ec53);
     h ^= h >> 33;
+    if unlikely(h == DEFERRED) {
+        h = DEFERRED - 1;
+    }
     h
 }
 
+/// Bytes taken by a table of `size` slots, with keys and values ahead of the
+/// control bytes so all of them stay pointer-aligned.
+fn table_layout(size: usize) -> std::alloc::Layout {
+    let bytes = size * 2 * std::mem::size_of::<usize>() + size + GROUP_WIDTH - 1;
+    std::alloc::Layout::from_size_align(bytes, std::mem::align_of::<usize>()).unwrap()
+}
+
 impl MemoTable {
     pub(crate) fn new() -> Self {
         Self {
-            slots: ptr::null_mut(),
+            ctrl: ptr::null_mut(),
             size: 0,
             used: 0,
             filled: 0,
+            keys: ptr::null_mut(),
+            values: ptr::null_mut(),
+        }
+    }
+
+    #[inline(always)]
+    pub(crate) fn is_allocated(&self) -> bool {
+        !self.ctrl.is_null()
+    }
+
+    /// Live `(key, value)` pairs, value borrowed.
+    pub(crate) fn entries(&self) -> impl Iterator<Item = (usize, *mut PyObject)> + '_ {
+        (0..self.size).filter_map(move |i| unsafe {
+            if is_full(*self.ctrl.add(i)) {
+                Some((*self.keys.add(i), *self.values.add(i)))
+            } else {
+                None
+            }
+        })
+    }
+
+    #[inline(always)]
+    fn set_ctrl(&mut self, idx: usize, ctrl: u8) {
+        let mask = self.size - 1;
+        unsafe {
+            *self.ctrl.add(idx) = ctrl;
+            *self
+                .ctrl
+                .add((idx.wrapping_sub(GROUP_WIDTH - 1) & mask) + (GROUP_WIDTH - 1)) = ctrl;
+        }
+    }
+
+    /// Slot holding `key`, if any.
+    #[inline(always)]
+    fn find(&self, key: usize, hash: usize) -> Option<usize> {
+        let mask = self.size - 1;
+        let mut pos = h1(hash) & mask;
+        let tag = h2(hash);
+        let mut stride = GROUP_WIDTH;
+        loop {
+            let group = unsafe { Group::load(self.ctrl.add(pos)) };
+            let mut matches = group.match_byte(tag);
+            while matches != 0 {
+                let idx = (pos + lowest(matches)) & mask;
+                if likely(unsafe { *self.keys.add(idx) } == key) {
+                    return Some(idx);
+                }
+                matches &= matches - 1;
+            }
+            if likely(group.match_byte(CTRL_EMPTY) != 0) {
+                return None;
+            }
+            pos = (pos + stride) & mask;
+            stride += GROUP_WIDTH;
+        }
+    }
+
+    /// First empty or deleted slot on `hash`'s probe sequence.
+    #[inline(always)]
+    fn find_free(&self, hash: usize) -> usize {
+        let mask = self.size - 1;
+        let mut pos = h1(hash) & mask;
+        let mut stride = GROUP_WIDTH;
+        loop {
+            let free = unsafe { Group::load(self.ctrl.add(pos)) }.match_free();
+            if likely(free != 0) {
+                return (pos + lowest(free)) & mask;
+            }
+            pos = (pos + stride) & mask;
+            stride += GROUP_WIDTH;
         }
     }
 
     fn ensure(&mut self) -> i32 {
-        if likely(!self.slots.is_null()) {
+        if likely(self.is_allocated()) {
             return 0;
         }
         self.resize(1)
     }
 
     fn resize(&mut self, min_needed: usize) -> i32 {
-        let mut new_size = 8usize;
+        let mut new_size = GROUP_WIDTH;
         while new_size < min_needed.saturating_mul(2) {
             new_size = new_size.saturating_mul(2);
         }
 
-        let layout = std::alloc::Layout::array::<MemoEntry>(new_size).unwrap();
-        let new_slots = unsafe { std::alloc::alloc_zeroed(layout) as *mut MemoEntry };
-        if new_slots.is_null() {
+        let block = unsafe { std::alloc::alloc(table_layout(new_size)) };
+        if block.is_null() {
             return -1;
         }
 
-        let old_slots = self.slots;
-        let old_size = self.size;
-
-        self.slots = new_slots;
-        self.size = new_size;
-        self.used = 0;
-        self.filled = 0;
-
-        if !old_slots.is_null() {
-            for i in 0..old_size {
-                let entry = unsafe { &*old_slots.add(i) };
-                if entry.key != 0 && entry.key != TOMBSTONE {
-                    self.insert_no_grow(entry.key, entry.value);
+        let old = std::mem::replace(
+            self,
+            Self {
+                ctrl: unsafe { block.add(new_size * 2 * std::mem::size_of::<usize>()) },
+                size: new_size,
+                used: 0,
+                filled: 0,
+                keys: block as *mut usize,
+                values: unsafe { (block as *mut *mut PyObject).add(new_size) },
+            },
+        );
+        unsafe { ptr::write_bytes(self.ctrl, CTRL_EMPTY, new_size + GROUP_WIDTH - 1) };
+
+        if old.is_allocated() {
+            for (key, value) in old.entries() {
+                // Values are moved over along with their references.
+                let hash = hash_pointer(key);
+                let idx = self.find_free(hash);
+                self.set_ctrl(idx, h2(hash));
+                unsafe {
+                    *self.keys.add(idx) = key;
+                    *self.values.add(idx) = value;
                 }
-            }
-            let old_layout = std::alloc::Layout::array::<MemoEntry>(old_size).unwrap();
-            unsafe { std::alloc::dealloc(old_slots as *mut u8, old_layout) };
-        }
-
-        0
-    }
-
-    fn insert_no_grow(&mut self, key: usize, value: *mut PyObject) {
-        let mask = self.size - 1;
-        let mut idx = hash_pointer(key) & mask;
-
-        loop {
-            let entry = unsafe { &mut *self.slots.add(idx) };
-            if entry.key == 0 {
-                entry.key = key;
-                entry.value = value;
-                unsafe { value.incref() };
                 self.used += 1;
                 self.filled += 1;
-                return;
             }
-            if entry.key == key {
-                let old = entry.value;
-                entry.value = value;
-                unsafe {
-                    value.incref();
-                    old.decref_nullable();
-                }
-                return;
-            }
-            idx = (idx + 1) & mask;
+            unsafe { std::alloc::dealloc(old.keys as *mut u8, table_layout(old.size)) };
+            std::mem::forget(old);
         }
+
+        0
     }
 
     #[inline(always)]
     pub fn lookup_h(&self, key: usize, hash: usize) -> *mut PyObject {
-        if std::hint::unlikely(self.slots.is_null()) {
+        if unlikely(!self.is_allocated()) {
             return ptr::null_mut();
         }
-
-        let mask = self.size - 1;
-        let mut idx = hash & mask;
-
-        loop {
-            let entry = unsafe { &*self.slots.add(idx) };
-            if entry.key == 0 {
-                return ptr::null_mut();
-            }
-            if likely(entry.key != TOMBSTONE) && entry.key == key {
-                return entry.value;
-            }
-            idx = (idx + 1) & mask;
+        match self.find(key, hash) {
+            Some(idx) => unsafe { *self.values.add(idx) },
+            None => ptr::null_mut(),
         }
     }
 
     #[inline(always)]
     pub fn insert_h(&mut self, key: usize, value: *mut PyObject, hash: usize) -> i32 {
-        if std::hint::unlikely(self.ensure() < 0) {
+        if unlikely(self.ensure() < 0) {
             return -1;
         }
-        if std::hint::unlikely(self.filled * 10 >= self.size * 7) {
+
+        if let Some(idx) = self.find(key, hash) {
+            unsafe {
+                let slot = self.values.add(idx);
+                let old = *slot;
+                value.incref();
+                *slot = value;
+                old.decref_nullable();
+            }
+            return 0;
+        }
+
+        if unlikely(self.filled * 10 >= self.size * 7) {
+            stat!(MemoResize);
             if self.resize(self.used + 1) < 0 {
                 return -1;
             }
         }
 
-        let mask = self.size - 1;
-        let mut idx = hash & mask;
-        let mut first_tomb: Option<usize> = None;
-
-        loop {
-            let entry = unsafe { &mut *self.slots.add(idx) };
-            if likely(entry.key == 0) {
-                let at = first_tomb.unwrap_or(idx);
-                let slot = unsafe { &mut *self.slots.add(at) };
-                slot.key = key;
-                unsafe { value.incref() };
-                slot.value = value;
-                self.used += 1;
-                self.filled += 1;
-                return 0;
-            }
-            if std::hint::unlikely(entry.key == TOMBSTONE) {
-                if first_tomb.is_none() {
-                    first_tomb = Some(idx);
-                }
-            } else if std::hint::unlikely(entry.key == key) {
-                let old = entry.value;
-                unsafe {
-                    value.incref();
-                    entry.value = value;
-                    old.decref_nullable();
-                }
-                return 0;
-            }
-            idx = (idx + 1) & mask;
+        let idx = self.find_free(hash);
+        if unsafe { *self.ctrl.add(idx) } == CTRL_EMPTY {
+            self.filled += 1;
+        }
+        self.set_ctrl(idx, h2(hash));
+        unsafe {
+            *self.keys.add(idx) = key;
+            value.incref();
+            *self.values.add(idx) = value;
         }
+        self.used += 1;
+        0
     }
 
     pub fn remove_h(&mut self, key: usize, hash: usize) -> i32 {
-        if self.slots.is_null() {
+        if !self.is_allocated() {
             return -1;
         }
+        let Some(idx) = self.find(key, hash) else {
+            return -1;
+        };
+        self.set_ctrl(idx, CTRL_DELETED);
+        unsafe {
+            let slot = self.values.add(idx);
+            (*slot).decref_nullable();
+            *slot = ptr::null_mut();
+        }
+        self.used -= 1;
+        0
+    }
 
-        let mask = self.size - 1;
-        let mut idx = hash & mask;
-
-        loop {
-            let entry = unsafe { &mut *self.slots.add(idx) };
-            if entry.key == 0 {
-                return -1;
-            }
-            if entry.key != TOMBSTONE && entry.key == key {
-                entry.key = TOMBSTONE;
-                unsafe { entry.value.decref_nullable() };
-                entry.value = ptr::null_mut();
-                self.used -= 1;
-                return 0;
-            }
-            idx = (idx + 1) & mask;
+    fn decref_values(&self) {
+        for (_, value) in self.entries() {
+            unsafe { value.decref_nullable() };
         }
     }
 
+    /// Keys and values of empty slots are never read, so clearing only has to
+    /// reset the control bytes.
     pub fn clear(&mut self) {
-        if self.slots.is_null() {
+        if !self.is_allocated() {
             return;
         }
-
-        for i in 0..self.size {
-            let entry = unsafe { &*self.slots.add(i) };
-            if likely(entry.key != 0 && entry.key != TOMBSTONE) {
-                unsafe { entry.value.decref_nullable() };
-            }
+        if self.used != 0 {
+            self.decref_values();
+        }
+        if self.filled != 0 {
+            unsafe { ptr::write_bytes(self.ctrl, CTRL_EMPTY, self.size + GROUP_WIDTH - 1) };
         }
-        unsafe { ptr::write_bytes(self.slots, 0, self.size) };
         self.used = 0;
         self.filled = 0;
     }
 
-    pub fn reset(&mut self) {
+    /// Table size `resize` picks for this many entries.
+    pub(super) fn slots_for(entries: usize) -> usize {
+        let mut slots = GROUP_WIDTH;
+        while slots < entries.saturating_mul(2) {
+            slots = slots.saturating_mul(2);
+        }
+        slots
+    }
+
+    /// Clear, and shrink back to `shrink_to` slots if the table grew past `limit`.
+    pub fn reset(&mut self, limit: usize, shrink_to: usize) {
         self.clear();
-        if self.size > MEMO_RETAIN_MAX_SLOTS {
-            let _ = self.resize(MEMO_RETAIN_SHRINK_TO / 2);
+        if self.size > limit {
+            let _ = self.resize(shrink_to / 2);
         }
     }
 }
 
 impl Drop for MemoTable {
     fn drop(&mut self) {
-        if self.slots.is_null() {
+        if !self.is_allocated() {
             return;
         }
-
-        for i in 0..self.size {
-            let entry = unsafe { &*self.slots.add(i) };
-            if entry.key != 0 && entry.key != TOMBSTONE {
-                unsafe { entry.value.decref_nullable() };
-            }
-        }
-
-        let layout = std::alloc::Layout::array::<MemoEntry>(self.size).unwrap();
-        unsafe { std::alloc::dealloc(self.slots as *mut u8, layout) };
+        self.decref_values();
+        unsafe { std::alloc::dealloc(self.keys as *mut u8, table_layout(self.size)) };
     }
 }
 
@@ -266,9 +474,9 @@ impl KeepaliveVec {
         self.items.clear();
     }
 
-    pub fn shrink_if_large(&mut self) {
-        if self.items.capacity() > KEEP_RETAIN_MAX {
-            self.items.shrink_to(KEEP_RETAIN_TARGET);
+    pub fn shrink_to(&mut self, limit: usize, target: usize) {
+        if self.items.capacity() > limit {
+            self.items.shrink_to(target);
         }
     }
 }
@@ -298,9 +506,9 @@ impl UndoLog {
         self.keys.clear();
     }
 
-    pub fn shrink_if_large(&mut self) {
-        if self.keys.capacity() > KEEP_RETAIN_MAX {
-            self.keys.shrink_to(KEEP_RETAIN_TARGET);
+    pub fn shrink_to(&mut self, limit: usize, target: usize) {
+        if self.keys.capacity() > limit {
+            self.keys.shrink_to(target);
         }
     }
 }
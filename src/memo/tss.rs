@@ -32,14 +32,23 @@ pub unsafe fn get_memo() -> (*mut PyMemoObject, bool) {
                 return (ptr::null_mut(), false);
             }
             TSS_MEMO = fresh;
+            (*fresh).defer_unique = true;
+            (*fresh).lazy_keepalive = !cfg!(Py_GIL_DISABLED);
             return (fresh, true);
         }
 
         if likely(tss.refcount() == 1) {
+            (*tss).defer_unique = true;
+            (*tss).lazy_keepalive = !cfg!(Py_GIL_DISABLED);
             return (tss, true);
         }
 
-        (pymemo_alloc(), false)
+        let fresh = pymemo_alloc();
+        if !fresh.is_null() {
+            (*fresh).defer_unique = true;
+            (*fresh).lazy_keepalive = !cfg!(Py_GIL_DISABLED);
+        }
+        (fresh, false)
     }
 }
 
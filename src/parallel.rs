@@ -0,0 +1,326 @@
+//! `copium.extra.parallel_deepcopy` on free-threaded builds.
+//!
+//! The items of a top-level list, tuple or dict are split into contiguous
+//! chunks, one per worker thread, and each worker deep-copies its chunk with a
+//! memo of its own that forwards to one [`ShardedMemo`]. The calling thread
+//! copies the first chunk itself, then assembles the result in the original
+//! order once all workers are done.
+
+use pyo3_ffi::*;
+use std::ptr;
+
+use crate::critical_section::with_critical_section_raw;
+use crate::deepcopy;
+use crate::memo::{hash_pointer, ShardedMemo};
+use crate::types::*;
+
+/// Rough object count (the items plus the items of the builtin containers
+/// among them) below which starting threads costs more than they save.
+const PARALLEL_MIN_ITEMS: Py_ssize_t = 4096;
+
+struct Chunk {
+    start: usize,
+    stop: usize,
+    /// What the chunk raised, if anything.
+    error: *mut PyObject,
+}
+
+/// What every worker reads: the snapshot of the items and where their copies go.
+#[derive(Clone, Copy)]
+struct Job {
+    shared: *const ShardedMemo,
+    originals: *const *mut PyObject,
+    copies: *mut *mut PyObject,
+}
+
+/// A chunk handed to a worker thread, which only runs while the caller waits for it.
+struct SendChunk(Job, *mut Chunk);
+
+unsafe impl Send for SendChunk {}
+
+unsafe fn run_chunk(job: Job, chunk: &mut Chunk) {
+    unsafe {
+        let memo = crate::memo::pymemo_alloc();
+        if memo.is_null() {
+            chunk.error = PyErr_GetRaisedException();
+            return;
+        }
+        (*memo).shared = job.shared;
+
+        for i in chunk.start..chunk.stop {
+            let copy = deepcopy::deepcopy(*job.originals.add(i), &mut *memo);
+            if copy.is_error() {
+                chunk.error = PyErr_GetRaisedException();
+                break;
+            }
+            *job.copies.add(i) = copy.into_raw();
+        }
+
+        (*memo).shared = ptr::null();
+        crate::memo::cleanup_memo(memo, false);
+    }
+}
+
+#[inline(always)]
+unsafe fn estimate_size(item: *mut PyObject) -> Py_ssize_t {
+    unsafe {
+        if PyList_CheckExact(item) != 0 || PyTuple_CheckExact(item) != 0 {
+            Py_SIZE(item)
+        } else if PyDict_CheckExact(item) != 0 {
+            PyDict_Size(item)
+        } else if PyAnySet_CheckExact(item) != 0 {
+            PySet_Size(item)
+        } else {
+            0
+        }
+    }
+}
+
+/// Copy `originals[..count]` into `copies[..count]` over `workers` threads.
+/// For dicts, `originals` holds keys and values interleaved and `stride` is 2
+/// so that a pair never straddles chunks. Returns -1 with the first chunk's
+/// exception set if any chunk failed.
+unsafe fn copy_items(job: Job, count: usize, stride: usize, workers: usize) -> i32 {
+    unsafe {
+        let units = count / stride;
+        let workers = workers.min(units).max(1);
+        let mut chunks: Vec<Chunk> = (0..workers)
+            .map(|w| Chunk {
+                start: units * w / workers * stride,
+                stop: units * (w + 1) / workers * stride,
+                error: ptr::null_mut(),
+            })
+            .collect();
+        let base = chunks.as_mut_ptr();
+
+        std::thread::scope(|scope| {
+            // A chunk whose thread couldn't be started is copied on this thread instead.
+            let mut handles = Vec::with_capacity(workers - 1);
+            let mut inline = Vec::new();
+            for w in 1..workers {
+                let task = SendChunk(job, base.add(w));
+                let spawned = std::thread::Builder::new().spawn_scoped(scope, move || {
+                    let task = task;
+                    let gil = PyGILState_Ensure();
+                    run_chunk(task.0, &mut *task.1);
+                    PyGILState_Release(gil);
+                });
+                match spawned {
+                    Ok(handle) => handles.push(handle),
+                    Err(_) => inline.push(w),
+                }
+            }
+
+            run_chunk(job, &mut *base);
+            for w in inline {
+                run_chunk(job, &mut *base.add(w));
+            }
+
+            let tstate = PyEval_SaveThread();
+            for handle in handles {
+                let _ = handle.join();
+            }
+            PyEval_RestoreThread(tstate);
+        });
+
+        let mut error = ptr::null_mut();
+        for chunk in &chunks {
+            if chunk.error.is_null() {
+                continue;
+            }
+            if error.is_null() {
+                error = chunk.error;
+            } else {
+                chunk.error.decref();
+            }
+        }
+        if !error.is_null() {
+            PyErr_SetRaisedException(error);
+            return -1;
+        }
+        0
+    }
+}
+
+/// Shallow snapshot of a list's, tuple's or dict's items (dict keys and values
+/// interleaved) as new references.
+unsafe fn snapshot(obj: *mut PyObject) -> Vec<*mut PyObject> {
+    with_critical_section_raw(obj, || unsafe {
+        if PyDict_CheckExact(obj) != 0 {
+            let mut items = Vec::with_capacity(PyDict_Size(obj) as usize * 2);
+            let mut pos: Py_ssize_t = 0;
+            let mut key = ptr::null_mut();
+            let mut value = ptr::null_mut();
+            while PyDict_Next(obj, &mut pos, &mut key, &mut value) != 0 {
+                items.push(key.newref());
+                items.push(value.newref());
+            }
+            items
+        } else if PyList_CheckExact(obj) != 0 {
+            (0..PyList_GET_SIZE(obj))
+                .map(|i| PyList_GET_ITEM(obj, i).newref())
+                .collect()
+        } else {
+            (0..PyTuple_GET_SIZE(obj))
+                .map(|i| PyTuple_GET_ITEM(obj, i).newref())
+                .collect()
+        }
+    })
+}
+
+unsafe fn release(items: &[*mut PyObject]) {
+    for &item in items {
+        unsafe { item.decref_nullable() };
+    }
+}
+
+/// `parallel_deepcopy()` for exact lists, tuples and dicts that are large
+/// enough. Returns null without an exception set when `obj` should go through
+/// plain `deepcopy()` instead.
+pub unsafe fn parallel_deepcopy(obj: *mut PyObject, workers: usize) -> *mut PyObject {
+    unsafe {
+        let is_list = PyList_CheckExact(obj) != 0;
+        let is_dict = PyDict_CheckExact(obj) != 0;
+        if workers < 2 || !(is_list || is_dict || PyTuple_CheckExact(obj) != 0) {
+            return ptr::null_mut();
+        }
+
+        let originals = snapshot(obj);
+        let count = originals.len();
+
+        let mut estimate = count as Py_ssize_t;
+        for &item in &originals {
+            if estimate >= PARALLEL_MIN_ITEMS {
+                break;
+            }
+            estimate += estimate_size(item);
+        }
+        if estimate < PARALLEL_MIN_ITEMS {
+            release(&originals);
+            return ptr::null_mut();
+        }
+
+        let shared = ShardedMemo::new();
+        let mut copies: Vec<*mut PyObject> = vec![ptr::null_mut(); count];
+        let result = assemble(
+            obj,
+            &shared,
+            &originals,
+            &mut copies,
+            is_list,
+            is_dict,
+            workers,
+        );
+        release(&copies);
+        drop(shared);
+        release(&originals);
+        result
+    }
+}
+
+unsafe fn assemble(
+    obj: *mut PyObject,
+    shared: &ShardedMemo,
+    originals: &[*mut PyObject],
+    copies: &mut [*mut PyObject],
+    is_list: bool,
+    is_dict: bool,
+    workers: usize,
+) -> *mut PyObject {
+    unsafe {
+        let count = originals.len();
+        let hash = hash_pointer(obj as usize);
+
+        // Lists and dicts go into the memo before their items are copied, like
+        // in the serial deepcopy, so that cycles back to obj resolve to the result.
+        let copied = if is_list {
+            let list = PyList_New(count as Py_ssize_t);
+            if list.is_null() {
+                return ptr::null_mut();
+            }
+            for i in 0..count {
+                PyList_SET_ITEM(list, i as Py_ssize_t, Py_Ellipsis().newref());
+            }
+            list
+        } else if is_dict {
+            let dict = PyDict_New();
+            if dict.is_null() {
+                return ptr::null_mut();
+            }
+            dict
+        } else {
+            ptr::null_mut()
+        };
+        if !copied.is_null() && shared.insert(obj as usize, copied, hash, true).is_null() {
+            copied.decref();
+            return ptr::null_mut();
+        }
+
+        let job = Job {
+            shared,
+            originals: originals.as_ptr(),
+            copies: copies.as_mut_ptr(),
+        };
+        if copy_items(job, count, if is_dict { 2 } else { 1 }, workers) < 0 {
+            copied.decref_nullable();
+            return ptr::null_mut();
+        }
+
+        if is_list {
+            let filled = with_critical_section_raw(copied, || {
+                if PyList_GET_SIZE(copied) as usize != count {
+                    return false;
+                }
+                for (i, copy) in copies.iter_mut().enumerate() {
+                    let placeholder = PyList_GET_ITEM(copied, i as Py_ssize_t);
+                    PyList_SET_ITEM(copied, i as Py_ssize_t, *copy);
+                    *copy = ptr::null_mut();
+                    placeholder.decref();
+                }
+                true
+            });
+            if !filled {
+                PyErr_SetString(
+                    PyExc_RuntimeError,
+                    crate::cstr!("list changed size during iteration"),
+                );
+                copied.decref();
+                return ptr::null_mut();
+            }
+            return copied;
+        }
+
+        if is_dict {
+            for pair in copies.chunks_exact(2) {
+                if PyDict_SetItem(copied, pair[0], pair[1]) < 0 {
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+            }
+            return copied;
+        }
+
+        // Tuples are memoized after their items, and give back the original
+        // when nothing inside needed a copy, like in the serial deepcopy.
+        if copies
+            .iter()
+            .zip(originals)
+            .all(|(copy, original)| copy == original)
+        {
+            return obj.newref();
+        }
+        let existing = shared.lookup(obj as usize, hash);
+        if !existing.is_null() {
+            return existing.newref();
+        }
+        let tuple = PyTuple_New(count as Py_ssize_t);
+        if tuple.is_null() {
+            return ptr::null_mut();
+        }
+        for (i, copy) in copies.iter_mut().enumerate() {
+            PyTuple_SET_ITEM(tuple, i as Py_ssize_t, *copy);
+            *copy = ptr::null_mut();
+        }
+        tuple
+    }
+}
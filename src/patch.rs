@@ -159,6 +159,28 @@ unsafe fn template_code() -> *mut PyObject {
     })
 }
 
+/// Whether `code` is that of a `copy.deepcopy` patched here: whoever called it
+/// is the frame below.
+#[cfg(not(Py_3_12))]
+pub(crate) unsafe fn is_patched_code(code: *mut PyObject) -> bool {
+    unsafe {
+        let template = template_code();
+        if template.is_null() {
+            return false;
+        }
+        let mut same = true;
+        for attr in [crate::cstr!("co_filename"), crate::cstr!("co_name")] {
+            let ours = PyObject_GetAttrString(template, attr);
+            let theirs = PyObject_GetAttrString(code, attr);
+            same &= !ours.is_null() && ours == theirs;
+            ours.decref_nullable();
+            theirs.decref_nullable();
+        }
+        PyErr_Clear();
+        same
+    }
+}
+
 #[cfg(not(Py_3_12))]
 unsafe fn build_patched_code(target: *mut PyObject) -> *mut PyObject {
     unsafe {
@@ -0,0 +1,998 @@
+//! Compiled copy plans (`copium.extra.compile`).
+//!
+//! A plan is the template's graph flattened into pre-order instructions:
+//! containers with their sizes, atomic leaves that copies share, and
+//! back-edges to containers emitted earlier. Running it rebuilds the graph
+//! with no type dispatch and, as long as the template is made of builtin
+//! containers and atomics only, without a memo.
+//!
+//! Anything else becomes a [`OpKind::Deepcopy`] instruction. Such plans run
+//! with a memo: every container is memoized as it is built, so objects copied
+//! through regular deepcopy see the same identities they would in a plain
+//! deepcopy of the template, and containers a deepcopy instruction already
+//! reached are taken from the memo instead of being built twice.
+
+use pyo3_ffi::*;
+use std::collections::HashMap;
+use std::ffi::c_void;
+use std::ptr;
+
+use crate::deepcopy;
+use crate::memo::{Memo, PyMemoObject};
+use crate::types::*;
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum OpKind {
+    /// Share `obj`.
+    Leaf,
+    /// Copy already built for `slot`; `obj` is the original it stands for.
+    Ref,
+    /// `deepcopy(obj, memo)`.
+    Deepcopy,
+    /// Followed by `size` items.
+    List,
+    /// Followed by `size` key/value pairs.
+    Dict,
+    /// Followed by `size` items.
+    Set,
+    /// Followed by `size` items.
+    Tuple,
+    /// Followed by `size` items.
+    Frozenset,
+    /// Copy of `obj`'s current contents.
+    ByteArray,
+}
+
+const NO_SLOT: usize = usize::MAX;
+const OPEN: usize = usize::MAX;
+
+struct PlanOp {
+    kind: OpKind,
+    /// Containers: number of items (pairs for dicts).
+    size: Py_ssize_t,
+    /// Containers: index of the first op past the subtree.
+    end: usize,
+    /// Slot receiving the copy (`NO_SLOT` if nothing refers back), or the slot read by `Ref`.
+    slot: usize,
+    /// Strong: the leaf to share, or the original the op copies.
+    obj: *mut PyObject,
+}
+
+#[repr(C)]
+pub struct PyPlanObject {
+    pub ob_base: PyObject,
+    ops: Vec<PlanOp>,
+    n_slots: usize,
+    /// Container nesting.
+    depth: usize,
+    uses_memo: bool,
+}
+
+pub static mut Plan_Type: PyTypeObject = unsafe { std::mem::zeroed() };
+
+// ══════════════════════════════════════════════════════════════
+//  Compiler
+// ══════════════════════════════════════════════════════════════
+
+struct PlanBuilder {
+    ops: Vec<PlanOp>,
+    n_slots: usize,
+    /// Container address → index of its op.
+    seen: HashMap<usize, usize>,
+    depth: usize,
+    max_depth: usize,
+    uses_memo: bool,
+    /// Give up, without an exception, at the first op that needs a memo.
+    memo_free_only: bool,
+    declined: bool,
+}
+
+impl PlanBuilder {
+    unsafe fn emit(&mut self, kind: OpKind, obj: *mut PyObject) -> usize {
+        unsafe {
+            self.ops.push(PlanOp {
+                kind,
+                size: 0,
+                end: OPEN,
+                slot: NO_SLOT,
+                obj: obj.newref(),
+            });
+            self.ops.len() - 1
+        }
+    }
+
+    unsafe fn emit_registered(&mut self, kind: OpKind, obj: *mut PyObject) -> usize {
+        unsafe {
+            let index = self.emit(kind, obj);
+            self.seen.insert(obj as usize, index);
+            index
+        }
+    }
+
+    /// Called before emitting an op that can only run with a memo.
+    fn needs_memo(&mut self) -> bool {
+        self.uses_memo = true;
+        if self.memo_free_only {
+            self.declined = true;
+        }
+        !self.declined
+    }
+
+    unsafe fn truncate(&mut self, len: usize) {
+        unsafe {
+            for op in self.ops.drain(len..) {
+                op.obj.decref();
+            }
+        }
+    }
+
+    unsafe fn compile_node(&mut self, obj: *mut PyObject) -> i32 {
+        unsafe {
+            let cls = obj.class();
+            if cls.is_atomic_immutable() {
+                self.emit(OpKind::Leaf, obj);
+                return 0;
+            }
+
+            if let Some(&index) = self.seen.get(&(obj as usize)) {
+                let target = &mut self.ops[index];
+                if target.end == OPEN
+                    && (target.kind == OpKind::Tuple || target.kind == OpKind::Frozenset)
+                {
+                    // A cycle through an immutable container that isn't built
+                    // yet: only deepcopy's memo dance can resolve that.
+                    if !self.needs_memo() {
+                        return -1;
+                    }
+                    self.emit(OpKind::Deepcopy, obj);
+                    return 0;
+                }
+                // Only ops something refers back to get a slot.
+                if target.slot == NO_SLOT {
+                    target.slot = self.n_slots;
+                    self.n_slots += 1;
+                }
+                let slot = target.slot;
+                let index = self.emit(OpKind::Ref, obj);
+                self.ops[index].slot = slot;
+                return 0;
+            }
+
+            let kind = if PyListObject::is(cls) {
+                OpKind::List
+            } else if PyDictObject::is(cls) {
+                OpKind::Dict
+            } else if PyTupleObject::is(cls) {
+                OpKind::Tuple
+            } else if PySetObject::is(cls) {
+                OpKind::Set
+            } else if PyFrozensetObject::is(cls) {
+                OpKind::Frozenset
+            } else if PyByteArrayObject::is(cls) {
+                OpKind::ByteArray
+            } else {
+                OpKind::Deepcopy
+            };
+
+            if kind == OpKind::ByteArray || kind == OpKind::Deepcopy {
+                if kind == OpKind::Deepcopy && !self.needs_memo() {
+                    return -1;
+                }
+                // Registered like containers, so repeated references share one copy.
+                self.emit_registered(kind, obj);
+                return 0;
+            }
+
+            if Py_EnterRecursiveCall(crate::cstr!(" while compiling a copy plan")) != 0 {
+                return -1;
+            }
+            self.depth += 1;
+            self.max_depth = self.max_depth.max(self.depth);
+            let rc = self.compile_container(obj, kind);
+            self.depth -= 1;
+            Py_LeaveRecursiveCall();
+            rc
+        }
+    }
+
+    unsafe fn compile_container(&mut self, obj: *mut PyObject, kind: OpKind) -> i32 {
+        unsafe {
+            let index = self.emit_registered(kind, obj);
+
+            let size = match kind {
+                OpKind::List => {
+                    let list = obj as *mut PyListObject;
+                    for i in 0..list.length() {
+                        if self.compile_node(list.get_borrowed_unchecked(i)) < 0 {
+                            return -1;
+                        }
+                    }
+                    list.length()
+                }
+                OpKind::Tuple => {
+                    let tuple = obj as *mut PyTupleObject;
+                    for i in 0..tuple.length() {
+                        if self.compile_node(tuple.get_borrowed_unchecked(i)) < 0 {
+                            return -1;
+                        }
+                    }
+                    tuple.length()
+                }
+                OpKind::Dict => {
+                    let mut pos: Py_ssize_t = 0;
+                    let mut key: *mut PyObject = ptr::null_mut();
+                    let mut value: *mut PyObject = ptr::null_mut();
+                    while PyDict_Next(obj, &mut pos, &mut key, &mut value) != 0 {
+                        if self.compile_node(key) < 0 || self.compile_node(value) < 0 {
+                            return -1;
+                        }
+                    }
+                    PyDict_Size(obj)
+                }
+                _ => {
+                    let iter = obj.get_iter();
+                    if iter.is_null() {
+                        return -1;
+                    }
+                    loop {
+                        let item = PyIter_Next(iter);
+                        if item.is_null() {
+                            break;
+                        }
+                        let rc = self.compile_node(item);
+                        item.decref();
+                        if rc < 0 {
+                            iter.decref();
+                            return -1;
+                        }
+                    }
+                    iter.decref();
+                    if !PyErr_Occurred().is_null() {
+                        return -1;
+                    }
+                    PySet_Size(obj)
+                }
+            };
+            self.ops[index].size = size;
+            self.ops[index].end = self.ops.len();
+
+            // A tuple or frozenset of shared leaves is what deepcopy would hand
+            // back as-is: fold it into a leaf. It's dropped from `seen` so that later
+            // occurrences fold again instead of pointing at ops that no longer exist.
+            if matches!(kind, OpKind::Tuple | OpKind::Frozenset)
+                && self.ops.len() - index - 1 == size as usize
+                && self.ops[index + 1..]
+                    .iter()
+                    .all(|op| op.kind == OpKind::Leaf)
+            {
+                self.truncate(index + 1);
+                let op = &mut self.ops[index];
+                op.kind = OpKind::Leaf;
+                op.end = OPEN;
+                op.slot = NO_SLOT;
+                self.seen.remove(&(obj as usize));
+            }
+            0
+        }
+    }
+}
+
+pub unsafe fn compile(template: *mut PyObject) -> *mut PyObject {
+    unsafe { compile_ex(template, false) }
+}
+
+/// With `memo_free_only`, templates that would need a memo are declined:
+/// null is returned with no exception set.
+pub unsafe fn compile_ex(template: *mut PyObject, memo_free_only: bool) -> *mut PyObject {
+    unsafe {
+        let mut builder = PlanBuilder {
+            ops: Vec::new(),
+            n_slots: 0,
+            seen: HashMap::new(),
+            depth: 0,
+            max_depth: 0,
+            uses_memo: false,
+            memo_free_only,
+            declined: false,
+        };
+        if builder.compile_node(template) < 0 {
+            builder.truncate(0);
+            return ptr::null_mut();
+        }
+
+        let plan = PyObject_GC_New::<PyPlanObject>(ptr::addr_of_mut!(Plan_Type));
+        if plan.is_null() {
+            builder.truncate(0);
+            return ptr::null_mut();
+        }
+        ptr::write(ptr::addr_of_mut!((*plan).ops), builder.ops);
+        (*plan).n_slots = builder.n_slots;
+        (*plan).depth = builder.max_depth;
+        (*plan).uses_memo = builder.uses_memo;
+        PyObject_GC_Track(plan as *mut c_void);
+        plan as *mut PyObject
+    }
+}
+
+#[inline(always)]
+pub unsafe fn is_plan(object: *mut PyObject) -> bool {
+    unsafe { object.class() == ptr::addr_of_mut!(Plan_Type) }
+}
+
+// ══════════════════════════════════════════════════════════════
+//  Runner
+// ══════════════════════════════════════════════════════════════
+
+struct PlanRun<'a> {
+    ops: &'a [PlanOp],
+    pc: usize,
+    /// Borrowed pointers to the copies built so far.
+    slots: &'a mut [*mut PyObject],
+    /// Only set for plans that `uses_memo`.
+    memo: Option<&'a mut PyMemoObject>,
+}
+
+impl PlanRun<'_> {
+    /// Builds the node starting at `ops[pc]` and advances `pc` past it.
+    unsafe fn node(&mut self) -> *mut PyObject {
+        unsafe {
+            let ops = self.ops;
+            let op = &ops[self.pc];
+            self.pc += 1;
+            let original = op.obj;
+
+            match op.kind {
+                OpKind::Leaf => return original.newref(),
+                OpKind::Ref => {
+                    let copy = self.slots[op.slot];
+                    if !copy.is_null() {
+                        return copy.newref();
+                    }
+                    // The target's subtree was skipped: a deepcopy instruction got there first.
+                    let memo = self.memo.as_deref_mut().unwrap();
+                    return deepcopy::deepcopy(original, memo).into_raw();
+                }
+                OpKind::Deepcopy => {
+                    let memo = self.memo.as_deref_mut().unwrap();
+                    let copy = deepcopy::deepcopy(original, memo).into_raw();
+                    if !copy.is_null() {
+                        self.bind(op.slot, copy);
+                    }
+                    return copy;
+                }
+                _ => {}
+            }
+
+            let mut probe = 0;
+            if let Some(memo) = self.memo.as_deref_mut() {
+                let (found_probe, found) = memo.recall(original);
+                if !found.is_null() {
+                    self.pc = op.end;
+                    self.bind(op.slot, found);
+                    return found;
+                }
+                probe = found_probe;
+            }
+
+            let copy = match op.kind {
+                OpKind::List => self.list(op, &probe),
+                OpKind::Dict => self.dict(op, &probe),
+                OpKind::Set => self.set(op, &probe),
+                OpKind::Tuple | OpKind::Frozenset => return self.immutable(op, &probe),
+                _ => {
+                    let source = original as *mut PyByteArrayObject;
+                    let sz = source.len();
+                    let copy = py_bytearray_new(sz);
+                    if copy.is_null() {
+                        return ptr::null_mut();
+                    }
+                    if sz > 0 {
+                        ptr::copy_nonoverlapping(source.as_ptr(), copy.as_ptr(), sz as usize);
+                    }
+                    if self.memoize(original, copy as _, &probe) < 0 {
+                        copy.decref();
+                        return ptr::null_mut();
+                    }
+                    self.bind(op.slot, copy as _);
+                    return copy as _;
+                }
+            };
+            if copy.is_null() {
+                if let Some(memo) = self.memo.as_deref_mut() {
+                    memo.forget(original, &probe);
+                }
+            }
+            copy
+        }
+    }
+
+    #[inline(always)]
+    fn bind(&mut self, slot: usize, copy: *mut PyObject) {
+        if slot != NO_SLOT {
+            self.slots[slot] = copy;
+        }
+    }
+
+    #[inline(always)]
+    unsafe fn memoize(
+        &mut self,
+        original: *mut PyObject,
+        copy: *mut PyObject,
+        probe: &usize,
+    ) -> i32 {
+        unsafe {
+            match self.memo.as_deref_mut() {
+                Some(memo) => memo.memoize(original, copy, probe),
+                None => 0,
+            }
+        }
+    }
+
+    unsafe fn list(&mut self, op: &PlanOp, probe: &usize) -> *mut PyObject {
+        unsafe {
+            let copied = py_list_new(op.size);
+            if copied.is_null() {
+                return ptr::null_mut();
+            }
+            let memoized = self.memo.is_some();
+            if memoized {
+                // Exposed through the memo to code run by deepcopy instructions.
+                for i in 0..op.size {
+                    let ellipsis = Py_Ellipsis();
+                    #[cfg(not(any(Py_3_12, Py_3_13, Py_3_14)))]
+                    ellipsis.incref();
+                    copied.set_slot_steal_unchecked(i, ellipsis);
+                }
+                if self.memoize(op.obj, copied as _, probe) < 0 {
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+            }
+            self.bind(op.slot, copied as _);
+            for i in 0..op.size {
+                let item = self.node();
+                if item.is_null() {
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+                #[cfg(not(any(Py_3_12, Py_3_13, Py_3_14)))]
+                {
+                    if memoized {
+                        copied.get_borrowed_unchecked(i).decref();
+                    }
+                }
+                copied.set_slot_steal_unchecked(i, item);
+            }
+            copied as _
+        }
+    }
+
+    unsafe fn dict(&mut self, op: &PlanOp, probe: &usize) -> *mut PyObject {
+        unsafe {
+            let copied = py_dict_new(op.size);
+            if copied.is_null() {
+                return ptr::null_mut();
+            }
+            if self.memoize(op.obj, copied as _, probe) < 0 {
+                copied.decref();
+                return ptr::null_mut();
+            }
+            self.bind(op.slot, copied as _);
+            for _ in 0..op.size {
+                let key = self.node();
+                if key.is_null() {
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+                let value = self.node();
+                if value.is_null() {
+                    key.decref();
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+                if copied.set_item_steal_two(key, value) < 0 {
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+            }
+            copied as _
+        }
+    }
+
+    unsafe fn set(&mut self, op: &PlanOp, probe: &usize) -> *mut PyObject {
+        unsafe {
+            let copied = py_set_new();
+            if copied.is_null() {
+                return ptr::null_mut();
+            }
+            if self.memoize(op.obj, copied as _, probe) < 0 {
+                copied.decref();
+                return ptr::null_mut();
+            }
+            self.bind(op.slot, copied as _);
+            for _ in 0..op.size {
+                let item = self.node();
+                if item.is_null() {
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+                let rc = copied.add_item(item);
+                item.decref();
+                if rc < 0 {
+                    copied.decref();
+                    return ptr::null_mut();
+                }
+            }
+            copied as _
+        }
+    }
+
+    unsafe fn immutable(&mut self, op: &PlanOp, probe: &usize) -> *mut PyObject {
+        unsafe {
+            let items = py_tuple_new(op.size);
+            if items.is_null() {
+                return ptr::null_mut();
+            }
+            for i in 0..op.size {
+                let item = self.node();
+                if item.is_null() {
+                    items.decref();
+                    return ptr::null_mut();
+                }
+                items.set_slot_steal_unchecked(i, item);
+            }
+
+            let copy = if op.kind == OpKind::Frozenset {
+                let copy = frozenset_from(items as _);
+                items.decref();
+                if copy.is_null() {
+                    return ptr::null_mut();
+                }
+                copy
+            } else {
+                if let Some(memo) = self.memo.as_deref_mut() {
+                    // Same checks `copy_frame_finish` makes for a tuple once its items are copied.
+                    let original = op.obj as *mut PyTupleObject;
+                    let all_same = (0..op.size).all(|i| {
+                        items.get_borrowed_unchecked(i) == original.get_borrowed_unchecked(i)
+                    });
+                    if all_same {
+                        items.decref();
+                        return op.obj.newref();
+                    }
+                    let existing = memo.recall_probed(op.obj, probe);
+                    if !existing.is_null() {
+                        items.decref();
+                        self.bind(op.slot, existing);
+                        return existing;
+                    }
+                }
+                items as *mut PyObject
+            };
+            if self.memoize(op.obj, copy, probe) < 0 {
+                copy.decref();
+                return ptr::null_mut();
+            }
+            self.bind(op.slot, copy);
+            copy
+        }
+    }
+}
+
+// ══════════════════════════════════════════════════════════════
+//  Batch runner
+// ══════════════════════════════════════════════════════════════
+
+/// Memo-less plans build all n copies in one pass over the instructions:
+/// every op produces a block of n results. A node at depth d gets its
+/// children's blocks from the scratch region of depth d + 1, which holds 2n
+/// entries so a dict's key and value blocks fit side by side. Slot blocks keep
+/// the n copies of every op something refers back to.
+struct PlanBatch<'a> {
+    ops: &'a [PlanOp],
+    pc: usize,
+    n: usize,
+    /// `(depth + 1) * 2n` entries.
+    scratch: Vec<*mut PyObject>,
+    /// `n_slots * n` entries.
+    slots: Vec<*mut PyObject>,
+}
+
+unsafe fn clear_block(block: *mut *mut PyObject, n: usize) {
+    unsafe {
+        for j in 0..n {
+            let item = *block.add(j);
+            *block.add(j) = ptr::null_mut();
+            item.decref_nullable();
+        }
+    }
+}
+
+impl PlanBatch<'_> {
+    #[inline(always)]
+    unsafe fn bind(&mut self, slot: usize, out: *mut *mut PyObject) {
+        unsafe {
+            if slot != NO_SLOT {
+                ptr::copy_nonoverlapping(out, self.slots.as_mut_ptr().add(slot * self.n), self.n);
+            }
+        }
+    }
+
+    /// Builds n copies of the node starting at `ops[pc]` into `out`; on
+    /// failure, `out` is left empty.
+    unsafe fn node(&mut self, depth: usize, out: *mut *mut PyObject) -> i32 {
+        unsafe {
+            let ops = self.ops;
+            let op = &ops[self.pc];
+            self.pc += 1;
+            let n = self.n;
+            let original = op.obj;
+            let items = self.scratch.as_mut_ptr().add((depth + 1) * 2 * n);
+
+            let rc = match op.kind {
+                OpKind::Leaf => {
+                    for j in 0..n {
+                        *out.add(j) = original.newref();
+                    }
+                    return 0;
+                }
+                OpKind::Ref => {
+                    for j in 0..n {
+                        *out.add(j) = self.slots[op.slot * n + j].newref();
+                    }
+                    return 0;
+                }
+                OpKind::List => self.list(op, depth, out, items),
+                OpKind::Dict => self.dict(op, depth, out, items),
+                OpKind::Set => self.set(op, depth, out, items),
+                OpKind::Tuple | OpKind::Frozenset => self.immutable(op, depth, out, items),
+                OpKind::ByteArray => {
+                    let source = original as *mut PyByteArrayObject;
+                    let sz = source.len();
+                    let mut rc = 0;
+                    for j in 0..n {
+                        let copy = py_bytearray_new(sz);
+                        *out.add(j) = copy as _;
+                        if copy.is_null() {
+                            rc = -1;
+                            break;
+                        }
+                        if sz > 0 {
+                            ptr::copy_nonoverlapping(source.as_ptr(), copy.as_ptr(), sz as usize);
+                        }
+                    }
+                    if rc == 0 {
+                        self.bind(op.slot, out);
+                    }
+                    rc
+                }
+                OpKind::Deepcopy => unreachable!("batch-run plans are memo-less"),
+            };
+            if rc < 0 {
+                clear_block(out, n);
+            }
+            rc
+        }
+    }
+
+    unsafe fn list(
+        &mut self,
+        op: &PlanOp,
+        depth: usize,
+        out: *mut *mut PyObject,
+        items: *mut *mut PyObject,
+    ) -> i32 {
+        unsafe {
+            for j in 0..self.n {
+                let copied = py_list_new(op.size);
+                *out.add(j) = copied as _;
+                if copied.is_null() {
+                    return -1;
+                }
+            }
+            self.bind(op.slot, out);
+            for i in 0..op.size {
+                if self.node(depth + 1, items) < 0 {
+                    return -1;
+                }
+                for j in 0..self.n {
+                    let copied = *out.add(j) as *mut PyListObject;
+                    copied.set_slot_steal_unchecked(i, *items.add(j));
+                }
+            }
+            0
+        }
+    }
+
+    unsafe fn dict(
+        &mut self,
+        op: &PlanOp,
+        depth: usize,
+        out: *mut *mut PyObject,
+        items: *mut *mut PyObject,
+    ) -> i32 {
+        unsafe {
+            let n = self.n;
+            for j in 0..n {
+                let copied = py_dict_new(op.size);
+                *out.add(j) = copied as _;
+                if copied.is_null() {
+                    return -1;
+                }
+            }
+            self.bind(op.slot, out);
+            for _ in 0..op.size {
+                if self.node(depth + 1, items) < 0 {
+                    return -1;
+                }
+                if self.node(depth + 1, items.add(n)) < 0 {
+                    clear_block(items, n);
+                    return -1;
+                }
+                for j in 0..n {
+                    let key = *items.add(j);
+                    let value = *items.add(n + j);
+                    *items.add(j) = ptr::null_mut();
+                    *items.add(n + j) = ptr::null_mut();
+                    let copied = *out.add(j) as *mut PyDictObject;
+                    if copied.set_item_steal_two(key, value) < 0 {
+                        clear_block(items, 2 * n);
+                        return -1;
+                    }
+                }
+            }
+            0
+        }
+    }
+
+    unsafe fn set(
+        &mut self,
+        op: &PlanOp,
+        depth: usize,
+        out: *mut *mut PyObject,
+        items: *mut *mut PyObject,
+    ) -> i32 {
+        unsafe {
+            for j in 0..self.n {
+                let copied = py_set_new();
+                *out.add(j) = copied as _;
+                if copied.is_null() {
+                    return -1;
+                }
+            }
+            self.bind(op.slot, out);
+            for _ in 0..op.size {
+                if self.node(depth + 1, items) < 0 {
+                    return -1;
+                }
+                let mut rc = 0;
+                for j in 0..self.n {
+                    let item = *items.add(j);
+                    *items.add(j) = ptr::null_mut();
+                    if rc == 0 {
+                        rc = (*out.add(j) as *mut PySetObject).add_item(item);
+                    }
+                    item.decref();
+                }
+                if rc < 0 {
+                    return -1;
+                }
+            }
+            0
+        }
+    }
+
+    unsafe fn immutable(
+        &mut self,
+        op: &PlanOp,
+        depth: usize,
+        out: *mut *mut PyObject,
+        items: *mut *mut PyObject,
+    ) -> i32 {
+        unsafe {
+            for j in 0..self.n {
+                let copied = py_tuple_new(op.size);
+                *out.add(j) = copied as _;
+                if copied.is_null() {
+                    return -1;
+                }
+            }
+            for i in 0..op.size {
+                if self.node(depth + 1, items) < 0 {
+                    return -1;
+                }
+                for j in 0..self.n {
+                    let copied = *out.add(j) as *mut PyTupleObject;
+                    copied.set_slot_steal_unchecked(i, *items.add(j));
+                }
+            }
+            if op.kind == OpKind::Frozenset {
+                for j in 0..self.n {
+                    let tuple = *out.add(j);
+                    let frozen = frozenset_from(tuple);
+                    tuple.decref();
+                    *out.add(j) = frozen;
+                    if frozen.is_null() {
+                        return -1;
+                    }
+                }
+            }
+            // Memo-less plans have no back-edges into unfinished tuples.
+            self.bind(op.slot, out);
+            0
+        }
+    }
+}
+
+/// Builds `n` copies of a memo-less plan straight into the items of list `out`.
+unsafe fn replicate_batch(plan: &PyPlanObject, out: *mut PyObject, n: usize) -> i32 {
+    unsafe {
+        let mut batch = PlanBatch {
+            ops: &plan.ops,
+            pc: 0,
+            n,
+            scratch: vec![ptr::null_mut(); (plan.depth + 1) * 2 * n],
+            slots: vec![ptr::null_mut(); plan.n_slots * n],
+        };
+        batch.node(0, (*(out as *mut PyListObject)).ob_item)
+    }
+}
+
+/// Runs the plan `n` times into a new list.
+pub unsafe fn replicate(plan: *mut PyObject, n: Py_ssize_t) -> *mut PyObject {
+    unsafe {
+        let plan = &*(plan as *mut PyPlanObject);
+        let out = PyList_New(n);
+        if out.is_null() {
+            return ptr::null_mut();
+        }
+
+        if !plan.uses_memo && n > 1 {
+            if replicate_batch(plan, out, n as usize) < 0 {
+                out.decref();
+                return ptr::null_mut();
+            }
+            return out;
+        }
+
+        let mut slots = vec![ptr::null_mut::<PyObject>(); plan.n_slots];
+        for i in 0..n {
+            slots.fill(ptr::null_mut());
+            let copy = if plan.uses_memo {
+                let (memo, is_tss) = crate::memo::get_memo();
+                if memo.is_null() {
+                    out.decref();
+                    return ptr::null_mut();
+                }
+                let mut run = PlanRun {
+                    ops: &plan.ops,
+                    pc: 0,
+                    slots: &mut slots,
+                    memo: Some(&mut *memo),
+                };
+                let copy = run.node();
+                crate::memo::cleanup_memo(memo, is_tss);
+                copy
+            } else {
+                let mut run = PlanRun {
+                    ops: &plan.ops,
+                    pc: 0,
+                    slots: &mut slots,
+                    memo: None,
+                };
+                run.node()
+            };
+            if copy.is_null() {
+                out.decref();
+                return ptr::null_mut();
+            }
+            PyList_SET_ITEM(out, i, copy);
+        }
+        out
+    }
+}
+
+/// How many slots a run of the plan needs, and whether it needs a memo.
+#[inline(always)]
+pub unsafe fn run_needs(plan: *mut PyObject) -> (usize, bool) {
+    unsafe {
+        let plan = &*(plan as *mut PyPlanObject);
+        (plan.n_slots, plan.uses_memo)
+    }
+}
+
+/// Runs the plan once. `slots` must hold `run_needs` nulls, and `memo` be set
+/// if the plan uses one.
+pub unsafe fn run_once(
+    plan: *mut PyObject,
+    slots: &mut [*mut PyObject],
+    memo: Option<&mut PyMemoObject>,
+) -> *mut PyObject {
+    unsafe {
+        let plan = &*(plan as *mut PyPlanObject);
+        let mut run = PlanRun {
+            ops: &plan.ops,
+            pc: 0,
+            slots,
+            memo,
+        };
+        run.node()
+    }
+}
+
+// ══════════════════════════════════════════════════════════════
+//  Plan type
+// ══════════════════════════════════════════════════════════════
+
+unsafe extern "C" fn plan_dealloc(obj: *mut PyObject) {
+    unsafe {
+        PyObject_GC_UnTrack(obj as *mut c_void);
+        plan_clear(obj);
+        ptr::drop_in_place(ptr::addr_of_mut!((*(obj as *mut PyPlanObject)).ops));
+        PyObject_GC_Del(obj as *mut c_void);
+    }
+}
+
+unsafe extern "C" fn plan_traverse(
+    obj: *mut PyObject,
+    visit: visitproc,
+    arg: *mut c_void,
+) -> std::ffi::c_int {
+    unsafe {
+        for op in &(*(obj as *mut PyPlanObject)).ops {
+            let rc = visit(op.obj, arg);
+            if rc != 0 {
+                return rc;
+            }
+        }
+        0
+    }
+}
+
+unsafe extern "C" fn plan_clear(obj: *mut PyObject) -> std::ffi::c_int {
+    unsafe {
+        let ops = std::mem::take(&mut (*(obj as *mut PyPlanObject)).ops);
+        for op in ops {
+            op.obj.decref();
+        }
+        0
+    }
+}
+
+unsafe extern "C" fn plan_repr(obj: *mut PyObject) -> *mut PyObject {
+    unsafe {
+        let plan = &*(obj as *mut PyPlanObject);
+        let text = format!(
+            "<copium.extra.Plan of {} instructions{}>\0",
+            plan.ops.len(),
+            if plan.uses_memo { ", with memo" } else { "" }
+        );
+        PyUnicode_FromString(text.as_ptr().cast())
+    }
+}
+
+pub unsafe fn plan_ready_type() -> i32 {
+    unsafe {
+        let tp = ptr::addr_of_mut!(Plan_Type);
+        (*tp).tp_name = crate::cstr!("copium.extra.Plan");
+        (*tp).tp_doc = crate::cstr!("Copy plan produced by copium.extra.compile().");
+        (*tp).tp_basicsize = std::mem::size_of::<PyPlanObject>() as Py_ssize_t;
+        (*tp).tp_dealloc = Some(plan_dealloc);
+        (*tp).tp_repr = Some(plan_repr);
+        #[cfg(Py_GIL_DISABLED)]
+        {
+            (*tp).tp_flags.store(
+                Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+                core::sync::atomic::Ordering::Relaxed,
+            );
+        }
+        #[cfg(not(Py_GIL_DISABLED))]
+        {
+            (*tp).tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+        }
+        (*tp).tp_traverse = Some(plan_traverse);
+        (*tp).tp_clear = Some(plan_clear);
+
+        PyType_Ready(tp)
+    }
+}
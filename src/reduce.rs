@@ -8,6 +8,8 @@ use crate::ffi_ext;
 use crate::memo::Memo;
 use crate::py_obj;
 use crate::py_str;
+use crate::stats::{stat, stat_reduce_type};
+use crate::type_cache::{self, ReducePlan};
 use crate::types::*;
 
 macro_rules! bail {
@@ -231,7 +233,7 @@ pub(crate) unsafe fn validate_reduce_tuple(
 
 // ── Instance reconstruction ────────────────────────────────
 
-unsafe fn call_tp_new(
+pub(crate) unsafe fn call_tp_new(
     cls: *mut PyTypeObject,
     args: *mut PyObject,
     kwargs: *mut PyObject,
@@ -795,6 +797,564 @@ unsafe fn apply_dictitems<M: Memo>(
     }
 }
 
+// ── Reduce plan cache ──────────────────────────────────────
+
+/// True when `tp` inherits `object`'s reduce protocol untouched, so that
+/// `__reduce_ex__(4)` can only ever yield `__newobj__(cls)` plus the state
+/// `object.__getstate__` makes of `__dict__` and `__slotnames__`.
+unsafe fn inherits_object_reduce(tp: *mut PyTypeObject) -> bool {
+    unsafe {
+        let flags = ffi_ext::tp_flags_of(tp);
+        if flags & (Py_TPFLAGS_HEAPTYPE as libc::c_ulong) == 0
+            || flags & ((Py_TPFLAGS_LIST_SUBCLASS | Py_TPFLAGS_DICT_SUBCLASS) as libc::c_ulong) != 0
+            || (*tp).tp_itemsize != 0
+            || (*tp).tp_getattro.map(|f| f as usize) != Some(PyObject_GenericGetAttr as usize)
+        {
+            return false;
+        }
+
+        let object_tp = ptr::addr_of_mut!(PyBaseObject_Type);
+        let inherited = |name: *mut PyObject| {
+            ffi_ext::_PyType_Lookup(tp, name) == ffi_ext::_PyType_Lookup(object_tp, name)
+        };
+        if !inherited(py_str!("__reduce_ex__"))
+            || !inherited(py_str!("__reduce__"))
+            || !inherited(py_str!("__getstate__"))
+            || !ffi_ext::_PyType_Lookup(tp, py_str!("__getnewargs_ex__")).is_null()
+            || !ffi_ext::_PyType_Lookup(tp, py_str!("__getnewargs__")).is_null()
+            || !ffi_ext::_PyType_Lookup(tp, py_str!("__setstate__")).is_null()
+        {
+            return false;
+        }
+        true
+    }
+}
+
+/// The `__slotnames__` copyreg cached on `tp`, borrowed; a reduce call must
+/// have been made to populate it.
+unsafe fn cached_slotnames(tp: *mut PyTypeObject) -> *mut PyObject {
+    unsafe {
+        let slotnames = PyDict_GetItemWithError((*tp).tp_dict, py_str!("__slotnames__"));
+        if slotnames.is_null() {
+            PyErr_Clear();
+            return ptr::null_mut();
+        }
+        if PyList_CheckExact(slotnames) != 0 {
+            slotnames
+        } else {
+            ptr::null_mut()
+        }
+    }
+}
+
+/// Whether the state of `tp`'s instances is their `__dict__` alone.
+unsafe fn has_default_reduce(tp: *mut PyTypeObject) -> bool {
+    unsafe {
+        if (*tp).tp_dictoffset == 0 || !inherits_object_reduce(tp) {
+            return false;
+        }
+        let slotnames = cached_slotnames(tp);
+        !slotnames.is_null() && PyList_GET_SIZE(slotnames) == 0
+    }
+}
+
+/// Whether every one of `tp`'s `__slotnames__` is a writable `T_OBJECT_EX`
+/// member, which `object.__getstate__` reads and `setattr()` writes at a fixed
+/// offset of the instance; if so, `slots` receives the offsets. Free-threaded
+/// builds go through the descriptors, which read the slots with the atomics a
+/// concurrent write calls for.
+#[cfg(not(Py_GIL_DISABLED))]
+unsafe fn slotted_reduce(tp: *mut PyTypeObject, slots: &mut type_cache::SlotPlan) -> bool {
+    unsafe {
+        if (*tp).tp_setattro.map(|f| f as usize) != Some(PyObject_GenericSetAttr as usize)
+            || !inherits_object_reduce(tp)
+        {
+            return false;
+        }
+        let slotnames = cached_slotnames(tp);
+        if slotnames.is_null() {
+            return false;
+        }
+        let count = PyList_GET_SIZE(slotnames);
+        if count == 0 || count as usize > type_cache::SLOT_PLAN_MAX {
+            return false;
+        }
+        for i in 0..count {
+            let name = PyList_GET_ITEM(slotnames, i);
+            let descr = if PyUnicode_Check(name) != 0 {
+                ffi_ext::_PyType_Lookup(tp, name)
+            } else {
+                ptr::null_mut()
+            };
+            if descr.is_null() || descr.class() != ptr::addr_of_mut!(ffi_ext::PyMemberDescr_Type) {
+                return false;
+            }
+            let member = (*(descr as *mut ffi_ext::PyMemberDescrObject)).d_member;
+            if (*member).type_code != ffi_ext::Py_T_OBJECT_EX
+                || (*member).flags & ffi_ext::Py_READONLY != 0
+                || (*member).offset <= 0
+                || (*member).offset > u16::MAX as Py_ssize_t
+            {
+                return false;
+            }
+            slots.offsets[i as usize] = (*member).offset as u16;
+        }
+        slots.count = count as u16;
+        true
+    }
+}
+
+#[cfg(Py_GIL_DISABLED)]
+unsafe fn slotted_reduce(_tp: *mut PyTypeObject, _slots: &mut type_cache::SlotPlan) -> bool {
+    false
+}
+
+/// State `object.__getstate__` gives a slotted instance: None, `__dict__`, or
+/// `(__dict__ or None, {slot: value})`.
+unsafe fn is_slot_state(state: *mut PyObject) -> bool {
+    unsafe {
+        if state.is_null() || PyDict_CheckExact(state) != 0 {
+            return true;
+        }
+        if PyTuple_CheckExact(state) == 0 || PyTuple_GET_SIZE(state) != 2 {
+            return false;
+        }
+        let dict_state = PyTuple_GET_ITEM(state, 0);
+        (dict_state.is_none() || PyDict_CheckExact(dict_state) != 0)
+            && PyDict_CheckExact(PyTuple_GET_ITEM(state, 1)) != 0
+    }
+}
+
+unsafe fn classify_reduce(
+    tp: *mut PyTypeObject,
+    parts: &ReduceParts,
+    slots: &mut type_cache::SlotPlan,
+) -> ReducePlan {
+    unsafe {
+        let newobj_of_cls = parts.callable == py_obj!("copyreg.__newobj__")
+            && (parts.argtup as *mut PyTupleObject).length() == 1
+            && (parts.argtup as *mut PyTupleObject).get_borrowed_unchecked(0)
+                == tp as *mut PyObject;
+        if !newobj_of_cls || !parts.listitems.is_null() || !parts.dictitems.is_null() {
+            return ReducePlan::Generic;
+        }
+
+        if (parts.state.is_null() || PyDict_CheckExact(parts.state) != 0) && has_default_reduce(tp)
+        {
+            ReducePlan::NewobjDict
+        } else if is_slot_state(parts.state) && slotted_reduce(tp, slots) {
+            ReducePlan::NewobjSlots
+        } else {
+            ReducePlan::Generic
+        }
+    }
+}
+
+/// Instance attributes that `object.__reduce_ex__` and `__setstate__`
+/// resolution would pick up ahead of the type's.
+unsafe fn shadows_reduce_protocol(dict: *mut PyObject) -> bool {
+    unsafe {
+        PyDict_Contains(dict, py_str!("__reduce_ex__")) != 0
+            || PyDict_Contains(dict, py_str!("__reduce__")) != 0
+            || PyDict_Contains(dict, py_str!("__getstate__")) != 0
+            || PyDict_Contains(dict, py_str!("__getnewargs_ex__")) != 0
+            || PyDict_Contains(dict, py_str!("__getnewargs__")) != 0
+            || PyDict_Contains(dict, py_str!("__setstate__")) != 0
+    }
+}
+
+#[inline(always)]
+unsafe fn slot_at(object: *mut PyObject, offset: u16) -> *mut *mut PyObject {
+    unsafe { object.cast::<u8>().add(offset as usize).cast() }
+}
+
+/// The slots of `original` set, deep copied into the same slots of
+/// `instance`, in the order of `__slotnames__`: what applying the slot state
+/// `object.__getstate__` makes amounts to.
+unsafe fn copy_slots<M: Memo>(
+    original: *mut PyObject,
+    instance: *mut PyObject,
+    slots: &type_cache::SlotPlan,
+    memo: &mut M,
+) -> c_int {
+    unsafe {
+        for &offset in &slots.offsets[..slots.count as usize] {
+            let value = *slot_at(original, offset);
+            if value.is_null() {
+                continue; // unset: left out of the state
+            }
+            value.incref();
+            let copied = deepcopy::deepcopy(value, memo);
+            value.decref();
+            if copied.is_error() {
+                return -1;
+            }
+            let old = std::mem::replace(&mut *slot_at(instance, offset), copied.into_raw());
+            old.decref_nullable();
+        }
+        0
+    }
+}
+
+/// Cached-plan equivalent of reducing to `__newobj__(cls)` + `__dict__`, and
+/// the slots if given: builds the instance directly and copies them without
+/// calling `__reduce_ex__` or building the state. Returns `None` when this
+/// instance doesn't fit the plan.
+unsafe fn reconstruct_newobj_state<M: Memo>(
+    original: *mut PyObject,
+    tp: *mut PyTypeObject,
+    slots: Option<&type_cache::SlotPlan>,
+    memo: &mut M,
+    probe: &M::Probe,
+) -> Option<*mut PyObject> {
+    unsafe {
+        let mut dict = ptr::null_mut();
+        let mut size = 0;
+        if slots.is_none() || (*tp).tp_dictoffset != 0 {
+            dict = original.getattr(py_str!("__dict__"));
+            if dict.is_null() {
+                PyErr_Clear();
+                return None;
+            }
+            size = PyDict_Size(dict);
+            if !dict.is_dict() || (size > 0 && shadows_reduce_protocol(dict)) {
+                dict.decref();
+                return None;
+            }
+        }
+
+        let args = PyTuple_New(0);
+        if args.is_null() {
+            dict.decref_nullable();
+            return Some(ptr::null_mut());
+        }
+        let instance = call_tp_new(tp, args, ptr::null_mut());
+        args.decref();
+        if instance.is_null() {
+            dict.decref_nullable();
+            return Some(ptr::null_mut());
+        }
+
+        if memo.memoize(original, instance, probe) < 0 {
+            dict.decref_nullable();
+            instance.decref();
+            return Some(ptr::null_mut());
+        }
+
+        if (size > 0 && apply_dict_state(instance, dict, memo) < 0)
+            || slots.is_some_and(|slots| copy_slots(original, instance, slots, memo) < 0)
+        {
+            memo.forget(original, probe);
+            dict.decref_nullable();
+            instance.decref();
+            return Some(ptr::null_mut());
+        }
+
+        dict.decref_nullable();
+        Some(instance)
+    }
+}
+
+// ── tuple / list / dict subclasses ─────────────────────────
+//
+// Subclasses of tuple, list and dict that leave the reduce protocol to
+// `object`. What `__reduce_ex__(4)` makes of those is known from the type
+// alone, so they are rebuilt the way deepcopy would rebuild them from it,
+// without the reduce call and the Python iterators: a tuple subclass is
+// created from copies of its items, a list or dict subclass is created empty,
+// memoized, and then gets a copy of the instance `__dict__` and copies of its
+// items.
+
+/// The code every namedtuple's `__getnewargs__` is made from, nested in
+/// `namedtuple()` itself (`None` if it isn't there).
+unsafe fn namedtuple_getnewargs_code() -> *mut PyObject {
+    use crate::{py_cache, py_eval};
+    py_cache!(py_eval!(
+        "next((c for c in __import__('collections').namedtuple.__code__.co_consts"
+        " if getattr(c, 'co_name', None) == '__getnewargs__'), None)"
+    ))
+}
+
+/// Whether a class in `tp`'s MRO declares `__slots__` beyond `__dict__` and
+/// `__weakref__`, which reduce would carry over as slot state.
+unsafe fn declares_slots(tp: *mut PyTypeObject) -> bool {
+    unsafe {
+        let mro = (*tp).tp_mro as *mut PyTupleObject;
+        for i in 0..mro.length() {
+            let base = mro.get_borrowed_unchecked(i) as *mut PyTypeObject;
+            if ffi_ext::tp_flags_of(base) & (Py_TPFLAGS_HEAPTYPE as libc::c_ulong) == 0 {
+                continue;
+            }
+            let slots = PyDict_GetItemWithError((*base).tp_dict, py_str!("__slots__"));
+            if slots.is_null() {
+                if !PyErr_Occurred().is_null() {
+                    PyErr_Clear();
+                    return true;
+                }
+                continue;
+            }
+            let slots = if PyUnicode_Check(slots) != 0 {
+                PyTuple_Pack(1, slots)
+            } else if PyTuple_Check(slots) != 0 || PyList_Check(slots) != 0 {
+                PySequence_Tuple(slots)
+            } else {
+                // Whatever iterable it was, it's been consumed by now.
+                return true;
+            };
+            if slots.is_null() {
+                PyErr_Clear();
+                return true;
+            }
+            let names = slots as *mut PyTupleObject;
+            let declared = (0..names.length()).any(|j| {
+                let name = names.get_borrowed_unchecked(j);
+                PyUnicode_Check(name) == 0
+                    || (PyUnicode_CompareWithASCIIString(name, crate::cstr!("__dict__")) != 0
+                        && PyUnicode_CompareWithASCIIString(name, crate::cstr!("__weakref__")) != 0)
+            });
+            slots.decref();
+            if declared {
+                return true;
+            }
+        }
+        false
+    }
+}
+
+/// `tp`'s `_fields`, if `tp` still has the `__new__` `namedtuple()` generated
+/// for it: a function that passes its arguments on to `tuple.__new__` as one
+/// tuple. Borrowed from the class that holds it.
+unsafe fn namedtuple_generated_new(tp: *mut PyTypeObject) -> *mut PyObject {
+    unsafe {
+        let descr = ffi_ext::_PyType_Lookup(tp, py_str!("__new__"));
+        let fields = ffi_ext::_PyType_Lookup(tp, py_str!("_fields"));
+        if descr.is_null()
+            || fields.is_null()
+            || PyTuple_CheckExact(fields) == 0
+            || descr.class() != ptr::addr_of_mut!(ffi_ext::PyStaticMethod_Type)
+        {
+            return ptr::null_mut();
+        }
+        let func = descr.getattr(py_str!("__func__"));
+        let globals = if func.is_null() {
+            ptr::null_mut()
+        } else {
+            func.getattr(py_str!("__globals__"))
+        };
+        let tuple_new =
+            (ptr::addr_of_mut!(PyTuple_Type) as *mut PyObject).getattr(py_str!("__new__"));
+        let generated = !globals.is_null()
+            && !tuple_new.is_null()
+            && PyDict_Check(globals) != 0
+            && PyDict_GetItemWithError(globals, py_str!("_tuple_new")) == tuple_new;
+        PyErr_Clear();
+        tuple_new.decref_nullable();
+        globals.decref_nullable();
+        func.decref_nullable();
+        if generated {
+            fields
+        } else {
+            ptr::null_mut()
+        }
+    }
+}
+
+/// Whether `tp` is a tuple, list or dict subclass `deepcopy_subclass` can
+/// rebuild, with what to cache for it. For tuple subclasses that's what the
+/// items are handed over to:
+/// - tuple's `__getnewargs__`: `tp_new`, as one tuple
+/// - a namedtuple's `__getnewargs__`: `tp_new`, one by one (into a `__new__`
+///   of `tp`'s own)
+/// - the `_fields` of a namedtuple that kept the `__new__` `namedtuple()`
+///   generated: tuple's `tp_new`, as one tuple, skipping that `__new__`
+pub(crate) unsafe fn keeps_builtin_reduce(tp: *mut PyTypeObject) -> Option<*mut PyObject> {
+    unsafe {
+        if ffi_ext::tp_flags_of(tp) & (Py_TPFLAGS_HEAPTYPE as libc::c_ulong) == 0
+            || (*tp).tp_getattro.map(|f| f as usize) != Some(PyObject_GenericGetAttr as usize)
+        {
+            return None;
+        }
+        let mut builtin = tp;
+        while ffi_ext::tp_flags_of(builtin) & (Py_TPFLAGS_HEAPTYPE as libc::c_ulong) != 0 {
+            builtin = (*builtin).tp_base;
+        }
+        let tuple_tp = ptr::addr_of_mut!(PyTuple_Type);
+        let list_tp = ptr::addr_of_mut!(PyList_Type);
+        let dict_tp = ptr::addr_of_mut!(PyDict_Type);
+        if builtin != tuple_tp && builtin != list_tp && builtin != dict_tp {
+            return None;
+        }
+
+        let object_tp = ptr::addr_of_mut!(PyBaseObject_Type);
+        let inherited_from = |base: *mut PyTypeObject, name: *mut PyObject| {
+            ffi_ext::_PyType_Lookup(tp, name) == ffi_ext::_PyType_Lookup(base, name)
+        };
+        if !inherited_from(object_tp, py_str!("__reduce_ex__"))
+            || !inherited_from(object_tp, py_str!("__reduce__"))
+            || !inherited_from(object_tp, py_str!("__getstate__"))
+            || !ffi_ext::_PyType_Lookup(tp, py_str!("__getnewargs_ex__")).is_null()
+            || !ffi_ext::_PyType_Lookup(tp, py_str!("__setstate__")).is_null()
+        {
+            return None;
+        }
+
+        let mut found = ffi_ext::_PyType_Lookup(tp, py_str!("__getnewargs__"));
+        if builtin == tuple_tp {
+            let tuples = inherited_from(tuple_tp, py_str!("__getnewargs__"));
+            let namedtuples = !found.is_null()
+                && found.class() == ptr::addr_of_mut!(PyFunction_Type)
+                && PyFunction_GetCode(found) == namedtuple_getnewargs_code();
+            if !tuples && !namedtuples {
+                return None;
+            }
+            let fields = if namedtuples {
+                namedtuple_generated_new(tp)
+            } else {
+                ptr::null_mut()
+            };
+            if !fields.is_null() {
+                found = fields;
+            }
+        } else if !found.is_null() {
+            return None;
+        }
+        // Reduction hands over `iter(obj)` or `obj.items()`, which deepcopy
+        // feeds to `append()` or item assignment.
+        if builtin == list_tp
+            && ((*tp).tp_iter.map(|f| f as usize) != (*list_tp).tp_iter.map(|f| f as usize)
+                || !inherited_from(list_tp, py_str!("append")))
+        {
+            return None;
+        }
+        if builtin == dict_tp
+            && ((*(*tp).tp_as_mapping).mp_ass_subscript.map(|f| f as usize)
+                != (*(*dict_tp).tp_as_mapping)
+                    .mp_ass_subscript
+                    .map(|f| f as usize)
+                || !inherited_from(dict_tp, py_str!("items")))
+        {
+            return None;
+        }
+
+        if declares_slots(tp) {
+            return None;
+        }
+        Some(found)
+    }
+}
+
+pub(crate) unsafe fn deepcopy_subclass<M: Memo>(
+    original: *mut PyObject,
+    tp: *mut PyTypeObject,
+    getnewargs: *mut PyObject,
+    memo: &mut M,
+    probe: M::Probe,
+) -> *mut PyObject {
+    unsafe {
+        let dictptr = if (*tp).tp_dictoffset != 0 {
+            ffi_ext::_PyObject_GetDictPtr(original)
+        } else {
+            ptr::null_mut()
+        };
+        let dict = if !dictptr.is_null() && !(*dictptr).is_null() && PyDict_Size(*dictptr) > 0 {
+            *dictptr
+        } else {
+            ptr::null_mut()
+        };
+        if has_registered_reductor(tp)
+            || (!dict.is_null()
+                && (shadows_reduce_protocol(dict)
+                    || PyDict_Contains(dict, py_str!("append")) != 0
+                    || PyDict_Contains(dict, py_str!("items")) != 0))
+        {
+            return reconstruct(original, tp, memo, probe);
+        }
+
+        stat!(Subclass);
+        let copied = if PyTuple_Check(original) != 0 {
+            // The items are arguments of the reconstruction: copied before the instance exists.
+            let original_items = original as *mut PyTupleObject;
+            let size = original_items.length();
+            let items = bail!(py_tuple_new(size));
+            for i in 0..size {
+                let item_copy =
+                    deepcopy::deepcopy(original_items.get_borrowed_unchecked(i), memo).into_raw();
+                if item_copy.is_null() {
+                    items.decref();
+                    return ptr::null_mut();
+                }
+                items.set_slot_steal_unchecked(i, item_copy);
+            }
+            let skips_new =
+                PyTuple_CheckExact(getnewargs) != 0 && PyTuple_GET_SIZE(getnewargs) == size;
+            // Otherwise, the generated `__new__` gets to reject the wrong number of fields.
+            let packed = skips_new
+                || (PyTuple_CheckExact(getnewargs) == 0
+                    && getnewargs.class() != ptr::addr_of_mut!(PyFunction_Type));
+            let args = if packed {
+                PyTuple_Pack(1, items as *mut PyObject)
+            } else {
+                (items as *mut PyObject).newref()
+            };
+            items.decref();
+            let args = bail!(args);
+            let new_tp = if skips_new {
+                ptr::addr_of_mut!(PyTuple_Type)
+            } else {
+                tp
+            };
+            let copied = match (*new_tp).tp_new {
+                Some(tp_new) => tp_new(tp, args, ptr::null_mut()),
+                None => call_tp_new(tp, args, ptr::null_mut()),
+            };
+            args.decref();
+            copied
+        } else {
+            let args = bail!(py_tuple_new(0));
+            let copied = call_tp_new(tp, args as _, ptr::null_mut());
+            args.decref();
+            copied
+        };
+        let copied = bail!(copied);
+        if memo.memoize(original, copied, &probe) < 0 {
+            copied.decref();
+            return ptr::null_mut();
+        }
+
+        // Same order as applying the reduced state: the `__dict__` first, then the items.
+        let mut status = if dict.is_null() {
+            0
+        } else {
+            apply_dict_state(copied, dict, memo)
+        };
+        if status == 0 && PyList_Check(original) != 0 {
+            let original_items = original as *mut PyListObject;
+            let mut i = 0;
+            while status == 0 && i < original_items.length() {
+                let item = original_items.get_borrowed_unchecked(i).newref();
+                let item_copy = deepcopy::deepcopy(item, memo).into_raw();
+                item.decref();
+                status = if item_copy.is_null() {
+                    -1
+                } else {
+                    let appended = PyList_Append(copied, item_copy);
+                    item_copy.decref();
+                    appended
+                };
+                i += 1;
+            }
+        } else if status == 0 && PyDict_Check(original) != 0 {
+            status = deepcopy::deepcopy_dict_items_into(copied, original, memo);
+        }
+        if status < 0 {
+            memo.forget(original, &probe);
+            copied.decref();
+            return ptr::null_mut();
+        }
+        copied
+    }
+}
+
 // ── Main entry point ───────────────────────────────────────
 
 pub unsafe fn reconstruct<M: Memo>(
@@ -804,11 +1364,30 @@ pub unsafe fn reconstruct<M: Memo>(
     probe: M::Probe,
 ) -> *mut PyObject {
     unsafe {
+        stat!(Reduce);
+        stat_reduce_type!(tp);
+        // A reductor, __reduce_ex__ or __getstate__ may hand back originals in
+        // what it returns.
+        if memo.expose() < 0 {
+            return ptr::null_mut();
+        }
+        let mut plan = ReducePlan::Generic;
         let mut reduce_result = try_reduce_via_registry(original, tp);
-        if reduce_result.is_null() {
+        if !reduce_result.is_null() {
+            stat!(Registry);
+        } else {
             if !PyErr_Occurred().is_null() {
                 return ptr::null_mut();
             }
+            plan = type_cache::reduce_plan(tp);
+            if plan.reads_dict() {
+                let slots = type_cache::slot_plan(tp);
+                if let Some(instance) =
+                    reconstruct_newobj_state(original, tp, slots.as_ref(), memo, &probe)
+                {
+                    return instance;
+                }
+            }
             reduce_result = call_reduce_method_preferring_ex(original);
             if reduce_result.is_null() {
                 return ptr::null_mut();
@@ -829,6 +1408,12 @@ pub unsafe fn reconstruct<M: Memo>(
             ReduceKind::Tuple => {}
         }
 
+        if plan == ReducePlan::Unknown {
+            let mut slots = type_cache::EMPTY_SLOT_PLAN;
+            let plan = classify_reduce(tp, &parts, &mut slots);
+            type_cache::set_reduce_plan(tp, plan, &slots);
+        }
+
         let instance = if parts.callable == py_obj!("copyreg.__newobj__") {
             reconstruct_newobj(parts.argtup, memo)
         } else if parts.callable == py_obj!("copyreg.__newobj_ex__") {
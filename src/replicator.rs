@@ -0,0 +1,286 @@
+//! Copies on demand (`copium.extra.ireplicate`).
+//!
+//! `ireplicate(obj, n)` is `replicate(obj, n)` as an iterator: each step makes
+//! one deep copy, so only the copies the consumer still holds are alive at a
+//! time. Given a plan from `compile()`, each step runs the plan instead. A
+//! template isn't compiled on its own the way `replicate()` does it: the
+//! consumer runs between steps and may change obj, which a plan wouldn't see.
+//!
+//! The iterator keeps a memo and the plan's slots of its own across steps. The
+//! memo is reset the way `cleanup_memo` resets the thread's one after a call, so
+//! a step doesn't go through the thread's memo at all; if Python code kept it,
+//! the next step starts a new one. A step nested in another one (a
+//! `__deepcopy__` that advances the iterator) or running beside it on another
+//! thread finds them taken and copies with `get_memo` and slots of its own
+//! instead.
+
+use core::ffi::c_void;
+use pyo3_ffi::*;
+use std::ptr;
+
+use crate::critical_section::with_critical_section_raw;
+use crate::deepcopy;
+use crate::memo::PyMemoObject;
+use crate::types::{PyObjectPtr, PyTypeObjectPtr};
+
+#[repr(C)]
+pub struct PyReplicatorObject {
+    pub ob_base: PyObject,
+    /// The template, or the plan to run.
+    obj: *mut PyObject,
+    /// Copies left to make, -1 for no end.
+    remaining: Py_ssize_t,
+    /// Kept between steps, null until one needs it.
+    memo: *mut PyMemoObject,
+    /// The plan's slots.
+    slots: Vec<*mut PyObject>,
+    /// A step is using memo and slots.
+    busy: bool,
+}
+
+pub static mut Replicator_Type: PyTypeObject = unsafe { std::mem::zeroed() };
+
+static mut REPLICATOR_METHODS: [PyMethodDef; 2] = [PyMethodDef::zeroed(); 2];
+
+/// What a step gets from `take`.
+enum Take {
+    /// No copies left.
+    Done,
+    /// Memo and slots are the step's.
+    Owned,
+    /// Another step has memo and slots.
+    Aside,
+}
+
+/// Takes one copy off the count, and memo and slots if no step has them.
+unsafe fn take(replicator: *mut PyReplicatorObject) -> Take {
+    unsafe {
+        with_critical_section_raw(replicator as *mut PyObject, || {
+            let replicator = &mut *replicator;
+            if replicator.remaining == 0 {
+                return Take::Done;
+            }
+            if replicator.remaining > 0 {
+                replicator.remaining -= 1;
+            }
+            if replicator.busy {
+                return Take::Aside;
+            }
+            replicator.busy = true;
+            Take::Owned
+        })
+    }
+}
+
+unsafe fn put_back(replicator: *mut PyReplicatorObject) {
+    unsafe {
+        with_critical_section_raw(replicator as *mut PyObject, || {
+            (*replicator).busy = false;
+        })
+    }
+}
+
+/// One copy of obj, or one run of the plan with slots. memo is only used by a
+/// plan that needs one.
+#[inline(always)]
+unsafe fn copy_once(
+    obj: *mut PyObject,
+    is_plan: bool,
+    slots: &mut [*mut PyObject],
+    memo: &mut PyMemoObject,
+) -> *mut PyObject {
+    unsafe {
+        if is_plan {
+            crate::plan::run_once(obj, slots, Some(memo))
+        } else {
+            deepcopy::deepcopy(obj, memo).0
+        }
+    }
+}
+
+/// A step with the iterator's memo and slots.
+unsafe fn step(replicator: &mut PyReplicatorObject) -> *mut PyObject {
+    unsafe {
+        let is_plan = crate::plan::is_plan(replicator.obj);
+        if is_plan {
+            let (n_slots, uses_memo) = crate::plan::run_needs(replicator.obj);
+            replicator.slots.clear();
+            replicator.slots.resize(n_slots, ptr::null_mut());
+            if !uses_memo {
+                return crate::plan::run_once(replicator.obj, &mut replicator.slots, None);
+            }
+        }
+
+        if replicator.memo.is_null() {
+            replicator.memo = crate::memo::pymemo_alloc();
+            if replicator.memo.is_null() {
+                return ptr::null_mut();
+            }
+        }
+        let memo = replicator.memo;
+        (*memo).defer_unique = true;
+        (*memo).lazy_keepalive = !cfg!(Py_GIL_DISABLED);
+        let copy = copy_once(replicator.obj, is_plan, &mut replicator.slots, &mut *memo);
+        if memo.refcount() == 1 {
+            (*memo).reset();
+        } else {
+            replicator.memo = ptr::null_mut();
+            PyObject_GC_Track(memo as *mut c_void);
+            memo.decref();
+        }
+        copy
+    }
+}
+
+/// A step while another one has the iterator's memo and slots.
+unsafe fn step_aside(obj: *mut PyObject) -> *mut PyObject {
+    unsafe {
+        let is_plan = crate::plan::is_plan(obj);
+        let mut slots = Vec::new();
+        if is_plan {
+            let (n_slots, uses_memo) = crate::plan::run_needs(obj);
+            slots.resize(n_slots, ptr::null_mut());
+            if !uses_memo {
+                return crate::plan::run_once(obj, &mut slots, None);
+            }
+        }
+        let (memo, is_tss) = crate::memo::get_memo();
+        if memo.is_null() {
+            return ptr::null_mut();
+        }
+        let copy = copy_once(obj, is_plan, &mut slots, &mut *memo);
+        crate::memo::cleanup_memo(memo, is_tss);
+        copy
+    }
+}
+
+unsafe extern "C" fn replicator_next(obj: *mut PyObject) -> *mut PyObject {
+    unsafe {
+        let replicator = obj as *mut PyReplicatorObject;
+        match take(replicator) {
+            Take::Done => ptr::null_mut(),
+            Take::Aside => {
+                let template = (*replicator).obj.newref();
+                let copy = step_aside(template);
+                template.decref();
+                copy
+            }
+            Take::Owned => {
+                let template = (*replicator).obj;
+                let copy = if template.class().is_atomic_immutable() {
+                    template.newref()
+                } else {
+                    step(&mut *replicator)
+                };
+                put_back(replicator);
+                copy
+            }
+        }
+    }
+}
+
+unsafe extern "C" fn replicator_length_hint(
+    obj: *mut PyObject,
+    _noargs: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        let remaining =
+            with_critical_section_raw(obj, || (*(obj as *mut PyReplicatorObject)).remaining);
+        if remaining < 0 {
+            return Py_NotImplemented().newref();
+        }
+        PyLong_FromSsize_t(remaining)
+    }
+}
+
+unsafe extern "C" fn replicator_dealloc(obj: *mut PyObject) {
+    unsafe {
+        PyObject_GC_UnTrack(obj as *mut c_void);
+        replicator_clear(obj);
+        let replicator = obj as *mut PyReplicatorObject;
+        (*replicator).memo.decref_nullable();
+        ptr::drop_in_place(ptr::addr_of_mut!((*replicator).slots));
+        PyObject_GC_Del(obj as *mut c_void);
+    }
+}
+
+unsafe extern "C" fn replicator_traverse(
+    obj: *mut PyObject,
+    visit: visitproc,
+    arg: *mut c_void,
+) -> std::ffi::c_int {
+    unsafe {
+        let template = (*(obj as *mut PyReplicatorObject)).obj;
+        if template.is_null() {
+            0
+        } else {
+            visit(template, arg)
+        }
+    }
+}
+
+unsafe extern "C" fn replicator_clear(obj: *mut PyObject) -> std::ffi::c_int {
+    unsafe {
+        let template = std::mem::replace(
+            &mut (*(obj as *mut PyReplicatorObject)).obj,
+            ptr::null_mut(),
+        );
+        template.decref_nullable();
+        0
+    }
+}
+
+/// Returns an iterator over n copies of obj, or over copies without end if n is
+/// -1.
+pub unsafe fn replicator_new(obj: *mut PyObject, n: Py_ssize_t) -> *mut PyObject {
+    unsafe {
+        let object = PyObject_GC_New::<PyReplicatorObject>(ptr::addr_of_mut!(Replicator_Type));
+        if object.is_null() {
+            return ptr::null_mut();
+        }
+        ptr::addr_of_mut!((*object).obj).write(obj.newref());
+        ptr::addr_of_mut!((*object).remaining).write(n);
+        ptr::addr_of_mut!((*object).memo).write(ptr::null_mut());
+        ptr::addr_of_mut!((*object).slots).write(Vec::new());
+        ptr::addr_of_mut!((*object).busy).write(false);
+        PyObject_GC_Track(object as *mut c_void);
+        object as *mut PyObject
+    }
+}
+
+pub unsafe fn replicator_ready_type() -> i32 {
+    unsafe {
+        REPLICATOR_METHODS[0] = PyMethodDef {
+            ml_name: crate::cstr!("__length_hint__"),
+            ml_meth: PyMethodDefPointer {
+                PyCFunction: replicator_length_hint,
+            },
+            ml_flags: METH_NOARGS,
+            ml_doc: crate::cstr!("Private method returning an estimate of len(list(it))."),
+        };
+
+        let tp = ptr::addr_of_mut!(Replicator_Type);
+        (*tp).tp_name = crate::cstr!("copium.extra.Replicator");
+        (*tp).tp_doc = crate::cstr!("Iterator over deep copies made by copium.extra.ireplicate().");
+        (*tp).tp_basicsize = std::mem::size_of::<PyReplicatorObject>() as Py_ssize_t;
+        (*tp).tp_dealloc = Some(replicator_dealloc);
+        #[cfg(Py_GIL_DISABLED)]
+        {
+            (*tp).tp_flags.store(
+                Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+                core::sync::atomic::Ordering::Relaxed,
+            );
+        }
+        #[cfg(not(Py_GIL_DISABLED))]
+        {
+            (*tp).tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+        }
+        (*tp).tp_traverse = Some(replicator_traverse);
+        (*tp).tp_clear = Some(replicator_clear);
+        (*tp).tp_iter = Some(PyObject_SelfIter);
+        (*tp).tp_iternext = Some(replicator_next);
+        (*tp).tp_methods = ptr::addr_of_mut!(REPLICATOR_METHODS).cast::<PyMethodDef>();
+
+        PyType_Ready(tp)
+    }
+}
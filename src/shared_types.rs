@@ -0,0 +1,165 @@
+//! Types shared rather than copied: `copium.config.apply(atomic_types=...)`
+//! for every call, and `deepcopy(x, share=...)` for one. Only exact types
+//! count, like registrations (see `capi`).
+//!
+//! The configured ones are consulted by `classify_route`, so once a type is
+//! classified they cost what any other atomic type does; changing them drops
+//! the routes cached for the types that came or went. The ones of a call are
+//! checked ahead of the route of every object copied while it runs on that
+//! thread, nested calls included. That is a thread-local load when there are
+//! none, and a scan of a few pointers when there are.
+
+use std::ffi::c_char;
+use std::hint::unlikely;
+use std::ptr;
+
+use pyo3_ffi::*;
+
+use crate::state::STATE;
+use crate::types::PyObjectPtr;
+
+/// Borrowed from the `deepcopy()` call that passed `share=`, null outside of
+/// one.
+#[thread_local]
+static mut CALL_SHARED_TYPES: *mut PyObject = ptr::null_mut();
+
+#[inline(always)]
+unsafe fn contain(types: *mut PyObject, cls: *mut PyTypeObject) -> bool {
+    unsafe {
+        (0..PyTuple_GET_SIZE(types)).any(|i| PyTuple_GET_ITEM(types, i) == cls as *mut PyObject)
+    }
+}
+
+/// Cold: only asked by `classify_route`.
+pub unsafe fn is_configured_atomic(cls: *mut PyTypeObject) -> bool {
+    unsafe {
+        let types = STATE.atomic_types;
+        !types.is_null() && contain(types, cls)
+    }
+}
+
+#[inline(always)]
+pub unsafe fn is_shared_by_call(cls: *mut PyTypeObject) -> bool {
+    unsafe {
+        let types = CALL_SHARED_TYPES;
+        unlikely(!types.is_null()) && contain(types, cls)
+    }
+}
+
+unsafe fn is_traversed_container(cls: *mut PyTypeObject) -> bool {
+    cls == ptr::addr_of_mut!(PyTuple_Type)
+        || cls == ptr::addr_of_mut!(PyList_Type)
+        || cls == ptr::addr_of_mut!(PyDict_Type)
+        || cls == ptr::addr_of_mut!(PySet_Type)
+        || cls == ptr::addr_of_mut!(PyFrozenSet_Type)
+}
+
+/// The types of a type or an iterable of them, as a new tuple, or null with an
+/// exception set. The containers `deepcopy` traverses itself never get to a
+/// route to be shared on.
+pub unsafe fn shared_types_from(value: *mut PyObject, param: *const c_char) -> *mut PyObject {
+    unsafe {
+        let types = if PyType_Check(value) != 0 {
+            PyTuple_Pack(1, value)
+        } else {
+            PySequence_Tuple(value)
+        };
+        if types.is_null() {
+            if PyErr_ExceptionMatches(PyExc_TypeError) != 0 {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    crate::cstr!("%s must be a type or an iterable of types, got '%.200s'"),
+                    param,
+                    (*value.class()).tp_name,
+                );
+            }
+            return ptr::null_mut();
+        }
+        for i in 0..PyTuple_GET_SIZE(types) {
+            let item = PyTuple_GET_ITEM(types, i);
+            if PyType_Check(item) == 0 {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    crate::cstr!("%s[%zd] must be a type, got '%.200s'"),
+                    param,
+                    i,
+                    (*item.class()).tp_name,
+                );
+                types.decref();
+                return ptr::null_mut();
+            }
+            let cls = item as *mut PyTypeObject;
+            if is_traversed_container(cls) {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    crate::cstr!("copium copies '%.200s' objects itself"),
+                    (*cls).tp_name,
+                );
+                types.decref();
+                return ptr::null_mut();
+            }
+        }
+        types
+    }
+}
+
+unsafe fn invalidate_all(types: *mut PyObject) {
+    unsafe {
+        if types.is_null() {
+            return;
+        }
+        for i in 0..PyTuple_GET_SIZE(types) {
+            crate::capi::invalidate(PyTuple_GET_ITEM(types, i) as *mut PyTypeObject);
+        }
+    }
+}
+
+/// Steals `types`, a tuple from `shared_types_from` or null for none.
+pub unsafe fn set_atomic_types(mut types: *mut PyObject) {
+    unsafe {
+        if !types.is_null() && PyTuple_GET_SIZE(types) == 0 {
+            types.decref();
+            types = ptr::null_mut();
+        }
+        let state = ptr::addr_of_mut!(STATE);
+        let old = (*state).atomic_types;
+        (*state).atomic_types = types;
+        invalidate_all(old);
+        invalidate_all(types);
+        old.decref_nullable();
+    }
+}
+
+/// `deepcopy(x, memo, share=...)`: the types are shared by whatever this
+/// thread copies until the call returns, on top of the ones an outer call
+/// shares.
+pub unsafe fn deepcopy_sharing(
+    object: *mut PyObject,
+    memo_arg: *mut PyObject,
+    share: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        let mut types = shared_types_from(share, crate::cstr!("share"));
+        if types.is_null() {
+            return ptr::null_mut();
+        }
+        let outer = CALL_SHARED_TYPES;
+        if !outer.is_null() {
+            let both = PySequence_Concat(outer, types);
+            types.decref();
+            if both.is_null() {
+                return ptr::null_mut();
+            }
+            types = both;
+        }
+        CALL_SHARED_TYPES = if PyTuple_GET_SIZE(types) > 0 {
+            types
+        } else {
+            ptr::null_mut()
+        };
+        let result = crate::deepcopy_top(object, memo_arg);
+        CALL_SHARED_TYPES = outer;
+        types.decref();
+        result
+    }
+}
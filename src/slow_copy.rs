@@ -0,0 +1,236 @@
+//! Slow-copy sampler, set up with
+//! `copium.config.apply(slow_copy_callback=...)`.
+//!
+//! Times the top-level `deepcopy()` calls, whatever memo they copy with; one
+//! made while another call on the thread is timed is part of that call. One
+//! that took at least `slow_copy_threshold_us`, or every `slow_copy_sample`-th
+//! one on a thread, is reported by calling the callback with a dict of:
+//!
+//! - `callsite`: `(filename, lineno, function, line)` of the calling frame,
+//!   or `None`
+//! - `elapsed_us`: how long the call took
+//! - `python_us`: ... of which in the reduce and `__deepcopy__` routes, along
+//!   with whatever those copied underneath
+//! - `native_us`: ... and the rest
+//! - `nodes`: objects copied rather than returned as is
+//! - `memo_size`: entries the memo got to hold
+//! - `sampled`: whether the call was one of the sampled ones
+//!
+//! `nodes` and `memo_size` are 0 for a memo that's neither copium's own nor a
+//! dict: counting its entries would call into Python.
+//!
+//! A call reads the clock on either end, and so does every reduce or
+//! `__deepcopy__` route it takes, which calls into Python anyway. Nothing is
+//! counted per native node: every copy ends up in the memo, which already knows
+//! how many it holds.
+
+use pyo3_ffi::*;
+use std::ptr;
+use std::time::Instant;
+
+use crate::deepcopy::PyResult;
+use crate::memo::Memo;
+use crate::state::STATE;
+use crate::types::PyObjectPtr;
+
+pub struct SlowCopySample {
+    start: Instant,
+    elapsed_ns: u64,
+    /// Of the outermost route in progress.
+    python_start: Instant,
+    python_ns: u64,
+    python_depth: u32,
+    active: bool,
+    sampled: bool,
+    nodes: usize,
+    memo_size: usize,
+}
+
+/// The call being timed on this thread, which the routes it takes report to.
+#[thread_local]
+pub(crate) static mut CURRENT: *mut SlowCopySample = ptr::null_mut();
+
+/// Set while the callback runs, so that copies it makes aren't timed
+/// themselves.
+#[thread_local]
+static mut REPORTING: bool = false;
+
+#[thread_local]
+static mut CALLS: isize = 0;
+
+/// Top-level `deepcopy` with `memo`, timed for the sampler. `release` gets the
+/// memo once the copy is measured, before the callback runs.
+pub unsafe fn deepcopy_sampled<M: Memo>(
+    object: *mut PyObject,
+    memo: &mut M,
+    release: impl FnOnce(&mut M),
+) -> PyResult {
+    unsafe {
+        let mut sample = SlowCopySample::new();
+        if sample.active {
+            // What the memo held before the call isn't the call's.
+            (sample.nodes, _) = memo.copied_counts();
+            CURRENT = &mut sample;
+        }
+        sample.start = Instant::now();
+        let result = crate::deepcopy::deepcopy(object, memo);
+        sample.stop(memo);
+        release(memo);
+        if !result.is_error() {
+            sample.finish();
+        }
+        result
+    }
+}
+
+impl SlowCopySample {
+    unsafe fn new() -> Self {
+        unsafe {
+            let now = Instant::now();
+            let mut sample = SlowCopySample {
+                start: now,
+                elapsed_ns: 0,
+                python_start: now,
+                python_ns: 0,
+                python_depth: 0,
+                active: !REPORTING && CURRENT.is_null(),
+                sampled: false,
+                nodes: 0,
+                memo_size: 0,
+            };
+            let every = STATE.slow_copy_sample;
+            if sample.active && every > 0 {
+                CALLS += 1;
+                if CALLS >= every {
+                    CALLS = 0;
+                    sample.sampled = true;
+                }
+            }
+            sample
+        }
+    }
+
+    /// Right after the copy, while the memo still holds what it made.
+    unsafe fn stop<M: Memo>(&mut self, memo: &mut M) {
+        unsafe {
+            if !self.active {
+                return;
+            }
+            self.elapsed_ns = self.start.elapsed().as_nanos() as u64;
+            CURRENT = ptr::null_mut();
+            let nodes_before = self.nodes;
+            (self.nodes, self.memo_size) = memo.copied_counts();
+            self.nodes = self.nodes.saturating_sub(nodes_before);
+        }
+    }
+
+    #[inline(always)]
+    pub fn route_enter(&mut self) {
+        if self.python_depth == 0 {
+            self.python_start = Instant::now();
+        }
+        self.python_depth += 1;
+    }
+
+    #[inline(always)]
+    pub fn route_leave(&mut self) {
+        self.python_depth -= 1;
+        if self.python_depth == 0 {
+            self.python_ns += self.python_start.elapsed().as_nanos() as u64;
+        }
+    }
+
+    /// Calls the callback if the call is due to be reported. Its failures are
+    /// unraisable: the copy itself went fine.
+    unsafe fn finish(&self) {
+        unsafe {
+            if !self.active {
+                return;
+            }
+            let threshold = STATE.slow_copy_threshold_ns;
+            let slow = threshold >= 0 && self.elapsed_ns >= threshold as u64;
+            if !slow && !self.sampled {
+                return;
+            }
+            let callback = STATE.slow_copy_callback;
+            if callback.is_null() {
+                return;
+            }
+            callback.incref();
+
+            REPORTING = true;
+            let report = self.make_report();
+            let result = if report.is_null() {
+                ptr::null_mut()
+            } else {
+                callback.call_one(report)
+            };
+            REPORTING = false;
+
+            if result.is_null() {
+                PyErr_WriteUnraisable(callback);
+            }
+            result.decref_nullable();
+            report.decref_nullable();
+            callback.decref();
+        }
+    }
+
+    unsafe fn make_report(&self) -> *mut PyObject {
+        unsafe {
+            let report = PyDict_New();
+            if report.is_null() {
+                return ptr::null_mut();
+            }
+            let mut callsite = crate::fallback::get_caller_frame_info();
+            if callsite.is_null() {
+                PyErr_Clear();
+                callsite = Py_None().newref();
+            }
+            let native_ns = self.elapsed_ns.saturating_sub(self.python_ns);
+            let entries = [
+                (crate::cstr!("callsite"), callsite),
+                (crate::cstr!("elapsed_us"), micros(self.elapsed_ns)),
+                (crate::cstr!("python_us"), micros(self.python_ns)),
+                (crate::cstr!("native_us"), micros(native_ns)),
+                (crate::cstr!("nodes"), PyLong_FromSize_t(self.nodes)),
+                (crate::cstr!("memo_size"), PyLong_FromSize_t(self.memo_size)),
+                (crate::cstr!("sampled"), PyBool_FromLong(self.sampled as _)),
+            ];
+            let mut failed = false;
+            for (key, value) in entries {
+                if value.is_null() || PyDict_SetItemString(report, key, value) < 0 {
+                    failed = true;
+                }
+                value.decref_nullable();
+            }
+            if failed {
+                report.decref();
+                return ptr::null_mut();
+            }
+            report
+        }
+    }
+}
+
+fn micros(ns: u64) -> *mut PyObject {
+    unsafe { PyFloat_FromDouble(ns as f64 / 1000.0) }
+}
+
+/// Times `$expr`, a reduce or `__deepcopy__` route taken by the call being
+/// timed, if any.
+macro_rules! slow_copy_route {
+    ($expr:expr) => {{
+        let sample = $crate::slow_copy::CURRENT;
+        if ::std::hint::likely(sample.is_null()) {
+            $expr
+        } else {
+            (*sample).route_enter();
+            let result = $expr;
+            (*sample).route_leave();
+            result
+        }
+    }};
+}
+
+pub(crate) use slow_copy_route;
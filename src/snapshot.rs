@@ -0,0 +1,562 @@
+//! Incremental snapshots (`copium.extra.Snapshotter`).
+//!
+//! A snapshotter keeps, for every dict of its root it has copied, a node with
+//! that copy. The dicts are watched (`PyDict_Watch`, 3.12+): any change marks
+//! the dict's node dirty, along with the nodes of every dict it was found in,
+//! up to the root. The next snapshot hands out the previous copy of a dict
+//! whose node is clean, as long as that copy holds nothing else than atomics
+//! and such dicts ("pure"), and copies everything else again.
+//!
+//! Lists and tuples are walked again on every snapshot, so that the dicts
+//! inside them still get reused, and are never pure themselves. Any other
+//! object goes through `deepcopy` with a memo shared by the whole snapshot,
+//! which also gets every copy the walk made. The dicts nested in a reused copy
+//! aren't in that memo, only the one at its top.
+//!
+//! Snapshots share what didn't change with each other, so they must not be
+//! mutated. Without dict watchers (before 3.12, and on free-threaded builds)
+//! every snapshot is a full deepcopy.
+
+use core::ffi::c_void;
+use pyo3_ffi::*;
+use std::collections::HashMap;
+use std::ptr;
+
+use crate::deepcopy;
+#[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+use crate::memo::Memo;
+use crate::types::PyObjectPtr;
+#[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+use crate::types::{PyTypeInfo, PyTypeObjectPtr};
+
+#[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+extern "C" {
+    fn PyDict_AddWatcher(
+        callback: Option<
+            unsafe extern "C" fn(
+                event: i32,
+                dict: *mut PyObject,
+                key: *mut PyObject,
+                new_value: *mut PyObject,
+            ) -> i32,
+        >,
+    ) -> i32;
+    fn PyDict_Watch(watcher_id: i32, dict: *mut PyObject) -> i32;
+    fn PyDict_Unwatch(watcher_id: i32, dict: *mut PyObject) -> i32;
+}
+
+struct Node {
+    /// The dict's copy in the latest snapshot that reached it; strong.
+    copy: *mut PyObject,
+    /// Dicts it was found in, only ever used as keys into `nodes`.
+    parents: Vec<usize>,
+    /// Latest snapshot that reached it.
+    epoch: u64,
+    /// The dict, or one in it, changed since `copy` was made.
+    dirty: bool,
+    /// `copy` holds nothing but atomics and pure dicts.
+    pure: bool,
+    /// `copy` is still being filled in.
+    copying: bool,
+}
+
+#[repr(C)]
+pub struct PySnapshotterObject {
+    pub ob_base: PyObject,
+    root: *mut PyObject,
+    /// Original dict -> its node.
+    nodes: HashMap<usize, Node>,
+    epoch: u64,
+    /// Work list of `mark_dirty`.
+    marking: Vec<usize>,
+}
+
+pub static mut Snapshotter_Type: PyTypeObject = unsafe { std::mem::zeroed() };
+
+static mut SNAPSHOTTER_METHODS: [PyMethodDef; 2] = [PyMethodDef::zeroed(); 2];
+static mut SNAPSHOTTER_GETSET: [PyGetSetDef; 2] = unsafe { std::mem::zeroed() };
+
+// ══════════════════════════════════════════════════════════════
+//  Watching
+// ══════════════════════════════════════════════════════════════
+
+#[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+mod watch {
+    use super::*;
+
+    const PYDICT_EVENT_DEALLOCATED: i32 = 5;
+
+    static mut WATCHER_ID: i32 = -1;
+    /// Every live snapshotter, for the watcher to look its nodes up in.
+    pub static mut SNAPSHOTTERS: Vec<*mut PySnapshotterObject> = Vec::new();
+
+    /// Marks `dict`'s node and those of the dicts it is in dirty, stopping at
+    /// nodes that already are.
+    unsafe fn mark_dirty(snapshotter: &mut PySnapshotterObject, dict: usize) {
+        let mut marking = std::mem::take(&mut snapshotter.marking);
+        marking.push(dict);
+        while let Some(current) = marking.pop() {
+            if let Some(node) = snapshotter.nodes.get_mut(&current) {
+                if !node.dirty {
+                    node.dirty = true;
+                    marking.extend_from_slice(&node.parents);
+                }
+            }
+        }
+        snapshotter.marking = marking;
+    }
+
+    unsafe extern "C" fn watcher_cb(
+        event: i32,
+        dict: *mut PyObject,
+        _key: *mut PyObject,
+        _new_value: *mut PyObject,
+    ) -> i32 {
+        unsafe {
+            for &snapshotter in (*ptr::addr_of!(SNAPSHOTTERS)).iter() {
+                let snapshotter = &mut *snapshotter;
+                if event == PYDICT_EVENT_DEALLOCATED {
+                    if let Some(node) = snapshotter.nodes.remove(&(dict as usize)) {
+                        node.copy.decref_nullable();
+                    }
+                } else {
+                    mark_dirty(snapshotter, dict as usize);
+                }
+            }
+            0
+        }
+    }
+
+    pub unsafe fn watch(dict: *mut PyObject) -> i32 {
+        unsafe {
+            if WATCHER_ID < 0 {
+                WATCHER_ID = PyDict_AddWatcher(Some(watcher_cb));
+                if WATCHER_ID < 0 {
+                    return -1;
+                }
+            }
+            PyDict_Watch(WATCHER_ID, dict)
+        }
+    }
+
+    /// Stops watching the dicts no other snapshotter has a node for.
+    pub unsafe fn unwatch_all(snapshotter: *mut PySnapshotterObject) {
+        unsafe {
+            let snapshotters = &*ptr::addr_of!(SNAPSHOTTERS);
+            for &dict in (*snapshotter).nodes.keys() {
+                let shared = snapshotters
+                    .iter()
+                    .any(|&other| other != snapshotter && (*other).nodes.contains_key(&dict));
+                if !shared {
+                    let _ = PyDict_Unwatch(WATCHER_ID, dict as *mut PyObject);
+                }
+            }
+        }
+    }
+}
+
+// ══════════════════════════════════════════════════════════════
+//  Copying
+// ══════════════════════════════════════════════════════════════
+
+#[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+unsafe fn copy_dict<M: Memo>(
+    snapshotter: &mut PySnapshotterObject,
+    dict: *mut PyObject,
+    parent: usize,
+    memo: &mut M,
+    pure: &mut bool,
+) -> *mut PyObject {
+    unsafe {
+        let key = dict as usize;
+        let epoch = snapshotter.epoch;
+        if let Some(node) = snapshotter.nodes.get_mut(&key) {
+            if parent != 0 && !node.parents.contains(&parent) {
+                node.parents.push(parent);
+            }
+            if node.epoch == epoch {
+                // Reached before in this snapshot. One still being filled in
+                // can't vouch for what it will hold yet.
+                *pure = node.pure && !node.copying;
+                return node.copy.newref();
+            }
+        }
+        // Copied already by deepcopy, from within an object.
+        let (probe, found) = memo.recall(dict);
+        if !found.is_null() {
+            *pure = false;
+            return found;
+        }
+        if let Some(node) = snapshotter.nodes.get_mut(&key) {
+            if node.pure && !node.dirty {
+                if memo.memoize(dict, node.copy, &probe) < 0 {
+                    return ptr::null_mut();
+                }
+                node.epoch = epoch;
+                *pure = true;
+                return node.copy.newref();
+            }
+        } else {
+            if watch::watch(dict) < 0 {
+                return ptr::null_mut();
+            }
+            snapshotter.nodes.insert(
+                key,
+                Node {
+                    copy: ptr::null_mut(),
+                    parents: if parent != 0 {
+                        vec![parent]
+                    } else {
+                        Vec::new()
+                    },
+                    epoch: 0,
+                    dirty: true,
+                    pure: false,
+                    copying: false,
+                },
+            );
+        }
+
+        let copy = PyDict_New();
+        if copy.is_null() || memo.memoize(dict, copy, &probe) < 0 {
+            copy.decref_nullable();
+            return ptr::null_mut();
+        }
+        if let Some(node) = snapshotter.nodes.get_mut(&key) {
+            let old = std::mem::replace(&mut node.copy, copy.newref());
+            old.decref_nullable();
+            node.epoch = epoch;
+            node.dirty = false;
+            node.pure = true;
+            node.copying = true;
+        }
+
+        let mut all_pure = true;
+        let mut failed = false;
+        let mut iter = crate::dict_iter::DictIterGuard::new(dict);
+        iter.activate();
+        loop {
+            let mut item_key: *mut PyObject = ptr::null_mut();
+            let mut value: *mut PyObject = ptr::null_mut();
+            let next = iter.next(&mut item_key, &mut value);
+            if next <= 0 {
+                failed = next < 0;
+                break;
+            }
+            let key_copy = if deepcopy::is_atomic_element(item_key) {
+                item_key.newref()
+            } else {
+                all_pure = false;
+                deepcopy::deepcopy(item_key, memo).0
+            };
+            let mut value_pure = false;
+            let value_copy = if key_copy.is_null() {
+                ptr::null_mut()
+            } else {
+                copy_object(snapshotter, value, key, memo, &mut value_pure)
+            };
+            item_key.decref();
+            value.decref();
+            all_pure &= value_pure;
+            if value_copy.is_null() {
+                key_copy.decref_nullable();
+                failed = true;
+                break;
+            }
+            if crate::compat::_PyDict_SetItem_Take2(copy, key_copy, value_copy) < 0 {
+                failed = true;
+                break;
+            }
+        }
+        iter.cleanup();
+
+        // The node may be gone if Python code run above dropped the dict.
+        if let Some(node) = snapshotter.nodes.get_mut(&key) {
+            node.copying = false;
+            node.pure &= all_pure;
+            // Whatever made it into the copy can't be trusted next time around.
+            node.dirty |= failed;
+            *pure = node.pure;
+        }
+        if failed {
+            copy.decref();
+            return ptr::null_mut();
+        }
+        copy
+    }
+}
+
+#[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+unsafe fn copy_object<M: Memo>(
+    snapshotter: &mut PySnapshotterObject,
+    object: *mut PyObject,
+    parent: usize,
+    memo: &mut M,
+    pure: &mut bool,
+) -> *mut PyObject {
+    unsafe {
+        let cls = object.class();
+        if cls.is_atomic_immutable() || deepcopy::is_atomic_element(object) {
+            *pure = true;
+            return object.newref();
+        }
+        if PyDictObject::is(cls) {
+            if Py_EnterRecursiveCall(crate::cstr!(" while taking a snapshot")) != 0 {
+                return ptr::null_mut();
+            }
+            let copy = copy_dict(snapshotter, object, parent, memo, pure);
+            Py_LeaveRecursiveCall();
+            return copy;
+        }
+
+        *pure = false;
+        let is_list = PyListObject::is(cls);
+        if !is_list && !PyTupleObject::is(cls) {
+            return deepcopy::deepcopy(object, memo).0;
+        }
+        let (probe, found) = memo.recall(object);
+        if !found.is_null() {
+            return found;
+        }
+
+        if Py_EnterRecursiveCall(crate::cstr!(" while taking a snapshot")) != 0 {
+            return ptr::null_mut();
+        }
+        let mut item_pure = false;
+        let mut copy;
+        if is_list {
+            copy = PyList_New(0);
+            if !copy.is_null() && memo.memoize(object, copy, &probe) < 0 {
+                copy.decref();
+                copy = ptr::null_mut();
+            }
+            let mut i = 0;
+            while !copy.is_null() && i < PyList_GET_SIZE(object) {
+                let item = PyList_GET_ITEM(object, i).newref();
+                let item_copy = copy_object(snapshotter, item, 0, memo, &mut item_pure);
+                item.decref();
+                if item_copy.is_null() || PyList_Append(copy, item_copy) < 0 {
+                    copy.decref();
+                    copy = ptr::null_mut();
+                }
+                item_copy.decref_nullable();
+                i += 1;
+            }
+        } else {
+            let size = PyTuple_GET_SIZE(object);
+            copy = PyTuple_New(size);
+            for i in 0..size {
+                if copy.is_null() {
+                    break;
+                }
+                let item = PyTuple_GET_ITEM(object, i);
+                let item_copy = copy_object(snapshotter, item, 0, memo, &mut item_pure);
+                if item_copy.is_null() {
+                    copy.decref();
+                    copy = ptr::null_mut();
+                } else {
+                    PyTuple_SET_ITEM(copy, i, item_copy);
+                }
+            }
+            if !copy.is_null() {
+                // An item may have led back here and copied the tuple already.
+                let existing = memo.recall_probed(object, &probe);
+                if !existing.is_null() {
+                    copy.decref();
+                    copy = existing;
+                } else if memo.memoize(object, copy, &probe) < 0 {
+                    copy.decref();
+                    copy = ptr::null_mut();
+                }
+            }
+        }
+        Py_LeaveRecursiveCall();
+        copy
+    }
+}
+
+// ══════════════════════════════════════════════════════════════
+//  Snapshotter type
+// ══════════════════════════════════════════════════════════════
+
+unsafe extern "C" fn snapshotter_new(
+    cls: *mut PyTypeObject,
+    args: *mut PyObject,
+    kwargs: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        let n_kwargs = if kwargs.is_null() {
+            0
+        } else {
+            PyDict_Size(kwargs)
+        };
+        let mut root = ptr::null_mut();
+        if PyTuple_GET_SIZE(args) == 1 && n_kwargs == 0 {
+            root = PyTuple_GET_ITEM(args, 0);
+        } else if PyTuple_GET_SIZE(args) == 0 && n_kwargs == 1 {
+            root = PyDict_GetItemString(kwargs, crate::cstr!("root"));
+        }
+        if root.is_null() {
+            PyErr_SetString(
+                PyExc_TypeError,
+                crate::cstr!("Snapshotter() takes exactly one argument, root"),
+            );
+            return ptr::null_mut();
+        }
+
+        let object = PyObject_GC_New::<PySnapshotterObject>(cls);
+        if object.is_null() {
+            return ptr::null_mut();
+        }
+        ptr::addr_of_mut!((*object).root).write(root.newref());
+        ptr::addr_of_mut!((*object).nodes).write(HashMap::new());
+        ptr::addr_of_mut!((*object).epoch).write(0);
+        ptr::addr_of_mut!((*object).marking).write(Vec::new());
+        #[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+        (*ptr::addr_of_mut!(watch::SNAPSHOTTERS)).push(object);
+        PyObject_GC_Track(object as *mut c_void);
+        object as *mut PyObject
+    }
+}
+
+unsafe extern "C" fn snapshotter_snapshot(
+    obj: *mut PyObject,
+    _noargs: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        let snapshotter = &mut *(obj as *mut PySnapshotterObject);
+        if snapshotter.root.is_null() {
+            return Py_None().newref();
+        }
+        let (memo, is_tss) = crate::memo::get_memo();
+        if memo.is_null() {
+            return ptr::null_mut();
+        }
+        #[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+        let copy = {
+            snapshotter.epoch += 1;
+            let mut pure = false;
+            let root = snapshotter.root;
+            copy_object(snapshotter, root, 0, &mut *memo, &mut pure)
+        };
+        #[cfg(not(all(Py_3_12, not(Py_GIL_DISABLED))))]
+        let copy = deepcopy::deepcopy(snapshotter.root, &mut *memo).0;
+        crate::memo::cleanup_memo(memo, is_tss);
+        copy
+    }
+}
+
+unsafe extern "C" fn snapshotter_get_root(
+    obj: *mut PyObject,
+    _closure: *mut c_void,
+) -> *mut PyObject {
+    unsafe {
+        let root = (*(obj as *mut PySnapshotterObject)).root;
+        if root.is_null() {
+            Py_None().newref()
+        } else {
+            root.newref()
+        }
+    }
+}
+
+unsafe extern "C" fn snapshotter_dealloc(obj: *mut PyObject) {
+    unsafe {
+        PyObject_GC_UnTrack(obj as *mut c_void);
+        snapshotter_clear(obj);
+        let snapshotter = obj as *mut PySnapshotterObject;
+        #[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+        (*ptr::addr_of_mut!(watch::SNAPSHOTTERS)).retain(|&other| other != snapshotter);
+        ptr::drop_in_place(ptr::addr_of_mut!((*snapshotter).nodes));
+        ptr::drop_in_place(ptr::addr_of_mut!((*snapshotter).marking));
+        PyObject_GC_Del(obj as *mut c_void);
+    }
+}
+
+unsafe extern "C" fn snapshotter_traverse(
+    obj: *mut PyObject,
+    visit: visitproc,
+    arg: *mut c_void,
+) -> std::ffi::c_int {
+    unsafe {
+        let snapshotter = &*(obj as *mut PySnapshotterObject);
+        if !snapshotter.root.is_null() {
+            let rc = visit(snapshotter.root, arg);
+            if rc != 0 {
+                return rc;
+            }
+        }
+        for node in snapshotter.nodes.values() {
+            if !node.copy.is_null() {
+                let rc = visit(node.copy, arg);
+                if rc != 0 {
+                    return rc;
+                }
+            }
+        }
+        0
+    }
+}
+
+unsafe extern "C" fn snapshotter_clear(obj: *mut PyObject) -> std::ffi::c_int {
+    unsafe {
+        let snapshotter = obj as *mut PySnapshotterObject;
+        #[cfg(all(Py_3_12, not(Py_GIL_DISABLED)))]
+        watch::unwatch_all(snapshotter);
+        let nodes = std::mem::take(&mut (*snapshotter).nodes);
+        for node in nodes.into_values() {
+            node.copy.decref_nullable();
+        }
+        let root = std::mem::replace(&mut (*snapshotter).root, ptr::null_mut());
+        root.decref_nullable();
+        0
+    }
+}
+
+pub unsafe fn snapshotter_ready_type() -> i32 {
+    unsafe {
+        SNAPSHOTTER_METHODS[0] = PyMethodDef {
+            ml_name: crate::cstr!("snapshot"),
+            ml_meth: PyMethodDefPointer {
+                PyCFunction: snapshotter_snapshot,
+            },
+            ml_flags: METH_NOARGS,
+            ml_doc: crate::cstr!(
+                "snapshot(self, /)\n--\n\nDeep copy root, reusing the copies of its dicts that didn't change since the previous\nsnapshot."
+            ),
+        };
+        SNAPSHOTTER_GETSET[0] = PyGetSetDef {
+            name: crate::cstr!("root"),
+            get: Some(snapshotter_get_root),
+            set: None,
+            doc: crate::cstr!("The object snapshots are taken of."),
+            closure: ptr::null_mut(),
+        };
+
+        let tp = ptr::addr_of_mut!(Snapshotter_Type);
+        (*tp).tp_name = crate::cstr!("copium.extra.Snapshotter");
+        (*tp).tp_doc = crate::cstr!(
+            "Snapshotter(root)\n--\n\nTakes deep copies of root that share whatever didn't change between them.\n\nDicts in root are watched for changes. snapshot() copies again only the dicts that\nchanged, or that hold a changed dict, and reuses the previous copies of the others.\nLists, tuples and other objects can't be watched and are copied again every time,\nalong with the dicts holding them. Snapshots share structure, so they must not be\nmutated. Before Python 3.12 and on free-threaded builds, every snapshot is a full\ndeepcopy(root)."
+        );
+        (*tp).tp_basicsize = std::mem::size_of::<PySnapshotterObject>() as Py_ssize_t;
+        (*tp).tp_new = Some(snapshotter_new);
+        (*tp).tp_dealloc = Some(snapshotter_dealloc);
+        #[cfg(Py_GIL_DISABLED)]
+        {
+            (*tp).tp_flags.store(
+                Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+                core::sync::atomic::Ordering::Relaxed,
+            );
+        }
+        #[cfg(not(Py_GIL_DISABLED))]
+        {
+            (*tp).tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC;
+        }
+        (*tp).tp_traverse = Some(snapshotter_traverse);
+        (*tp).tp_clear = Some(snapshotter_clear);
+        (*tp).tp_methods = ptr::addr_of_mut!(SNAPSHOTTER_METHODS).cast::<PyMethodDef>();
+        (*tp).tp_getset = ptr::addr_of_mut!(SNAPSHOTTER_GETSET).cast::<PyGetSetDef>();
+
+        PyType_Ready(tp)
+    }
+}
@@ -18,13 +18,32 @@ pub enum OnIncompatible {
     Silent = 2,
 }
 
+/// What the TSS memo keeps allocated between calls, see `PyMemoObject::reset`.
+#[derive(Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+pub enum MemoRetention {
+    Adaptive = 0,
+    Fixed = 1,
+    Minimal = 2,
+}
+
 pub struct ModuleState {
     pub sentinel: *mut PyObject,
 
     pub memo_mode: MemoMode,
     pub on_incompatible: OnIncompatible,
+    pub memo_retention: MemoRetention,
     pub ignored_errors: *mut PyObject,
     pub ignored_errors_joined: *mut PyObject,
+    /// See `slow_copy`; null when nothing is timed.
+    pub slow_copy_callback: *mut PyObject,
+    /// -1 when only sampled calls are reported.
+    pub slow_copy_threshold_ns: i64,
+    /// Report every nth call on a thread, 0 for none.
+    pub slow_copy_sample: isize,
+    /// `copium.config.apply(atomic_types=...)`, see `shared_types`; null for
+    /// none.
+    pub atomic_types: *mut PyObject,
 }
 
 unsafe impl Sync for ModuleState {}
@@ -34,8 +53,13 @@ pub static mut STATE: ModuleState = ModuleState {
     sentinel: ptr::null_mut(),
     memo_mode: MemoMode::Native,
     on_incompatible: OnIncompatible::Warn,
+    memo_retention: MemoRetention::Adaptive,
     ignored_errors: ptr::null_mut(),
     ignored_errors_joined: ptr::null_mut(),
+    slow_copy_callback: ptr::null_mut(),
+    slow_copy_threshold_ns: -1,
+    slow_copy_sample: 0,
+    atomic_types: ptr::null_mut(),
 };
 
 pub unsafe fn init() -> i32 {
@@ -138,6 +162,12 @@ pub unsafe fn load_config_from_env() -> i32 {
         } else {
             OnIncompatible::Warn
         };
+        (*s).memo_retention = MemoRetention::Adaptive;
+        (*s).slow_copy_callback.decref_nullable();
+        (*s).slow_copy_callback = ptr::null_mut();
+        (*s).slow_copy_threshold_ns = -1;
+        (*s).slow_copy_sample = 0;
+        crate::shared_types::set_atomic_types(ptr::null_mut());
 
         let parsed_ignored_errors = parse_ignored_errors_from_environment();
         if parsed_ignored_errors.is_null() {
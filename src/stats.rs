@@ -0,0 +1,319 @@
+//! `copium.stats()` counters.
+//!
+//! Only built with the `stats` feature; otherwise [`stat!`] and
+//! [`stat_reduce_type!`] expand to nothing. Every thread bumps a block of
+//! counters of its own, and `stats()` adds up the blocks of all threads that
+//! ever counted anything. Blocks are never freed, so counts of threads that
+//! have exited still show up.
+
+use pyo3_ffi::*;
+use std::ptr;
+
+#[cfg(feature = "stats")]
+mod enabled {
+    use pyo3_ffi::*;
+    use std::ptr;
+    use std::sync::atomic::{AtomicU64, Ordering};
+    use std::sync::Mutex;
+
+    use crate::types::PyObjectPtr;
+
+    #[derive(Clone, Copy)]
+    #[repr(usize)]
+    pub enum Stat {
+        /// Literal immutables returned before the memo lookup.
+        PrememoAtomic,
+        /// Objects found in the memo.
+        MemoHit,
+        Tuple,
+        Dict,
+        List,
+        Set,
+        Frozenset,
+        Bytearray,
+        Method,
+        /// OrderedDict, defaultdict, deque and Counter copied natively.
+        Collections,
+        /// Copiers registered through the `_C_API` capsule.
+        CApi,
+        /// Exact `array.array`, registered buffer exporters.
+        Buffer,
+        /// tuple, list and dict subclasses rebuilt natively.
+        Subclass,
+        /// Atomics recognized after the memo lookup.
+        Atomic,
+        /// `__deepcopy__` calls.
+        Deepcopy,
+        /// Objects reconstructed through the reduce protocol...
+        Reduce,
+        /// ...of which reduced through `copyreg.dispatch_table`.
+        Registry,
+        /// `__deepcopy__` calls retried with a dict memo.
+        DictMemoRetry,
+        /// Memo table growths.
+        MemoResize,
+    }
+
+    const COUNT: usize = Stat::MemoResize as usize + 1;
+
+    const NAMES: [*const std::ffi::c_char; COUNT] = [
+        crate::cstr!("prememo_atomic"),
+        crate::cstr!("memo_hit"),
+        crate::cstr!("tuple"),
+        crate::cstr!("dict"),
+        crate::cstr!("list"),
+        crate::cstr!("set"),
+        crate::cstr!("frozenset"),
+        crate::cstr!("bytearray"),
+        crate::cstr!("method"),
+        crate::cstr!("collections"),
+        crate::cstr!("c_api"),
+        crate::cstr!("buffer"),
+        crate::cstr!("subclass"),
+        crate::cstr!("atomic"),
+        crate::cstr!("deepcopy"),
+        crate::cstr!("reduce"),
+        crate::cstr!("registry"),
+        crate::cstr!("dict_memo_retry"),
+        crate::cstr!("memo_resize"),
+    ];
+
+    struct Block {
+        counters: [AtomicU64; COUNT],
+        /// `{type: count}` of objects that took the reduce route.
+        reduce_types: *mut PyObject,
+    }
+
+    // The dict is only touched by threads attached to the interpreter.
+    unsafe impl Sync for Block {}
+
+    #[thread_local]
+    static mut LOCAL: *const Block = ptr::null();
+
+    static BLOCKS: Mutex<Vec<&'static Block>> = Mutex::new(Vec::new());
+
+    #[cold]
+    fn block_slow() -> &'static Block {
+        // Made here so that stats() never sees it half-built; types go uncounted if this fails.
+        let reduce_types = unsafe { PyDict_New() };
+        if reduce_types.is_null() {
+            unsafe { PyErr_Clear() };
+        }
+        let block: &'static Block = Box::leak(Box::new(Block {
+            counters: [const { AtomicU64::new(0) }; COUNT],
+            reduce_types,
+        }));
+        BLOCKS.lock().unwrap_or_else(|e| e.into_inner()).push(block);
+        unsafe { LOCAL = block };
+        block
+    }
+
+    #[inline(always)]
+    fn block() -> &'static Block {
+        match unsafe { LOCAL.as_ref() } {
+            Some(block) => block,
+            None => block_slow(),
+        }
+    }
+
+    #[inline(always)]
+    pub fn bump(stat: Stat) {
+        // Only the owning thread writes, so a plain load and store is enough.
+        let counter = &block().counters[stat as usize];
+        counter.store(counter.load(Ordering::Relaxed) + 1, Ordering::Relaxed);
+    }
+
+    /// Called with no exception set; whatever goes wrong here is dropped.
+    pub unsafe fn bump_reduce_type(tp: *mut PyTypeObject) {
+        unsafe {
+            let counts = block().reduce_types;
+            if counts.is_null() {
+                return;
+            }
+            // stats(reset=True) may clear the dict from another thread, so don't borrow from it.
+            let key = tp as *mut PyObject;
+            let mut count = ptr::null_mut();
+            crate::compat::PyDict_GetItemRef(counts, key, &mut count);
+            let now = if count.is_null() {
+                1
+            } else {
+                PyLong_AsLongLong(count) + 1
+            };
+            count.decref_nullable();
+            let updated = if PyErr_Occurred().is_null() {
+                PyLong_FromLongLong(now)
+            } else {
+                ptr::null_mut()
+            };
+            if updated.is_null() || PyDict_SetItem(counts, key, updated) < 0 {
+                PyErr_Clear();
+            }
+            updated.decref_nullable();
+        }
+    }
+
+    unsafe fn add_counts(into: *mut PyObject, from: *mut PyObject) -> i32 {
+        crate::critical_section::with_critical_section_raw(from, || unsafe {
+            let mut pos: Py_ssize_t = 0;
+            let mut key = ptr::null_mut();
+            let mut value = ptr::null_mut();
+            while PyDict_Next(from, &mut pos, &mut key, &mut value) != 0 {
+                let seen = PyDict_GetItemWithError(into, key);
+                let sum = if seen.is_null() {
+                    value.newref()
+                } else {
+                    PyNumber_Add(seen, value)
+                };
+                let failed = sum.is_null() || PyDict_SetItem(into, key, sum) < 0;
+                sum.decref_nullable();
+                if failed {
+                    return -1;
+                }
+            }
+            0
+        })
+    }
+
+    /// `{counter name: total, ..., "reduce_types": {type: count}}` over all
+    /// threads. With `reset`, the counters are zeroed as they are read; a
+    /// thread counting at the same time may lose a bump.
+    pub unsafe fn collect(reset: bool) -> *mut PyObject {
+        unsafe {
+            let reduce_types = PyDict_New();
+            if reduce_types.is_null() {
+                return ptr::null_mut();
+            }
+
+            let blocks = BLOCKS.lock().unwrap_or_else(|e| e.into_inner()).clone();
+            let mut totals = [0u64; COUNT];
+            for block in blocks {
+                for (total, counter) in totals.iter_mut().zip(&block.counters) {
+                    *total += if reset {
+                        counter.swap(0, Ordering::Relaxed)
+                    } else {
+                        counter.load(Ordering::Relaxed)
+                    };
+                }
+                if !block.reduce_types.is_null() {
+                    if add_counts(reduce_types, block.reduce_types) < 0 {
+                        reduce_types.decref();
+                        return ptr::null_mut();
+                    }
+                    if reset {
+                        PyDict_Clear(block.reduce_types);
+                    }
+                }
+            }
+
+            let result = PyDict_New();
+            if result.is_null() {
+                reduce_types.decref();
+                return ptr::null_mut();
+            }
+            for (name, total) in NAMES.iter().zip(totals) {
+                let value = PyLong_FromUnsignedLongLong(total);
+                if value.is_null() || PyDict_SetItemString(result, *name, value) < 0 {
+                    value.decref_nullable();
+                    reduce_types.decref();
+                    result.decref();
+                    return ptr::null_mut();
+                }
+                value.decref();
+            }
+            let status = PyDict_SetItemString(result, crate::cstr!("reduce_types"), reduce_types);
+            reduce_types.decref();
+            if status < 0 {
+                result.decref();
+                return ptr::null_mut();
+            }
+            result
+        }
+    }
+}
+
+#[cfg(feature = "stats")]
+pub use enabled::{bump, bump_reduce_type, Stat};
+
+#[cfg(feature = "stats")]
+macro_rules! stat {
+    ($name:ident) => {
+        $crate::stats::bump($crate::stats::Stat::$name)
+    };
+}
+
+#[cfg(not(feature = "stats"))]
+macro_rules! stat {
+    ($name:ident) => {
+        ()
+    };
+}
+
+#[cfg(feature = "stats")]
+macro_rules! stat_reduce_type {
+    ($tp:expr) => {
+        $crate::stats::bump_reduce_type($tp)
+    };
+}
+
+#[cfg(not(feature = "stats"))]
+macro_rules! stat_reduce_type {
+    ($tp:expr) => {{
+        let _ = $tp;
+    }};
+}
+
+pub(crate) use {stat, stat_reduce_type};
+
+pub unsafe extern "C" fn py_stats(
+    _self: *mut PyObject,
+    args: *const *mut PyObject,
+    nargs: Py_ssize_t,
+    kwnames: *mut PyObject,
+) -> *mut PyObject {
+    unsafe {
+        if nargs > 0 {
+            PyErr_SetString(
+                PyExc_TypeError,
+                crate::cstr!("stats() takes no positional arguments"),
+            );
+            return ptr::null_mut();
+        }
+
+        let mut reset = false;
+        let kwcount = if kwnames.is_null() {
+            0
+        } else {
+            PyTuple_Size(kwnames)
+        };
+        for i in 0..kwcount {
+            let name = PyTuple_GetItem(kwnames, i);
+            if PyUnicode_CompareWithASCIIString(name, crate::cstr!("reset")) != 0 {
+                PyErr_Format(
+                    PyExc_TypeError,
+                    crate::cstr!("stats() got an unexpected keyword argument '%U'"),
+                    name,
+                );
+                return ptr::null_mut();
+            }
+            let truth = PyObject_IsTrue(*args.add(i as usize));
+            if truth < 0 {
+                return ptr::null_mut();
+            }
+            reset = truth != 0;
+        }
+
+        #[cfg(feature = "stats")]
+        {
+            enabled::collect(reset)
+        }
+        #[cfg(not(feature = "stats"))]
+        {
+            let _ = reset;
+            PyErr_SetString(
+                PyExc_RuntimeError,
+                crate::cstr!("stats() needs copium built with the 'stats' feature"),
+            );
+            ptr::null_mut()
+        }
+    }
+}
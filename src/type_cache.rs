@@ -0,0 +1,215 @@
+//! Per-type classification cache.
+//!
+//! Entries are keyed by `tp_version_tag`. CPython clears the tag whenever a
+//! type (or any of its bases) is mutated and never hands the same tag to a
+//! different type, so a stale entry simply stops matching — no explicit
+//! invalidation is needed. The table is thread-local, which keeps it free of
+//! synchronization on free-threaded builds.
+
+use pyo3_ffi::*;
+use std::hint::likely;
+use std::ptr;
+
+const TYPE_CACHE_SIZE: usize = 256;
+
+/// Most `__slotnames__` a type can have for its slots to be copied by offset.
+pub const SLOT_PLAN_MAX: usize = 16;
+
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum ReducePlan {
+    /// Type not classified yet, or it has no valid version tag.
+    Unknown,
+    /// Go through `__reduce_ex__` on every copy.
+    Generic,
+    /// `__reduce_ex__(4)` is known to produce
+    /// `(copyreg.__newobj__, (cls,), __dict__ or None, None, None)`.
+    NewobjDict,
+    /// The same with `(__dict__ or None, {slot: value})` state, every slot a
+    /// plain object member: read and written at the offsets in `SlotPlan`.
+    NewobjSlots,
+}
+
+impl ReducePlan {
+    /// Plans that skip `__reduce_ex__` and read the instance `__dict__`
+    /// themselves.
+    #[inline(always)]
+    pub fn reads_dict(self) -> bool {
+        matches!(self, ReducePlan::NewobjDict | ReducePlan::NewobjSlots)
+    }
+}
+
+/// Where instances of a `ReducePlan::NewobjSlots` type keep their
+/// `__slotnames__`, in order.
+#[derive(Clone, Copy)]
+pub struct SlotPlan {
+    pub count: u16,
+    pub offsets: [u16; SLOT_PLAN_MAX],
+}
+
+pub const EMPTY_SLOT_PLAN: SlotPlan = SlotPlan {
+    count: 0,
+    offsets: [0; SLOT_PLAN_MAX],
+};
+
+/// How `deepcopy` handles instances of a type that isn't one of the exact
+/// builtin containers.
+#[derive(Clone, Copy, PartialEq, Eq)]
+pub enum Route {
+    /// Type not classified yet, or it has no valid version tag.
+    Unknown,
+    /// Immutable: returned as-is.
+    Atomic,
+    /// Exact frozenset / bytearray / bound method / stdlib container: copied natively.
+    Native,
+    /// `__deepcopy__` is a function or C method on the type, called unbound as `(obj, memo)`.
+    Custom,
+    /// No `__deepcopy__` anywhere in the MRO: straight to reduce.
+    Reduce,
+    /// The cache can't vouch for attribute resolution: look `__deepcopy__` up per instance.
+    Lookup,
+    /// Exact datetime / time: atomic, unless its tzinfo isn't.
+    Tzinfo,
+    /// Copier or buffer allocator registered through the `_C_API` capsule.
+    Registered,
+    /// Exact `array.array`: a flat buffer, copied by its own `__copy__`.
+    Buffer,
+    /// tuple / list / dict subclass keeping `object`'s reduce: rebuilt natively.
+    Subclass,
+    /// Exact date / UUID / Path / ...: atomic, unless copyreg has a reductor.
+    Stdlib,
+}
+
+#[derive(Clone, Copy)]
+struct TypeCacheEntry {
+    tp: *mut PyTypeObject,
+    version: u32,
+    route: Route,
+    /// Borrowed: kept alive by the type's MRO (or the `_C_API` registry) for
+    /// as long as `version` matches, which only holds up under the GIL;
+    /// `deepcopy::route_of` checks it without.
+    deepcopy: *mut PyObject,
+    reduce: ReducePlan,
+    slots: SlotPlan,
+}
+
+const EMPTY_ENTRY: TypeCacheEntry = TypeCacheEntry {
+    tp: ptr::null_mut(),
+    version: 0,
+    route: Route::Unknown,
+    deepcopy: ptr::null_mut(),
+    reduce: ReducePlan::Unknown,
+    slots: EMPTY_SLOT_PLAN,
+};
+
+#[thread_local]
+static mut TYPE_CACHE: [TypeCacheEntry; TYPE_CACHE_SIZE] = [EMPTY_ENTRY; TYPE_CACHE_SIZE];
+
+#[inline(always)]
+unsafe fn entry_for(version: u32) -> *mut TypeCacheEntry {
+    unsafe {
+        ptr::addr_of_mut!(TYPE_CACHE)
+            .cast::<TypeCacheEntry>()
+            .add(version as usize & (TYPE_CACHE_SIZE - 1))
+    }
+}
+
+#[inline(always)]
+unsafe fn matching_entry(tp: *mut PyTypeObject) -> *mut TypeCacheEntry {
+    unsafe {
+        let version = (*tp).tp_version_tag;
+        if version == 0 {
+            return ptr::null_mut();
+        }
+        let entry = entry_for(version);
+        if likely((*entry).version == version && (*entry).tp == tp) {
+            entry
+        } else {
+            ptr::null_mut()
+        }
+    }
+}
+
+/// Entry for the current version of `tp`, evicting whatever occupied its slot.
+/// Null for types without a valid version tag, which are never cached.
+unsafe fn claim_entry(tp: *mut PyTypeObject) -> *mut TypeCacheEntry {
+    unsafe {
+        let entry = matching_entry(tp);
+        if !entry.is_null() {
+            return entry;
+        }
+        let version = (*tp).tp_version_tag;
+        if version == 0 {
+            return ptr::null_mut();
+        }
+        let entry = entry_for(version);
+        *entry = TypeCacheEntry {
+            tp,
+            version,
+            ..EMPTY_ENTRY
+        };
+        entry
+    }
+}
+
+/// Cached route for `tp` together with its unbound `__deepcopy__` (borrowed,
+/// only set for `Route::Custom`; `__copy__` for `Route::Buffer`, see
+/// `keeps_builtin_reduce` for `Route::Subclass`).
+#[inline(always)]
+pub unsafe fn route(tp: *mut PyTypeObject) -> (Route, *mut PyObject) {
+    unsafe {
+        let entry = matching_entry(tp);
+        if entry.is_null() {
+            (Route::Unknown, ptr::null_mut())
+        } else {
+            ((*entry).route, (*entry).deepcopy)
+        }
+    }
+}
+
+pub unsafe fn set_route(tp: *mut PyTypeObject, route: Route, deepcopy: *mut PyObject) {
+    unsafe {
+        let entry = claim_entry(tp);
+        if !entry.is_null() {
+            (*entry).route = route;
+            (*entry).deepcopy = deepcopy;
+        }
+    }
+}
+
+#[inline(always)]
+pub unsafe fn reduce_plan(tp: *mut PyTypeObject) -> ReducePlan {
+    unsafe {
+        let entry = matching_entry(tp);
+        if entry.is_null() {
+            ReducePlan::Unknown
+        } else {
+            (*entry).reduce
+        }
+    }
+}
+
+/// Copied out, since copying the slots can run code that evicts the entry.
+#[inline(always)]
+pub unsafe fn slot_plan(tp: *mut PyTypeObject) -> Option<SlotPlan> {
+    unsafe {
+        let entry = matching_entry(tp);
+        if entry.is_null() || (*entry).reduce != ReducePlan::NewobjSlots {
+            None
+        } else {
+            Some((*entry).slots)
+        }
+    }
+}
+
+/// `slots` is only read for `ReducePlan::NewobjSlots`.
+pub unsafe fn set_reduce_plan(tp: *mut PyTypeObject, plan: ReducePlan, slots: &SlotPlan) {
+    unsafe {
+        let entry = claim_entry(tp);
+        if !entry.is_null() {
+            (*entry).reduce = plan;
+            if plan == ReducePlan::NewobjSlots {
+                (*entry).slots = *slots;
+            }
+        }
+    }
+}
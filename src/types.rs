@@ -392,6 +392,10 @@ pub unsafe trait PyTypeObjectPtr {
     unsafe fn is_literal_immutable(self) -> bool;
     unsafe fn is_builtin_immutable(self) -> bool;
     unsafe fn is_stdlib_immutable(self) -> bool;
+    unsafe fn is_stdlib_container(self) -> bool;
+    unsafe fn is_stdlib_value(self) -> bool;
+    unsafe fn is_stdlib_tzinfo_holder(self) -> bool;
+    unsafe fn is_stdlib_buffer(self) -> bool;
     unsafe fn is_type_subclass(self) -> bool;
     unsafe fn is_atomic_immutable(self) -> bool;
     unsafe fn is_immutable_collection(self) -> bool;
@@ -423,9 +427,52 @@ unsafe impl PyTypeObjectPtr for *mut PyTypeObject {
 
     #[inline(always)]
     unsafe fn is_stdlib_immutable(self) -> bool {
-        (self == py_type!("re.Pattern"))
-            || (self == py_type!("decimal.Decimal"))
-            || (self == py_type!("fractions.Fraction"))
+        (self == py_type!(imported "re.Pattern"))
+            || (self == py_type!(imported "decimal.Decimal"))
+            || (self == py_type!(imported "fractions.Fraction"))
+    }
+
+    #[inline(always)]
+    unsafe fn is_stdlib_container(self) -> bool {
+        (self == py_type!(imported "collections.OrderedDict"))
+            || (self == py_type!(imported "collections.defaultdict"))
+            || (self == py_type!(imported "collections.deque"))
+            || (self == py_type!(imported "collections.Counter"))
+    }
+
+    /// Unlike `is_stdlib_immutable`, none of these is copied by
+    /// `copy._deepcopy_dispatch`: a reductor registered in
+    /// `copyreg.dispatch_table` takes over, so the routes check for one on
+    /// each copy.
+    #[inline(always)]
+    unsafe fn is_stdlib_value(self) -> bool {
+        (self == py_type!(imported "datetime.date"))
+            || (self == py_type!(imported "datetime.timedelta"))
+            || (self == py_type!(imported "datetime.timezone"))
+            || (self == py_type!(imported "uuid.UUID"))
+            || (self == py_type!(imported "pathlib.PurePosixPath"))
+            || (self == py_type!(imported "pathlib.PureWindowsPath"))
+            || (self == py_type!(imported "pathlib.PosixPath"))
+            || (self == py_type!(imported "pathlib.WindowsPath"))
+            || (self == py_type!(imported "ipaddress.IPv4Address"))
+            || (self == py_type!(imported "ipaddress.IPv6Address"))
+            || (self == py_type!(imported "ipaddress.IPv4Network"))
+            || (self == py_type!(imported "ipaddress.IPv6Network"))
+            || (self == py_type!(imported "ipaddress.IPv4Interface"))
+            || (self == py_type!(imported "ipaddress.IPv6Interface"))
+    }
+
+    /// Immutable too, but they hold on to a tzinfo, which can be anything.
+    #[inline(always)]
+    unsafe fn is_stdlib_tzinfo_holder(self) -> bool {
+        (self == py_type!(imported "datetime.datetime"))
+            || (self == py_type!(imported "datetime.time"))
+    }
+
+    /// Flat buffers of C values, copied wholesale by their own `__copy__`.
+    #[inline(always)]
+    unsafe fn is_stdlib_buffer(self) -> bool {
+        self == py_type!(imported "array.array")
     }
 
     #[inline(always)]
@@ -448,3 +495,28 @@ unsafe impl PyTypeObjectPtr for *mut PyTypeObject {
             || self.is_stdlib_immutable()
     }
 }
+
+/// Whether a reductor registered in `copyreg.dispatch_table` is meant to take
+/// over for `tp`.
+pub(crate) unsafe fn has_registered_reductor(tp: *mut PyTypeObject) -> bool {
+    unsafe {
+        let reductor =
+            crate::py_obj!(PyDictObject, "copyreg.dispatch_table").get_item(tp as *mut PyObject);
+        PyErr_Clear();
+        !reductor.is_null()
+    }
+}
+
+/// Members of an enum that copies them through `enum.Enum.__deepcopy__`, i.e.
+/// as themselves. The `__deepcopy__` comes before any reductor, so these are
+/// atomic for good.
+pub(crate) unsafe fn is_enum_member_type(tp: *mut PyTypeObject) -> bool {
+    unsafe {
+        let enum_type = py_type!(imported "enum.EnumMeta");
+        let enum_deepcopy = crate::py_obj!(imported "enum.Enum.__deepcopy__");
+        !enum_type.is_null()
+            && !enum_deepcopy.is_null()
+            && PyType_IsSubtype((*(tp as *mut PyObject)).ob_type, enum_type) != 0
+            && ffi_ext::_PyType_Lookup(tp, crate::py_str!("__deepcopy__")) == enum_deepcopy
+    }
+}
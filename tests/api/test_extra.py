@@ -18,3 +18,7 @@ from tests.api import X
 def test_extra() -> None:
     assert_type(copium.extra.replicate(X, 1), list[XT])
     assert_type(copium.extra.repeatcall(lambda: X, 1), list[XT])
+    assert_type(copium.extra.compile(X), copium.extra.Plan[XT])
+    assert_type(copium.extra.replicate(copium.extra.compile(X), 1), list[XT])
+    assert_type(copium.extra.parallel_deepcopy(X), XT)
+    assert_type(copium.extra.parallel_deepcopy(X, workers=2), XT)
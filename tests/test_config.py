@@ -6,6 +6,9 @@ from __future__ import annotations
 
 import os
 import re
+import subprocess
+import sys
+import time
 import warnings
 from pathlib import Path
 from typing import Any
@@ -56,7 +59,16 @@ class StubbornTracking:
 class TestGetConfig:
     def test_returns_dict_with_expected_keys(self):
         cfg = copium.config.get()
-        assert set(cfg) == {"memo", "on_incompatible", "suppress_warnings"}
+        assert set(cfg) == {
+            "memo",
+            "on_incompatible",
+            "suppress_warnings",
+            "memo_retention",
+            "slow_copy_threshold_us",
+            "slow_copy_sample",
+            "slow_copy_callback",
+            "atomic_types",
+        }
 
     def test_default_values(self):
         copium.config.apply()
@@ -64,6 +76,11 @@ class TestGetConfig:
         assert cfg["memo"] == "native"
         assert cfg["on_incompatible"] == "warn"
         assert cfg["suppress_warnings"] == ()
+        assert cfg["memo_retention"] == "adaptive"
+        assert cfg["slow_copy_threshold_us"] is None
+        assert cfg["slow_copy_sample"] == 0
+        assert cfg["slow_copy_callback"] is None
+        assert cfg["atomic_types"] == ()
 
 
 # ===========================================================================
@@ -88,6 +105,10 @@ class TestConfigureAPI:
         with pytest.raises(ValueError, match="'warn', 'raise', or 'silent'"):
             copium.config.apply(on_incompatible="ignore")  # type: ignore[arg-type]
 
+    def test_invalid_memo_retention_value(self):
+        with pytest.raises(ValueError, match="'adaptive', 'fixed', or 'minimal'"):
+            copium.config.apply(memo_retention="never")  # type: ignore[arg-type]
+
     def test_suppress_warnings_non_string_item(self):
         with pytest.raises(
             TypeError, match=re.escape("on_incompatible[0] must be a 'str', got 'int'")
@@ -238,6 +259,13 @@ class TestConfigureIncremental:
         copium.config.apply(memo="native")
         assert copium.config.get()["on_incompatible"] == "silent"
 
+    def test_setting_memo_retention_preserves_memo(self):
+        copium.config.apply(memo="dict")
+        copium.config.apply(memo_retention="minimal")
+        cfg = copium.config.get()
+        assert cfg["memo"] == "dict"
+        assert cfg["memo_retention"] == "minimal"
+
 
 # ===========================================================================
 #  configure() — reset
@@ -246,12 +274,13 @@ class TestConfigureIncremental:
 
 class TestConfigureReset:
     def test_reset_restores_defaults(self):
-        copium.config.apply(memo="dict")
+        copium.config.apply(memo="dict", memo_retention="fixed")
         copium.config.apply()
         cfg = copium.config.get()
         assert cfg["memo"] == "native"
         assert cfg["on_incompatible"] == "warn"
         assert cfg["suppress_warnings"] == ()
+        assert cfg["memo_retention"] == "adaptive"
 
     def test_reset_restores_to_current_env(self):
         os.environ["COPIUM_USE_DICT_MEMO"] = "1"
@@ -259,6 +288,157 @@ class TestConfigureReset:
         assert copium.config.get()["memo"] == "dict"
 
 
+# ===========================================================================
+#  configure() — slow-copy sampler
+# ===========================================================================
+
+
+class SlowDeepcopy:
+    def __deepcopy__(self, memo):
+        time.sleep(0.002)
+        return SlowDeepcopy()
+
+
+class TestSlowCopySampler:
+    def test_reports_calls_over_threshold(self):
+        reports = []
+        copium.config.apply(slow_copy_threshold_us=1000, slow_copy_callback=reports.append)
+        assert copium.config.get()["slow_copy_threshold_us"] == 1000.0
+        copium.deepcopy([[1], [2]])
+        copium.deepcopy({"slow": SlowDeepcopy(), "fast": [[1], [2]]})  # the slow one
+        assert len(reports) == 1
+        report = reports[0]
+        filename, lineno, function, line = report["callsite"]
+        assert filename == __file__
+        assert function == "test_reports_calls_over_threshold"
+        assert line.endswith("# the slow one")
+        assert report["python_us"] >= 2000
+        assert report["elapsed_us"] == pytest.approx(report["python_us"] + report["native_us"])
+        assert report["nodes"] == 5
+        assert report["memo_size"] <= report["nodes"]
+        assert report["sampled"] is False
+
+    def test_reports_every_nth_call(self):
+        reports = []
+        copium.config.apply(slow_copy_sample=3, slow_copy_callback=reports.append)
+        for i in range(9):
+            copium.deepcopy([i])
+        assert len(reports) == 3
+        assert all(report["sampled"] and report["nodes"] == 1 for report in reports)
+
+    @pytest.mark.parametrize("memo", ["dict config", "dict", "kept dict"])
+    def test_reports_calls_whatever_the_memo(self, memo):
+        reports = []
+        copium.config.apply(slow_copy_sample=1, slow_copy_callback=reports.append)
+        kept = {}
+        copium.deepcopy([0], kept)
+        reports.clear()
+        args = {"dict config": (), "dict": ({},), "kept dict": (kept,)}[memo]
+        if memo == "dict config":
+            copium.config.apply(memo="dict")
+
+        copium.deepcopy({"slow": SlowDeepcopy(), "fast": [[1], [2]]}, *args)
+        assert len(reports) == 1
+        report = reports[0]
+        assert report["python_us"] >= 2000
+        assert report["nodes"] == 5
+        assert report["memo_size"] > report["nodes"]  # the keep-alive list is one more
+
+    def test_nested_calls_are_part_of_the_outer_one(self):
+        class Nested:
+            def __deepcopy__(self, memo):
+                return copium.deepcopy([[1]], memo)
+
+        reports = []
+        copium.config.apply(slow_copy_sample=1, slow_copy_callback=reports.append)
+        copium.deepcopy([Nested()])
+        copium.deepcopy([Nested()], {})
+        assert [report["nodes"] for report in reports] == [4, 4]
+
+    def test_callback_failures_are_unraisable(self, monkeypatch):
+        unraisable = []
+        monkeypatch.setattr(sys, "unraisablehook", unraisable.append)
+
+        def callback(report):
+            copium.deepcopy([report])  # not reported itself
+            raise ValueError("callback failed")
+
+        copium.config.apply(slow_copy_sample=1, slow_copy_callback=callback)
+        assert copium.deepcopy([1]) == [1]
+        assert len(unraisable) == 1
+        assert isinstance(unraisable[0].exc_value, ValueError)
+
+    def test_none_turns_it_off(self):
+        reports = []
+        copium.config.apply(slow_copy_sample=1, slow_copy_callback=reports.append)
+        copium.config.apply(slow_copy_callback=None)
+        copium.deepcopy([1])
+        assert reports == []
+        assert copium.config.get()["slow_copy_callback"] is None
+
+    @pytest.mark.parametrize(
+        ("kwargs", "error"),
+        [
+            ({"slow_copy_threshold_us": -1}, ValueError),
+            ({"slow_copy_threshold_us": "1"}, TypeError),
+            ({"slow_copy_sample": -1}, ValueError),
+            ({"slow_copy_callback": 1}, TypeError),
+        ],
+    )
+    def test_rejects_invalid_values(self, kwargs, error):
+        with pytest.raises(error):
+            copium.config.apply(**kwargs)
+
+
+# ===========================================================================
+#  configure() — atomic types
+# ===========================================================================
+
+
+class Shared:
+    def __init__(self):
+        self.payload = [1, 2]
+
+
+class SharedSubclass(Shared):
+    pass
+
+
+class TestAtomicTypes:
+    def test_instances_are_shared(self):
+        shared = Shared()
+        copium.config.apply(atomic_types=[Shared])
+        assert copium.config.get()["atomic_types"] == (Shared,)
+        assert copium.deepcopy(shared) is shared
+        copied = copium.deepcopy({"nested": [shared, (shared,)]})
+        assert copied["nested"][0] is shared
+        assert copied["nested"][1][0] is shared
+
+    def test_exact_types_only(self):
+        copium.config.apply(atomic_types=Shared)
+        subclass_instance = SharedSubclass()
+        assert copium.deepcopy(subclass_instance) is not subclass_instance
+
+    def test_dict_memo(self):
+        shared = Shared()
+        copium.config.apply(memo="dict", atomic_types=Shared)
+        assert copium.deepcopy([shared])[0] is shared
+
+    @pytest.mark.parametrize("clear", [{"atomic_types": None}, {"atomic_types": ()}, {}])
+    def test_clearing_copies_them_again(self, clear):
+        shared = Shared()
+        copium.config.apply(atomic_types=Shared)
+        assert copium.deepcopy(shared) is shared
+        copium.config.apply(**clear)
+        assert copium.config.get()["atomic_types"] == ()
+        assert copium.deepcopy(shared) is not shared
+
+    @pytest.mark.parametrize("atomic_types", [list, (dict,), [Shared, 1], 1])
+    def test_rejects_invalid_values(self, atomic_types):
+        with pytest.raises(TypeError):
+            copium.config.apply(atomic_types=atomic_types)
+
+
 # ===========================================================================
 #  Warning message format
 # ===========================================================================
@@ -647,6 +827,40 @@ def test_env_patch_enabled():
     assert copium.patch.enabled()
 
 
+@pytest.mark.subprocess(environ=env(COPIUM_PATCH_ENABLE="1"))
+@pytest.mark.xfail(
+    copium_is_editable() and os.getenv("COPIUM_LOCAL_DEVELOPMENT"),
+    reason=".pth files in editable installs are broken at the moment.",
+    strict=True,
+)
+def test_env_patch_waits_for_copy():
+    import sys
+
+    assert "_copium_autopatch" in sys.modules
+    assert "copy" in sys.modules or "copium" not in sys.modules, "copium was loaded before copy"
+
+    import copy
+
+    import copium.patch
+
+    assert copium.patch.enabled()
+    assert copy.deepcopy.__wrapped__ is copium.deepcopy
+
+
+def test_import_leaves_stdlib_modules_alone(tmp_path):
+    # Needs a process without pytest in it: the assertion rewriting of subprocess tests imports re.
+    code = (
+        "import sys\n"
+        "lazy = {'re', 'decimal', 'fractions', 'enum'} - set(sys.modules)\n"
+        "import copium\n"
+        "print(*sorted(lazy & set(sys.modules)))\n"
+    )
+    proc = subprocess.run(
+        [sys.executable, "-c", code], cwd=tmp_path, capture_output=True, text=True, check=True
+    )
+    assert proc.stdout.split() == []
+
+
 @pytest.mark.subprocess(environ=env())
 def test_env_patch_disabled():
     import copium.patch
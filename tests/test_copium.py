@@ -17,6 +17,7 @@ from contextlib import contextmanager
 from dataclasses import dataclass
 from types import MappingProxyType
 from typing import Any
+from typing import ClassVar
 from typing import Literal
 
 import pytest
@@ -177,6 +178,475 @@ def test_mutable_keys(copy):
     assert original_key not in copied
 
 
+def test_atomic_key_dicts(copy):
+    class Instance:
+        pass
+
+    first, second, reordered = Instance(), Instance(), Instance()
+    first.x, first.y = [1], {"z": [2]}
+    second.x, second.y = [3], {"z": [4]}
+    reordered.y, reordered.x = [5], [6]
+
+    sparse = {str(i): [i] for i in range(30)}
+    for i in range(0, 30, 3):
+        del sparse[str(i)]
+    sparse["appended"] = [30]
+
+    shared = [0]
+    cyclic = {"shared": shared, 2.5: shared, b"k": (shared,)}
+    cyclic["self"] = cyclic
+
+    for original in (vars(first), vars(second), vars(reordered), sparse, cyclic):
+        copied = copy.deepcopy(original)
+        assert list(copied) == list(original)
+        assert all(copied[key] is not original[key] for key in original)
+
+    assert copied["self"] is copied
+    assert copied["shared"] is copied[2.5] is copied[b"k"][0]
+    assert gc.is_tracked(copy.deepcopy({"untracked": 1, "tracked": (shared,)}))
+
+
+def test_record_lists(copy):
+    class Instance:
+        pass
+
+    class Row(dict):
+        pass
+
+    rows = [{"id": i, "name": f"row{i}", "score": i / 3, "none": None} for i in range(20)]
+    sparse = {"a": 1, "b": 2, "c": 3}
+    del sparse["b"]
+    instance = Instance()
+    instance.x, instance.y = 1, "y"
+    mixed = [{1: 2, (3, 4): 5.0}, sparse, vars(instance), Row(a=1), {"nested": [1]}, {"after": 1}]
+    original = {"rows": [*rows, rows[0]], "first": rows[0], "mixed": mixed}
+
+    copied = copy.deepcopy(original)
+
+    assert copied == original
+    assert copied["rows"][0] is copied["rows"][-1] is copied["first"]
+    assert all(row is not original_row for row, original_row in zip(copied["rows"], rows))
+    assert list(copied["mixed"][1]) == ["a", "c"]
+    assert type(copied["mixed"][3]) is Row
+    assert copied["mixed"][4]["nested"] is not mixed[4]["nested"]
+    assert copied["mixed"][5] is not mixed[5]
+
+    memo = {}
+    copied = copy.deepcopy(rows, memo)
+    assert memo[id(rows[3])] is copied[3]
+
+
+def test_atomic_sets():
+    class Opaque:
+        pass
+
+    tags = {1, "a", 2.5, b"b", None, True, (1, "c"), (2, (3,))}
+    frozen = frozenset(tags)
+    opaque = frozenset({1, Opaque()})
+
+    copied = copium.deepcopy([tags, tags, frozen, opaque])
+
+    assert copied[0] == tags
+    assert copied[0] is copied[1]
+    assert copied[0] is not tags
+    assert copied[2] is frozen, "frozenset of atomics should be returned as is, like a tuple"
+    assert frozenset({1, (2, (3,))}) in copium.deepcopy({frozenset({1, (2, (3,))})})
+    assert copied[3] is not opaque
+    assert len(copied[3]) == 2
+
+
+@pytest.mark.parametrize("size", [0, 1, 3, 4, 9, 1000])
+@pytest.mark.parametrize("mutable_at", [None, 0, -1])
+def test_atomic_sequences(size, mutable_at):
+    items: list = [*range(size // 2), *map(str, range(size - size // 2))]
+    if mutable_at is not None and items:
+        items[mutable_at] = [items[mutable_at]]
+
+    for original in (items, tuple(items)):
+        copied = copium.deepcopy([original, original])
+        assert copied[0] == original
+        assert copied[0] is copied[1]
+        if mutable_at is not None and items:
+            assert copied[0][mutable_at] is not original[mutable_at]
+
+    frozen = tuple(items)
+    assert copium.deepcopy(items) is not items
+    assert (copium.deepcopy(frozen) is frozen) == (mutable_at is None or not items)
+
+
+def test_stdlib_values_are_atomic():
+    import datetime
+    import enum
+    import ipaddress
+    import pathlib
+    import uuid
+
+    class Color(enum.Enum):
+        RED = 1
+
+    class Date(datetime.date):
+        pass
+
+    class Zone(datetime.tzinfo):
+        def utcoffset(self, dt):
+            return datetime.timedelta(hours=1)
+
+    values = [
+        datetime.date(2025, 1, 2),
+        datetime.timedelta(seconds=5),
+        datetime.timezone.utc,
+        datetime.datetime(2025, 1, 2, 3, 4, tzinfo=datetime.timezone.utc),
+        datetime.time(3, 4),
+        uuid.UUID(int=1),
+        pathlib.PurePosixPath("a/b"),
+        pathlib.Path("a/b"),
+        ipaddress.ip_address("127.0.0.1"),
+        ipaddress.ip_network("10.0.0.0/8"),
+        Color.RED,
+    ]
+    for value in values:
+        assert copium.deepcopy(value) is value, value
+
+    subclassed = Date(2025, 1, 2)
+    assert copium.deepcopy(subclassed) is not subclassed
+    custom_zone = datetime.datetime(2025, 1, 2, tzinfo=Zone())
+    copied = copium.deepcopy(custom_zone)
+    assert copied == custom_zone
+    assert copied.tzinfo is not custom_zone.tzinfo
+
+
+def test_stdlib_containers():
+    inner = [1]
+    ordered = collections.OrderedDict([("b", inner), ("a", inner)])
+    ordered.move_to_end("b")
+    default = collections.defaultdict(list, {"x": inner})
+    bounded = collections.deque([inner, inner], maxlen=3)
+    counter = collections.Counter("abca")
+    bounded.append(bounded)
+
+    copied = copium.deepcopy([ordered, default, bounded, counter, inner])
+
+    for original, copy in zip([ordered, default, bounded, counter], copied):
+        assert type(copy) is type(original)
+        assert copy is not original
+    assert list(copied[0]) == ["a", "b"]
+    assert copied[0]["a"] is copied[0]["b"] is copied[4]
+    assert copied[1].default_factory is list
+    assert copied[1]["x"] is copied[4]
+    assert copied[2].maxlen == 3
+    assert copied[2][0] is copied[4]
+    assert copied[2][2] is copied[2]
+    assert copied[3] == counter
+
+
+def test_buffers():
+    import array
+
+    class Subclass(array.array):
+        pass
+
+    doubles = array.array("d", range(1000))
+    subclassed = Subclass("i", [1, 2, 3])
+    subclassed.tag = [1]
+
+    copied = copium.deepcopy([doubles, doubles, subclassed])
+
+    assert type(copied[0]) is array.array
+    assert copied[0] == doubles
+    assert copied[0] is not doubles
+    assert copied[1] is copied[0]
+    expected = stdlib_copy.deepcopy(subclassed)
+    assert type(copied[2]) is type(expected)
+    assert copied[2] == expected
+
+
+def test_reductors_registered_after_a_first_copy_take_over():
+    import array
+    import copyreg
+    import datetime
+
+    values = [
+        datetime.date(2025, 1, 2),
+        datetime.datetime(2025, 1, 2, 3, 4),
+        array.array("i", [1, 2]),
+        collections.OrderedDict(a=1),
+    ]
+    copium.deepcopy(values)
+
+    reduced = []
+
+    def reductor(obj):
+        reduced.append(obj)
+        return obj.__reduce_ex__(4)
+
+    for value in values:
+        copyreg.pickle(type(value), reductor)
+    try:
+        copied = copium.deepcopy(values)
+    finally:
+        for value in values:
+            del copyreg.dispatch_table[type(value)]
+
+    assert reduced == values
+    assert copied == values
+    assert all(copy is not value for copy, value in zip(copied, values))
+
+
+def test_container_subclasses():
+    from typing import NamedTuple
+
+    Pair = collections.namedtuple("Pair", "left right")
+
+    class Record(NamedTuple):
+        items: list
+        count: int = 0
+
+    class Wrapped(Pair):
+        def __new__(cls, left, right):
+            return super().__new__(cls, left, [right])
+
+    class Items(list):
+        pass
+
+    class Appending(list):
+        def append(self, item):
+            super().append(("appended", item))
+
+    class Attrs(dict):
+        pass
+
+    inner = [1]
+    items = Items([inner, inner])
+    items.append(items)
+    items.tag = inner
+    attrs = Attrs(key=inner)
+    attrs["self"] = attrs
+
+    copied = copium.deepcopy(
+        [Pair(inner, 2), Record([inner]), Wrapped(1, 2), items, attrs, Appending([1]), inner]
+    )
+
+    shared = copied[-1]
+    assert copied[0] == Pair(shared, 2) and type(copied[0]) is Pair
+    assert copied[0].left is shared
+    assert copied[1].items[0] is shared and type(copied[1]) is Record
+    assert copied[2] == stdlib_copy.deepcopy(Wrapped(1, 2))
+    assert type(copied[3]) is Items
+    assert copied[3][0] is copied[3][1] is copied[3].tag is shared
+    assert copied[3][2] is copied[3]
+    assert type(copied[4]) is Attrs
+    assert copied[4]["self"] is copied[4] and copied[4]["key"] is shared
+    assert copied[5] == stdlib_copy.deepcopy(Appending([1]))
+
+
+def load_c_api():
+    import ctypes
+
+    def fn(restype, *argtypes):
+        return ctypes.PYFUNCTYPE(restype, *argtypes)
+
+    class CopiumCAPI(ctypes.Structure):
+        _fields_ = [
+            ("version", ctypes.c_int),
+            ("register_atomic", fn(ctypes.c_int, ctypes.py_object)),
+            ("register_copier", fn(ctypes.c_int, ctypes.py_object, ctypes.c_void_p)),
+            ("unregister", fn(ctypes.c_int, ctypes.py_object)),
+            ("deepcopy", fn(ctypes.py_object, ctypes.py_object, ctypes.c_void_p)),
+            ("memoize", fn(ctypes.c_int, ctypes.c_void_p, ctypes.py_object, ctypes.py_object)),
+            ("recall", fn(ctypes.c_void_p, ctypes.c_void_p, ctypes.py_object)),
+            ("register_buffer", fn(ctypes.c_int, ctypes.py_object, ctypes.c_void_p)),
+        ]
+
+    pythonapi = ctypes.pythonapi
+    pythonapi.PyCapsule_GetName.restype = ctypes.c_char_p
+    pythonapi.PyCapsule_GetName.argtypes = [ctypes.py_object]
+    pythonapi.PyCapsule_GetPointer.restype = ctypes.c_void_p
+    pythonapi.PyCapsule_GetPointer.argtypes = [ctypes.py_object, ctypes.c_char_p]
+    capsule = copium._C_API
+    address = pythonapi.PyCapsule_GetPointer(capsule, pythonapi.PyCapsule_GetName(capsule))
+    return CopiumCAPI.from_address(address)
+
+
+def test_c_api_registrations():
+    import ctypes
+
+    api = load_c_api()
+    assert api.version >= 1
+
+    class Shared:
+        pass
+
+    class Node:
+        def __init__(self, children):
+            self.children = children
+
+    copied_nodes = []
+
+    @ctypes.PYFUNCTYPE(ctypes.py_object, ctypes.py_object, ctypes.c_void_p)
+    def copy_node(node, memo_ctx):
+        copied_nodes.append(node)
+        copy = Node.__new__(Node)
+        assert api.memoize(memo_ctx, node, copy) == 0
+        assert api.recall(memo_ctx, node) is not None
+        copy.children = api.deepcopy(node.children, memo_ctx)
+        return copy
+
+    shared = Shared()
+    node = Node([shared])
+    node.children.append(node)
+    try:
+        assert api.register_atomic(Shared) == 0
+        assert api.register_copier(Node, ctypes.cast(copy_node, ctypes.c_void_p)) == 0
+
+        copied = copium.deepcopy([node, node])
+        assert copied[0] is copied[1]
+        assert copied[0].children[0] is shared
+        assert copied[0].children[1] is copied[0]
+        assert copied_nodes == [node]
+
+        assert copium.deepcopy(node, {}).children[0] is not shared, "dict memo ignores the registry"
+        assert copied_nodes == [node]
+        with pytest.raises(TypeError):
+            api.register_atomic(list)
+    finally:
+        assert api.unregister(Shared) == 1
+        assert api.unregister(Node) == 1
+    assert api.unregister(Node) == 0
+    assert copium.deepcopy(shared) is not shared
+
+
+def test_c_api_buffer_registrations():
+    import ctypes
+
+    api = load_c_api()
+    assert api.version >= 2
+    Doubles = ctypes.c_double * 4
+    Objects = ctypes.py_object * 2
+    allocated = []
+
+    @ctypes.PYFUNCTYPE(ctypes.py_object, ctypes.py_object, ctypes.c_void_p)
+    def alloc(obj, view):
+        allocated.append(obj)
+        return type(obj)()
+
+    doubles = Doubles(1.5, 2.5, 3.5, 4.5)
+    objects = Objects([1], [2])
+    try:
+        assert api.register_buffer(Doubles, ctypes.cast(alloc, ctypes.c_void_p)) == 0
+        assert api.register_buffer(Objects, ctypes.cast(alloc, ctypes.c_void_p)) == 0
+
+        copied = copium.deepcopy([doubles, doubles])
+        assert copied[0] is copied[1]
+        assert type(copied[0]) is Doubles and copied[0] is not doubles
+        assert list(copied[0]) == [1.5, 2.5, 3.5, 4.5]
+        assert allocated == [doubles]
+
+        # Objects in the buffer: copied as if it weren't registered.
+        with pytest.raises(ValueError, match="pointers"):
+            stdlib_copy.deepcopy(objects)
+        with pytest.raises(ValueError, match="pointers"):
+            copium.deepcopy(objects)
+        assert allocated == [doubles]
+        with pytest.raises(TypeError, match="don't export a buffer"):
+            api.register_buffer(type("Plain", (), {}), ctypes.cast(alloc, ctypes.c_void_p))
+    finally:
+        assert api.unregister(Doubles) == 1
+        assert api.unregister(Objects) == 1
+    assert list(copium.deepcopy(doubles)) == [1.5, 2.5, 3.5, 4.5]
+    assert allocated == [doubles]
+
+
+def test_deepcopy_share():
+    class Shared:
+        pass
+
+    class Node:
+        def __init__(self, child):
+            self.child = child
+
+        def __deepcopy__(self, memo):
+            return Node(copium.deepcopy(self.child, memo, share=Node))
+
+    shared = Shared()
+    copied = copium.deepcopy({"nested": [shared, (shared,)]}, share=Shared)
+    assert copied["nested"][0] is shared
+    assert copied["nested"][1][0] is shared
+    assert copium.deepcopy(shared) is not shared, "only applies to the call itself"
+    assert copium.deepcopy(shared, {}, share=[Shared]) is shared
+
+    inner = Node(shared)
+    copied = copium.deepcopy(Node(inner), share=Shared)
+    assert copied.child is inner, "shared by the nested call on top of the outer ones"
+    assert copied.child.child is shared
+
+    assert copium.deepcopy(shared, share=None) is not shared
+    with pytest.raises(TypeError):
+        copium.deepcopy(shared, share=list)
+    with pytest.raises(TypeError):
+        copium.deepcopy(shared, share=[shared])
+
+
+SUBINTERPRETER_CODE = """
+import copium
+from copium import extra
+
+data = {"a": [1, (2, [3])], "b": {4}}
+for _ in range(1000):
+    copied = copium.deepcopy(data)
+    assert copied == data and copied["a"] is not data["a"]
+assert extra.replicate(extra.compile(data), 2) == [data, data]
+assert extra.Snapshotter(data).snapshot() == data
+copium.configure(memo="dict")
+"""
+
+
+@pytest.mark.skipif(sys.version_info < (3, 13), reason="needs _interpreters")
+def test_legacy_subinterpreters():
+    _interpreters = pytest.importorskip("_interpreters")
+
+    interp = _interpreters.create("legacy")
+    try:
+        _interpreters.run_string(interp, f"import sys; sys.path[:0] = {sys.path!r}")
+        error = _interpreters.run_string(
+            interp,
+            "import copium\n"
+            "data = {'a': [1, (2, [3])]}\n"
+            "assert copium.deepcopy(data) == data\n",
+        )
+    finally:
+        _interpreters.destroy(interp)
+    assert error is None, error.msg
+
+
+@pytest.mark.skipif(sys.version_info < (3, 13), reason="needs _interpreters")
+def test_isolated_subinterpreters():
+    _interpreters = pytest.importorskip("_interpreters")
+
+    def run(errors):
+        interp = _interpreters.create("isolated")
+        try:
+            _interpreters.run_string(interp, f"import sys; sys.path[:0] = {sys.path!r}")
+            errors.append(_interpreters.run_string(interp, SUBINTERPRETER_CODE))
+        finally:
+            _interpreters.destroy(interp)
+
+    errors = []
+    run(errors)
+    if errors[0] is not None and "subinterpreters" in errors[0].msg:
+        pytest.skip(errors[0].msg)
+
+    threads = [threading.Thread(target=run, args=(errors,)) for _ in range(4)]
+    for thread in threads:
+        thread.start()
+    data = [{"a": [1, 2]}] * 100
+    for _ in range(100):
+        assert copium.deepcopy(data) == data
+    for thread in threads:
+        thread.join()
+    assert errors == [None] * 5
+    assert copium.get_config()["memo"] == "native", "configure() in a subinterpreter leaked"
+
+
 @pytest.mark.filterwarnings(r"ignore:\s+Seems like 'copium.memo' was rejected")
 @pytest.mark.filterwarnings("error")
 @pytest.mark.parametrize("memo", ALL_MEMO_PARAMS)
@@ -307,8 +777,50 @@ def test_recursion_limit_increase():
         copium.deepcopy(at_interpreter_limit)
 
 
+class Link:
+    def __init__(self, next_link):
+        self.next = next_link
+
+
+def make_linked(depth):
+    result = None
+    for _ in range(depth):
+        result = Link(result)
+    return result
+
+
+NESTINGS = [
+    pytest.param(lambda x: [x], lambda x: x[0], id="list"),
+    pytest.param(lambda x: (x, 1), lambda x: x[0], id="tuple"),
+    pytest.param(lambda x: {"k": x}, lambda x: x["k"], id="dict"),
+    pytest.param(lambda x: frozenset({x}), lambda x: next(iter(x)), id="frozenset"),
+    pytest.param(lambda x: [{"k": ([x],)}], lambda x: x[0]["k"][0][0], id="mixed"),
+]
+
+
+@pytest.mark.parametrize("wrap,unwrap", NESTINGS)
+def test_deep_containers_dont_recurse(wrap, unwrap):
+    """
+    Native containers are copied on a heap-allocated stack, so their depth isn't bounded by
+    the recursion limit.
+    """
+    depth = 200_000
+    value = Link(None)
+    for _ in range(depth):
+        value = wrap(value)
+
+    with recursion_limit(100):
+        copied = copium.deepcopy(value)
+
+    for _ in range(depth):
+        assert type(copied) is type(value)
+        copied, value = unwrap(copied), unwrap(value)
+    assert type(copied) is Link
+    assert copied is not value
+
+
 def test_graceful_recursion_error():
-    value = make_nested(999999)
+    value = make_linked(999999)
     with pytest.raises(RecursionError):
         copium.deepcopy(value)  # without safeguards this can SIGSEGV
 
@@ -318,7 +830,7 @@ def test_graceful_recursion_error_with_increased_limit():
     We won't guarantee to match interpreter recursion limit, but will handle it gracefully.
     """
     too_large = 999999
-    value = make_nested(too_large)
+    value = make_linked(too_large)
     with recursion_limit(too_large), pytest.raises(RecursionError):
         copium.deepcopy(value)  # without safeguards this can SIGSEGV
 
@@ -588,6 +1100,15 @@ def test_deepcopy_detects_self_mutation(copy) -> None:
         assert not failures, f"{len(failures)}/{total_runs} runs didn't raise RuntimeError"
 
 
+def test_deepcopy_detects_list_shrinking() -> None:
+    """Stdlib just stops early; copium copies a list as of the size it started with."""
+    values: list[Any] = []
+    values.extend([[1], DeepcopyRuntimeError(values.clear), [2]])
+
+    with pytest.raises(RuntimeError, match="list changed size during iteration"):
+        copium.deepcopy(values)
+
+
 def test_cross_thread_mutation_detection(copy) -> None:
     iterator_ready = threading.Event()
     mutation_done = threading.Event()
@@ -631,3 +1152,206 @@ def test_cross_thread_mutation_detection(copy) -> None:
         correctly_handled += result["raised"]
 
     assert correctly_handled == total_attempts
+
+
+def test_reduce_plan_follows_type_and_instance_changes(copy) -> None:
+    @dataclass
+    class Plain:
+        value: Any
+
+    # warm up whatever the implementation caches per type
+    for i in range(3):
+        assert copy.deepcopy(Plain([i])) == Plain([i])
+
+    shadowed = Plain(1)
+    shadowed.__reduce_ex__ = lambda protocol: (list, ())
+    assert copy.deepcopy(shadowed) == []
+
+    Plain.__reduce_ex__ = lambda self, protocol: (str, ("reduced",))
+    assert copy.deepcopy(Plain(2)) == "reduced"
+
+    del Plain.__reduce_ex__
+    Plain.__setstate__ = lambda self, state: self.__dict__.update(state, restored=True)
+    assert copy.deepcopy(Plain(3)).restored
+
+    del Plain.__setstate__
+    cyclic = Plain(None)
+    cyclic.value = [cyclic]
+    copied = copy.deepcopy(cyclic)
+    assert copied.value[0] is copied
+    assert not hasattr(copied, "restored")
+
+
+def test_reduce_plan_of_slotted_types(copy) -> None:
+    class Message:
+        __slots__ = ("body", "headers", "reply_to", "__weakref__")
+
+    class Envelope(Message):
+        __slots__ = ("route", "__dict__")
+
+    class Traced:
+        __slots__ = ("value",)
+        assigned: ClassVar[list] = []
+
+        def __setattr__(self, name, value):
+            Traced.assigned.append(name)
+            object.__setattr__(self, name, value)
+
+    # warm up whatever the implementation caches per type
+    for _ in range(3):
+        message = Message()
+        message.body = [1]
+        message.reply_to = message
+        copied = copy.deepcopy(message)
+        assert copied.body == [1]
+        assert copied.body is not message.body
+        assert copied.reply_to is copied
+        assert not hasattr(copied, "headers")
+
+        envelope = Envelope()
+        envelope.route = ["a"]
+        envelope.extra = {"b": 2}
+        copied = copy.deepcopy(envelope)
+        assert copied.route == ["a"]
+        assert copied.__dict__ == {"extra": {"b": 2}}
+        assert not hasattr(copied, "body")
+
+        traced = Traced()
+        traced.value = 1
+        Traced.assigned.clear()
+        assert copy.deepcopy(traced).value == 1
+        assert Traced.assigned == ["value"]
+
+    Message.__setstate__ = lambda self, state: object.__setattr__(self, "body", "restored")
+    assert copy.deepcopy(message).body == "restored"
+    del Message.__setstate__
+
+    Envelope.route = property(lambda self: "property", lambda self, value: None)
+    envelope = Envelope()
+    envelope.body = 1
+    copied = copy.deepcopy(envelope)
+    assert copied.body == 1
+    assert copied.route == "property"
+
+
+def test_deepcopy_dispatch_follows_type_and_instance_changes(copy) -> None:
+    class Base:
+        __slots__ = ("__dict__",)
+
+        def __deepcopy__(self, memo):
+            return "type"
+
+    class Leaf(Base):
+        pass
+
+    class Slotted:
+        __slots__ = ("value",)
+
+        def __deepcopy__(self, memo):
+            return "slotted"
+
+    class Dynamic:
+        def __getattr__(self, name):
+            if name == "__deepcopy__":
+                return lambda memo: "getattr"
+            raise AttributeError(name)
+
+    for _ in range(3):
+        assert copy.deepcopy([Leaf(), Slotted(), Dynamic()]) == ["type", "slotted", "getattr"]
+
+    shadowed = Leaf()
+    shadowed.__deepcopy__ = lambda memo: "instance"
+    assert copy.deepcopy(shadowed) == "instance"
+
+    Base.__deepcopy__ = staticmethod(lambda memo: "static")
+    assert copy.deepcopy(Leaf()) == "static"
+
+    del Base.__deepcopy__
+    assert type(copy.deepcopy(Leaf())) is Leaf
+
+
+def test_deepcopy_dispatch_follows_instance_attributes(copy) -> None:
+    class Plain:
+        def __init__(self):
+            self.value = 1
+
+        def __deepcopy__(self, memo):
+            return "type"
+
+    assert copy.deepcopy([Plain(), Plain()]) == ["type", "type"]
+
+    inline = Plain()
+    inline.__deepcopy__ = lambda memo: "inline"
+    uninterned = Plain()
+    object.__setattr__(uninterned, "".join(["__deep", "copy__"]), lambda memo: "uninterned")
+    materialized = Plain()
+    vars(materialized)["__deepcopy__"] = lambda memo: "materialized"
+    later = Plain()
+    later.other = 2
+
+    assert copy.deepcopy([inline, uninterned, materialized, later, Plain()]) == [
+        "inline",
+        "uninterned",
+        "materialized",
+        "type",
+        "type",
+    ]
+
+
+def test_deepcopy_under_uniquely_referenced_containers_sees_full_memo(copy) -> None:
+    class Probe:
+        def __init__(self, path):
+            self.path = path
+
+        def __deepcopy__(self, memo):
+            node = root
+            for key in self.path:
+                # Every enclosing container is already memoized, however many
+                # references it has, and maps to the copy being built.
+                assert memo[id(node)] is not node
+                node = node[key]
+            return Probe(self.path)
+
+    root = [[{"k": [[Probe((0, 0, "k", 0, 0))]]}], {1: {2, 3}}]
+    shared = [1]
+    root.append([shared, (shared, [shared])])
+
+    copied = copy.deepcopy(root)
+
+    assert copied[0][0]["k"][0][0].path == (0, 0, "k", 0, 0)
+    assert copied[1] == {1: {2, 3}}
+    assert copied[2][0] is copied[2][1][0] is copied[2][1][1][0]
+    assert copied[2][0] is not shared
+
+
+def test_reductions_under_uniquely_referenced_containers_keep_identity(copy) -> None:
+    import copyreg
+
+    class Reduced:
+        def __init__(self, a):
+            self.a = a
+
+        def __reduce_ex__(self, protocol):
+            return Reduced, (None,), {"r": self.a[0]}
+
+    class Registered:
+        def __init__(self, a):
+            self.a = a
+
+    class Stated:
+        def __init__(self, a):
+            self.a = a
+
+        def __getstate__(self):
+            return {"r": self.a[0]}
+
+    copyreg.pickle(Registered, lambda obj: (Registered, (None,), {"r": obj.a[0]}))
+    try:
+        for cls in (Reduced, Registered, Stated):
+            a = [[1, 2], None]
+            a[1] = cls(a)
+            copied = copy.deepcopy(a)
+            assert copied[1].r is copied[0], cls
+            assert copied[0] is not a[0]
+    finally:
+        del copyreg.dispatch_table[Registered]
@@ -0,0 +1,293 @@
+# SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+#
+# SPDX-License-Identifier: MIT
+import copy as stdlib_copy
+import sys
+
+import pytest
+
+import copium.extra
+
+
+class Node:
+    def __init__(self, value):
+        self.value = value
+
+
+def test_compiled_plan_matches_deepcopy():
+    shared = [1, 2]
+    template = [shared, shared, {"a": (1, 2), "b": {1, 2}, "c": frozenset({3})}, bytearray(b"xy")]
+    template.append(template)
+
+    plan = copium.extra.compile(template)
+    copies = copium.extra.replicate(plan, 3)
+
+    assert len(copies) == 3
+    for copied in copies:
+        assert copied[:4] == stdlib_copy.deepcopy(template)[:4]
+        assert copied[0] is copied[1]
+        assert copied[0] is not shared
+        assert copied[4] is copied
+        assert copied[2]["a"] is template[2]["a"]
+        assert copied[3] is not template[3]
+    assert copies[0][0] is not copies[1][0]
+
+
+def test_compiled_plan_keeps_identities_across_deepcopied_objects():
+    shared = [1, 2]
+    node = Node(shared)
+    template = {"node": node, "shared": shared, "again": node}
+
+    for copied in copium.extra.replicate(copium.extra.compile(template), 2):
+        assert copied["node"] is copied["again"]
+        assert copied["node"] is not node
+        assert copied["node"].value is copied["shared"]
+
+
+def test_compiled_plan_handles_cycles_through_tuples():
+    template = ([],)
+    template[0].append(template)
+
+    for copied in copium.extra.replicate(copium.extra.compile(template), 2):
+        assert copied is not template
+        assert copied[0][0] is copied
+
+
+def test_compiled_plan_of_atomic():
+    assert copium.extra.replicate(copium.extra.compile((1, "a")), 2) == [(1, "a"), (1, "a")]
+    assert copium.extra.replicate(copium.extra.compile([]), 0) == []
+
+
+def test_compile_respects_recursion_limit():
+    nested: list = []
+    for _ in range(100_000):
+        nested = [nested]
+    with pytest.raises(RecursionError):
+        copium.extra.compile(nested)
+
+
+@pytest.mark.parametrize("n", [1, 2, 8, 64])
+def test_replicate_keeps_shared_references_and_cycles(n):
+    shared = {"k": [1, 2]}
+    template = [shared, shared, (shared,), frozenset({(1, 2)}), {3}, bytearray(b"ab")]
+    template.append(template)
+
+    copies = copium.extra.replicate(template, n)
+
+    assert len(copies) == n
+    assert len({id(copied) for copied in copies}) == n
+    expected = stdlib_copy.deepcopy(template)
+    for copied in copies:
+        assert repr(copied) == repr(expected)
+        assert copied[0] is copied[1] is copied[2][0]
+        assert copied[0] is not shared
+        assert copied[6] is copied
+
+
+@pytest.mark.parametrize("compiled", [False, True])
+def test_ireplicate_makes_copies_one_at_a_time(compiled):
+    shared = [1, 2]
+    template = {"a": shared, "b": shared, "node": Node(shared)}
+    template["self"] = template
+    obj = copium.extra.compile(template) if compiled else template
+
+    copies = copium.extra.ireplicate(obj, n=3)
+    assert copies.__length_hint__() == 3
+    first = next(copies)
+    assert copies.__length_hint__() == 2
+    rest = list(copies)
+
+    assert len(rest) == 2
+    assert list(copies) == []
+    for copied in [first, *rest]:
+        assert copied["a"] is copied["b"] is copied["node"].value
+        assert copied["a"] is not shared
+        assert copied["self"] is copied
+    assert first["a"] is not rest[0]["a"]
+
+
+def test_ireplicate_without_end():
+    copies = copium.extra.ireplicate([[1]])
+    assert copies.__length_hint__() is NotImplemented
+    taken = [next(copies) for _ in range(100)]
+    assert taken == [[[1]]] * 100
+    assert len({id(copied[0]) for copied in taken}) == 100
+    assert isinstance(copies, copium.extra.Replicator)
+    assert list(copium.extra.ireplicate((1, "a"), 2)) == [(1, "a"), (1, "a")]
+
+
+def test_ireplicate_steps_from_deepcopy_and_kept_memos():
+    class Steps:
+        def __deepcopy__(self, memo):
+            kept.append(memo)
+            if len(kept) < 3:
+                return next(copies)
+            return "inner"
+
+    kept: list = []
+    copies = copium.extra.ireplicate([Steps()], 5)
+    assert next(copies) == [[["inner"]]]
+    assert next(copies) == ["inner"]
+    assert copies.__length_hint__() == 1
+    # Each step got a memo of its own, the kept one isn't reused.
+    assert len({id(memo) for memo in kept}) == 4
+
+    with pytest.raises(ValueError, match="n must be >= 0"):
+        copium.extra.ireplicate([], -1)
+    with pytest.raises(TypeError):
+        copium.extra.ireplicate([], count=1)
+
+
+@pytest.mark.parametrize("workers", [None, 1, 4])
+@pytest.mark.parametrize("size", [10, 20_000])
+def test_parallel_deepcopy_keeps_shared_references_and_cycles(size, workers):
+    shared = {"k": [1, 2]}
+    template: list = [[i, shared, (i, shared)] for i in range(size)]
+    template.append(template)
+    tail = template[-2]
+
+    copied = copium.extra.parallel_deepcopy(template, workers=workers)
+
+    assert copied is not template
+    assert copied[-1] is copied
+    assert copied[0][1] is copied[-2][1] is copied[size // 2][2][1]
+    assert copied[0][1] is not shared
+    assert copied[-2] == tail and copied[-2] is not tail
+    assert repr(copied) == repr(stdlib_copy.deepcopy(template))
+
+
+@pytest.mark.parametrize("size", [10, 20_000])
+def test_parallel_deepcopy_of_dict_and_tuple(size):
+    node = Node([1])
+    mapping = {i: [i, node] for i in range(size)}
+    copied = copium.extra.parallel_deepcopy(mapping, workers=4)
+    assert list(copied) == list(mapping)
+    assert copied[0][1] is copied[size - 1][1] is not node
+    assert copied[0][1].value == [1]
+
+    atomic = tuple(range(size))
+    assert copium.extra.parallel_deepcopy(atomic, workers=4) is atomic
+    nested = tuple([i] for i in range(size))
+    assert copium.extra.parallel_deepcopy(nested, workers=4) == nested
+
+
+def test_parallel_deepcopy_propagates_errors():
+    class Unpicklable:
+        def __deepcopy__(self, memo):
+            raise ValueError("nope")
+
+    with pytest.raises(ValueError, match="nope"):
+        copium.extra.parallel_deepcopy([[i] for i in range(20_000)] + [Unpicklable()], workers=4)
+
+
+def test_parallel_deepcopy_rejects_bad_workers():
+    with pytest.raises(ValueError, match="workers must be >= 1"):
+        copium.extra.parallel_deepcopy([], workers=0)
+    with pytest.raises(TypeError):
+        copium.extra.parallel_deepcopy([], threads=2)
+
+
+# Dict watchers exist from 3.12 on; free-threaded builds don't use them here.
+SNAPSHOTS_SHARE = sys.version_info >= (3, 12) and getattr(sys, "_is_gil_enabled", lambda: True)()
+
+
+def test_snapshots_share_unchanged_dicts():
+    state = {
+        "users": {"a": {"age": 1, "tags": ("x", "y")}, "b": {"age": 2}},
+        "config": {"ports": [80, 443]},
+    }
+    snapshotter = copium.extra.Snapshotter(state)
+    first = snapshotter.snapshot()
+    second = snapshotter.snapshot()
+    assert first == second == state
+    assert first is not state
+
+    state["users"]["b"]["age"] = 3
+    third = snapshotter.snapshot()
+    assert third == stdlib_copy.deepcopy(state)
+    assert first["users"]["b"]["age"] == 2
+
+    # Lists can't be watched: they, and the dicts holding them, are copied every time.
+    assert third["config"]["ports"] is not second["config"]["ports"]
+    assert third["config"] is not second["config"]
+    if SNAPSHOTS_SHARE:
+        assert second["users"] is first["users"]
+        assert third["users"] is not second["users"]
+        assert third["users"]["b"] is not second["users"]["b"]
+        assert third["users"]["a"] is second["users"]["a"]
+
+
+def test_snapshots_keep_identities_and_cycles():
+    node = Node({"q": 1})
+    state = {"node": node, "value": node.value}
+    state["self"] = state
+    snapshotter = copium.extra.Snapshotter(state)
+    for _ in range(3):
+        copied = snapshotter.snapshot()
+        assert copied["self"] is copied
+        assert copied["node"] is not node
+        assert copied["node"].value is copied["value"] is not node.value
+
+
+def test_snapshot_after_failed_one_sees_the_fix():
+    class Unpicklable:
+        def __deepcopy__(self, memo):
+            raise ValueError("nope")
+
+    state = {"inner": {"bad": Unpicklable()}}
+    snapshotter = copium.extra.Snapshotter(state)
+    with pytest.raises(ValueError, match="nope"):
+        snapshotter.snapshot()
+    state["inner"]["bad"] = 1
+    assert snapshotter.snapshot() == {"inner": {"bad": 1}}
+
+
+def test_copy_into_reuses_matching_containers():
+    src = {"rows": [[1, 2], [3, 4]], "meta": {"name": "a", "ids": {1, 2}}, "tags": ["x"]}
+    dst = copium.extra.copy_into({}, src)
+    rows, meta, first_row = dst["rows"], dst["meta"], dst["rows"][0]
+
+    src["rows"].append([5, 6])
+    src["meta"]["name"] = "b"
+    src["tags"] = ("x",)
+    assert copium.extra.copy_into(dst, src) is dst
+    assert dst == stdlib_copy.deepcopy(src)
+    assert dst["rows"] is rows
+    assert dst["rows"][0] is first_row
+    assert dst["meta"] is meta
+    assert dst["meta"]["ids"] is not src["meta"]["ids"]
+    assert dst["tags"] == ("x",)
+
+    src["rows"] = [[7]]
+    del src["meta"]["name"]
+    copium.extra.copy_into(dst, src)
+    assert dst == stdlib_copy.deepcopy(src)
+    assert dst["rows"] is rows
+    assert dst["meta"] is meta
+
+
+def test_copy_into_falls_back_to_deepcopy():
+    src = [1, [2]]
+    copied = copium.extra.copy_into({}, src)
+    assert copied == src
+    assert copied[1] is not src[1]
+    assert copium.extra.copy_into(src, src) is not src
+
+
+def test_copy_into_keeps_shared_references_and_cycles():
+    shared = [1]
+    src = {"a": shared, "b": shared}
+    src["self"] = src
+    dst = {"a": [0], "b": [0], "self": None}
+    a = dst["a"]
+    copium.extra.copy_into(dst, src)
+    assert dst["a"] is dst["b"] is a
+    assert dst["self"] is dst
+
+    # A container dst held in two places is only reused for one of them.
+    shared_dst = [0]
+    dst = [shared_dst, shared_dst]
+    copium.extra.copy_into(dst, [[1], [2]])
+    assert dst == [[1], [2]]
+    assert dst[0] is shared_dst
+    assert dst[1] is not shared_dst
@@ -1,8 +1,11 @@
 """
 Memo table retention / shrink policy tests.
 
-TSS memo is reused across deepcopy() calls. After each call, the table is cleared.
-If table.size exceeded MEMO_RETAIN_MAX_SLOTS (2^17), it shrinks to 2^13 slots.
+TSS memo is reused across deepcopy() calls. After each call, the table is cleared
+and shrunk according to config memo_retention:
+  fixed    — if table.size exceeded MEMO_RETAIN_MAX_SLOTS (2^17), it shrinks to 2^13 slots.
+  adaptive — capacity for a decaying high-water mark of recent calls is kept.
+  minimal  — the table drops to its minimum size after every call.
 
 Observability challenge: capturing the memo via __deepcopy__ bumps refcount,
 which diverts cleanup_memo away from the reset() path. So we can't inspect
@@ -32,18 +35,27 @@ _PTR = struct.calcsize("P")
 
 # PyMemoObject is #[repr(C)]:
 #   PyObject      ob_refcnt  ob_type
-#   MemoTable     slots      size     used     filled
+#   MemoTable     ctrl       size     used     filled   keys   values
 #   KeepaliveVec  (Vec internals)
 #   UndoLog       (Vec internals)
 #   dict_proxy
 #
 # MemoTable fields are all pointer-sized — no padding, no reorder benefit.
 _OFF_REFCNT = 0
-_OFF_TABLE_SLOTS = 2 * _PTR
+_OFF_TABLE_CTRL = 2 * _PTR
 _OFF_TABLE_SIZE = 3 * _PTR
 _OFF_TABLE_USED = 4 * _PTR
 
 
+def _shared_lists(n):
+    """n distinct lists, each referenced twice so that every one gets a memo table entry.
+
+    Containers referenced only by their parent are copied without one.
+    """
+    lists = [[] for _ in range(n)]
+    return lists + lists
+
+
 def _usize_at(addr, offset):
     return ctypes.c_size_t.from_address(addr + offset).value
 
@@ -119,11 +131,15 @@ needs_64bit = pytest.mark.skipif(_PTR != 8, reason="64-bit layout assumed")
 
 @needs_64bit
 class TestTableRetention:
+    @pytest.fixture(autouse=True)
+    def _fixed(self):
+        copium.config.apply(memo_retention="fixed")
+
     def test_shrinks_after_exceeding_threshold(self):
         N = 200_000
 
         def setup():
-            copium.deepcopy([[] for _ in range(N)])
+            copium.deepcopy(_shared_lists(N))
 
         memo = _capture_tss_after(setup)
         table_size = _usize_at(id(memo), _OFF_TABLE_SIZE)
@@ -137,7 +153,7 @@ class TestTableRetention:
         N = 50_000  # grows table to exactly 131072 slots
 
         def setup():
-            copium.deepcopy([[] for _ in range(N)])
+            copium.deepcopy(_shared_lists(N))
 
         memo = _capture_tss_after(setup)
         table_size = _usize_at(id(memo), _OFF_TABLE_SIZE)
@@ -150,7 +166,7 @@ class TestTableRetention:
         N = 1_000
 
         def setup():
-            copium.deepcopy([[] for _ in range(N)])
+            copium.deepcopy(_shared_lists(N))
 
         memo = _capture_tss_after(setup)
         table_size = _usize_at(id(memo), _OFF_TABLE_SIZE)
@@ -162,9 +178,9 @@ class TestTableRetention:
         N = 200_000
 
         def setup():
-            copium.deepcopy([[] for _ in range(N)])
+            copium.deepcopy(_shared_lists(N))
             gc.collect()
-            copium.deepcopy([[] for _ in range(N)])
+            copium.deepcopy(_shared_lists(N))
 
         memo = _capture_tss_after(setup)
         table_size = _usize_at(id(memo), _OFF_TABLE_SIZE)
@@ -215,3 +231,56 @@ class TestTSSLifecycle:
 
         assert observed is not None
         assert observed < 10, f"stale entries from previous call: len={observed}"
+
+
+@needs_64bit
+class TestAdaptiveRetention:
+    @pytest.fixture(autouse=True)
+    def _adaptive(self):
+        copium.config.apply(memo_retention="adaptive")
+
+    def test_keeps_capacity_recent_calls_used(self):
+        N = 200_000
+
+        def setup():
+            copium.deepcopy(_shared_lists(N))
+            for _ in range(3):
+                copium.deepcopy(_shared_lists(50))
+
+        memo = _capture_tss_after(setup)
+        table_size = _usize_at(id(memo), _OFF_TABLE_SIZE)
+
+        assert table_size > MEMO_RETAIN_MAX_SLOTS, (
+            f"large copy 4 calls ago should still be retained, got table_size={table_size}"
+        )
+
+    def test_releases_capacity_after_it_stops_being_used(self):
+        N = 200_000
+
+        def setup():
+            copium.deepcopy(_shared_lists(N))
+            for _ in range(100):
+                copium.deepcopy(_shared_lists(50))
+
+        memo = _capture_tss_after(setup)
+        table_size = _usize_at(id(memo), _OFF_TABLE_SIZE)
+
+        assert table_size <= 1024, f"stale capacity retained: table_size={table_size}"
+
+
+@needs_64bit
+class TestMinimalRetention:
+    @pytest.fixture(autouse=True)
+    def _minimal(self):
+        copium.config.apply(memo_retention="minimal")
+
+    def test_shrinks_to_minimum_after_every_call(self):
+        N = 50_000
+
+        def setup():
+            copium.deepcopy(_shared_lists(N))
+
+        memo = _capture_tss_after(setup)
+        table_size = _usize_at(id(memo), _OFF_TABLE_SIZE)
+
+        assert table_size == 16
@@ -33,6 +33,7 @@ import pytest
 
 import copium
 import copium.patch
+from tools.thread_group import ThreadGroup
 
 
 class Case(NamedTuple):
@@ -531,6 +532,53 @@ SAMPLE_CASES = [
 ]
 
 
+# ═══════════════════════════════════════════════════════════
+#  THREAD SCALING
+#
+#  k threads each deep-copy the same payload once per round,
+#  released together.  Work per thread is constant, so on a
+#  free-threaded build round time should stay flat as k grows;
+#  TSS memo setup and per-container critical sections are what
+#  make it climb.  With the GIL, it shows the serialization cost.
+# ═══════════════════════════════════════════════════════════
+
+THREAD_COUNTS = (1, 2, 4, 8, 16)
+
+
+THREAD_CASES = [
+    Case("json_api_response", make_json_api_response()),
+    Case("tabular_100", make_tabular_data(100)),
+    Case("orm_graph_10u3s", make_orm_graph()),
+]
+
+
+# ═══════════════════════════════════════════════════════════
+#  RETAINED MEMORY
+#
+#  Each thread alternates one huge copy with a run of small
+#  ones, like a service that mostly copies requests and now
+#  and then a whole cache (past the fixed cap of 2^17 memo
+#  slots).  What the TSS memo keeps between calls is set by
+#  memo_retention; memory mode shows the allocations each
+#  policy costs, walltime what re-growing the memo costs.
+# ═══════════════════════════════════════════════════════════
+
+RETENTION_POLICIES = ("adaptive", "fixed", "minimal")
+RETENTION_THREADS = (1, 4)
+
+
+def alternate_small_and_huge(small, huge, small_per_huge=32):
+    copium.deepcopy(huge)
+    for _ in range(small_per_huge):
+        copium.deepcopy(small)
+
+
+RETENTION_CASE = Case(
+    "tabular_10_vs_60000",
+    (make_tabular_data(10), make_tabular_data(60000)),
+)
+
+
 # ═══════════════════════════════════════════════════════════
 #  BENCHMARKS
 # ═══════════════════════════════════════════════════════════
@@ -595,3 +643,23 @@ def stdlib_sample_data(case: Case, _python, benchmark):
 @generate_params(SAMPLE_CASES)
 def patched_stdlib_sample_data(case: Case, _python, benchmark, copium_patch_enabled):
     benchmark(stdlib_copy.deepcopy, case.obj)
+
+
+@PYTHON_VERSION
+@pytest.mark.parametrize("threads", THREAD_COUNTS)
+@generate_params(THREAD_CASES)
+def thread_scaling(case: Case, threads, _python, benchmark):
+    with ThreadGroup(threads, copium.deepcopy, case.obj) as group:
+        benchmark(group.run)
+
+
+@PYTHON_VERSION
+@pytest.mark.parametrize("threads", RETENTION_THREADS)
+@pytest.mark.parametrize("policy", RETENTION_POLICIES)
+def retained_memory(policy, threads, _python, benchmark):
+    copium.config.apply(memo_retention=policy)
+    try:
+        with ThreadGroup(threads, alternate_small_and_huge, *RETENTION_CASE.obj) as group:
+            benchmark(group.run)
+    finally:
+        copium.config.apply()
@@ -0,0 +1,72 @@
+"""
+copium.stats() route counters. Only built in on request, so most of these skip on a default build.
+"""
+
+from __future__ import annotations
+
+import threading
+
+import pytest
+
+import copium
+
+
+def _stats_or_skip() -> dict:
+    try:
+        return copium.stats(reset=True)
+    except RuntimeError:
+        pytest.skip("copium built without stats")
+
+
+def test_stats_compiled_out_raises():
+    try:
+        copium.stats()
+    except RuntimeError as e:
+        assert "stats" in str(e)
+
+
+def test_stats_rejects_positional():
+    with pytest.raises(TypeError):
+        copium.stats(True)
+
+
+class Reduced:
+    def __init__(self):
+        self.value = [1]
+
+
+def test_stats_counts_routes():
+    _stats_or_skip()
+
+    copium.deepcopy([(1, [2]), {"a": {3}}, Reduced(), None])
+    stats = copium.stats()
+
+    assert stats["list"] >= 3
+    assert stats["tuple"] == 1
+    assert stats["dict"] >= 2
+    assert stats["set"] == 1
+    assert stats["reduce"] == 1
+    assert stats["prememo_atomic"] >= 3
+    assert stats["reduce_types"] == {Reduced: 1}
+
+
+def test_stats_reset():
+    _stats_or_skip()
+
+    copium.deepcopy([[]])
+    assert copium.stats(reset=True)["list"] == 2
+    after = copium.stats()
+    assert after["list"] == 0
+    assert after["reduce_types"] == {}
+
+
+def test_stats_sums_threads():
+    _stats_or_skip()
+
+    threads = [threading.Thread(target=copium.deepcopy, args=([[], []],)) for _ in range(4)]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+
+    assert copium.stats()["list"] == 12
@@ -0,0 +1,442 @@
+# SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+#
+# SPDX-License-Identifier: MIT
+"""
+The C extension (ccopium) against the Rust one (copium), head to head, with hardware counters.
+
+    python tools/compare_backends.py --backend c:ccopium=.task/bench-c/bin/python \\
+        --backend rust=.task/bench-rust/bin/python -o backends.json
+    python tools/compare_backends.py ... -k sample_data --baseline backends.json
+
+Each backend is given as an interpreter it is installed in (task bench:backends sets those up),
+along with the module it installs as: ccopium for the C one, copium (the default) for the Rust
+one. Every one of them copies the tests/test_performance.py cases and the run_benchmark.py
+payloads in a worker process pinned to one CPU, with that module standing in for copium, and
+the workers take turns, --rounds times. Per copy, a worker records the wall time, the pymalloc
+blocks the copy leaves allocated, and, where perf_event_open(2) is allowed, instructions,
+cycles, L1d and last level cache read misses and branch misses, for user space only. The table
+puts them per node: every reference the copy walks, the way deepcopy's memo sees them.
+
+The deltas compare every backend to the first one, or to its own numbers in --baseline, so
+that a regression shows as instructions per node rather than as wall time within the noise.
+"""
+
+import argparse
+import copyreg
+import ctypes
+import errno
+import fcntl
+import gc
+import importlib.util
+import json
+import math
+import os
+import platform
+import statistics
+import struct
+import subprocess
+import sys
+import time
+import types
+from datetime import datetime
+from pathlib import Path
+
+ROOT = Path(__file__).resolve().parent.parent
+
+# ── perf_event_open ─────────────────────────────────────────
+
+PERF_TYPE_HARDWARE = 0
+PERF_TYPE_HW_CACHE = 3
+PERF_COUNT_HW_CACHE_L1D = 0
+PERF_COUNT_HW_CACHE_LL = 2
+PERF_COUNT_HW_CACHE_MISS = 1 << 16  # with PERF_COUNT_HW_CACHE_OP_READ (0) in between
+
+COUNTERS = {
+    "instructions": (PERF_TYPE_HARDWARE, 1),
+    "cycles": (PERF_TYPE_HARDWARE, 0),
+    "l1d_misses": (PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_MISS),
+    "llc_misses": (PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | PERF_COUNT_HW_CACHE_MISS),
+    "branch_misses": (PERF_TYPE_HARDWARE, 5),
+}
+
+PERF_ATTR_SIZE = 128
+PERF_FORMAT_TOTAL_TIME_ENABLED = 1 << 0
+PERF_FORMAT_TOTAL_TIME_RUNNING = 1 << 1
+PERF_ATTR_DISABLED = 1 << 0
+PERF_ATTR_EXCLUDE_KERNEL = 1 << 5
+PERF_ATTR_EXCLUDE_HV = 1 << 6
+PERF_EVENT_IOC_ENABLE = 0x2400
+PERF_EVENT_IOC_DISABLE = 0x2401
+PERF_EVENT_IOC_RESET = 0x2403
+
+SYS_PERF_EVENT_OPEN = {
+    "x86_64": 298,
+    "aarch64": 241,
+    "arm64": 241,
+    "riscv64": 241,
+    "ppc64le": 319,
+    "s390x": 331,
+}
+
+
+class Counters:
+    """The COUNTERS that could be opened for this thread, each on its own so that the PMU can
+    multiplex what doesn't fit; their values are scaled by the time they actually ran."""
+
+    def __init__(self):
+        self.fds = {}
+        self.unavailable = None
+        number = SYS_PERF_EVENT_OPEN.get(platform.machine())
+        if sys.platform != "linux" or number is None:
+            self.unavailable = f"no perf_event_open on {sys.platform}/{platform.machine()}"
+            return
+        libc = ctypes.CDLL(None, use_errno=True)
+        libc.syscall.restype = ctypes.c_long
+        for name, (kind, config) in COUNTERS.items():
+            attr = struct.pack(
+                "IIQQQQQ",
+                kind,
+                PERF_ATTR_SIZE,
+                config,
+                0,
+                0,
+                PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING,
+                PERF_ATTR_DISABLED | PERF_ATTR_EXCLUDE_KERNEL | PERF_ATTR_EXCLUDE_HV,
+            ).ljust(PERF_ATTR_SIZE, b"\0")
+            buffer = ctypes.create_string_buffer(attr, PERF_ATTR_SIZE)
+            fd = libc.syscall(number, buffer, 0, -1, -1, 0)
+            if fd >= 0:
+                self.fds[name] = fd
+            elif name == "instructions":
+                code = ctypes.get_errno()
+                self.unavailable = f"perf_event_open: {os.strerror(code)}"
+                if code in (errno.EACCES, errno.EPERM):
+                    self.unavailable += " (see /proc/sys/kernel/perf_event_paranoid)"
+                self.close()
+                return
+
+    def start(self):
+        for fd in self.fds.values():
+            fcntl.ioctl(fd, PERF_EVENT_IOC_RESET, 0)
+            fcntl.ioctl(fd, PERF_EVENT_IOC_ENABLE, 0)
+
+    def stop(self):
+        for fd in self.fds.values():
+            fcntl.ioctl(fd, PERF_EVENT_IOC_DISABLE, 0)
+        values = {}
+        for name, fd in self.fds.items():
+            value, enabled, running = struct.unpack("QQQ", os.read(fd, 24))
+            if running:
+                values[name] = value * enabled / running
+        return values
+
+    def close(self):
+        for fd in self.fds.values():
+            os.close(fd)
+        self.fds = {}
+
+
+# ── Cases ───────────────────────────────────────────────────
+
+BENCHMARK_GROUPS = ("memo", "container", "depth", "atomic", "generic", "edge_cases", "sample_data")
+
+
+def load_cases(module):
+    """(group/name, object) for every case of the benchmarks in test_performance.py, read back
+    from their parametrize marks, and for run_benchmark.py's two payloads. The module imports
+    copium; it gets the backend's module instead."""
+    sys.modules["copium"] = module
+    sys.modules["copium.patch"] = module.patch
+    sys.path.insert(0, str(ROOT))
+    sys.path.insert(0, str(ROOT / "tools"))
+    spec = importlib.util.spec_from_file_location(
+        "test_performance", ROOT / "tests" / "test_performance.py"
+    )
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+
+    cases = []
+    for group in BENCHMARK_GROUPS:
+        for mark in getattr(module, group).pytestmark:
+            if mark.name == "parametrize" and mark.args[0] == "case":
+                cases.extend((f"{group}/{param.id}", param.values[0].obj) for param in mark.args[1])
+
+    from run_benchmark import CacheEntry
+    from run_benchmark import User
+    from run_benchmark import get_data
+
+    cases.append(
+        (
+            "run_benchmark/mixed",
+            get_data(lambda: datetime.fromtimestamp(123456789), User, CacheEntry),  # noqa: DTZ006
+        )
+    )
+    cases.append(("run_benchmark/builtin", get_data(lambda: 123456789, dict, lambda *a: tuple(a))))
+    return cases
+
+
+ATOMIC_TYPES = (
+    str,
+    bytes,
+    int,
+    float,
+    complex,
+    bool,
+    type(None),
+    type,
+    range,
+    types.FunctionType,
+    types.BuiltinFunctionType,
+)
+
+
+def count_nodes(obj):
+    """References deepcopy walks from obj: every item, key, attribute and slot value reached,
+    counted again when reached again, but looked into only once."""
+    seen = set()
+    stack = [obj]
+    nodes = 0
+    while stack:
+        current = stack.pop()
+        nodes += 1
+        if isinstance(current, ATOMIC_TYPES) or id(current) in seen:
+            continue
+        seen.add(id(current))
+        if isinstance(current, dict):
+            stack.extend(current.keys())
+            stack.extend(current.values())
+        elif isinstance(current, (list, tuple, set, frozenset)):
+            stack.extend(current)
+        stack.extend(getattr(current, "__dict__", {}).values())
+        for name in copyreg._slotnames(type(current)):
+            if hasattr(current, name):
+                stack.append(getattr(current, name))
+    return nodes
+
+
+# ── Worker ──────────────────────────────────────────────────
+
+
+def calibrate(deepcopy, obj, min_time):
+    """Copies a timed run makes to last about min_time."""
+    loops = 1
+    while True:
+        t0 = time.perf_counter()
+        for _ in range(loops):
+            deepcopy(obj)
+        elapsed = time.perf_counter() - t0
+        if elapsed >= min_time / 10:
+            return max(1, math.ceil(loops * min_time / elapsed))
+        loops *= 2
+
+
+def measure(deepcopy, obj, counters, repeat, min_time):
+    deepcopy(obj)
+    loops = calibrate(deepcopy, obj, min_time)
+
+    times = []
+    samples = {}
+    for _ in range(repeat):
+        counters.start()
+        t0 = time.perf_counter_ns()
+        for _ in range(loops):
+            deepcopy(obj)
+        elapsed = time.perf_counter_ns() - t0
+        values = counters.stop()
+        times.append(elapsed / loops)
+        for name, value in values.items():
+            samples.setdefault(name, []).append(value / loops)
+
+    before = sys.getallocatedblocks()
+    kept = deepcopy(obj)
+    blocks = sys.getallocatedblocks() - before
+    del kept
+
+    result = {"ns": min(times), "blocks": blocks}
+    result.update({name: statistics.median(values) for name, values in samples.items()})
+    return result
+
+
+def run_worker(args):
+    if args.cpu is not None and hasattr(os, "sched_setaffinity"):
+        os.sched_setaffinity(0, {args.cpu})
+    module = importlib.import_module(args.module)
+    # A copy left in the working directory, or one without a file at all (a namespace package
+    # like the ccopium source directory), isn't the backend being reported.
+    origin = getattr(module, "__file__", None)
+    prefix = Path(sys.prefix).resolve()
+    if origin is None or not Path(origin).resolve().is_relative_to(prefix):
+        sys.exit(f"{args.module} was imported from {origin}, not from the environment at {prefix}")
+
+    counters = Counters()
+    results = {}
+    gc.disable()
+    try:
+        for name, obj in load_cases(module):
+            if args.k and not any(pattern in name for pattern in args.k):
+                continue
+            metrics = measure(module.deepcopy, obj, counters, args.repeat, args.min_time)
+            metrics["nodes"] = count_nodes(obj)
+            results[name] = metrics
+    finally:
+        gc.enable()
+        counters.close()
+    meta = {
+        "module": origin,
+        "python": sys.version.split()[0],
+        "gil": getattr(sys, "_is_gil_enabled", lambda: True)(),
+        "counters": counters.unavailable or "user space",
+    }
+    json.dump({"meta": meta, "results": results}, sys.stdout)
+
+
+# ── Driver ──────────────────────────────────────────────────
+
+
+def default_cpu():
+    if not hasattr(os, "sched_getaffinity"):
+        return None
+    # The last one: the first tends to take most of the interrupts.
+    return max(os.sched_getaffinity(0))
+
+
+def median_of_rounds(rounds):
+    merged = {}
+    for case in rounds[0]:
+        runs = [results[case] for results in rounds if case in results]
+        merged[case] = {
+            name: min(run[name] for run in runs)
+            if name == "ns"
+            else statistics.median(run[name] for run in runs if name in run)
+            for name in runs[0]
+        }
+    return merged
+
+
+COLUMNS = (
+    ("ns/copy", lambda m: m["ns"], "{:>10,.0f}"),
+    ("ns/node", lambda m: m["ns"] / m["nodes"], "{:>8.2f}"),
+    ("ins/node", lambda m: m.get("instructions", math.nan) / m["nodes"], "{:>9.1f}"),
+    ("IPC", lambda m: m.get("instructions", math.nan) / m.get("cycles", math.nan), "{:>5.2f}"),
+    ("L1d/node", lambda m: m.get("l1d_misses", math.nan) / m["nodes"], "{:>8.3f}"),
+    ("LLC/node", lambda m: m.get("llc_misses", math.nan) / m["nodes"], "{:>8.3f}"),
+    ("br/node", lambda m: m.get("branch_misses", math.nan) / m["nodes"], "{:>8.3f}"),
+    ("blocks", lambda m: m["blocks"], "{:>8,}"),
+)
+
+
+def cell(fmt, value):
+    if isinstance(value, float) and math.isnan(value):
+        return f"{'-':>{len(fmt.format(0))}}"
+    return fmt.format(value)
+
+
+def delta(value, reference):
+    if math.isnan(value) or math.isnan(reference) or not reference:
+        return f"{'':>8}"
+    return f"{(value / reference - 1) * 100:>+7.1f}%"
+
+
+def print_table(results, baseline):
+    backends = list(results)
+    cases = [case for case in results[backends[0]] if all(case in results[b] for b in backends)]
+    width = max(len(case) for case in cases)
+    header = f"{'case':<{width}} {'nodes':>8} {'backend':<8} "
+    header += " ".join(f"{title:>{len(fmt.format(0))}}" for title, _, fmt in COLUMNS)
+    print(header + f" {'Δtime':>8} {'Δins':>8}")
+
+    ratios = {backend: [] for backend in backends}
+    for case in cases:
+        for i, backend in enumerate(backends):
+            metrics = results[backend][case]
+            reference = None
+            if baseline is not None:
+                reference = baseline.get(backend, {}).get(case)
+            elif i > 0:
+                reference = results[backends[0]][case]
+            line = f"{case if i == 0 else '':<{width}} "
+            line += f"{metrics['nodes'] if i == 0 else '':>8} {backend:<8} "
+            line += " ".join(cell(fmt, get(metrics)) for _, get, fmt in COLUMNS)
+            if reference:
+                ratios[backend].append(metrics["ns"] / reference["ns"])
+                instructions = metrics.get("instructions", math.nan)
+                line += f" {delta(metrics['ns'], reference['ns'])}"
+                line += f" {delta(instructions, reference.get('instructions', math.nan))}"
+            print(line)
+
+    against = "its baseline" if baseline is not None else backends[0]
+    for backend, values in ratios.items():
+        if values:
+            mean = math.exp(statistics.fmean(math.log(value) for value in values))
+            cases = len(values)
+            print(f"{backend}: geometric mean time {mean:.3f}x of {against} over {cases} cases")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0].strip())
+    parser.add_argument(
+        "--backend",
+        action="append",
+        default=[],
+        metavar="NAME[:MODULE]=PYTHON",
+        help="an interpreter one backend is installed in, and the module it installs as "
+        "(copium by default); the first is the reference",
+    )
+    parser.add_argument("--module", default="copium", help=argparse.SUPPRESS)
+    parser.add_argument("-k", action="append", help="only cases whose name contains this")
+    parser.add_argument("--cpu", type=int, default=default_cpu(), help="CPU to pin workers to")
+    parser.add_argument("--rounds", type=int, default=3, help="worker runs per backend")
+    parser.add_argument("--repeat", type=int, default=5, help="timed runs per case and worker")
+    parser.add_argument("--min-time", type=float, default=0.02, help="seconds per timed run")
+    parser.add_argument("-o", "--output", type=Path, help="write the results as JSON")
+    parser.add_argument("--baseline", type=Path, help="JSON from an earlier -o to compare to")
+    parser.add_argument("--worker", action="store_true", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.worker:
+        run_worker(args)
+        return
+    if not args.backend:
+        parser.error("at least one --backend NAME[:MODULE]=PYTHON is required")
+
+    backends = {}
+    for spec in args.backend:
+        name, _, python = spec.partition("=")
+        name, _, module = name.partition(":")
+        if not python:
+            parser.error(f"--backend {spec}: expected NAME[:MODULE]=PYTHON")
+        backends[name] = (module or "copium", python)
+    forwarded = ["--repeat", str(args.repeat), "--min-time", str(args.min_time)]
+    if args.cpu is not None:
+        forwarded += ["--cpu", str(args.cpu)]
+    for pattern in args.k or ():
+        forwarded += ["-k", pattern]
+
+    rounds = {name: [] for name in backends}
+    meta = {}
+    for _ in range(args.rounds):
+        for name, (module, python) in backends.items():
+            worker = [python, str(Path(__file__).resolve()), "--worker", "--module", module]
+            process = subprocess.run([*worker, *forwarded], stdout=subprocess.PIPE, text=True)
+            if process.returncode:
+                sys.exit(f"{name}: the worker failed with exit status {process.returncode}")
+            report = json.loads(process.stdout)
+            meta[name] = report["meta"]
+            rounds[name].append(report["results"])
+    results = {name: median_of_rounds(runs) for name, runs in rounds.items()}
+
+    cpu = "unpinned" if args.cpu is None else f"CPU {args.cpu}"
+    for name, info in meta.items():
+        gil = "" if info["gil"] else ", free-threaded"
+        python = f"Python {info['python']}{gil}"
+        print(f"{name}: {info['module']} ({python}), counters: {info['counters']}")
+    print(f"{args.rounds} rounds of {args.repeat} runs, {cpu}\n")
+
+    baseline = json.loads(args.baseline.read_text())["results"] if args.baseline else None
+    print_table(results, baseline)
+    if args.output:
+        args.output.write_text(json.dumps({"meta": meta, "results": results}, indent=2))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,136 @@
+# SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+#
+# SPDX-License-Identifier: MIT
+"""
+deepcopy under concurrent threads: throughput per thread count, and the memory a thread's
+reusable memo keeps after alternating small and huge copies.
+
+    python tools/run_threaded_benchmark.py -o threads.json
+    python tools/run_threaded_benchmark.py rss
+
+Like run_benchmark.py, this measures stdlib copy unless COPIUM_PATCH_ENABLE=1 is set. Run it
+with a free-threaded interpreter (python3.14t) for the no-GIL numbers; the GIL state is
+recorded in the metadata and printed with the results.
+"""
+
+import argparse
+import copy
+import gc
+import json
+import os
+import subprocess
+import sys
+from datetime import datetime
+
+import pyperf
+
+from run_benchmark import CacheEntry
+from run_benchmark import User
+from run_benchmark import get_data
+from thread_group import ThreadGroup
+
+THREAD_COUNTS = (1, 2, 4, 8, 16)
+RETENTION_POLICIES = ("adaptive", "fixed", "minimal")
+
+GIL = "gil" if getattr(sys, "_is_gil_enabled", lambda: True)() else "free-threaded"
+IMPLEMENTATION = "copium" if os.getenv("COPIUM_PATCH_ENABLE") else "copy"
+
+
+def benchmark_threads(loops, k):
+    """One round is every one of k threads copying the mixed payload once."""
+    value = get_data(lambda: datetime.fromtimestamp(123456789), User, CacheEntry)
+    with ThreadGroup(k, copy.deepcopy, value) as group:
+        t0 = pyperf.perf_counter()
+        for _ in range(loops):
+            group.run()
+        return pyperf.perf_counter() - t0
+
+
+def run_throughput():
+    runner = pyperf.Runner()
+    runner.metadata["implementation"] = IMPLEMENTATION
+    runner.metadata["gil"] = GIL
+    results = {}
+    for k in THREAD_COUNTS:
+        results[k] = runner.bench_time_func(f"threads-{k}", benchmark_threads, k)
+
+    if runner.args.worker or any(bench is None for bench in results.values()):
+        return
+    print(f"\n{IMPLEMENTATION}, {GIL}")
+    print(f"{'threads':>8} {'ops/sec':>12} {'per thread':>12} {'scaling':>8}")
+    single = None
+    for k, bench in results.items():
+        ops = k / bench.mean()
+        single = single or ops
+        print(f"{k:>8} {ops:>12,.0f} {ops / k:>12,.0f} {ops / single:>7.2f}x")
+
+
+def current_rss():
+    try:
+        with open("/proc/self/statm") as statm:
+            return int(statm.read().split()[1]) * os.sysconf("SC_PAGE_SIZE")
+    except OSError:
+        # Peak rather than current, but monotonic enough to show what a policy keeps.
+        import resource
+
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss
+        return peak if sys.platform == "darwin" else peak * 1024
+
+
+def alternate_small_and_huge(small, huge, small_per_huge=32):
+    copy.deepcopy(huge)
+    for _ in range(small_per_huge):
+        copy.deepcopy(small)
+
+
+def measure_retained(policy, k, rounds):
+    """RSS that k threads still hold after `rounds` of alternating copies, in bytes."""
+    if policy != "-":
+        import copium
+
+        copium.config.apply(memo_retention=policy)
+    small = [{"id": i, "tags": [f"t{i}"]} for i in range(10)]
+    huge = [{"id": i, "tags": [f"t{i}"]} for i in range(60000)]
+    with ThreadGroup(k, alternate_small_and_huge, small, huge) as group:
+        gc.collect()
+        baseline = current_rss()
+        for _ in range(rounds):
+            group.run()
+        gc.collect()
+        return current_rss() - baseline
+
+
+def run_rss(argv):
+    parser = argparse.ArgumentParser(prog="run_threaded_benchmark.py rss")
+    parser.add_argument("--rounds", type=int, default=5)
+    parser.add_argument("--worker", nargs=2, metavar=("POLICY", "THREADS"), help=argparse.SUPPRESS)
+    args = parser.parse_args(argv)
+
+    if args.worker:
+        policy, k = args.worker
+        print(json.dumps(measure_retained(policy, int(k), args.rounds)))
+        return
+
+    policies = RETENTION_POLICIES if IMPLEMENTATION == "copium" else ("-",)
+    print(f"{IMPLEMENTATION}, {GIL}: RSS retained after {args.rounds} rounds, per thread")
+    print(f"{'policy':>10} " + " ".join(f"{f'{k} threads':>13}" for k in THREAD_COUNTS))
+    for policy in policies:
+        row = []
+        for k in THREAD_COUNTS:
+            # A fresh process each, so that one measurement doesn't inherit another's heap.
+            command = [sys.executable, __file__, "rss", "--rounds", str(args.rounds)]
+            output = subprocess.run(
+                [*command, "--worker", policy, str(k)],
+                check=True,
+                capture_output=True,
+                text=True,
+            ).stdout
+            row.append(json.loads(output) / k / 1024)
+        print(f"{policy:>10} " + " ".join(f"{kib:>9,.0f} KiB" for kib in row))
+
+
+if __name__ == "__main__":
+    if sys.argv[1:2] == ["rss"]:
+        run_rss(sys.argv[2:])
+    else:
+        run_throughput()
@@ -0,0 +1,52 @@
+# SPDX-FileCopyrightText: 2025-present Arseny Boykov (Bobronium) <hi@bobronium.me>
+#
+# SPDX-License-Identifier: MIT
+"""The thread pool behind the thread scaling benchmarks of test_performance.py and
+run_threaded_benchmark.py."""
+
+import threading
+
+
+class ThreadGroup:
+    """k threads parked on a barrier; each run() has every one of them call fn(*args) once.
+
+    An exception fn raises in a thread is raised again by run(), once every thread is done.
+    """
+
+    def __init__(self, k, fn, *args):
+        self.fn = fn
+        self.args = args
+        self.errors = []
+        self.start = threading.Barrier(k + 1)
+        self.done = threading.Barrier(k + 1)
+        self.threads = [threading.Thread(target=self._work, daemon=True) for _ in range(k)]
+        for thread in self.threads:
+            thread.start()
+
+    def _work(self):
+        while True:
+            self.start.wait()
+            if self.fn is None:
+                return
+            try:
+                self.fn(*self.args)
+            except BaseException as e:
+                self.errors.append(e)
+            self.done.wait()
+
+    def run(self):
+        self.start.wait()
+        self.done.wait()
+        if self.errors:
+            error = self.errors[0]
+            self.errors.clear()
+            raise error
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *exc_info):
+        self.fn = None
+        self.start.wait()
+        for thread in self.threads:
+            thread.join()
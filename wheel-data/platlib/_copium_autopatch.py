@@ -0,0 +1,63 @@
+"""
+Patches copy.deepcopy with copium's once copy is first imported, see copium_patch.pth.
+
+Interpreters that never import copy never load copium either: importing this module only adds
+a finder to sys.meta_path. The finder wraps the loaders of copy and copium, and whichever of
+the two finishes loading last applies the patch (copium imports copy while it loads).
+
+The C build ships this file as _ccopium_autopatch.py, the package it patches with comes
+from the module's name.
+"""
+
+import sys
+from _thread import get_ident
+
+PACKAGE = __name__.removeprefix("_").removesuffix("_autopatch")
+
+# Threads looking up a spec through the other finders, which skip this one.
+_finding = set()
+
+
+def _patch() -> None:
+    try:
+        sys.meta_path.remove(_Autopatch)
+    except ValueError:
+        pass  # another thread patched first, or the finder was never installed
+    __import__(PACKAGE + ".patch").patch.enable()
+
+
+class _Autopatch:
+    @classmethod
+    def find_spec(cls, name, path=None, target=None):
+        if name not in ("copy", PACKAGE):
+            return None
+        thread = get_ident()
+        if thread in _finding:
+            return None
+        from importlib.util import find_spec
+
+        _finding.add(thread)
+        try:
+            spec = find_spec(name)
+        finally:
+            _finding.discard(thread)
+        if spec is None or spec.loader is None:
+            return spec
+
+        exec_module = spec.loader.exec_module
+
+        def exec_and_patch(module):
+            exec_module(module)
+            if name == "copy" and PACKAGE in sys.modules:
+                return  # copium is loading copy itself, and patches once it's done
+            _patch()
+
+        spec.loader.exec_module = exec_and_patch
+        return spec
+
+
+def install() -> None:
+    if "copy" in sys.modules:
+        _patch()
+    elif _Autopatch not in sys.meta_path:
+        sys.meta_path.insert(0, _Autopatch)